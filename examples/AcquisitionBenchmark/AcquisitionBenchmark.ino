@@ -0,0 +1,166 @@
+/*!
+ * @file AcquisitionBenchmark.ino
+ * @brief Continuous ADC acquisition benchmark for MicroSafari ESP32 Library
+ * 
+ * This example demonstrates how to:
+ * - Measure the CPU cost of polling analogRead
+ * - Run the decimation pipeline from a synthetic signal source
+ * - Show the noise reduction of different decimation factors
+ * - Sample two pins in continuous DMA mode and report the CPU share
+ * 
+ * Hardware Requirements:
+ * - ESP32 development board (arduino-esp32 3.x for the DMA run)
+ * - Optional analog inputs on GPIO 34 and 35
+ * 
+ * No WiFi connection is needed for this benchmark.
+ * 
+ * @version 1.0.0
+ * @date 2025-08-22
+ * @author MicroSafari Team
+ */
+
+#include <MicroSafari.h>
+
+// Benchmark parameters
+const uint32_t POLL_SAMPLES = 5000;          // analogRead calls timed
+const uint32_t PIPELINE_SAMPLES = 200000;    // Synthetic samples per decimation run
+const uint32_t NOISE_OUTPUTS = 200;          // Outputs used for the noise estimate
+const uint32_t DMA_SAMPLE_RATE = 20000;      // Conversions per second over both pins
+const unsigned long DMA_RUN_MS = 5000;       // Duration of the DMA run
+
+const uint8_t PIN_A = 34;
+const uint8_t PIN_B = 35;
+
+/**
+ * @brief Time analogRead polling
+ */
+void benchmarkPolling() {
+    unsigned long started = micros();
+    uint32_t sum = 0;
+    for (uint32_t i = 0; i < POLL_SAMPLES; i++) {
+        sum += analogRead(PIN_A);
+    }
+    unsigned long elapsed = micros() - started;
+    
+    Serial.printf("analogRead polling      %6.1f us/sample  %8.0f samples/s  (mean %lu)\n",
+                  elapsed / (float)POLL_SAMPLES,
+                  POLL_SAMPLES * 1000000.0f / elapsed,
+                  (unsigned long)(sum / POLL_SAMPLES));
+}
+
+/**
+ * @brief Time the pipeline with a free-running synthetic source
+ */
+void benchmarkPipeline(uint32_t decimation) {
+    MicroSafariSyntheticSource source;
+    MicroSafariAcquisition acquisition;
+    
+    source.setSignal(0, 2048, 400, 5, 100);
+    source.setSignal(1, 1024, 0, 0, 100);
+    source.setFreeRunning(true);
+    acquisition.addChannel(PIN_A, "a", decimation);
+    acquisition.addChannel(PIN_B, "b", decimation);
+    acquisition.begin(&source, DMA_SAMPLE_RATE);
+    
+    while (acquisition.getStats().samples < PIPELINE_SAMPLES) {
+        acquisition.process();
+    }
+    
+    const MicroSafariAcquisitionStats& stats = acquisition.getStats();
+    Serial.printf("pipeline decimation %-4lu %6.3f us/sample  %8.0f samples/s  %lu outputs\n",
+                  (unsigned long)decimation,
+                  stats.busyMicros / (float)stats.samples,
+                  stats.samples * 1000000.0f / stats.busyMicros,
+                  (unsigned long)stats.outputs);
+}
+
+/**
+ * @brief Standard deviation of decimated outputs of a noisy DC signal
+ */
+void measureNoise(uint32_t decimation) {
+    MicroSafariSyntheticSource source;
+    MicroSafariAcquisition acquisition;
+    
+    source.setSignal(0, 2048, 0, 0, 200); // ±200 counts uniform noise
+    source.setFreeRunning(true);
+    acquisition.addChannel(PIN_A, "a", decimation);
+    acquisition.begin(&source, DMA_SAMPLE_RATE);
+    
+    double sum = 0;
+    double sumSquares = 0;
+    for (uint32_t i = 0; i < NOISE_OUTPUTS; i++) {
+        acquisition.process(decimation); // Exactly one output
+        float value;
+        acquisition.getValue("a", value);
+        sum += value;
+        sumSquares += (double)value * value;
+    }
+    
+    double mean = sum / NOISE_OUTPUTS;
+    double deviation = sqrt(max(0.0, sumSquares / NOISE_OUTPUTS - mean * mean));
+    Serial.printf("noise decimation %-4lu    mean %7.1f  stddev %6.2f counts\n",
+                  (unsigned long)decimation, mean, deviation);
+}
+
+/**
+ * @brief Sample two pins in continuous DMA mode
+ */
+void benchmarkDma() {
+    MicroSafariDmaAdcSource source(16);
+    MicroSafariAcquisition acquisition;
+    
+    acquisition.addChannel(PIN_A, "adc_a", 64);
+    acquisition.addChannel(PIN_B, "adc_b", 64);
+    
+    if (!acquisition.begin(&source, DMA_SAMPLE_RATE)) {
+        Serial.println("DMA ADC                 not available (needs arduino-esp32 3.x)");
+        return;
+    }
+    
+    unsigned long started = millis();
+    while (millis() - started < DMA_RUN_MS) {
+        acquisition.process();
+        delay(10); // Leave the CPU to other work, like a real loop()
+    }
+    acquisition.end();
+    
+    const MicroSafariAcquisitionStats& stats = acquisition.getStats();
+    float busyShare = stats.busyMicros / (DMA_RUN_MS * 10.0f);
+    float a = 0;
+    float b = 0;
+    acquisition.getValue("adc_a", a);
+    acquisition.getValue("adc_b", b);
+    
+    Serial.printf("DMA ADC                 %lu samples  %lu outputs  CPU %.2f%%  a=%.0f b=%.0f\n",
+                  (unsigned long)stats.samples,
+                  (unsigned long)stats.outputs,
+                  busyShare, a, b);
+}
+
+void setup() {
+    Serial.begin(115200);
+    while (!Serial) delay(10);
+    
+    Serial.println();
+    Serial.println("=======================================");
+    Serial.println("MicroSafari Acquisition Benchmark");
+    Serial.println("=======================================");
+    
+    benchmarkPolling();
+    
+    const uint32_t decimations[] = { 1, 16, 64 };
+    for (uint32_t decimation : decimations) {
+        benchmarkPipeline(decimation);
+    }
+    for (uint32_t decimation : decimations) {
+        measureNoise(decimation);
+    }
+    
+    benchmarkDma();
+    
+    Serial.println("Benchmark complete");
+}
+
+void loop() {
+    delay(1000);
+}
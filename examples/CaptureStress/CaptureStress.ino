@@ -0,0 +1,155 @@
+/*!
+ * @file CaptureStress.ino
+ * @brief ISR sample capture stress test for MicroSafari ESP32 Library
+ * 
+ * This example demonstrates how to:
+ * - Push samples from a hardware timer interrupt into the lock-free ring
+ * - Drain the ring from loop() while the consumer stalls like a network send
+ * - Check every sample by sequence number to prove there is no loss
+ * - Find the highest rate the ring absorbs for a given consumer stall
+ * 
+ * Hardware Requirements:
+ * - ESP32 development board
+ * 
+ * Each run produces sequence numbers at a fixed rate for a few seconds.
+ * The consumer drains the ring but blocks for STALL_MS every
+ * STALL_INTERVAL_MS. A run passes when every sequence number arrives,
+ * in order, and nothing was dropped. Without stalls the ring keeps up
+ * with far higher rates; the stall decides how large the ring must be
+ * (rate x stall < MICROSAFARI_CAPTURE_RING_SIZE).
+ * 
+ * No WiFi connection is needed for this test.
+ * 
+ * @version 1.0.0
+ * @date 2025-08-22
+ * @author MicroSafari Team
+ */
+
+#include <MicroSafari.h>
+
+// Test parameters
+const uint32_t RATES[] = { 1000, 5000, 10000, 20000, 40000 }; // Samples per second
+const unsigned long RUN_MS = 5000;              // Duration of each run
+const unsigned long STALL_MS = 10;              // Simulated blocking send
+const unsigned long STALL_INTERVAL_MS = 500;    // Time between stalls
+
+const size_t RUN_COUNT = sizeof(RATES) / sizeof(RATES[0]);
+
+// One ring per run, so statistics start from zero
+MicroSafariCaptureRing rings[RUN_COUNT];
+MicroSafariCaptureRing* volatile activeRing = nullptr;
+volatile int32_t sequence = 0;
+hw_timer_t* timer = nullptr;
+
+/**
+ * @brief Timer interrupt: push the next sequence number
+ */
+void IRAM_ATTR onTimer() {
+    MicroSafariCaptureRing* ring = activeRing;
+    if (ring != nullptr) {
+        ring->push(0, sequence);
+        sequence = sequence + 1; // Counts up even when the ring is full
+    }
+}
+
+/**
+ * @brief Start the sample timer at a rate
+ */
+void startTimer(uint32_t rate) {
+#if ESP_ARDUINO_VERSION_MAJOR >= 3
+    timer = timerBegin(1000000);
+    timerAttachInterrupt(timer, onTimer);
+    timerAlarm(timer, 1000000 / rate, true, 0);
+#else
+    timer = timerBegin(0, 80, true);
+    timerAttachInterrupt(timer, onTimer, true);
+    timerAlarmWrite(timer, 1000000 / rate, true);
+    timerAlarmEnable(timer);
+#endif
+}
+
+/**
+ * @brief Run the producer at one rate and verify every sample
+ */
+bool runStress(size_t run) {
+    MicroSafariCaptureRing& ring = rings[run];
+    MicroSafariCaptureSample samples[64];
+    int32_t expected = 0;
+    uint32_t received = 0;
+    uint32_t outOfOrder = 0;
+    uint32_t maxSpreadUs = 0;
+    uint32_t lastTimestamp = 0;
+    
+    sequence = 0;
+    activeRing = &ring;
+    startTimer(RATES[run]);
+    
+    unsigned long started = millis();
+    unsigned long lastStall = started;
+    bool producing = true;
+    
+    while (producing || ring.available() > 0) {
+        if (producing && millis() - started >= RUN_MS) {
+            activeRing = nullptr;
+            timerEnd(timer);
+            producing = false;
+        }
+        
+        size_t count = ring.pop(samples, 64);
+        for (size_t i = 0; i < count; i++) {
+            if (samples[i].value < expected) {
+                outOfOrder++;
+            }
+            expected = samples[i].value + 1;
+            if (received > 0 && samples[i].timestamp - lastTimestamp > maxSpreadUs) {
+                maxSpreadUs = samples[i].timestamp - lastTimestamp;
+            }
+            lastTimestamp = samples[i].timestamp;
+            received++;
+        }
+        
+        // Block like an HTTP request would
+        if (producing && millis() - lastStall >= STALL_INTERVAL_MS) {
+            lastStall = millis();
+            delay(STALL_MS);
+        }
+    }
+    
+    uint32_t produced = sequence;
+    uint32_t lost = produced - received;
+    bool passed = lost == 0 && outOfOrder == 0 && ring.getDropped() == 0;
+    
+    Serial.printf("%6lu Hz: %7lu produced, %7lu received, %5lu dropped, %lu out of order, "
+                  "peak fill %3lu/%d, max gap %lu us  %s\n",
+                  (unsigned long)RATES[run], (unsigned long)produced, (unsigned long)received,
+                  (unsigned long)ring.getDropped(), (unsigned long)outOfOrder,
+                  (unsigned long)ring.getHighWater(), MICROSAFARI_CAPTURE_RING_SIZE,
+                  (unsigned long)maxSpreadUs, passed ? "✅ no loss" : "❌ LOSS");
+    return passed;
+}
+
+void setup() {
+    Serial.begin(115200);
+    while (!Serial) delay(10);
+    
+    Serial.println();
+    Serial.println("=======================================");
+    Serial.println("MicroSafari Capture Stress Test");
+    Serial.println("=======================================");
+    Serial.printf("Ring: %d samples, consumer stall %lu ms every %lu ms\n\n",
+                  MICROSAFARI_CAPTURE_RING_SIZE, STALL_MS, STALL_INTERVAL_MS);
+    
+    uint32_t highestPassed = 0;
+    for (size_t run = 0; run < RUN_COUNT; run++) {
+        if (runStress(run)) {
+            highestPassed = RATES[run];
+        }
+    }
+    
+    Serial.println();
+    Serial.printf("Highest rate without loss: %lu Hz\n", (unsigned long)highestPassed);
+}
+
+void loop() {
+    delay(1000);
+}
@@ -0,0 +1,102 @@
+/*!
+ * @file DeltaUpdate.ino
+ * @brief Delta firmware update example for MicroSafari ESP32 Library
+ * 
+ * This example demonstrates how to:
+ * - Check the platform for firmware updates once an hour
+ * - Download a binary delta against the running image in ranged windows
+ * - Resume the update after a dropped link or a reboot
+ * - Restart into the new image once it is verified
+ * 
+ * Hardware Requirements:
+ * - ESP32 development board with an OTA partition scheme
+ *   (e.g. "Minimal SPIFFS (1.9MB APP with OTA)")
+ * 
+ * Turn the access point off and on (or reset the board) during the
+ * download to see it continue instead of starting over.
+ * 
+ * @version 1.0.0
+ * @date 2025-08-22
+ * @author MicroSafari Team
+ */
+
+#include <MicroSafari.h>
+
+// WiFi credentials
+const char* WIFI_SSID = "your_wifi_ssid";
+const char* WIFI_PASSWORD = "your_wifi_password";
+
+// MicroSafari configuration
+const char* API_KEY = "your_device_api_key";
+const char* PLATFORM_URL = "https://your-microsafari-instance.com";
+const char* DEVICE_NAME = "ESP32-Delta-Update";
+
+// Version of this firmware; the platform picks the delta against it
+const char* FIRMWARE_VERSION = "1.0.0";
+
+// Create MicroSafari instance
+MicroSafari microSafari;
+MicroSafariUpdate update;
+
+void setup() {
+    Serial.begin(115200);
+    while (!Serial) delay(10);
+    
+    Serial.println();
+    Serial.println("=======================================");
+    Serial.println("MicroSafari Delta Update Demo");
+    Serial.print("Firmware version: ");
+    Serial.println(FIRMWARE_VERSION);
+    Serial.println("=======================================");
+    
+    microSafari.setDebug(true);
+    
+    if (!microSafari.begin(WIFI_SSID, WIFI_PASSWORD, API_KEY, PLATFORM_URL, DEVICE_NAME)) {
+        Serial.println("❌ Failed to initialize MicroSafari library!");
+        while (true) {
+            delay(1000);
+        }
+    }
+    
+    if (!microSafari.connectWiFi()) {
+        Serial.println("❌ WiFi connection failed, auto-reconnect will keep trying");
+    }
+    
+    // Resumes an update an earlier run did not finish
+    if (!update.begin(microSafari, FIRMWARE_VERSION)) {
+        Serial.println("❌ No OTA partition, choose a partition scheme with OTA");
+    }
+}
+
+void loop() {
+    microSafari.loop();
+    
+    // One window per pass; nothing is sent while WiFi is down
+    static MicroSafariUpdateStatus lastStatus = MICROSAFARI_UPDATE_IDLE;
+    MicroSafariUpdateStatus status = update.step();
+    const MicroSafariUpdateStats& stats = update.getStats();
+    
+    static unsigned long lastReport = 0;
+    if (status == MICROSAFARI_UPDATE_IN_PROGRESS && millis() - lastReport >= 2000) {
+        lastReport = millis();
+        Serial.printf("📥 %s: %lu / %lu patch bytes applied (%lu downloaded, %lu resumes)\n",
+                      update.getVersion(), (unsigned long)update.getOffset(), (unsigned long)stats.patchBytes,
+                      (unsigned long)stats.downloadedBytes, (unsigned long)stats.resumes);
+    }
+    
+    if (status != lastStatus) {
+        lastStatus = status;
+        if (status == MICROSAFARI_UPDATE_UP_TO_DATE) {
+            Serial.println("✅ Firmware is up to date");
+        } else if (status == MICROSAFARI_UPDATE_READY) {
+            Serial.printf("✅ %s verified: %lu byte image, %lu bytes saved by the delta. Restarting...\n",
+                          update.getVersion(), (unsigned long)stats.imageBytes, (unsigned long)stats.savedBytes);
+            delay(1000);
+            ESP.restart();
+        } else if (status == MICROSAFARI_UPDATE_FAILED) {
+            Serial.println("❌ Update failed, see debug output");
+        }
+    }
+    
+    delay(10);
+}
@@ -134,6 +134,9 @@ void performDiagnostics() {
     String diagnostics = microSafari.getConnectionDiagnostics();
     Serial.println(diagnostics);
     
+    // Heap and stack needed by each library call so far
+    Serial.println(microSafari.getMemoryReport());
+    
     // Send diagnostic data if connected
     if (microSafari.isPlatformActive()) {
         sendDiagnosticData();
@@ -277,12 +277,25 @@ bool sendSensorReading(const SensorReading& reading) {
         Serial.printf("   🚨 Send failed: %s\n", response.errorMessage.c_str());
         
         // Handle specific error types
-        if (response.httpCode == 401) {
-            Serial.println("   🔑 Authentication error - check API key");
-        } else if (response.httpCode == 503) {
-            Serial.println("   🔧 Service unavailable - development mode");
-        } else if (response.httpCode <= 0) {
-            Serial.println("   📶 Network error - connection issue");
+        switch (response.error) {
+            case MICROSAFARI_ERROR_AUTH:
+                Serial.println("   🔑 Authentication error - check API key");
+                break;
+            case MICROSAFARI_ERROR_THROTTLED:
+            case MICROSAFARI_ERROR_SERVER:
+                Serial.println("   🔧 Server busy or unavailable - will retry later");
+                break;
+            case MICROSAFARI_ERROR_DNS:
+            case MICROSAFARI_ERROR_TLS:
+                Serial.println("   🌐 Cannot reach platform - check URL and certificates");
+                break;
+            case MICROSAFARI_ERROR_NETWORK:
+            case MICROSAFARI_ERROR_TIMEOUT:
+            case MICROSAFARI_ERROR_WIFI:
+                Serial.println("   📶 Network error - connection issue");
+                break;
+            default:
+                break;
         }
         
         return false;
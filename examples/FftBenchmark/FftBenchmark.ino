@@ -0,0 +1,133 @@
+/*!
+ * @file FftBenchmark.ino
+ * @brief Waveform FFT feature benchmark for MicroSafari ESP32 Library
+ * 
+ * This example demonstrates how to:
+ * - Measure FFT and feature extraction time per waveform
+ * - Check the features against a known synthetic vibration signal
+ * - Capture a 1 kHz waveform from the ADC in continuous DMA mode
+ * - Print the payload that would be uploaded instead of raw samples
+ * 
+ * Hardware Requirements:
+ * - ESP32 development board (arduino-esp32 3.x for esp-dsp and the DMA run)
+ * - Optional vibration sensor on GPIO 34
+ * 
+ * No WiFi connection is needed for this benchmark. Build once as is and
+ * once with MICROSAFARI_WAVEFORM_NO_ESP_DSP defined to compare the
+ * esp-dsp kernels with the portable FFT.
+ * 
+ * @version 1.0.0
+ * @date 2025-08-22
+ * @author MicroSafari Team
+ */
+
+#include <MicroSafari.h>
+
+// Benchmark parameters
+const uint32_t FFT_RUNS = 200;               // Waveforms timed
+const float SAMPLE_RATE = 1000.0f;           // Vibration sampling rate in Hz
+const uint32_t DMA_CONVERSIONS = 16;         // Conversions averaged per DMA sample
+const unsigned long DMA_TIMEOUT_MS = 5000;   // Longest wait for the DMA capture
+
+const uint8_t VIBRATION_PIN = 34;
+
+// Too large for the loop task stack
+MicroSafariWaveform waveform("vib");
+
+/**
+ * @brief Add the bands a pump monitor would report
+ */
+void addBands() {
+    waveform.addBand("band_low", 2, 50);     // Imbalance, misalignment
+    waveform.addBand("band_mid", 50, 200);   // Vane pass, looseness
+    waveform.addBand("band_high", 200, 500); // Bearings, cavitation
+}
+
+/**
+ * @brief Time compute() on a synthetic 1x + 3x rotation signal with noise
+ */
+void benchmarkCompute() {
+    waveform.begin(SAMPLE_RATE);
+    
+    uint32_t fftMicros = 0;
+    uint32_t computeMicros = 0;
+    for (uint32_t run = 0; run < FFT_RUNS; run++) {
+        for (size_t i = 0; i < MICROSAFARI_WAVEFORM_SIZE; i++) {
+            float t = i / SAMPLE_RATE;
+            float noise = (random(2001) - 1000) / 10000.0f;
+            waveform.addSample(0.5f + 1.5f * sinf(2 * PI * 49.3f * t) + 0.4f * sinf(2 * PI * 147.9f * t) + noise);
+        }
+        waveform.compute();
+        fftMicros += waveform.getFeatures().fftMicros;
+        computeMicros += waveform.getFeatures().computeMicros;
+    }
+    
+    const MicroSafariWaveformFeatures& features = waveform.getFeatures();
+    float fftAverage = fftMicros / (float)FFT_RUNS;
+    Serial.printf("FFT %-8s N=%-5d %8.1f us/FFT  %6.2f Msamples/s\n",
+                  MicroSafariWaveform::getBackend(), MICROSAFARI_WAVEFORM_SIZE,
+                  fftAverage, MICROSAFARI_WAVEFORM_SIZE / fftAverage);
+    Serial.printf("compute() with features %8.1f us  (%.2f%% CPU at %.0f Hz)\n",
+                  computeMicros / (float)FFT_RUNS,
+                  computeMicros / (float)FFT_RUNS / (MICROSAFARI_WAVEFORM_SIZE / SAMPLE_RATE * 10000.0f),
+                  SAMPLE_RATE);
+    
+    // Expected: rms 1.10, 49.3 Hz at amplitude 1.5, bands 1.125 / 0.08 / ~0
+    Serial.printf("features  rms %.3f  peak %.3f  crest %.2f  %.2f Hz @ %.3f\n",
+                  features.rms, features.peak, features.crest,
+                  features.peakFrequency, features.peakAmplitude);
+    Serial.printf("bands     low %.4f  mid %.4f  high %.4f\n",
+                  features.bandEnergy[0], features.bandEnergy[1], features.bandEnergy[2]);
+}
+
+/**
+ * @brief Capture one waveform from the ADC in continuous DMA mode
+ */
+void captureDma() {
+    MicroSafariDmaAdcSource source(DMA_CONVERSIONS);
+    
+    if (!waveform.begin(&source, VIBRATION_PIN, SAMPLE_RATE * DMA_CONVERSIONS, SAMPLE_RATE, 3.3f / 4095)) {
+        Serial.println("DMA capture             not available (needs arduino-esp32 3.x)");
+        return;
+    }
+    
+    unsigned long started = millis();
+    while (!waveform.process() && millis() - started < DMA_TIMEOUT_MS) {
+        delay(10);
+    }
+    waveform.end();
+    
+    if (!waveform.compute()) {
+        Serial.println("DMA capture             timed out");
+        return;
+    }
+    
+    DynamicJsonDocument doc(512);
+    JsonObject payload = doc.to<JsonObject>();
+    size_t values = waveform.populate(payload);
+    
+    Serial.printf("DMA capture             %d samples in %lu ms, %u values uploaded:\n",
+                  MICROSAFARI_WAVEFORM_SIZE, millis() - started, (unsigned)values);
+    serializeJson(payload, Serial);
+    Serial.println();
+}
+
+void setup() {
+    Serial.begin(115200);
+    while (!Serial) delay(10);
+    
+    Serial.println();
+    Serial.println("=======================================");
+    Serial.println("MicroSafari FFT Benchmark");
+    Serial.println("=======================================");
+    
+    addBands();
+    benchmarkCompute();
+    captureDma();
+    
+    Serial.println("Benchmark complete");
+}
+
+void loop() {
+    delay(1000);
+}
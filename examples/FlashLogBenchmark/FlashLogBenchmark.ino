@@ -0,0 +1,206 @@
+/*!
+ * @file FlashLogBenchmark.ino
+ * @brief Flash ring log vs LittleFS append benchmark for MicroSafari ESP32 Library
+ * 
+ * This example demonstrates how to:
+ * - Mount a MicroSafariFlashLog on a raw data partition
+ * - Append fixed-size telemetry records at a high rate
+ * - Compare append throughput and worst-case latency against LittleFS
+ * - Run the same ring log on the RAM flash emulator and inspect wear
+ * 
+ * Partition Setup:
+ * Use a custom partitions.csv that contains both a LittleFS partition
+ * and a raw data partition for the ring log, for example:
+ * 
+ *   # Name,   Type, SubType, Offset,  Size
+ *   nvs,      data, nvs,     0x9000,  0x5000
+ *   otadata,  data, ota,     0xe000,  0x2000
+ *   app0,     app,  ota_0,   0x10000, 0x1E0000
+ *   spiffs,   data, spiffs,  ,        0x100000
+ *   mslog,    data, 0x99,    ,        0x40000
+ * 
+ * No WiFi connection is needed for this benchmark.
+ * 
+ * @version 1.0.0
+ * @date 2025-08-22
+ * @author MicroSafari Team
+ */
+
+#include <MicroSafari.h>
+#include <LittleFS.h>
+
+// Benchmark parameters
+const uint32_t RECORD_COUNT = 2000;      // Records appended per run
+const uint32_t EMULATED_FLASH_SIZE = 64 * 1024;
+const char* LITTLEFS_PATH = "/bench.log";
+
+// Telemetry record used for all runs
+struct TelemetryRecord {
+    uint32_t timestamp;
+    uint32_t sequence;
+    float values[6];
+};
+
+const uint16_t RECORD_SIZE = sizeof(TelemetryRecord);
+
+// Benchmark result
+struct BenchmarkResult {
+    uint32_t records;
+    unsigned long totalMicros;
+    unsigned long maxMicros;
+};
+
+void printResult(const char* name, const BenchmarkResult& result) {
+    float seconds = result.totalMicros / 1000000.0f;
+    float recordsPerSecond = seconds > 0 ? result.records / seconds : 0;
+    float kbPerSecond = recordsPerSecond * RECORD_SIZE / 1024.0f;
+    
+    Serial.printf("%-22s %6lu records  %8.0f rec/s  %7.1f KB/s  avg %6.1f us  max %7lu us\n",
+                  name,
+                  (unsigned long)result.records,
+                  recordsPerSecond,
+                  kbPerSecond,
+                  result.records > 0 ? (float)result.totalMicros / result.records : 0.0f,
+                  result.maxMicros);
+}
+
+void fillRecord(TelemetryRecord& record, uint32_t sequence) {
+    record.timestamp = millis();
+    record.sequence = sequence;
+    for (int i = 0; i < 6; i++) {
+        record.values[i] = 20.0f + (sequence % 100) * 0.1f + i;
+    }
+}
+
+BenchmarkResult benchmarkRingLog(MicroSafariFlashLog& log) {
+    BenchmarkResult result = {0, 0, 0};
+    TelemetryRecord record;
+    
+    for (uint32_t i = 0; i < RECORD_COUNT; i++) {
+        fillRecord(record, i);
+        
+        unsigned long start = micros();
+        bool ok = log.append(&record, sizeof(record));
+        unsigned long elapsed = micros() - start;
+        
+        if (!ok) {
+            Serial.printf("❌ Ring log append failed at record %lu\n", (unsigned long)i);
+            break;
+        }
+        
+        result.records++;
+        result.totalMicros += elapsed;
+        if (elapsed > result.maxMicros) {
+            result.maxMicros = elapsed;
+        }
+    }
+    
+    return result;
+}
+
+BenchmarkResult benchmarkLittleFS(bool keepOpen) {
+    BenchmarkResult result = {0, 0, 0};
+    TelemetryRecord record;
+    
+    LittleFS.remove(LITTLEFS_PATH);
+    File file;
+    if (keepOpen) {
+        file = LittleFS.open(LITTLEFS_PATH, "a");
+    }
+    
+    for (uint32_t i = 0; i < RECORD_COUNT; i++) {
+        fillRecord(record, i);
+        
+        unsigned long start = micros();
+        bool ok;
+        if (keepOpen) {
+            ok = file.write((const uint8_t*)&record, sizeof(record)) == sizeof(record);
+            file.flush();
+        } else {
+            // Typical sketch pattern: open, append, close per sample
+            File appendFile = LittleFS.open(LITTLEFS_PATH, "a");
+            ok = appendFile && appendFile.write((const uint8_t*)&record, sizeof(record)) == sizeof(record);
+            appendFile.close();
+        }
+        unsigned long elapsed = micros() - start;
+        
+        if (!ok) {
+            Serial.printf("❌ LittleFS append failed at record %lu\n", (unsigned long)i);
+            break;
+        }
+        
+        result.records++;
+        result.totalMicros += elapsed;
+        if (elapsed > result.maxMicros) {
+            result.maxMicros = elapsed;
+        }
+    }
+    
+    if (keepOpen) {
+        file.close();
+    }
+    LittleFS.remove(LITTLEFS_PATH);
+    
+    return result;
+}
+
+void setup() {
+    Serial.begin(115200);
+    while (!Serial) delay(10);
+    
+    Serial.println();
+    Serial.println("=========================================");
+    Serial.println("MicroSafari Flash Ring Log Benchmark");
+    Serial.println("=========================================");
+    Serial.printf("Records per run: %lu x %u bytes\n\n", (unsigned long)RECORD_COUNT, RECORD_SIZE);
+    
+    // 1. Ring log on the RAM flash emulator
+    MicroSafariEmulatedFlash emulatedFlash;
+    if (emulatedFlash.begin(EMULATED_FLASH_SIZE)) {
+        MicroSafariFlashLog emulatedLog;
+        emulatedLog.begin(&emulatedFlash);
+        printResult("Ring log (emulated)", benchmarkRingLog(emulatedLog));
+        
+        Serial.print("   Erase cycles per sector:");
+        for (uint32_t sector = 0; sector < emulatedLog.getSectorCount(); sector++) {
+            Serial.printf(" %lu", (unsigned long)emulatedFlash.getEraseCount(sector));
+        }
+        Serial.printf("\n   NOR write violations: %lu\n", (unsigned long)emulatedFlash.getWriteViolations());
+    } else {
+        Serial.println("⚠️ Not enough RAM for the flash emulator");
+    }
+    
+    // 2. Ring log on the raw data partition
+    MicroSafariPartitionFlash partitionFlash;
+    if (partitionFlash.begin("mslog")) {
+        MicroSafariFlashLog partitionLog;
+        unsigned long mountStart = micros();
+        partitionLog.begin(&partitionFlash);
+        Serial.printf("%-22s boot scan of %lu sectors took %lu us\n",
+                      "Ring log (partition)",
+                      (unsigned long)partitionLog.getSectorCount(),
+                      micros() - mountStart);
+        printResult("Ring log (partition)", benchmarkRingLog(partitionLog));
+        
+        const MicroSafariFlashLogStats& stats = partitionLog.getStats();
+        Serial.printf("   Sector erases: %lu, dropped records: %lu\n",
+                      (unsigned long)stats.sectorErases,
+                      (unsigned long)stats.droppedRecords);
+    } else {
+        Serial.println("⚠️ Partition 'mslog' not found, check partitions.csv");
+    }
+    
+    // 3. LittleFS appends
+    if (LittleFS.begin(true)) {
+        printResult("LittleFS (open/close)", benchmarkLittleFS(false));
+        printResult("LittleFS (kept open)", benchmarkLittleFS(true));
+    } else {
+        Serial.println("⚠️ LittleFS mount failed");
+    }
+    
+    Serial.println("\n✅ Benchmark complete");
+}
+
+void loop() {
+    delay(1000);
+}
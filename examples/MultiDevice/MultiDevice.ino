@@ -0,0 +1,138 @@
+/*!
+ * @file MultiDevice.ino
+ * @brief Several logical devices on one connection with MicroSafari ESP32 Library
+ * 
+ * This example demonstrates how to:
+ * - Serve several greenhouses (separate API keys) from one board
+ * - Share one WiFi client, HTTP client and TLS session between them
+ * - Multiplex their readings into shared batch requests
+ * - Measure the memory cost of an extra identity
+ * 
+ * Hardware Requirements:
+ * - ESP32 development board
+ * - Analog sensors on GPIO 32, 33, 34 and 35 (one per greenhouse)
+ * 
+ * @version 1.0.0
+ * @date 2025-08-22
+ * @author MicroSafari Team
+ */
+
+#include <MicroSafari.h>
+
+// WiFi credentials
+const char* WIFI_SSID = "your_wifi_ssid";
+const char* WIFI_PASSWORD = "your_wifi_password";
+
+// MicroSafari configuration (primary identity owns the connection)
+const char* API_KEY = "greenhouse_a_api_key";
+const char* PLATFORM_URL = "https://your-microsafari-instance.com";
+const char* DEVICE_NAME = "Greenhouse-A";
+
+// Extra logical devices
+const int CHANNEL_COUNT = 3;
+const char* CHANNEL_KEYS[CHANNEL_COUNT] = {
+    "greenhouse_b_api_key",
+    "greenhouse_c_api_key",
+    "greenhouse_d_api_key"
+};
+const char* CHANNEL_NAMES[CHANNEL_COUNT] = {
+    "Greenhouse-B",
+    "Greenhouse-C",
+    "Greenhouse-D"
+};
+
+// Pin definitions
+const int PRIMARY_SENSOR_PIN = 32;
+const int CHANNEL_SENSOR_PINS[CHANNEL_COUNT] = { 33, 34, 35 };
+
+// Reading interval
+const unsigned long READ_INTERVAL = 10000; // 10 seconds
+
+MicroSafari microSafari;
+MicroSafariChannel channels[CHANNEL_COUNT];
+
+/**
+ * @brief Print the memory cost of a channel vs a full instance
+ */
+void printMemoryReport(uint32_t heapBefore, uint32_t heapAfter) {
+    Serial.println("📏 Memory per extra identity:");
+    Serial.printf("   MicroSafariChannel object: %u bytes\n", (unsigned)channels[0].getMemoryUsage());
+    Serial.printf("   Heap used by %d channels: %d bytes\n", CHANNEL_COUNT, (int)(heapBefore - heapAfter));
+    Serial.printf("   MicroSafari instance object: %u bytes (plus its TLS session on heap)\n",
+                  (unsigned)sizeof(MicroSafari));
+}
+
+/**
+ * @brief Read a percentage from an analog pin
+ */
+float readPercent(int pin) {
+    return analogRead(pin) * 100.0f / 4095.0f;
+}
+
+void setup() {
+    Serial.begin(115200);
+    while (!Serial) delay(10);
+    
+    Serial.println();
+    Serial.println("=======================================");
+    Serial.println("MicroSafari Multi-Device Demo");
+    Serial.println("=======================================");
+    
+    microSafari.setDebug(true);
+    
+    if (!microSafari.begin(WIFI_SSID, WIFI_PASSWORD, API_KEY, PLATFORM_URL, DEVICE_NAME)) {
+        Serial.println("❌ Failed to initialize MicroSafari library!");
+        while (true) {
+            delay(1000);
+        }
+    }
+    
+    // Attach extra identities and measure what they cost
+    uint32_t heapBefore = ESP.getFreeHeap();
+    for (int i = 0; i < CHANNEL_COUNT; i++) {
+        if (!channels[i].begin(microSafari, CHANNEL_KEYS[i], CHANNEL_NAMES[i])) {
+            Serial.printf("❌ Failed to attach %s\n", CHANNEL_NAMES[i]);
+        }
+    }
+    printMemoryReport(heapBefore, ESP.getFreeHeap());
+    
+    // One batch request per reading round: 1 primary + 3 channel entries
+    microSafari.setBatchConfig(CHANNEL_COUNT + 1, 30000);
+    
+    if (!microSafari.connectWiFi()) {
+        Serial.println("❌ WiFi connection failed, auto-reconnect will keep trying");
+    }
+}
+
+void loop() {
+    // Sends the shared batch when full or due
+    microSafari.loop();
+    
+    static unsigned long lastRead = 0;
+    if (millis() - lastRead >= READ_INTERVAL) {
+        lastRead = millis();
+        
+        DynamicJsonDocument doc(256);
+        JsonObject data = doc.to<JsonObject>();
+        
+        data["soil_moisture"] = readPercent(PRIMARY_SENSOR_PIN);
+        data["timestamp"] = millis();
+        microSafari.queueSensorData(data);
+        
+        for (int i = 0; i < CHANNEL_COUNT; i++) {
+            doc.clear();
+            data = doc.to<JsonObject>();
+            data["soil_moisture"] = readPercent(CHANNEL_SENSOR_PINS[i]);
+            data["timestamp"] = millis();
+            
+            if (!channels[i].queueSensorData(data)) {
+                Serial.printf("⚠️ Batch full, %s reading dropped\n", channels[i].getDeviceName());
+            }
+        }
+        
+        Serial.printf("📦 Queued entries: %u, free heap: %u bytes\n",
+                      (unsigned)microSafari.getQueuedCount(), (unsigned)ESP.getFreeHeap());
+    }
+    
+    delay(100);
+}
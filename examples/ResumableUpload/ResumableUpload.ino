@@ -0,0 +1,132 @@
+/*!
+ * @file ResumableUpload.ino
+ * @brief Resumable bulk upload example for MicroSafari ESP32 Library
+ * 
+ * This example demonstrates how to:
+ * - Upload a large log file from LittleFS in chunks
+ * - Continue from the offset confirmed by the server after a dropped link
+ * - Resume the same upload session after a reboot
+ * 
+ * Hardware Requirements:
+ * - ESP32 development board with a LittleFS partition
+ * 
+ * The example writes a 64 KB backlog file on first start. Turn the
+ * access point off and on (or reset the board) during the upload to see
+ * it resume instead of starting over.
+ * 
+ * @version 1.0.0
+ * @date 2025-08-22
+ * @author MicroSafari Team
+ */
+
+#include <MicroSafari.h>
+#include <LittleFS.h>
+
+// WiFi credentials
+const char* WIFI_SSID = "your_wifi_ssid";
+const char* WIFI_PASSWORD = "your_wifi_password";
+
+// MicroSafari configuration
+const char* API_KEY = "your_device_api_key";
+const char* PLATFORM_URL = "https://your-microsafari-instance.com";
+const char* DEVICE_NAME = "ESP32-Resumable-Upload";
+
+// Backlog file to upload
+const char* BACKLOG_PATH = "/backlog.csv";
+const size_t BACKLOG_LINES = 2048;
+
+// Create MicroSafari instance
+MicroSafari microSafari;
+MicroSafariUpload upload;
+File backlog;
+
+/**
+ * @brief Read part of the backlog file for the upload
+ */
+size_t readBacklog(void* context, uint32_t offset, uint8_t* buffer, size_t length) {
+    File* file = static_cast<File*>(context);
+    if (!file->seek(offset)) {
+        return 0;
+    }
+    return file->read(buffer, length);
+}
+
+/**
+ * @brief Write a sample backlog if there is none yet
+ */
+void createBacklog() {
+    if (LittleFS.exists(BACKLOG_PATH)) {
+        return;
+    }
+    
+    File file = LittleFS.open(BACKLOG_PATH, "w");
+    for (size_t i = 0; i < BACKLOG_LINES; i++) {
+        file.printf("%08u,soil_moisture,%5.1f,temperature,%4.1f\n",
+                    (unsigned)(i * 60), 30.0f + (i % 40), 24.0f + (i % 10) / 2.0f);
+    }
+    file.close();
+}
+
+void setup() {
+    Serial.begin(115200);
+    while (!Serial) delay(10);
+    
+    Serial.println();
+    Serial.println("=======================================");
+    Serial.println("MicroSafari Resumable Upload Demo");
+    Serial.println("=======================================");
+    
+    if (!LittleFS.begin(true)) {
+        Serial.println("❌ LittleFS mount failed");
+        while (true) {
+            delay(1000);
+        }
+    }
+    createBacklog();
+    
+    microSafari.setDebug(true);
+    
+    if (!microSafari.begin(WIFI_SSID, WIFI_PASSWORD, API_KEY, PLATFORM_URL, DEVICE_NAME)) {
+        Serial.println("❌ Failed to initialize MicroSafari library!");
+        while (true) {
+            delay(1000);
+        }
+    }
+    
+    if (!microSafari.connectWiFi()) {
+        Serial.println("❌ WiFi connection failed, auto-reconnect will keep trying");
+    }
+    
+    // Same name, size and content as an interrupted run resumes its session
+    backlog = LittleFS.open(BACKLOG_PATH, "r");
+    upload.begin(microSafari, "backlog", backlog.size(), readBacklog, &backlog);
+}
+
+void loop() {
+    microSafari.loop();
+    
+    // One chunk per pass; nothing is sent while WiFi is down
+    static MicroSafariUploadStatus lastStatus = MICROSAFARI_UPLOAD_IDLE;
+    MicroSafariUploadStatus status = upload.step();
+    
+    static unsigned long lastReport = 0;
+    if (status == MICROSAFARI_UPLOAD_IN_PROGRESS && millis() - lastReport >= 2000) {
+        lastReport = millis();
+        Serial.printf("📤 %lu / %lu bytes confirmed (%lu sent, %lu resumes)\n",
+                      (unsigned long)upload.getOffset(), (unsigned long)upload.getSize(),
+                      (unsigned long)upload.getBytesSent(), (unsigned long)upload.getResumeCount());
+    }
+    
+    if (status != lastStatus) {
+        lastStatus = status;
+        if (status == MICROSAFARI_UPLOAD_COMPLETE) {
+            Serial.println("✅ Backlog uploaded");
+            backlog.close();
+            LittleFS.remove(BACKLOG_PATH);
+        } else if (status == MICROSAFARI_UPLOAD_FAILED) {
+            Serial.println("❌ Upload rejected");
+        }
+    }
+    
+    delay(10);
+}
@@ -0,0 +1,148 @@
+/*!
+ * @file SdArchive.ino
+ * @brief SD card archive example for MicroSafari ESP32 Library
+ * 
+ * This example demonstrates how to:
+ * - Keep every reading on an SD card next to sending it to the platform
+ * - Measure the sustained throughput of the archive writer task
+ * - Report write latency, dropped readings and day files
+ * 
+ * Hardware Requirements:
+ * - ESP32 development board
+ * - SD card module on the default SPI pins, chip select on GPIO 5
+ * 
+ * On start the example pushes BENCHMARK_READINGS readings into the
+ * archive as fast as the queue takes them and prints the rate the card
+ * sustained. Afterwards it sends one set of readings per second; the
+ * archive gets a copy of each, also while WiFi is down.
+ * 
+ * @version 1.0.0
+ * @date 2025-08-22
+ * @author MicroSafari Team
+ */
+
+#include <MicroSafari.h>
+#include <SD.h>
+
+// WiFi credentials
+const char* WIFI_SSID = "your_wifi_ssid";
+const char* WIFI_PASSWORD = "your_wifi_password";
+
+// MicroSafari configuration
+const char* API_KEY = "your_device_api_key";
+const char* PLATFORM_URL = "https://your-microsafari-instance.com";
+const char* DEVICE_NAME = "ESP32-SD-Archive";
+
+// SD card chip select pin
+const uint8_t SD_CS_PIN = 5;
+
+// Readings written by the start-up benchmark
+const uint32_t BENCHMARK_READINGS = 20000;
+
+// Create MicroSafari instance
+MicroSafari microSafari;
+MicroSafariArchive archive;
+
+/**
+ * @brief Print archive counters and write latency
+ */
+void printArchiveStats() {
+    MicroSafariArchiveStats stats = archive.getStats();
+    const MicroSafariLatencyHistogram& latency = archive.getWriteLatency();
+    Serial.printf("💾 %lu/%lu readings written, %lu dropped, %lu lost, %lu files, %lu KB\n",
+                  (unsigned long)stats.written, (unsigned long)stats.records, (unsigned long)stats.dropped,
+                  (unsigned long)stats.lost, (unsigned long)stats.files, (unsigned long)(stats.bytes / 1024));
+    Serial.printf("   card %lu KB/s, write p50 %.1f ms, p99 %.1f ms, max %.1f ms, queue peak %lu\n",
+                  (unsigned long)(stats.throughput / 1024), latency.getPercentile(50) / 1000.0f,
+                  latency.getPercentile(99) / 1000.0f, latency.getMax() / 1000.0f, (unsigned long)stats.queuePeak);
+}
+
+/**
+ * @brief Push readings into the archive as fast as it takes them
+ */
+void runBenchmark() {
+    Serial.printf("Writing %lu readings...\n", (unsigned long)BENCHMARK_READINGS);
+    
+    unsigned long started = millis();
+    uint32_t waits = 0;
+    for (uint32_t i = 0; i < BENCHMARK_READINGS; i++) {
+        // A full queue drops the reading; wait for the writer instead to measure the card
+        while (!archive.record("benchmark", i * 0.01f)) {
+            waits++;
+            delay(1);
+        }
+    }
+    if (!archive.flush()) {
+        Serial.println("⚠️ Archive flush timed out");
+    }
+    unsigned long elapsed = max(millis() - started, 1UL);
+    
+    Serial.printf("✅ %lu readings/s sustained (%lu KB/s of records), %lu waits for a full queue\n",
+                  (unsigned long)(BENCHMARK_READINGS * 1000UL / elapsed),
+                  (unsigned long)(BENCHMARK_READINGS * sizeof(MicroSafariArchiveRecord) / elapsed),
+                  (unsigned long)waits);
+    printArchiveStats();
+}
+
+void setup() {
+    Serial.begin(115200);
+    while (!Serial) delay(10);
+    
+    Serial.println();
+    Serial.println("=======================================");
+    Serial.println("MicroSafari SD Archive Demo");
+    Serial.println("=======================================");
+    
+    if (!SD.begin(SD_CS_PIN)) {
+        Serial.println("❌ SD card mount failed");
+        while (true) {
+            delay(1000);
+        }
+    }
+    
+    if (!archive.begin(SD, "/archive")) {
+        Serial.println("❌ Failed to start the archive writer");
+        while (true) {
+            delay(1000);
+        }
+    }
+    runBenchmark();
+    
+    if (!microSafari.begin(WIFI_SSID, WIFI_PASSWORD, API_KEY, PLATFORM_URL, DEVICE_NAME)) {
+        Serial.println("❌ Failed to initialize MicroSafari library!");
+        while (true) {
+            delay(1000);
+        }
+    }
+    
+    // Every reading sent from now on is archived as well
+    microSafari.setArchive(&archive);
+    
+    if (!microSafari.connectWiFi()) {
+        Serial.println("❌ WiFi connection failed, readings are still archived");
+    }
+}
+
+void loop() {
+    microSafari.loop();
+    
+    static unsigned long lastSend = 0;
+    if (millis() - lastSend >= 1000) {
+        lastSend = millis();
+        
+        DynamicJsonDocument doc(256);
+        JsonObject data = doc.to<JsonObject>();
+        data["temperature"] = 24.0f + (millis() / 1000 % 20) / 10.0f;
+        data["humidity"] = 55.0f + (millis() / 1000 % 30) / 10.0f;
+        data["timestamp"] = millis();
+        microSafari.sendSensorData(data);
+    }
+    
+    static unsigned long lastReport = 0;
+    if (millis() - lastReport >= 10000) {
+        lastReport = millis();
+        printArchiveStats();
+    }
+    
+    delay(10);
+}
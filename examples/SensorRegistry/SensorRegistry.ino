@@ -0,0 +1,153 @@
+/*!
+ * @file SensorRegistry.ino
+ * @brief Non-blocking sensor registry example for MicroSafari ESP32 Library
+ * 
+ * This example demonstrates how to:
+ * - Register sensors as small non-blocking state machines
+ * - Average analog samples across loop iterations instead of in a tight loop
+ * - Wait for slow conversions without calling delay()
+ * - Send payloads built from cached values only
+ * 
+ * Hardware Requirements:
+ * - ESP32 development board
+ * - Capacitive soil moisture sensor on GPIO 34
+ * - Light sensor (LDR voltage divider) on GPIO 35
+ * 
+ * The temperature sensor below simulates a slow sensor with a 750 ms
+ * conversion time (like a DS18B20). With the DallasTemperature library
+ * the same state machine maps to setWaitForConversion(false),
+ * requestTemperatures() on start and isConversionComplete() afterwards.
+ * 
+ * @version 1.0.0
+ * @date 2025-08-22
+ * @author MicroSafari Team
+ */
+
+#include <MicroSafari.h>
+
+// WiFi credentials
+const char* WIFI_SSID = "your_wifi_ssid";
+const char* WIFI_PASSWORD = "your_wifi_password";
+
+// MicroSafari configuration
+const char* API_KEY = "your_device_api_key";
+const char* PLATFORM_URL = "https://your-microsafari-instance.com";
+const char* DEVICE_NAME = "ESP32-Sensor-Registry";
+
+// Pin definitions
+const int SOIL_MOISTURE_PIN = 34;
+const int LIGHT_SENSOR_PIN = 35;
+
+// Send interval
+const unsigned long SEND_INTERVAL = 30000; // 30 seconds
+
+// Create MicroSafari instance
+MicroSafari microSafari;
+
+/**
+ * @brief Averaging state for an analog input
+ */
+struct AnalogAverage {
+    int pin;
+    int samples;          // Samples per reading
+    int taken;
+    long sum;
+};
+
+AnalogAverage soilMoisture = { SOIL_MOISTURE_PIN, 32, 0, 0 };
+AnalogAverage lightLevel = { LIGHT_SENSOR_PIN, 16, 0, 0 };
+
+/**
+ * @brief Take one analog sample per step until the average is complete
+ */
+MicroSafariSensorState readAnalogAverage(void* context, bool start, float& value) {
+    AnalogAverage* input = static_cast<AnalogAverage*>(context);
+    
+    if (start) {
+        input->taken = 0;
+        input->sum = 0;
+    }
+    
+    input->sum += analogRead(input->pin);
+    input->taken++;
+    
+    if (input->taken < input->samples) {
+        return MICROSAFARI_SENSOR_PENDING;
+    }
+    
+    // Convert 12-bit ADC average to percent
+    value = (input->sum / (float)input->samples) * 100.0f / 4095.0f;
+    return MICROSAFARI_SENSOR_READY;
+}
+
+/**
+ * @brief Slow temperature sensor with a 750 ms conversion
+ */
+MicroSafariSensorState readTemperature(void* context, bool start, float& value) {
+    static unsigned long conversionStart = 0;
+    
+    if (start) {
+        conversionStart = millis(); // Trigger conversion here
+        return MICROSAFARI_SENSOR_PENDING;
+    }
+    
+    if (millis() - conversionStart < 750) {
+        return MICROSAFARI_SENSOR_PENDING; // Conversion still running
+    }
+    
+    value = 26.0f + random(0, 40) / 10.0f; // Read result here
+    return MICROSAFARI_SENSOR_READY;
+}
+
+void setup() {
+    Serial.begin(115200);
+    while (!Serial) delay(10);
+    
+    Serial.println();
+    Serial.println("=======================================");
+    Serial.println("MicroSafari Sensor Registry Demo");
+    Serial.println("=======================================");
+    
+    microSafari.setDebug(true);
+    
+    // Register sensors: metric, step function, context, min interval, TTL
+    microSafari.registerSensor("temperature", readTemperature, nullptr, 2000, 10000);
+    microSafari.registerSensor("soil_moisture", readAnalogAverage, &soilMoisture, 5000, 30000);
+    microSafari.registerSensor("light_level", readAnalogAverage, &lightLevel, 1000, 10000);
+    
+    if (!microSafari.begin(WIFI_SSID, WIFI_PASSWORD, API_KEY, PLATFORM_URL, DEVICE_NAME)) {
+        Serial.println("❌ Failed to initialize MicroSafari library!");
+        while (true) {
+            delay(1000);
+        }
+    }
+    
+    if (!microSafari.connectWiFi()) {
+        Serial.println("❌ WiFi connection failed, auto-reconnect will keep trying");
+    }
+}
+
+void loop() {
+    // Steps all registered sensors; never waits on hardware
+    microSafari.loop();
+    
+    static unsigned long lastSend = 0;
+    if (millis() - lastSend >= SEND_INTERVAL) {
+        lastSend = millis();
+        
+        float temperature;
+        if (microSafari.getSensorRegistry().getValue("temperature", temperature)) {
+            Serial.printf("🌡️ Cached temperature: %.1f °C\n", temperature);
+        }
+        
+        MicroSafariResponse response = microSafari.sendCachedSensorData();
+        if (response.success) {
+            Serial.println("✅ Cached sensor data sent");
+        } else {
+            Serial.printf("❌ Failed: %s\n", response.errorMessage.c_str());
+        }
+    }
+    
+    // Short delay keeps the sensor state machines responsive
+    delay(10);
+}
@@ -6,6 +6,96 @@
  */
 
 #include "MicroSafari.h"
+#include <Preferences.h>
+#include <sys/time.h>
+#include <new>
+
+// NVS namespace used for persisted library state
+static const char* PREFERENCES_NAMESPACE = "microsafari";
+
+// Response headers collected on every request, indexed by ResponseHeader
+static const char* COLLECTED_HEADERS[] = { "ETag", "Upload-Offset", "Retry-After", "X-Ingest-Min-Interval" };
+
+// Largest unread error body drained to keep the connection, in bytes; larger ones close it
+static const int DISCARD_BODY_LIMIT = 2048;
+
+// Connection setup assumed before the first prewarm is measured, in ms
+static const uint32_t PREWARM_INITIAL_SETUP = 1500;
+
+// Data source prefix of commands handled by the library itself
+static const char* CONFIG_COMMAND_PREFIX = "__cfg";
+
+// Data source of the reserved command replacing the local rule table
+static const char* RULES_COMMAND = "__rules";
+
+// Limits for configuration values accepted from the platform
+struct ConfigLimit {
+    const char* key;
+    long minValue;
+    long maxValue;
+};
+
+static const ConfigLimit CONFIG_LIMITS[] = {
+    { "heartbeat_interval_ms",    10000, 86400000 },
+    { "max_retries",              1,     10 },
+    { "retry_delay_ms",           0,     60000 },
+    { "connection_timeout_ms",    1000,  120000 },
+    { "max_consecutive_failures", 1,     100 },
+    { "auto_reconnect",           0,     1 },
+    { "retention_batch",          1,     MICROSAFARI_RETENTION_DRAIN_BATCH },
+    { "config_interval_ms",       60000, 86400000 },
+    { "batch_size",               1,     MICROSAFARI_BATCH_MAX_ENTRIES },
+    { "command_poll_interval_ms", 1000,  3600000 }
+};
+
+/**
+ * @brief Get wall clock time in Unix milliseconds, 0 if the clock is not set
+ */
+static uint64_t epochMillis() {
+    struct timeval now;
+    gettimeofday(&now, nullptr);
+    if (now.tv_sec < MICROSAFARI_EPOCH_VALID) {
+        return 0;
+    }
+    return (uint64_t)now.tv_sec * 1000 + now.tv_usec / 1000;
+}
+
+/**
+ * @brief Find the limits of a configuration key
+ */
+static const ConfigLimit* findConfigLimit(const char* key) {
+    for (const ConfigLimit& limit : CONFIG_LIMITS) {
+        if (strcmp(limit.key, key) == 0) {
+            return &limit;
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * @brief Describe the mbedTLS record buffers the core was built with
+ *
+ * WiFiClientSecure does not expose the mbedTLS configuration, so record
+ * buffer sizes and max fragment length negotiation are chosen in the
+ * core's sdkconfig, not at runtime.
+ */
+static String getTlsBufferInfo() {
+#if defined(CONFIG_MBEDTLS_ASYMMETRIC_CONTENT_LEN) && defined(CONFIG_MBEDTLS_SSL_IN_CONTENT_LEN)
+    String info = "in " + String(CONFIG_MBEDTLS_SSL_IN_CONTENT_LEN) + " / out " +
+                  String(CONFIG_MBEDTLS_SSL_OUT_CONTENT_LEN) + " bytes";
+#elif defined(CONFIG_MBEDTLS_SSL_MAX_CONTENT_LEN)
+    String info = String(CONFIG_MBEDTLS_SSL_MAX_CONTENT_LEN) + " bytes each way";
+#else
+    String info = "core default";
+#endif
+#ifdef CONFIG_MBEDTLS_DYNAMIC_BUFFER
+    info += ", dynamic";
+#endif
+#ifdef CONFIG_MBEDTLS_SSL_MAX_FRAGMENT_LENGTH
+    info += ", MFL compiled in";
+#endif
+    return info;
+}
 
 /**
  * @brief Constructor
@@ -21,10 +111,62 @@ MicroSafari::MicroSafari() {
     _consecutiveFailures = 0;
     _maxConsecutiveFailures = 5;
     _lastErrorTime = 0;
-    _lastErrorMessage = "";
+    _lastError = MicroSafariErrorMessage();
     _autoReconnect = true;
     _debug = false;
     _commandCallback = nullptr;
+    _transport = nullptr;
+    _transportSecure = false;
+    _httpClient = nullptr;
+    _lastTransportUse = 0;
+    _transportIdleTimeout = 30000; // 30 seconds default
+    memset(&_transportStats, 0, sizeof(_transportStats));
+    _prewarmEnabled = true;
+    _prewarmPending = false;
+    _lastPrewarm = 0;
+    _announcedSend = 0;
+    _sendAnnounced = false;
+    memset(&_prewarmStats, 0, sizeof(_prewarmStats));
+    _prewarmStats.setupMs = PREWARM_INITIAL_SETUP;
+    memset(_memoryStats, 0, sizeof(_memoryStats));
+    _acquisition = nullptr;
+    _capture = nullptr;
+    _captureWindow = 60000; // 1 minute default
+    _captureWindowStart = 0;
+    _waveform = nullptr;
+    _log = nullptr;
+    _archive = nullptr;
+    _waveformInterval = 60000; // 1 minute default
+    _lastWaveformCapture = 0;
+    _lastRuleEventFlush = 0;
+    _readingCache.setListener(onReading, this);
+    _ruleEngine.setActionHandler(onRuleAction, this);
+    _shadow.setActionHandler(onShadowAction, this);
+    _lastShadowApply = 0;
+    _lastShadowSync = 0;
+    _retentionStore = nullptr;
+    _lastRetentionDrain = 0;
+    _retentionDrainBatch = MICROSAFARI_RETENTION_DRAIN_BATCH;
+    _remoteConfigEnabled = false;
+    _remoteConfigInterval = 3600000; // 1 hour default
+    _lastRemoteConfigFetch = 0;
+    _commandPollingEnabled = false;
+    _commandPollInterval = 30000; // 30 seconds default
+    _lastCommandPoll = 0;
+    _configCommandsEnabled = true;
+    _persistConfigCommands = false;
+    _pendingAckCount = 0;
+    _lastAckFlush = 0;
+    _commandCursor = 0;
+    _commandPolls = 0;
+    _emptyCommandPolls = 0;
+    _headerOnlyCommandPolls = 0;
+    _batchEntries = 0;
+    _batchSize = 8;
+    _batchInterval = 30000; // 30 seconds default
+    _adaptiveBatching = false;
+    _lastRssiSample = 0;
+    _batchStarted = 0;
 }
 
 /**
@@ -39,6 +181,11 @@ MicroSafari::~MicroSafari() {
  */
 void MicroSafari::debugPrint(const String& message) {
     if (_debug) {
+        // Records the ring cannot take are counted as dropped, never waited for
+        if (_log != nullptr && _log->isRunning()) {
+            _log->write(message);
+            return;
+        }
         Serial.print("[MicroSafari] ");
         Serial.println(message);
     }
@@ -52,6 +199,7 @@ bool MicroSafari::begin(const String& ssid,
                         const String& apiKey,
                         const String& platformUrl,
                         const String& deviceName) {
+    MicroSafariMemoryProbe probe(_memoryStats[MICROSAFARI_API_BEGIN]);
     debugPrint("Initializing MicroSafari library...");
     
     // Validate parameters
@@ -76,6 +224,13 @@ bool MicroSafari::begin(const String& ssid,
     WiFi.mode(WIFI_STA);
     WiFi.setHostname(_deviceName.c_str());
     
+    // Values set by persisted configuration commands
+    loadCommandConfig();
+    
+    // Scheduled commands and local rules survive reboots
+    loadSchedule();
+    loadRules();
+    
     debugPrint("Configuration stored successfully");
     debugPrint("Device name: " + _deviceName);
     debugPrint("Platform URL: " + _platformUrl);
@@ -87,6 +242,7 @@ bool MicroSafari::begin(const String& ssid,
  * @brief Connect to WiFi network
  */
 bool MicroSafari::connectWiFi(unsigned long timeout) {
+    MicroSafariMemoryProbe probe(_memoryStats[MICROSAFARI_API_CONNECT_WIFI]);
     debugPrint("Attempting WiFi connection...");
     debugPrint("SSID: " + _ssid);
     
@@ -119,9 +275,7 @@ bool MicroSafari::connectWiFi(unsigned long timeout) {
         return true;
     } else {
         _status = MICROSAFARI_ERROR;
-        String errorMsg = "WiFi connection failed (status: " + String(WiFi.status()) + ")";
-        debugPrint(errorMsg);
-        handleConnectionFailure(errorMsg);
+        handleConnectionFailure(MicroSafariErrorMessage(MICROSAFARI_ERROR_WIFI, WiFi.status(), "connection failed"));
         return false;
     }
 }
@@ -137,6 +291,7 @@ bool MicroSafari::isWiFiConnected() {
  * @brief Test connection to MicroSafari platform
  */
 bool MicroSafari::testConnection() {
+    MicroSafariMemoryProbe probe(_memoryStats[MICROSAFARI_API_TEST_CONNECTION]);
     if (!isWiFiConnected()) {
         debugPrint("Cannot test connection - WiFi not connected");
         return false;
@@ -167,11 +322,16 @@ bool MicroSafari::testConnection() {
  * @brief Send sensor data with JsonObject
  */
 MicroSafariResponse MicroSafari::sendSensorData(const JsonObject& sensorData) {
+    MicroSafariMemoryProbe probe(_memoryStats[MICROSAFARI_API_SEND_SENSOR_DATA]);
     debugPrint("Preparing to send sensor data...");
     
+    // Keep numeric readings available for local queries
+    recordReadings(sensorData);
+    
     // Create the complete payload structure expected by /api/ingest
-    DynamicJsonDocument doc(1024);
+    DynamicJsonDocument doc(1024 + (_shadow.hasChanges() ? MICROSAFARI_SHADOW_REPORT_CAPACITY : 0));
     doc["payload"] = sensorData;
+    uint32_t shadowReported = attachShadowReport(doc.as<JsonObject>());
     
     String jsonString;
     serializeJson(doc, jsonString);
@@ -181,28 +341,37 @@ MicroSafariResponse MicroSafari::sendSensorData(const JsonObject& sensorData) {
     // Validate JSON structure before sending
     if (!validateJsonPayload(jsonString)) {
         MicroSafariResponse response;
-        response.success = false;
-        response.httpCode = 0;
-        response.errorMessage = "Invalid JSON payload structure";
+        response.fail(MICROSAFARI_ERROR_INVALID_PAYLOAD);
         return response;
     }
     
-    return performHttpRequest("/api/ingest", jsonString);
+    MicroSafariResponse response = performHttpRequest("/api/ingest", jsonString);
+    
+    if (response.success) {
+        _shadow.clearChanges(shadowReported);
+        handleShadowResponse(response.payload);
+    }
+    
+    // Keep readings for later unless the platform rejected them
+    if (!response.success && response.httpCode != 400 && response.httpCode != 401) {
+        retainReadings(sensorData);
+    }
+    
+    return response;
 }
 
 /**
  * @brief Send raw JSON string data
  */
 MicroSafariResponse MicroSafari::sendRawData(const String& jsonPayload) {
+    MicroSafariMemoryProbe probe(_memoryStats[MICROSAFARI_API_SEND_RAW_DATA]);
     debugPrint("Preparing to send raw JSON data...");
     debugPrint("Raw JSON payload: " + jsonPayload);
     
     // Validate JSON structure before sending
     if (!validateJsonPayload(jsonPayload)) {
         MicroSafariResponse response;
-        response.success = false;
-        response.httpCode = 0;
-        response.errorMessage = "Invalid JSON payload structure";
+        response.fail(MICROSAFARI_ERROR_INVALID_PAYLOAD);
         return response;
     }
     
@@ -241,213 +410,995 @@ MicroSafariResponse MicroSafari::sendSensorData(float temperature,
 }
 
 /**
- * @brief Get current status
+ * @brief Store numeric readings in the reading cache
  */
-MicroSafariStatus MicroSafari::getStatus() {
-    return _status;
+void MicroSafari::recordReadings(const JsonObject& sensorData) {
+    unsigned long now = millis();
+    
+    for (JsonPair reading : sensorData) {
+        // Skip metadata such as the send timestamp
+        if (strcmp(reading.key().c_str(), "timestamp") == 0) {
+            continue;
+        }
+        
+        if (reading.value().is<float>()) {
+            _readingCache.record(reading.key().c_str(), reading.value().as<float>(), now);
+            if (_archive != nullptr) {
+                _archive->record(reading.key().c_str(), reading.value().as<float>());
+            }
+        }
+    }
 }
 
 /**
- * @brief Get status as string
+ * @brief Keep numeric readings in the retention store
  */
-String MicroSafari::getStatusString() {
-    switch (_status) {
-        case MICROSAFARI_DISCONNECTED:
-            return "Disconnected";
-        case MICROSAFARI_WIFI_CONNECTING:
-            return "WiFi Connecting";
-        case MICROSAFARI_WIFI_CONNECTED:
-            return "WiFi Connected";
-        case MICROSAFARI_PLATFORM_CONNECTED:
-            return "Platform Connected";
-        case MICROSAFARI_ERROR:
-            return "Error";
-        default:
-            return "Unknown";
+void MicroSafari::retainReadings(const JsonObject& sensorData) {
+    if (_retentionStore == nullptr) {
+        return;
+    }
+    
+    size_t retained = 0;
+    for (JsonPair reading : sensorData) {
+        if (strcmp(reading.key().c_str(), "timestamp") == 0) {
+            continue;
+        }
+        
+        if (reading.value().is<float>() &&
+            _retentionStore->record(reading.key().c_str(), reading.value().as<float>())) {
+            retained++;
+        }
     }
+    
+    debugPrint("Retained " + String(retained) + " readings in flash");
 }
 
 /**
- * @brief Get WiFi signal strength
+ * @brief Set retention store
  */
-int MicroSafari::getWiFiSignalStrength() {
-    if (isWiFiConnected()) {
-        return WiFi.RSSI();
-    }
-    return -999; // Invalid signal strength
+void MicroSafari::setRetentionStore(MicroSafariRetentionStore* store) {
+    _retentionStore = store;
+    debugPrint(store != nullptr ? "Retention store enabled" : "Retention store disabled");
 }
 
 /**
- * @brief Set debug mode
+ * @brief Send one batch of retained readings
  */
-void MicroSafari::setDebug(bool enable) {
-    _debug = enable;
-    debugPrint(enable ? "Debug mode enabled" : "Debug mode disabled");
+size_t MicroSafari::drainRetention(size_t maxRecords) {
+    MicroSafariMemoryProbe probe(_memoryStats[MICROSAFARI_API_DRAIN_RETENTION]);
+    if (_retentionStore == nullptr || !isWiFiConnected()) {
+        return 0;
+    }
+    
+    MicroSafariRetentionRecord records[MICROSAFARI_RETENTION_DRAIN_BATCH];
+    size_t count = _retentionStore->peekBatch(records, min(maxRecords, (size_t)MICROSAFARI_RETENTION_DRAIN_BATCH));
+    if (count == 0) {
+        return 0;
+    }
+    
+    debugPrint("Draining " + String(count) + " retained records...");
+    
+    DynamicJsonDocument doc(256 + count * 192);
+    JsonObject payload = doc.createNestedObject("payload");
+    payload["device_name"] = _deviceName;
+    payload["device_uptime"] = millis() / 1000; // Reference for uptime-stamped records
+    
+    JsonArray retained = payload.createNestedArray("retained");
+    for (size_t i = 0; i < count; i++) {
+        const MicroSafariRetentionRecord& record = records[i];
+        JsonObject item = retained.createNestedObject();
+        item["metric"] = record.metric;
+        item["timestamp"] = record.timestamp;
+        item["epoch"] = (record.flags & MICROSAFARI_RETENTION_FLAG_EPOCH) != 0;
+        item["resolution_s"] = MicroSafariRetentionStore::getResolutionSeconds((MicroSafariRetentionTier)record.tier);
+        item["value"] = record.mean;
+        if (record.count > 1) {
+            item["min"] = record.min;
+            item["max"] = record.max;
+            item["count"] = record.count;
+        }
+    }
+    
+    String jsonString;
+    serializeJson(doc, jsonString);
+    
+    MicroSafariResponse response = performHttpRequest("/api/ingest", jsonString);
+    if (!response.success) {
+        debugPrint("Retention drain failed: " + response.errorMessage);
+        return 0;
+    }
+    
+    _retentionStore->commitBatch();
+    debugPrint("Drained " + String(count) + " retained records");
+    return count;
 }
 
 /**
- * @brief Set connection timeout
+ * @brief Enable/disable remote configuration
  */
-void MicroSafari::setConnectionTimeout(unsigned long timeout) {
-    _connectionTimeout = timeout;
-    debugPrint("Connection timeout set to " + String(timeout) + "ms");
+void MicroSafari::setRemoteConfig(bool enable, unsigned long interval) {
+    _remoteConfigEnabled = enable;
+    _remoteConfigInterval = interval;
+    _lastRemoteConfigFetch = 0;
+    debugPrint("Remote config " + String(enable ? "enabled" : "disabled") +
+               ", interval " + String(interval) + "ms");
+    
+    if (enable) {
+        loadCachedConfig();
+    }
 }
 
 /**
- * @brief Set HTTP retry configuration
+ * @brief Load cached remote configuration from NVS
  */
-void MicroSafari::setRetryConfig(int maxRetries, unsigned long retryDelay) {
-    _maxRetries = maxRetries;
-    _retryDelay = retryDelay;
-    debugPrint("Retry config set: " + String(maxRetries) + " retries, " + String(retryDelay) + "ms delay");
+void MicroSafari::loadCachedConfig() {
+    Preferences preferences;
+    if (!preferences.begin(PREFERENCES_NAMESPACE, true)) {
+        return;
+    }
+    String cachedEtag = preferences.getString("cfg_etag", "");
+    String cachedDoc = preferences.getString("cfg_doc", "");
+    preferences.end();
+    
+    if (cachedDoc.isEmpty()) {
+        return;
+    }
+    
+    DynamicJsonDocument doc(1024);
+    if (deserializeJson(doc, cachedDoc) != DeserializationError::Ok) {
+        debugPrint("Cached remote config is invalid, ignoring");
+        return;
+    }
+    
+    JsonObject config = doc.containsKey("config") ? doc["config"].as<JsonObject>() : doc.as<JsonObject>();
+    if (applyConfig(config)) {
+        _remoteConfigEtag = cachedEtag;
+        debugPrint("Applied cached remote config " + cachedEtag);
+    }
 }
 
 /**
- * @brief Set heartbeat interval
+ * @brief Fetch remote configuration
  */
-void MicroSafari::setHeartbeatInterval(unsigned long interval) {
-    _heartbeatInterval = interval;
-    debugPrint("Heartbeat interval set to " + String(interval) + "ms");
+bool MicroSafari::fetchRemoteConfig() {
+    MicroSafariMemoryProbe probe(_memoryStats[MICROSAFARI_API_FETCH_REMOTE_CONFIG]);
+    debugPrint("Fetching remote config...");
+    _lastRemoteConfigFetch = millis();
+    
+    MicroSafariHttpHeader header = { "If-None-Match", _remoteConfigEtag };
+    MicroSafariResponse response = performHttpRequest("/api/devices/config", "{}", "GET",
+                                                      &header, _remoteConfigEtag.isEmpty() ? 0 : 1);
+    
+    if (!response.success) {
+        debugPrint("Remote config fetch failed: " + response.errorMessage);
+        return false;
+    }
+    
+    if (response.httpCode == HTTP_CODE_NOT_MODIFIED) {
+        debugPrint("Remote config unchanged");
+        return true;
+    }
+    
+    DynamicJsonDocument doc(1024);
+    DeserializationError error = deserializeJson(doc, response.payload);
+    if (error) {
+        debugPrint("Failed to parse remote config: " + String(error.c_str()));
+        return false;
+    }
+    
+    JsonObject config = doc.containsKey("config") ? doc["config"].as<JsonObject>() : doc.as<JsonObject>();
+    if (!applyConfig(config)) {
+        return false;
+    }
+    
+    _remoteConfigEtag = _responseHeaders[RESPONSE_HEADER_ETAG];
+    
+    Preferences preferences;
+    if (preferences.begin(PREFERENCES_NAMESPACE, false)) {
+        preferences.putString("cfg_etag", _remoteConfigEtag);
+        preferences.putString("cfg_doc", response.payload);
+        preferences.end();
+    }
+    
+    debugPrint("Remote config applied" + (_remoteConfigEtag.isEmpty() ? String("") : " (ETag " + _remoteConfigEtag + ")"));
+    return true;
 }
 
 /**
- * @brief Force immediate heartbeat
+ * @brief Validate and apply a configuration document
  */
-bool MicroSafari::forceHeartbeat() {
-    return sendHeartbeat();
+bool MicroSafari::applyConfig(const JsonObject& config) {
+    if (config.isNull()) {
+        return false;
+    }
+    
+    // Validate everything first so a bad document changes nothing
+    for (JsonPair entry : config) {
+        if (!validateConfigValue(entry.key().c_str(), entry.value())) {
+            debugPrint("Rejected config value for " + String(entry.key().c_str()));
+            return false;
+        }
+    }
+    
+    for (JsonPair entry : config) {
+        applyConfigValue(entry.key().c_str(), entry.value());
+    }
+    
+    return true;
 }
 
 /**
- * @brief Get last heartbeat timestamp
+ * @brief Validate a configuration value
  */
-unsigned long MicroSafari::getLastHeartbeat() {
-    return _lastHeartbeat;
+bool MicroSafari::validateConfigValue(const char* key, const JsonVariant& value) {
+    const ConfigLimit* limit = findConfigLimit(key);
+    if (limit == nullptr) {
+        // Unknown keys are ignored so newer platforms can add settings
+        return true;
+    }
+    
+    long number;
+    if (value.is<bool>()) {
+        number = value.as<bool>() ? 1 : 0;
+    } else if (value.is<long>()) {
+        number = value.as<long>();
+    } else {
+        return false;
+    }
+    return number >= limit->minValue && number <= limit->maxValue;
 }
 
 /**
- * @brief Check if platform is actively connected
+ * @brief Apply a validated configuration value
  */
-bool MicroSafari::isPlatformActive() {
-    if (!isWiFiConnected()) {
-        return false;
+void MicroSafari::applyConfigValue(const char* key, const JsonVariant& value) {
+    long number = value.is<bool>() ? (value.as<bool>() ? 1 : 0) : value.as<long>();
+    
+    if (strcmp(key, "heartbeat_interval_ms") == 0) {
+        setHeartbeatInterval(number);
+    } else if (strcmp(key, "max_retries") == 0) {
+        setRetryConfig(number, _retryDelay);
+    } else if (strcmp(key, "retry_delay_ms") == 0) {
+        setRetryConfig(_maxRetries, number);
+    } else if (strcmp(key, "connection_timeout_ms") == 0) {
+        setConnectionTimeout(number);
+    } else if (strcmp(key, "max_consecutive_failures") == 0) {
+        setMaxConsecutiveFailures(number);
+    } else if (strcmp(key, "auto_reconnect") == 0) {
+        setAutoReconnect(number != 0);
+    } else if (strcmp(key, "retention_batch") == 0) {
+        _retentionDrainBatch = number;
+    } else if (strcmp(key, "config_interval_ms") == 0) {
+        _remoteConfigInterval = number;
+    } else if (strcmp(key, "batch_size") == 0) {
+        _batchSize = number;
+    } else if (strcmp(key, "command_poll_interval_ms") == 0) {
+        _commandPollInterval = number;
     }
-    
-    // Consider platform active if last heartbeat was within 2x the interval
-    return (millis() - _lastHeartbeat) < (_heartbeatInterval * 2);
 }
 
 /**
- * @brief Handle connection failure
+ * @brief Handle a reserved configuration command
  */
-void MicroSafari::handleConnectionFailure(const String& errorMessage) {
-    _consecutiveFailures++;
-    _lastErrorTime = millis();
-    _lastErrorMessage = errorMessage;
+bool MicroSafari::handleConfigCommand(const String& dataSource, const JsonVariant& value) {
+    if (!_configCommandsEnabled) {
+        debugPrint("Config commands disabled, rejecting " + dataSource);
+        return false;
+    }
     
-    debugPrint("Connection failure #" + String(_consecutiveFailures) + ": " + errorMessage);
+    // Platform values usually arrive as strings: "60000", "true", "{...}"
+    DynamicJsonDocument parsed(512);
+    JsonVariant input = value;
+    if (value.is<const char*>()) {
+        if (deserializeJson(parsed, value.as<const char*>()) != DeserializationError::Ok) {
+            debugPrint("Invalid config command value for " + dataSource);
+            return false;
+        }
+        input = parsed.as<JsonVariant>();
+    }
     
-    if (_consecutiveFailures >= _maxConsecutiveFailures) {
-        debugPrint("Maximum consecutive failures reached, resetting connection...");
-        resetConnectionState();
+    DynamicJsonDocument doc(512);
+    JsonObject config = doc.to<JsonObject>();
+    size_t prefixLength = strlen(CONFIG_COMMAND_PREFIX);
+    
+    if (dataSource.length() == prefixLength) {
+        // "__cfg": several keys at once
+        if (!input.is<JsonObject>()) {
+            return false;
+        }
+        config.set(input.as<JsonObject>());
+    } else if (dataSource.charAt(prefixLength) == '.') {
+        // "__cfg.<key>": a single key
+        config[dataSource.substring(prefixLength + 1)] = input;
+    } else {
+        return false;
+    }
+    
+    // Unlike remote configuration documents, commands must not name unknown keys
+    for (JsonPair entry : config) {
+        if (findConfigLimit(entry.key().c_str()) == nullptr) {
+            debugPrint("Unknown config key " + String(entry.key().c_str()));
+            return false;
+        }
     }
+    
+    if (!applyConfig(config)) {
+        return false;
+    }
+    debugPrint("Config command applied: " + dataSource);
+    
+    if (_persistConfigCommands) {
+        Preferences preferences;
+        if (preferences.begin(PREFERENCES_NAMESPACE, false)) {
+            DynamicJsonDocument stored(1024);
+            String storedDoc = preferences.getString("cfg_cmd", "");
+            if (storedDoc.isEmpty() || deserializeJson(stored, storedDoc) != DeserializationError::Ok) {
+                stored.to<JsonObject>();
+            }
+            for (JsonPair entry : config) {
+                stored[entry.key()] = entry.value();
+            }
+            
+            storedDoc = "";
+            serializeJson(stored, storedDoc);
+            preferences.putString("cfg_cmd", storedDoc);
+            preferences.end();
+        }
+    }
+    
+    return true;
 }
 
 /**
- * @brief Reset connection state
+ * @brief Apply configuration persisted by commands
  */
-void MicroSafari::resetConnectionState() {
-    debugPrint("Resetting connection state...");
-    
-    // Disconnect and reset WiFi
-    WiFi.disconnect();
-    delay(1000);
-    
-    // Reset internal state
-    _status = MICROSAFARI_DISCONNECTED;
-    _consecutiveFailures = 0;
-    _lastConnectionAttempt = 0;
+void MicroSafari::loadCommandConfig() {
+    Preferences preferences;
+    if (!preferences.begin(PREFERENCES_NAMESPACE, true)) {
+        return;
+    }
+    String storedDoc = preferences.getString("cfg_cmd", "");
+    preferences.end();
     
-    // Reinitialize WiFi
-    WiFi.mode(WIFI_STA);
-    WiFi.setHostname(_deviceName.c_str());
+    if (storedDoc.isEmpty()) {
+        return;
+    }
     
-    debugPrint("Connection state reset complete");
+    DynamicJsonDocument doc(1024);
+    if (deserializeJson(doc, storedDoc) == DeserializationError::Ok && applyConfig(doc.as<JsonObject>())) {
+        debugPrint("Applied persisted config commands");
+    }
 }
 
 /**
- * @brief Get WiFi diagnostics
+ * @brief Enable/disable automatic command polling
  */
-String MicroSafari::getWiFiDiagnostics() {
-    String diagnostics = "WiFi Diagnostics:\n";
-    diagnostics += "Status: " + String(WiFi.status()) + "\n";
-    diagnostics += "SSID: " + WiFi.SSID() + "\n";
-    diagnostics += "RSSI: " + String(WiFi.RSSI()) + " dBm\n";
-    diagnostics += "IP: " + WiFi.localIP().toString() + "\n";
-    diagnostics += "Gateway: " + WiFi.gatewayIP().toString() + "\n";
-    diagnostics += "DNS: " + WiFi.dnsIP().toString() + "\n";
-    diagnostics += "MAC: " + WiFi.macAddress() + "\n";
-    return diagnostics;
+void MicroSafari::setCommandPolling(bool enable, unsigned long interval) {
+    _commandPollingEnabled = enable;
+    _commandPollInterval = interval;
+    debugPrint("Command polling " + String(enable ? "enabled" : "disabled") +
+               ", interval " + String(interval) + "ms");
 }
 
 /**
- * @brief Enable/disable auto-reconnect
+ * @brief Configure reserved configuration commands
  */
-void MicroSafari::setAutoReconnect(bool enable) {
-    _autoReconnect = enable;
-    debugPrint("Auto-reconnect " + String(enable ? "enabled" : "disabled"));
+void MicroSafari::setConfigCommands(bool enable, bool persist) {
+    _configCommandsEnabled = enable;
+    _persistConfigCommands = persist;
+    debugPrint("Config commands " + String(enable ? "enabled" : "disabled") +
+               (persist ? " (persisted)" : ""));
 }
 
 /**
- * @brief Set max consecutive failures
+ * @brief Queue sensor data for the next batch
  */
-void MicroSafari::setMaxConsecutiveFailures(int maxFailures) {
-    _maxConsecutiveFailures = maxFailures;
-    debugPrint("Max consecutive failures set to " + String(maxFailures));
+bool MicroSafari::queueSensorData(const JsonObject& sensorData) {
+    recordReadings(sensorData);
+    return enqueueBatchEntry(_apiKey.c_str(), _deviceName.c_str(), sensorData);
 }
 
 /**
- * @brief Get connection diagnostics
+ * @brief Add entry to the shared batch
  */
-String MicroSafari::getConnectionDiagnostics() {
-    String diagnostics = "=== MicroSafari Connection Diagnostics ===\n";
-    diagnostics += "Status: " + getStatusString() + "\n";
-    diagnostics += "Platform Active: " + String(isPlatformActive() ? "Yes" : "No") + "\n";
-    diagnostics += "Consecutive Failures: " + String(_consecutiveFailures) + "/" + String(_maxConsecutiveFailures) + "\n";
-    diagnostics += "Last Heartbeat: " + String((millis() - _lastHeartbeat) / 1000) + "s ago\n";
-    diagnostics += "Auto-reconnect: " + String(_autoReconnect ? "Enabled" : "Disabled") + "\n";
-    diagnostics += "Free Heap: " + String(ESP.getFreeHeap()) + " bytes\n";
-    diagnostics += "Uptime: " + String(millis() / 1000) + "s\n";
+bool MicroSafari::enqueueBatchEntry(const char* apiKey, const char* deviceName, const JsonObject& sensorData) {
+    if (_batchEntries >= MICROSAFARI_BATCH_MAX_ENTRIES) {
+        debugPrint("Batch queue full, entry rejected");
+        return false;
+    }
     
-    if (isWiFiConnected()) {
-        diagnostics += getWiFiDiagnostics();
+    DynamicJsonDocument doc(1024);
+    doc["api_key"] = apiKey;
+    JsonObject payload = doc.createNestedObject("payload");
+    payload.set(sensorData);
+    if (!payload.containsKey("device_name")) {
+        payload["device_name"] = deviceName;
     }
     
-    if (!_lastErrorMessage.isEmpty()) {
-        diagnostics += "\nLast Error: " + _lastErrorMessage + "\n";
-        diagnostics += "Error Time: " + String((millis() - _lastErrorTime) / 1000) + "s ago\n";
+    String entry;
+    serializeJson(doc, entry);
+    
+    if (_batchBuffer.length() + entry.length() + 1 > MICROSAFARI_BATCH_MAX_BYTES) {
+        debugPrint("Batch buffer full, entry rejected");
+        return false;
     }
     
-    return diagnostics;
-}
-
-/**
- * @brief Get last error information
- */
-String MicroSafari::getLastError() {
-    if (_lastErrorMessage.isEmpty()) {
-        return "No errors recorded";
+    if (_batchEntries == 0) {
+        _batchStarted = millis();
+    } else {
+        _batchBuffer += ',';
     }
+    _batchBuffer += entry;
+    _batchEntries++;
     
-    return "[" + String((millis() - _lastErrorTime) / 1000) + "s ago] " + _lastErrorMessage;
+    debugPrint("Queued batch entry for " + String(deviceName) + " (" + String(_batchEntries) + " queued)");
+    return true;
 }
 
 /**
- * @brief Clear error history
+ * @brief Send queued batch entries
  */
-void MicroSafari::clearErrors() {
-    _consecutiveFailures = 0;
-    _lastErrorTime = 0;
-    _lastErrorMessage = "";
+MicroSafariResponse MicroSafari::flushBatch() {
+    MicroSafariMemoryProbe probe(_memoryStats[MICROSAFARI_API_FLUSH_BATCH]);
+    if (_batchEntries == 0) {
+        MicroSafariResponse response;
+        response.fail(MICROSAFARI_ERROR_NO_DATA, "no queued batch entries");
+        return response;
+    }
+    
+    debugPrint("Sending batch of " + String(_batchEntries) + " entries...");
+    
+    String jsonString;
+    jsonString.reserve(_batchBuffer.length() + 16);
+    jsonString = "{\"entries\":[";
+    jsonString += _batchBuffer;
+    jsonString += "]";
+    
+    // Shadow changes of this instance ride along with the batch
+    uint32_t shadowReported = 0;
+    if (_shadow.hasChanges()) {
+        DynamicJsonDocument shadowDoc(JSON_OBJECT_SIZE(1) + MICROSAFARI_SHADOW_REPORT_CAPACITY);
+        shadowReported = attachShadowReport(shadowDoc.to<JsonObject>());
+        jsonString += ",\"shadow\":";
+        serializeJson(shadowDoc["shadow"], jsonString);
+    }
+    jsonString += "}";
+    
+    MicroSafariResponse response = performHttpRequest("/api/ingest/batch", jsonString);
+    
+    if (response.success) {
+        _shadow.clearChanges(shadowReported);
+        handleShadowResponse(response.payload);
+    }
+    
+    // Keep the batch for the next attempt unless it was sent or rejected
+    if (response.success || response.httpCode == 400 || response.httpCode == 401) {
+        _batchBuffer = "";
+        _batchEntries = 0;
+    }
+    
+    return response;
+}
+
+/**
+ * @brief Set batch flush thresholds
+ */
+void MicroSafari::setBatchConfig(size_t maxEntries, unsigned long interval) {
+    _batchSize = constrain(maxEntries, (size_t)1, (size_t)MICROSAFARI_BATCH_MAX_ENTRIES);
+    _batchInterval = interval;
+    debugPrint("Batch config set: " + String(_batchSize) + " entries, " + String(interval) + "ms");
+}
+
+/**
+ * @brief Get number of queued batch entries
+ */
+size_t MicroSafari::getQueuedCount() {
+    return _batchEntries;
+}
+
+/**
+ * @brief Enable or disable link-quality-driven batching
+ */
+void MicroSafari::setAdaptiveBatching(bool enabled) {
+    _adaptiveBatching = enabled;
+}
+
+/**
+ * @brief Get link quality estimate
+ */
+const MicroSafariLinkStats& MicroSafari::getLinkStats() const {
+    return _link.getStats();
+}
+
+/**
+ * @brief Get ingest budget state
+ */
+const MicroSafariFlowStats& MicroSafari::getFlowStats() const {
+    return _flowControl.getStats();
+}
+
+/**
+ * @brief Update ingest budget from last response
+ */
+void MicroSafari::applyFlowControl(int httpCode) {
+    unsigned long now = millis();
+    bool overloaded = httpCode == 429 || httpCode == 503;
+    bool budget = false;
+    
+    const String& interval = _responseHeaders[RESPONSE_HEADER_INGEST_INTERVAL];
+    if (!interval.isEmpty()) {
+        _flowControl.setServerInterval(max(interval.toInt(), 0L), now);
+        budget = true;
+    }
+    // Only delta-seconds are understood; an HTTP date falls back to AIMD
+    long retryAfter = _responseHeaders[RESPONSE_HEADER_RETRY_AFTER].toInt();
+    if (overloaded && retryAfter > 0) {
+        _flowControl.holdFor(retryAfter * 1000UL, now);
+        budget = true;
+    }
+    
+    if (overloaded && !budget) {
+        _flowControl.onOverload();
+    } else if (httpCode >= 200 && httpCode < 300) {
+        _flowControl.onAccepted();
+    }
+    if (overloaded || budget) {
+        debugPrint("Ingest paced: " + String(_flowControl.getInterval(now)) + "ms between requests, next in " +
+                   String(_flowControl.getWait(now)) + "ms");
+    }
+}
+
+/**
+ * @brief Get batch size in effect
+ */
+size_t MicroSafari::getActiveBatchSize() const {
+    if (!_adaptiveBatching) {
+        return _batchSize;
+    }
+    return _link.getBatchSize(_batchSize, MICROSAFARI_BATCH_MAX_ENTRIES);
+}
+
+/**
+ * @brief Get batch interval in effect
+ */
+unsigned long MicroSafari::getActiveBatchInterval() const {
+    if (!_adaptiveBatching) {
+        return _batchInterval;
+    }
+    return _link.getBatchInterval(_batchInterval);
+}
+
+/**
+ * @brief Sample link and apply level changes
+ */
+void MicroSafari::updateLinkQuality() {
+    if (millis() - _lastRssiSample < 5000) { // RSSI every 5 seconds
+        return;
+    }
+    _lastRssiSample = millis();
+    _link.addRssi(WiFi.RSSI());
+    
+    if (!_link.update(millis()) || !_adaptiveBatching) {
+        return;
+    }
+    
+    // Record the decision with the metrics, so the platform sees why the cadence changed
+    const MicroSafariLinkStats& link = _link.getStats();
+    debugPrint("Link " + String(MicroSafariLinkController::getLevelName(link.level)) +
+               " (score " + String(link.score) + "): batch " + String(getActiveBatchSize()) +
+               " entries, " + String(getActiveBatchInterval()) + "ms");
+    
+    DynamicJsonDocument doc(384);
+    JsonObject decision = doc.to<JsonObject>();
+    _link.populate(decision);
+    decision["batch_size"] = getActiveBatchSize();
+    decision["batch_interval_ms"] = getActiveBatchInterval();
+    decision["timestamp"] = millis();
+    // Diagnostics, not readings: bypass the reading cache, rules and archive
+    if (!enqueueBatchEntry(_apiKey.c_str(), _deviceName.c_str(), decision)) {
+        debugPrint("Link decision not recorded, batch is full");
+    }
+}
+
+/**
+ * @brief Register a non-blocking sensor
+ */
+bool MicroSafari::registerSensor(const char* metric,
+                                 MicroSafariSensorStep step,
+                                 void* context,
+                                 unsigned long minInterval,
+                                 unsigned long ttl) {
+    if (_sensorRegistry.registerSensor(metric, step, context, minInterval, ttl) < 0) {
+        debugPrint("Failed to register sensor " + String(metric));
+        return false;
+    }
+    
+    debugPrint("Registered sensor " + String(metric) + " (interval " + String(minInterval) +
+               "ms, TTL " + String(ttl) + "ms)");
+    return true;
+}
+
+/**
+ * @brief Send cached sensor values
+ */
+MicroSafariResponse MicroSafari::sendCachedSensorData() {
+    MicroSafariMemoryProbe probe(_memoryStats[MICROSAFARI_API_SEND_CACHED_SENSOR_DATA]);
+    DynamicJsonDocument doc(256 + MICROSAFARI_MAX_SENSORS * 48);
+    JsonObject sensorData = doc.to<JsonObject>();
+    
+    if (_sensorRegistry.populate(sensorData) == 0) {
+        MicroSafariResponse response;
+        response.fail(MICROSAFARI_ERROR_NO_DATA, "no valid cached sensor values");
+        return response;
+    }
+    
+    // Add timestamp and device info
+    sensorData["timestamp"] = millis();
+    sensorData["device_name"] = _deviceName;
+    
+    return sendSensorData(sensorData);
+}
+
+/**
+ * @brief Set continuous ADC acquisition
+ */
+void MicroSafari::setAcquisition(MicroSafariAcquisition* acquisition) {
+    if (_acquisition != nullptr) {
+        _acquisition->setReadingCache(nullptr);
+    }
+    _acquisition = acquisition;
+    if (_acquisition != nullptr) {
+        _acquisition->setReadingCache(&_readingCache);
+    }
+    debugPrint(acquisition != nullptr ? "ADC acquisition enabled" : "ADC acquisition disabled");
+}
+
+/**
+ * @brief Set ISR sample capture
+ */
+void MicroSafari::setCapture(MicroSafariCapture* capture, unsigned long window) {
+    _capture = capture;
+    _captureWindow = window;
+    _captureWindowStart = millis();
+    debugPrint(capture != nullptr ? "Sample capture enabled (" + String(window) + "ms window)" : "Sample capture disabled");
+}
+
+/**
+ * @brief Set waveform capture
+ */
+void MicroSafari::setWaveform(MicroSafariWaveform* waveform, unsigned long interval) {
+    _waveform = waveform;
+    _waveformInterval = interval;
+    _lastWaveformCapture = millis();
+    debugPrint(waveform != nullptr ? "Waveform capture enabled (" + String(MICROSAFARI_WAVEFORM_SIZE) +
+                                     " samples every " + String(interval) + "ms, " +
+                                     MicroSafariWaveform::getBackend() + " FFT)"
+                                   : "Waveform capture disabled");
+}
+
+/**
+ * @brief Get the sensor registry
+ */
+MicroSafariSensorRegistry& MicroSafari::getSensorRegistry() {
+    return _sensorRegistry;
+}
+
+/**
+ * @brief Get the reading cache
+ */
+MicroSafariReadingCache& MicroSafari::getReadingCache() {
+    return _readingCache;
+}
+
+/**
+ * @brief Get current status
+ */
+MicroSafariStatus MicroSafari::getStatus() {
+    return _status;
+}
+
+/**
+ * @brief Get status as string
+ */
+String MicroSafari::getStatusString() {
+    switch (_status) {
+        case MICROSAFARI_DISCONNECTED:
+            return "Disconnected";
+        case MICROSAFARI_WIFI_CONNECTING:
+            return "WiFi Connecting";
+        case MICROSAFARI_WIFI_CONNECTED:
+            return "WiFi Connected";
+        case MICROSAFARI_PLATFORM_CONNECTED:
+            return "Platform Connected";
+        case MICROSAFARI_ERROR:
+            return "Error";
+        default:
+            return "Unknown";
+    }
+}
+
+/**
+ * @brief Get WiFi signal strength
+ */
+int MicroSafari::getWiFiSignalStrength() {
+    if (isWiFiConnected()) {
+        return WiFi.RSSI();
+    }
+    return -999; // Invalid signal strength
+}
+
+/**
+ * @brief Set debug mode
+ */
+void MicroSafari::setDebug(bool enable) {
+    _debug = enable;
+    debugPrint(enable ? "Debug mode enabled" : "Debug mode disabled");
+}
+
+/**
+ * @brief Set asynchronous debug log
+ */
+void MicroSafari::setLog(MicroSafariLog* log) {
+    _log = log;
+}
+
+/**
+ * @brief Set SD card archive
+ */
+void MicroSafari::setArchive(MicroSafariArchive* archive) {
+    _archive = archive;
+    debugPrint(archive != nullptr ? "SD archive enabled" : "SD archive disabled");
+}
+
+/**
+ * @brief Set connection timeout
+ */
+void MicroSafari::setConnectionTimeout(unsigned long timeout) {
+    _connectionTimeout = timeout;
+    debugPrint("Connection timeout set to " + String(timeout) + "ms");
+}
+
+/**
+ * @brief Set HTTP retry configuration
+ */
+void MicroSafari::setRetryConfig(int maxRetries, unsigned long retryDelay) {
+    _maxRetries = maxRetries;
+    _retryDelay = retryDelay;
+    debugPrint("Retry config set: " + String(maxRetries) + " retries, " + String(retryDelay) + "ms delay");
+}
+
+/**
+ * @brief Set heartbeat interval
+ */
+void MicroSafari::setHeartbeatInterval(unsigned long interval) {
+    _heartbeatInterval = interval;
+    debugPrint("Heartbeat interval set to " + String(interval) + "ms");
+}
+
+/**
+ * @brief Force immediate heartbeat
+ */
+bool MicroSafari::forceHeartbeat() {
+    return sendHeartbeat().success;
+}
+
+/**
+ * @brief Get last heartbeat timestamp
+ */
+unsigned long MicroSafari::getLastHeartbeat() {
+    return _lastHeartbeat;
+}
+
+/**
+ * @brief Check if platform is actively connected
+ */
+bool MicroSafari::isPlatformActive() {
+    if (!isWiFiConnected()) {
+        return false;
+    }
+    
+    // Consider platform active if last heartbeat was within 2x the interval
+    return (millis() - _lastHeartbeat) < (_heartbeatInterval * 2);
+}
+
+/**
+ * @brief Handle connection failure
+ */
+void MicroSafari::handleConnectionFailure(const MicroSafariErrorMessage& error) {
+    _consecutiveFailures++;
+    _lastErrorTime = millis();
+    _lastError = error;
+    
+    debugPrint("Connection failure #" + String(_consecutiveFailures) + ": " + error);
+    
+    if (_consecutiveFailures >= _maxConsecutiveFailures) {
+        debugPrint("Maximum consecutive failures reached, resetting connection...");
+        resetConnectionState();
+    }
+}
+
+/**
+ * @brief Reset connection state
+ */
+void MicroSafari::resetConnectionState() {
+    debugPrint("Resetting connection state...");
+    
+    // Disconnect and reset WiFi
+    WiFi.disconnect();
+    delay(1000);
+    
+    // Reset internal state
+    _status = MICROSAFARI_DISCONNECTED;
+    _consecutiveFailures = 0;
+    _lastConnectionAttempt = 0;
+    
+    // Reinitialize WiFi
+    WiFi.mode(WIFI_STA);
+    WiFi.setHostname(_deviceName.c_str());
+    
+    debugPrint("Connection state reset complete");
+}
+
+/**
+ * @brief Get WiFi diagnostics
+ */
+String MicroSafari::getWiFiDiagnostics() {
+    String diagnostics = "WiFi Diagnostics:\n";
+    diagnostics += "Status: " + String(WiFi.status()) + "\n";
+    diagnostics += "SSID: " + WiFi.SSID() + "\n";
+    diagnostics += "RSSI: " + String(WiFi.RSSI()) + " dBm\n";
+    diagnostics += "IP: " + WiFi.localIP().toString() + "\n";
+    diagnostics += "Gateway: " + WiFi.gatewayIP().toString() + "\n";
+    diagnostics += "DNS: " + WiFi.dnsIP().toString() + "\n";
+    diagnostics += "MAC: " + WiFi.macAddress() + "\n";
+    return diagnostics;
+}
+
+/**
+ * @brief Enable/disable auto-reconnect
+ */
+void MicroSafari::setAutoReconnect(bool enable) {
+    _autoReconnect = enable;
+    debugPrint("Auto-reconnect " + String(enable ? "enabled" : "disabled"));
+}
+
+/**
+ * @brief Set max consecutive failures
+ */
+void MicroSafari::setMaxConsecutiveFailures(int maxFailures) {
+    _maxConsecutiveFailures = maxFailures;
+    debugPrint("Max consecutive failures set to " + String(maxFailures));
+}
+
+/**
+ * @brief Get connection diagnostics
+ */
+String MicroSafari::getConnectionDiagnostics() {
+    String diagnostics = "=== MicroSafari Connection Diagnostics ===\n";
+    diagnostics += "Status: " + getStatusString() + "\n";
+    diagnostics += "Platform Active: " + String(isPlatformActive() ? "Yes" : "No") + "\n";
+    diagnostics += "Consecutive Failures: " + String(_consecutiveFailures) + "/" + String(_maxConsecutiveFailures) + "\n";
+    diagnostics += "Last Heartbeat: " + String((millis() - _lastHeartbeat) / 1000) + "s ago\n";
+    diagnostics += "Auto-reconnect: " + String(_autoReconnect ? "Enabled" : "Disabled") + "\n";
+    if (_commandPolls > 0) {
+        diagnostics += "Command Polls: " + String(_commandPolls) + " (" +
+                       String(getEmptyPollRatio() * 100, 1) + "% empty, " +
+                       String(_headerOnlyCommandPolls) + " header-only)\n";
+    }
+    const MicroSafariLatencyHistogram& latency = _commandLatency[MICROSAFARI_LATENCY_TOTAL];
+    if (latency.getCount() > 0) {
+        diagnostics += "Command Latency: p50 " + String(latency.getPercentile(50) / 1000.0, 1) +
+                       "ms, p95 " + String(latency.getPercentile(95) / 1000.0, 1) +
+                       "ms, max " + String(latency.getMax() / 1000.0, 1) +
+                       "ms (" + String(latency.getCount()) + " commands)\n";
+    }
+    if (_capture != nullptr) {
+        MicroSafariCaptureStats captureStats = _capture->getStats();
+        diagnostics += "Sample Capture: " + String(captureStats.consumed) + " samples, " +
+                       String(captureStats.dropped) + " dropped, ring peak " +
+                       String(captureStats.highWater) + "/" + String(MICROSAFARI_CAPTURE_RING_SIZE) + "\n";
+    }
+    if (_transportStats.connections > 0) {
+        diagnostics += "Transport: " + String(_transport == nullptr ? "released" : (_transportSecure ? "HTTPS" : "HTTP")) +
+                       ", " + String(_transportStats.connections) + " connections, " +
+                       String(_transportStats.heldBytes) + " bytes held, peak " +
+                       String(_transportStats.peakBytes) + " bytes\n";
+    }
+    if (_prewarmStats.prewarms > 0 || _prewarmStats.failures > 0) {
+        diagnostics += "Prewarm: " + String(_prewarmStats.prewarms) + " prewarms, " +
+                       String(_prewarmStats.used) + " used, " + String(_prewarmStats.unused) + " unused, " +
+                       String(_prewarmStats.failures) + " failed, setup " + String(_prewarmStats.setupMs) + " ms\n";
+    }
+    if (_archive != nullptr) {
+        MicroSafariArchiveStats archive = _archive->getStats();
+        const MicroSafariLatencyHistogram& latency = _archive->getWriteLatency();
+        diagnostics += "SD Archive: " + String(archive.written) + "/" + String(archive.records) + " readings written, " +
+                       String(archive.dropped) + " dropped, " + String(archive.lost) + " lost, " +
+                       String(archive.files) + " files, " + String(archive.throughput / 1024) + " KB/s, write p50 " +
+                       String(latency.getPercentile(50) / 1000.0f, 1) + " ms / p99 " +
+                       String(latency.getPercentile(99) / 1000.0f, 1) + " ms\n";
+    }
+    if (_log != nullptr) {
+        MicroSafariLogStats logStats = _log->getStats();
+        diagnostics += "Debug Log: " + String(logStats.written) + " records, " + String(logStats.dropped) +
+                       " dropped, ring peak " + String(logStats.highWater) + "/" + String(MICROSAFARI_LOG_RING_SIZE) +
+                       " bytes, " + String(logStats.datagrams) + " syslog datagrams\n";
+    }
+    if (_flowControl.getStats().budgets > 0 || _flowControl.getStats().overloads > 0) {
+        const MicroSafariFlowStats& flow = _flowControl.getStats();
+        diagnostics += "Ingest Budget: " + String(_flowControl.getInterval(millis())) + "ms between requests, " +
+                       String(flow.budgets) + " server budgets, " + String(flow.overloads) + " overloads, " +
+                       String(flow.deferred) + " deferred\n";
+    }
+    if (_link.getStats().requests > 0) {
+        const MicroSafariLinkStats& link = _link.getStats();
+        diagnostics += "Link: " + String(MicroSafariLinkController::getLevelName(link.level)) +
+                       " (score " + String(link.score) + "), RSSI " + String(link.rssi, 0) + " dBm, RTT " +
+                       String(link.rttMs, 0) + " ms, loss " + String(link.loss * 100, 1) + "%, " +
+                       String(link.decisions) + " level changes" +
+                       (_adaptiveBatching ? ", batch " + String(getActiveBatchSize()) + " / " +
+                                            String(getActiveBatchInterval()) + "ms" : String()) + "\n";
+    }
+    if (_transportSecure) {
+        diagnostics += "TLS Record Buffers: " + getTlsBufferInfo() + "\n";
+    }
+    if (_waveform != nullptr && _waveform->getCaptureCount() > 0) {
+        const MicroSafariWaveformFeatures& features = _waveform->getFeatures();
+        diagnostics += "Waveform: " + String(_waveform->getCaptureCount()) + " captures, peak " +
+                       String(features.peakFrequency, 1) + "Hz, FFT " + String(features.fftMicros) + "us\n";
+    }
+    if (_shadow.getCount() > 0) {
+        diagnostics += "Shadow Properties: " + String(_shadow.getCount()) +
+                       " (version " + String(_shadow.getVersion()) +
+                       (_shadow.hasChanges() ? ", changes pending" : "") + ")\n";
+    }
+    if (_scheduler.getCount() > 0 || _pendingAckCount > 0) {
+        diagnostics += "Scheduled Commands: " + String(_scheduler.getCount()) +
+                       " (" + String(_pendingAckCount) + " acks pending)\n";
+    }
+    if (_remoteConfigEnabled) {
+        diagnostics += "Remote Config: " + (_remoteConfigEtag.isEmpty() ? String("not received") : _remoteConfigEtag) + "\n";
+    }
+    diagnostics += "Free Heap: " + String(ESP.getFreeHeap()) + " bytes\n";
+    diagnostics += "Uptime: " + String(millis() / 1000) + "s\n";
+    
+    if (isWiFiConnected()) {
+        diagnostics += getWiFiDiagnostics();
+    }
+    
+    if (!_lastError.isEmpty()) {
+        diagnostics += "\nLast Error: " + _lastError + "\n";
+        diagnostics += "Error Time: " + String((millis() - _lastErrorTime) / 1000) + "s ago\n";
+    }
+    
+    return diagnostics;
+}
+
+/**
+ * @brief Get last error information
+ */
+String MicroSafari::getLastError() {
+    if (_lastError.isEmpty()) {
+        return "No errors recorded";
+    }
+    
+    return "[" + String((millis() - _lastErrorTime) / 1000) + "s ago] " + _lastError;
+}
+
+/**
+ * @brief Get cause of last error
+ */
+MicroSafariError MicroSafari::getLastErrorCode() const {
+    return _lastError.error();
+}
+
+/**
+ * @brief Clear error history
+ */
+void MicroSafari::clearErrors() {
+    _consecutiveFailures = 0;
+    _lastErrorTime = 0;
+    _lastError = MicroSafariErrorMessage();
     debugPrint("Error history cleared");
 }
 
@@ -514,11 +1465,14 @@ JsonObject MicroSafari::getDetailedStatus() {
     status["auto_reconnect"] = _autoReconnect;
     status["last_heartbeat"] = _lastHeartbeat;
     status["heartbeat_interval"] = _heartbeatInterval;
+    status["command_polls"] = _commandPolls;
+    status["empty_poll_ratio"] = getEmptyPollRatio();
     status["uptime_seconds"] = millis() / 1000;
     status["free_heap"] = ESP.getFreeHeap();
     
-    if (!_lastErrorMessage.isEmpty()) {
-        status["last_error"] = _lastErrorMessage;
+    if (!_lastError.isEmpty()) {
+        status["last_error"] = String(_lastError);
+        status["last_error_code"] = (int)_lastError.error();
         status["error_time"] = _lastErrorTime;
     }
     
@@ -530,7 +1484,7 @@ JsonObject MicroSafari::getDetailedStatus() {
  */
 void MicroSafari::disconnect() {
     debugPrint("Disconnecting...");
-    _httpClient.end();
+    releaseTransport();
     WiFi.disconnect();
     _status = MICROSAFARI_DISCONNECTED;
 }
@@ -539,6 +1493,62 @@ void MicroSafari::disconnect() {
  * @brief Main loop function
  */
 void MicroSafari::loop() {
+    MicroSafariMemoryProbe probe(_memoryStats[MICROSAFARI_API_LOOP]);
+    // Step registered sensors first; their reads never block
+    _sensorRegistry.update();
+    
+    // Scheduled commands run on time, with or without a connection
+    runScheduledCommands();
+    if (_acquisition != nullptr) {
+        _acquisition->process();
+    }
+    
+    // Drain samples captured in interrupts; window aggregates join the batch
+    if (_capture != nullptr) {
+        _capture->process();
+        if (millis() - _captureWindowStart >= _captureWindow) {
+            _captureWindowStart = millis();
+            
+            DynamicJsonDocument doc(256 + MICROSAFARI_CAPTURE_MAX_CHANNELS * 48);
+            JsonObject captureData = doc.to<JsonObject>();
+            if (_capture->populate(captureData) > 0) {
+                captureData["timestamp"] = millis();
+                // Aggregates bypass recordReadings(): they would take reading cache slots
+                // from real metrics, trigger rules and fill the archive
+                if (!enqueueBatchEntry(_apiKey.c_str(), _deviceName.c_str(), captureData)) {
+                    debugPrint("Capture window dropped, batch is full");
+                }
+            }
+        }
+    }
+    
+    // Waveform capture: only the FFT features of a full buffer join the batch
+    if (_waveform != nullptr) {
+        if (!_waveform->isCapturing() && !_waveform->isFull() &&
+            millis() - _lastWaveformCapture >= _waveformInterval) {
+            _lastWaveformCapture = millis();
+            _waveform->start();
+        }
+        if (_waveform->process() && _waveform->compute()) {
+            DynamicJsonDocument doc(256 + MICROSAFARI_WAVEFORM_MAX_BANDS * 48);
+            JsonObject waveformData = doc.to<JsonObject>();
+            _waveform->populate(waveformData);
+            waveformData["timestamp"] = millis();
+            // One waveform has more features than the reading cache has slots; keep
+            // them out of recordReadings() so they never displace real metrics
+            if (!enqueueBatchEntry(_apiKey.c_str(), _deviceName.c_str(), waveformData)) {
+                debugPrint("Waveform features dropped, batch is full");
+            }
+        }
+    }
+    
+    // Free the transport and its TLS buffers between infrequent requests
+    if (_transport != nullptr && _transportIdleTimeout > 0 &&
+        millis() - _lastTransportUse >= _transportIdleTimeout) {
+        debugPrint("Releasing idle transport");
+        releaseTransport();
+    }
+    
     // Check WiFi connection status
     if (!isWiFiConnected() && _status != MICROSAFARI_WIFI_CONNECTING) {
         if (millis() - _lastConnectionAttempt > 30000) { // Retry every 30 seconds
@@ -554,11 +1564,26 @@ void MicroSafari::loop() {
         _status = MICROSAFARI_DISCONNECTED;
     }
     
+    // Track link quality; adaptive batching follows its level
+    if (isWiFiConnected()) {
+        updateLinkQuality();
+    }
+    
+    // Open the connection ahead of the next scheduled request
+    if (_prewarmEnabled && isWiFiConnected()) {
+        prewarmConnection();
+    }
+    
     // Send heartbeat if needed and WiFi is connected
-    if (isWiFiConnected() && needsHeartbeat()) {
+    if (isWiFiConnected() && needsHeartbeat() && _flowControl.getWait(millis()) == 0) {
         debugPrint("Heartbeat interval reached, sending heartbeat...");
-        if (!sendHeartbeat()) {
-            handleConnectionFailure("Heartbeat failed");
+        MicroSafariResponse heartbeat = sendHeartbeat();
+        if (!heartbeat.success) {
+            // An overloaded server answered, so the link is fine; resetting WiFi would not help
+            if (heartbeat.error != MICROSAFARI_ERROR_THROTTLED && heartbeat.httpCode != 429 &&
+                heartbeat.httpCode != 503) {
+                handleConnectionFailure(heartbeat.errorMessage);
+            }
         } else {
             // Reset failure counter on successful heartbeat
             if (_consecutiveFailures > 0) {
@@ -568,6 +1593,65 @@ void MicroSafari::loop() {
         }
     }
     
+    // Refresh remote configuration (first fetch as soon as WiFi is up)
+    if (_remoteConfigEnabled && isWiFiConnected() &&
+        (_lastRemoteConfigFetch == 0 || millis() - _lastRemoteConfigFetch > _remoteConfigInterval)) {
+        fetchRemoteConfig();
+    }
+    
+    // Send the shared batch when it is full or its oldest entry is due
+    if (_batchEntries > 0 && isWiFiConnected() && _flowControl.getWait(millis()) == 0 &&
+        (_batchEntries >= getActiveBatchSize() || millis() - _batchStarted > getActiveBatchInterval())) {
+        if (!flushBatch().success) {
+            _batchStarted = millis(); // Back off for one interval before retrying
+        }
+    }
+    
+    // Acknowledge scheduled executions in batches, at most a minute late; a full
+    // batch that failed to send is retried after MICROSAFARI_ACK_RETRY_MS
+    if (_pendingAckCount > 0 && isWiFiConnected() &&
+        millis() - _lastAckFlush > (_pendingAckCount >= MICROSAFARI_ACK_BATCH ? MICROSAFARI_ACK_RETRY_MS : 60000UL)) {
+        flushCommandAcks();
+    }
+    
+    // Report rule hits in batches, at most a minute late; a full buffer stays full
+    // while reports fail, so it is retried after MICROSAFARI_RULE_EVENT_RETRY_MS
+    size_t ruleEvents;
+    _ruleEngine.getEvents(ruleEvents);
+    if (ruleEvents > 0 && isWiFiConnected() &&
+        millis() - _lastRuleEventFlush >
+            (ruleEvents >= MICROSAFARI_RULE_EVENT_BATCH ? MICROSAFARI_RULE_EVENT_RETRY_MS : 60000UL)) {
+        flushRuleEvents();
+    }
+    
+    // Retry desired values that could not be applied
+    if (_shadow.hasPendingDesired() && millis() - _lastShadowApply > 10000) { // Every 10 seconds
+        _lastShadowApply = millis();
+        _shadow.applyDesired();
+    }
+    
+    // Report shadow changes that no ingest request carried
+    if (_shadow.hasChanges() && isWiFiConnected() &&
+        _shadow.getChangeAge(millis()) > 15000 && millis() - _lastShadowSync > 15000) { // At most 15 seconds late
+        syncShadow();
+    }
+    
+    // Poll commands when the library manages the poll cadence
+    if (_commandPollingEnabled && isWiFiConnected() &&
+        (_lastCommandPoll == 0 || millis() - _lastCommandPoll > _commandPollInterval)) {
+        _lastCommandPoll = millis();
+        pollCommands();
+    }
+    
+    // Drain retained readings once the platform is reachable again
+    if (_retentionStore != nullptr && isWiFiConnected() && _flowControl.getWait(millis()) == 0 &&
+        millis() - _lastRetentionDrain > 10000) { // One batch every 10 seconds
+        _lastRetentionDrain = millis();
+        if (!_retentionStore->isEmpty()) {
+            drainRetention(_retentionDrainBatch);
+        }
+    }
+    
     // Handle auto-reconnection if enabled
     if (_autoReconnect && !isWiFiConnected() && _status == MICROSAFARI_DISCONNECTED) {
         if (millis() - _lastConnectionAttempt > (30000 + (_consecutiveFailures * 10000))) {
@@ -601,22 +1685,520 @@ bool MicroSafari::validateResponse(const MicroSafariResponse& response) {
     return response.success && response.httpCode == 201;
 }
 
+/**
+ * @brief Create transport for URL scheme
+ */
+bool MicroSafari::acquireTransport() {
+    bool secure = _platformUrl.startsWith("https://");
+    if (_transport != nullptr && _transportSecure == secure) {
+        return true;
+    }
+    releaseTransport();
+    
+    // Only the client for the scheme in use exists, so plain HTTP never carries TLS state
+    if (secure) {
+        _transport = new (std::nothrow) WiFiClientSecure();
+    } else {
+        _transport = new (std::nothrow) WiFiClient();
+    }
+    _httpClient = new (std::nothrow) HTTPClient();
+    if (_transport == nullptr || _httpClient == nullptr) {
+        releaseTransport();
+        debugPrint("Not enough memory for the HTTP transport");
+        return false;
+    }
+    
+    _transportSecure = secure;
+    _lastTransportUse = millis();
+    _transportStats.transports++;
+    return true;
+}
+
+/**
+ * @brief Close connection and free transport
+ */
+void MicroSafari::releaseTransport() {
+    if (_httpClient != nullptr) {
+        _httpClient->end();
+        delete _httpClient;
+        _httpClient = nullptr;
+    }
+    if (_transport != nullptr) {
+        if (_prewarmPending) {
+            _prewarmPending = false;
+            _prewarmStats.unused++;
+        }
+        // Closes the socket and frees the TLS session with its record buffers
+        _transport->stop();
+        delete _transport;
+        _transport = nullptr;
+        _transportStats.releases++;
+    }
+}
+
+/**
+ * @brief Set transport idle timeout
+ */
+void MicroSafari::setTransportIdleTimeout(unsigned long timeout) {
+    _transportIdleTimeout = timeout;
+}
+
+/**
+ * @brief Get transport statistics
+ */
+const MicroSafariTransportStats& MicroSafari::getTransportStats() const {
+    return _transportStats;
+}
+
+/**
+ * @brief Enable or disable connection prewarming
+ */
+void MicroSafari::setPrewarm(bool enabled) {
+    _prewarmEnabled = enabled;
+}
+
+/**
+ * @brief Announce send made by the sketch
+ */
+void MicroSafari::announceSend(unsigned long delayMs) {
+    _announcedSend = millis() + delayMs;
+    _sendAnnounced = true;
+}
+
+/**
+ * @brief Get prewarm statistics
+ */
+const MicroSafariPrewarmStats& MicroSafari::getPrewarmStats() const {
+    return _prewarmStats;
+}
+
+/**
+ * @brief Get time until next scheduled request
+ */
+long MicroSafari::getNextRequestDelay() const {
+    unsigned long now = millis();
+    // Heartbeats and batches are ingest requests and wait for the budget
+    long ingestWait = (long)_flowControl.getWait(now);
+    long next = max((long)(_lastHeartbeat + _heartbeatInterval - now), ingestWait);
+    if (_batchEntries > 0) {
+        next = min(next, max((long)(_batchStarted + getActiveBatchInterval() - now), ingestWait));
+    }
+    if (_commandPollingEnabled && _lastCommandPoll != 0) {
+        next = min(next, (long)(_lastCommandPoll + _commandPollInterval - now));
+    }
+    if (_remoteConfigEnabled && _lastRemoteConfigFetch != 0) {
+        next = min(next, (long)(_lastRemoteConfigFetch + _remoteConfigInterval - now));
+    }
+    // An announced send that did not happen must not hold back the others
+    if (_sendAnnounced && (long)(_announcedSend - now) >= 0) {
+        next = min(next, (long)(_announcedSend - now));
+    }
+    return next;
+}
+
+/**
+ * @brief Open connection ahead of next scheduled request
+ */
+void MicroSafari::prewarmConnection() {
+    // Half the setup time again as headroom for slow handshakes
+    unsigned long lead = _prewarmStats.setupMs + _prewarmStats.setupMs / 2;
+    long due = getNextRequestDelay();
+    if (due < 0 || (unsigned long)due > lead || millis() - _lastPrewarm < lead) {
+        return;
+    }
+    if (_transport != nullptr && _transport->connected()) {
+        return; // Already warm
+    }
+    _lastPrewarm = millis();
+    if (!acquireTransport()) {
+        return;
+    }
+    if (_transportSecure) {
+        static_cast<WiFiClientSecure*>(_transport)->setInsecure(); // Same as beginHttpRequest
+    }
+    
+    String host;
+    uint16_t port;
+    getPlatformHost(host, port);
+    uint32_t freeBefore = ESP.getFreeHeap();
+    uint32_t lowestBefore = ESP.getMinFreeHeap();
+    unsigned long started = millis();
+    if (!_transport->connect(host.c_str(), port)) {
+        _prewarmStats.failures++;
+        debugPrint("Prewarm connect to " + host + " failed");
+        return;
+    }
+    
+    // Moving average over about four setups, so one slow handshake does not dominate
+    uint32_t setup = millis() - started;
+    _prewarmStats.lastSetupMs = setup;
+    _prewarmStats.setupMs = (_prewarmStats.setupMs * 3 + setup) / 4;
+    _prewarmStats.prewarms++;
+    _prewarmPending = true;
+    _lastTransportUse = millis();
+    noteNewConnection(freeBefore, lowestBefore);
+    debugPrint("Connection prewarmed in " + String(setup) + " ms, next request in " + String(due) + " ms");
+}
+
+/**
+ * @brief Get memory use of public operation
+ */
+const MicroSafariMemoryStats& MicroSafari::getMemoryStats(MicroSafariApi api) const {
+    return _memoryStats[api < MICROSAFARI_API_COUNT ? api : MICROSAFARI_API_LOOP];
+}
+
+/**
+ * @brief Get memory report
+ */
+String MicroSafari::getMemoryReport() const {
+    String report = "=== MicroSafari Memory Budget ===\n";
+    for (size_t i = 0; i < MICROSAFARI_API_COUNT; i++) {
+        const MicroSafariMemoryStats& stats = _memoryStats[i];
+        if (stats.calls == 0) {
+            continue;
+        }
+        report += String(microSafariApiName((MicroSafariApi)i)) + ": heap peak " + String(stats.heapPeak) +
+                  ", largest block " + String(stats.largestBlock) + ", stack " + String(stats.stackPeak) +
+                  " (" + String(stats.stackHighWater) + " free), " + String(stats.calls) + " calls\n";
+    }
+    report += "Instance: " + String(sizeof(MicroSafari)) + " bytes, free heap " + String(ESP.getFreeHeap()) +
+              ", largest free block " + String(ESP.getMaxAllocHeap()) + "\n";
+    return report;
+}
+
+/**
+ * @brief Reset memory statistics
+ */
+void MicroSafari::resetMemoryStats() {
+    memset(_memoryStats, 0, sizeof(_memoryStats));
+}
+
+/**
+ * @brief Open HTTP client with default and extra headers
+ */
+bool MicroSafari::beginHttpRequest(const String& endpoint, const MicroSafariHttpHeader* headers, size_t headerCount) {
+    if (!acquireTransport()) {
+        return false;
+    }
+    if (_transportSecure) {
+        static_cast<WiFiClientSecure*>(_transport)->setInsecure(); // Skip certificate verification for now
+    }
+    _httpClient->begin(*_transport, _platformUrl + endpoint);
+    _httpClient->addHeader("Content-Type", "application/json");
+    _httpClient->addHeader("X-API-Key", _apiKey);
+    _httpClient->addHeader("User-Agent", "MicroSafari-ESP32/1.0.0");
+    for (size_t i = 0; i < headerCount; i++) {
+        // addHeader replaces a default header of the same name (e.g. a channel's X-API-Key)
+        _httpClient->addHeader(headers[i].name, headers[i].value);
+    }
+    _httpClient->collectHeaders(COLLECTED_HEADERS, RESPONSE_HEADER_COUNT);
+    _httpClient->setTimeout(15000); // 15 second timeout
+    return true;
+}
+
+/**
+ * @brief Send opened request and measure new connections
+ */
+int MicroSafari::sendHttpRequest(const char* method, const uint8_t* body, size_t length) {
+    // A reused keep-alive connection allocates nothing; only new ones are measured
+    bool reused = _transport->connected();
+    uint32_t freeBefore = ESP.getFreeHeap();
+    uint32_t lowestBefore = ESP.getMinFreeHeap();
+    
+    MicroSafariMemoryProbe::noteBlock(length + 1);
+    unsigned long started = millis();
+    int httpCode = _httpClient->sendRequest(method, const_cast<uint8_t*>(body), length);
+    _lastTransportUse = millis();
+    
+    // Only requests on an open connection measure the round trip; new ones include the handshake
+    _link.addRequest(httpCode > 0, reused ? max(_lastTransportUse - started, 1UL) : 0);
+    _sendAnnounced = false;
+    
+    if (_prewarmPending) {
+        // A prewarmed socket the server closed in the meantime was wasted
+        _prewarmPending = false;
+        if (reused) {
+            _prewarmStats.used++;
+        } else {
+            _prewarmStats.unused++;
+        }
+    }
+    if (!reused && _transport->connected()) {
+        noteNewConnection(freeBefore, lowestBefore);
+    }
+    return httpCode;
+}
+
+/**
+ * @brief Update transport statistics after new connection
+ */
+void MicroSafari::noteNewConnection(uint32_t freeBefore, uint32_t lowestBefore) {
+    uint32_t freeAfter = ESP.getFreeHeap();
+    uint32_t lowestAfter = ESP.getMinFreeHeap();
+    _transportStats.connections++;
+    _transportStats.heldBytes = freeBefore > freeAfter ? freeBefore - freeAfter : 0;
+    
+    // The low-water mark only moves if this handshake set a new minimum
+    uint32_t peak = lowestAfter < lowestBefore ? freeBefore - lowestAfter : _transportStats.heldBytes;
+    if (peak > _transportStats.peakBytes) {
+        _transportStats.peakBytes = peak;
+    }
+}
+
+/**
+ * @brief Get host and port of platform URL
+ */
+void MicroSafari::getPlatformHost(String& host, uint16_t& port) const {
+    int hostStart = _platformUrl.indexOf("://");
+    hostStart = hostStart < 0 ? 0 : hostStart + 3;
+    int hostEnd = hostStart;
+    while (hostEnd < (int)_platformUrl.length() && _platformUrl[hostEnd] != ':' && _platformUrl[hostEnd] != '/') {
+        hostEnd++;
+    }
+    host = _platformUrl.substring(hostStart, hostEnd);
+    port = _platformUrl.startsWith("https://") ? 443 : 80;
+    if (hostEnd < (int)_platformUrl.length() && _platformUrl[hostEnd] == ':') {
+        port = _platformUrl.substring(hostEnd + 1).toInt();
+    }
+}
+
+/**
+ * @brief Check if response body is read
+ */
+bool MicroSafari::wantsResponseBody(int httpCode) const {
+    if (httpCode <= 0 || httpCode == HTTP_CODE_NO_CONTENT || httpCode == HTTP_CODE_NOT_MODIFIED) {
+        return false;
+    }
+    // Error bodies are only logged, so they are skipped unless debugging
+    return (httpCode >= 200 && httpCode < 300) || _debug;
+}
+
+/**
+ * @brief Classify failed request
+ */
+MicroSafariError MicroSafari::classifyHttpError(int httpCode) {
+    if (httpCode > 0) {
+        return microSafariErrorForStatus(httpCode);
+    }
+    if (httpCode == HTTPC_ERROR_READ_TIMEOUT) {
+        return MICROSAFARI_ERROR_TIMEOUT;
+    }
+    if (httpCode == HTTPC_ERROR_TOO_LESS_RAM) {
+        return MICROSAFARI_ERROR_NO_MEMORY;
+    }
+    if (httpCode != HTTPC_ERROR_CONNECTION_REFUSED) {
+        return MICROSAFARI_ERROR_NETWORK;
+    }
+    
+    // HTTPClient reports every failed connect as refused; find the step that failed.
+    // The secure client fails name lookup and TCP connect with -1; mbedTLS codes are
+    // below that and only occur once the host resolved and the socket connected.
+    if (_transportSecure && _transport != nullptr) {
+        char text[1];
+        if (static_cast<WiFiClientSecure*>(_transport)->lastError(text, sizeof(text)) < -1) {
+            return MICROSAFARI_ERROR_TLS;
+        }
+    }
+    
+    // One lookup tells a name that does not resolve from a host that refused the connection
+    String host;
+    uint16_t port;
+    getPlatformHost(host, port);
+    IPAddress address;
+    if (!WiFi.hostByName(host.c_str(), address)) {
+        return MICROSAFARI_ERROR_DNS;
+    }
+    return MICROSAFARI_ERROR_NETWORK;
+}
+
+/**
+ * @brief Send one binary request without retries
+ */
+MicroSafariResponse MicroSafari::performBinaryRequest(const String& endpoint,
+                                                     const char* method,
+                                                     const uint8_t* body,
+                                                     size_t length,
+                                                     const MicroSafariHttpHeader* headers,
+                                                     size_t headerCount) {
+    MicroSafariResponse response;
+    
+    if (!isWiFiConnected()) {
+        response.fail(MICROSAFARI_ERROR_WIFI);
+        return response;
+    }
+    
+    debugPrint("Performing HTTP " + String(method) + " to: " + endpoint + " (" + String(length) + " bytes)");
+    
+    if (!beginHttpRequest(endpoint, headers, headerCount)) {
+        response.fail(MICROSAFARI_ERROR_NO_MEMORY, "cannot create HTTP transport");
+        return response;
+    }
+    response.httpCode = sendHttpRequest(method, body, length);
+    
+    // HEAD answers and 204/304 carry no body; unread error bodies must not stay on the socket
+    if (strcmp(method, "HEAD") != 0) {
+        if (wantsResponseBody(response.httpCode)) {
+            response.payload = _httpClient->getString();
+            MicroSafariMemoryProbe::noteBlock(response.payload.length() + 1);
+        } else {
+            discardResponseBody(response.httpCode);
+        }
+    }
+    for (size_t i = 0; i < RESPONSE_HEADER_COUNT; i++) {
+        _responseHeaders[i] = _httpClient->header(COLLECTED_HEADERS[i]);
+    }
+    _httpClient->end();
+    
+    debugPrint("HTTP response code: " + String(response.httpCode));
+    
+    if (response.httpCode >= 200 && response.httpCode < 300) {
+        response.success = true;
+        _lastHeartbeat = millis(); // Update heartbeat on successful communication
+    } else {
+        response.fail(classifyHttpError(response.httpCode));
+    }
+    return response;
+}
+
+/**
+ * @brief Stream handing downloaded bytes to a sink
+ */
+class MicroSafariSinkStream : public Stream {
+private:
+    MicroSafariDownloadSink _sink;
+    void* _context;
+    
+public:
+    MicroSafariSinkStream(MicroSafariDownloadSink sink, void* context) : _sink(sink), _context(context) {}
+    
+    size_t write(const uint8_t* data, size_t length) override {
+        // Writing 0 bytes makes HTTPClient stop the transfer
+        return _sink(_context, data, length) ? length : 0;
+    }
+    size_t write(uint8_t value) override { return write(&value, 1); }
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+    void flush() override {}
+};
+
+/**
+ * @brief Sink dropping every byte
+ */
+static bool discardSink(void* context, const uint8_t* data, size_t length) {
+    return true;
+}
+
+/**
+ * @brief Drain or drop unread response body
+ */
+void MicroSafari::discardResponseBody(int httpCode) {
+    if (httpCode <= 0 || httpCode == HTTP_CODE_NO_CONTENT || httpCode == HTTP_CODE_NOT_MODIFIED) {
+        return;
+    }
+    // end() only drops bytes already received; the rest would arrive as the next response
+    int size = _httpClient->getSize();
+    if (size == 0) {
+        return;
+    }
+    if (size > 0 && size <= DISCARD_BODY_LIMIT) {
+        MicroSafariSinkStream stream(discardSink, nullptr);
+        if (_httpClient->writeToStream(&stream) >= 0) {
+            return;
+        }
+    }
+    // Chunked, unknown length, too large or cut short: give up the keep-alive connection
+    _transport->stop();
+}
+
+/**
+ * @brief Download byte range to sink
+ */
+MicroSafariResponse MicroSafari::performDownloadRequest(const String& endpoint,
+                                                       uint32_t offset,
+                                                       uint32_t length,
+                                                       MicroSafariDownloadSink sink,
+                                                       void* context) {
+    MicroSafariResponse response;
+    
+    if (length == 0) {
+        // bytes=N-(N-1) is not a valid range
+        response.fail(MICROSAFARI_ERROR_CLIENT, "empty range");
+        return response;
+    }
+    if (!isWiFiConnected()) {
+        response.fail(MICROSAFARI_ERROR_WIFI);
+        return response;
+    }
+    
+    char range[32];
+    snprintf(range, sizeof(range), "bytes=%lu-%lu", (unsigned long)offset, (unsigned long)(offset + length - 1));
+    MicroSafariHttpHeader header = { "Range", range };
+    debugPrint("Performing HTTP GET to: " + endpoint + " (" + range + ")");
+    
+    if (!beginHttpRequest(endpoint, &header, 1)) {
+        response.fail(MICROSAFARI_ERROR_NO_MEMORY, "cannot create HTTP transport");
+        return response;
+    }
+    response.httpCode = sendHttpRequest("GET", nullptr, 0);
+    for (size_t i = 0; i < RESPONSE_HEADER_COUNT; i++) {
+        _responseHeaders[i] = _httpClient->header(COLLECTED_HEADERS[i]);
+    }
+    debugPrint("HTTP response code: " + String(response.httpCode));
+    
+    if (response.httpCode != HTTP_CODE_PARTIAL_CONTENT && !(response.httpCode == HTTP_CODE_OK && offset == 0)) {
+        discardResponseBody(response.httpCode);
+        _httpClient->end();
+        if (response.httpCode == HTTP_CODE_OK) {
+            response.fail(MICROSAFARI_ERROR_SERVER, "range requests not supported");
+        } else {
+            response.fail(classifyHttpError(response.httpCode));
+        }
+        return response;
+    }
+    
+    // writeToStream handles chunked bodies and reads through a fixed buffer
+    MicroSafariSinkStream stream(sink, context);
+    int received = _httpClient->writeToStream(&stream);
+    _httpClient->end();
+    _lastTransportUse = millis();
+    
+    if (received < 0) {
+        // A short body and a sink that stopped both end as a stream write error
+        response.fail(received == HTTPC_ERROR_STREAM_WRITE ? MICROSAFARI_ERROR_NETWORK : classifyHttpError(received),
+                      "download interrupted");
+        return response;
+    }
+    response.success = true;
+    _lastHeartbeat = millis(); // Update heartbeat on successful communication
+    return response;
+}
+
 /**
  * @brief Perform HTTP request with retry logic
  */
 MicroSafariResponse MicroSafari::performHttpRequest(const String& endpoint, 
                                                    const String& payload, 
-                                                   const String& method) {
+                                                   const String& method,
+                                                   const MicroSafariHttpHeader* headers,
+                                                   size_t headerCount) {
     MicroSafariResponse response;
-    response.success = false;
-    response.httpCode = 0;
     
     if (!isWiFiConnected()) {
-        response.errorMessage = "WiFi not connected";
+        response.fail(MICROSAFARI_ERROR_WIFI);
         debugPrint("Cannot perform HTTP request - WiFi not connected");
         return response;
     }
     
+    // Ingest requests respect the budget handed out by the platform
+    bool ingest = endpoint.startsWith("/api/ingest");
+    if (ingest && _flowControl.getWait(millis()) > 0) {
+        _flowControl.onDeferred();
+        response.fail(MICROSAFARI_ERROR_THROTTLED, "ingest budget");
+        debugPrint("Ingest request deferred for " + String(_flowControl.getWait(millis())) + "ms");
+        return response;
+    }
+    
     debugPrint("Performing HTTP " + method + " to: " + endpoint);
     
     int attempts = 0;
@@ -624,47 +2206,65 @@ MicroSafariResponse MicroSafari::performHttpRequest(const String& endpoint,
         attempts++;
         debugPrint("HTTP attempt " + String(attempts) + "/" + String(_maxRetries));
         
-        // Use appropriate client based on URL scheme
-        if (_platformUrl.startsWith("https://")) {
-            _wifiClientHttps.setInsecure(); // Skip certificate verification for now
-            _httpClient.begin(_wifiClientHttps, _platformUrl + endpoint);
-        } else {
-            _httpClient.begin(_wifiClientHttp, _platformUrl + endpoint);
+        if (!beginHttpRequest(endpoint, headers, headerCount)) {
+            response.fail(MICROSAFARI_ERROR_NO_MEMORY, "cannot create HTTP transport");
+            return response;
+        }
+        
+        if (ingest) {
+            _flowControl.onSend(millis());
         }
-        _httpClient.addHeader("Content-Type", "application/json");
-        _httpClient.addHeader("X-API-Key", _apiKey);
-        _httpClient.addHeader("User-Agent", "MicroSafari-ESP32/1.0.0");
-        _httpClient.setTimeout(15000); // 15 second timeout
         
         // Send request based on method
         if (method == "POST") {
-            response.httpCode = _httpClient.POST(payload);
+            response.httpCode = sendHttpRequest("POST", (const uint8_t*)payload.c_str(), payload.length());
         } else if (method == "GET") {
-            response.httpCode = _httpClient.GET();
+            response.httpCode = sendHttpRequest("GET", nullptr, 0);
         } else if (method == "PUT") {
-            response.httpCode = _httpClient.PUT(payload);
+            response.httpCode = sendHttpRequest("PUT", (const uint8_t*)payload.c_str(), payload.length());
         }
         
-        response.payload = _httpClient.getString();
-        _httpClient.end();
+        // 204 No Content and 304 Not Modified carry no body; unread error bodies must not stay on the socket
+        response.payload = "";
+        if (wantsResponseBody(response.httpCode)) {
+            response.payload = _httpClient->getString();
+            MicroSafariMemoryProbe::noteBlock(response.payload.length() + 1);
+        } else {
+            discardResponseBody(response.httpCode);
+        }
+        for (size_t i = 0; i < RESPONSE_HEADER_COUNT; i++) {
+            _responseHeaders[i] = _httpClient->header(COLLECTED_HEADERS[i]);
+        }
+        _httpClient->end();
         
         debugPrint("HTTP response code: " + String(response.httpCode));
-        debugPrint("HTTP response body: " + response.payload);
+        if (ingest) {
+            applyFlowControl(response.httpCode);
+        }
+        if (!response.payload.isEmpty()) {
+            debugPrint("HTTP response body: " + response.payload);
+        }
         
         // Check if request was successful
-        if (response.httpCode == 201 || response.httpCode == 200) {
+        if (response.httpCode == 201 || response.httpCode == 200 ||
+            response.httpCode == HTTP_CODE_NO_CONTENT || response.httpCode == HTTP_CODE_NOT_MODIFIED) {
             response.success = true;
             _lastHeartbeat = millis(); // Update heartbeat on successful communication
             debugPrint("HTTP request successful!");
             return response;
         } else if (response.httpCode == 401) {
-            response.errorMessage = "Authentication failed - check API key";
+            response.fail(MICROSAFARI_ERROR_AUTH);
             debugPrint("Authentication failed - will not retry");
             return response; // Don't retry auth failures
         } else if (response.httpCode == 400) {
-            response.errorMessage = "Invalid data format";
+            response.fail(MICROSAFARI_ERROR_CLIENT, "invalid data format");
             debugPrint("Bad request - will not retry");
             return response; // Don't retry client errors
+        } else if (response.httpCode == 429 || response.httpCode == 503) {
+            // Retrying an overloaded server multiplies its load; the server answered, so the link is fine
+            response.fail(classifyHttpError(response.httpCode));
+            debugPrint("Server overloaded - will not retry");
+            return response;
         }
         
         // For other errors, retry if we have attempts left
@@ -675,13 +2275,7 @@ MicroSafariResponse MicroSafari::performHttpRequest(const String& endpoint,
     }
     
     // All retries exhausted
-    if (response.httpCode == 503) {
-        response.errorMessage = "Service unavailable - development mode";
-    } else if (response.httpCode <= 0) {
-        response.errorMessage = "Network error - check connection";
-    } else {
-        response.errorMessage = "Server error (HTTP " + String(response.httpCode) + ") - all retries exhausted";
-    }
+    response.fail(classifyHttpError(response.httpCode), "all retries exhausted");
     
     debugPrint("HTTP request failed after " + String(_maxRetries) + " attempts");
     handleConnectionFailure(response.errorMessage);
@@ -726,7 +2320,8 @@ bool MicroSafari::needsHeartbeat() {
 /**
  * @brief Send heartbeat to platform
  */
-bool MicroSafari::sendHeartbeat() {
+MicroSafariResponse MicroSafari::sendHeartbeat() {
+    MicroSafariMemoryProbe probe(_memoryStats[MICROSAFARI_API_SEND_HEARTBEAT]);
     debugPrint("Sending heartbeat to platform...");
     
     // Create heartbeat payload
@@ -739,10 +2334,16 @@ bool MicroSafari::sendHeartbeat() {
     heartbeatData["signal_strength"] = getWiFiSignalStrength();
     heartbeatData["free_heap"] = ESP.getFreeHeap();
     heartbeatData["uptime"] = millis() / 1000; // Uptime in seconds
+    _link.populate(heartbeatData);
+    if (_adaptiveBatching) {
+        heartbeatData["batch_size"] = getActiveBatchSize();
+        heartbeatData["batch_interval_ms"] = getActiveBatchInterval();
+    }
     
     // Wrap in payload structure
-    DynamicJsonDocument payloadDoc(1024);
+    DynamicJsonDocument payloadDoc(1024 + (_shadow.hasChanges() ? MICROSAFARI_SHADOW_REPORT_CAPACITY : 0));
     payloadDoc["payload"] = heartbeatData;
+    uint32_t shadowReported = attachShadowReport(payloadDoc.as<JsonObject>());
     
     String jsonString;
     serializeJson(payloadDoc, jsonString);
@@ -750,26 +2351,26 @@ bool MicroSafari::sendHeartbeat() {
     MicroSafariResponse response = performHttpRequest("/api/ingest", jsonString);
     
     if (response.success) {
+        _shadow.clearChanges(shadowReported);
+        handleShadowResponse(response.payload);
         debugPrint("Heartbeat sent successfully");
-        return true;
     } else {
         debugPrint("Heartbeat failed: " + response.errorMessage);
-        return false;
     }
+    return response;
 }
 
 /**
  * @brief Send custom JSON data to MicroSafari platform
  */
 MicroSafariResponse MicroSafari::sendCustomData(const String& jsonPayload) {
+    MicroSafariMemoryProbe probe(_memoryStats[MICROSAFARI_API_SEND_CUSTOM_DATA]);
     debugPrint("Sending custom JSON data...");
     
     // Validate basic JSON structure
     if (!validateJsonPayload(jsonPayload)) {
         MicroSafariResponse errorResponse;
-        errorResponse.success = false;
-        errorResponse.httpCode = 0;
-        errorResponse.errorMessage = "Invalid JSON payload structure";
+        errorResponse.fail(MICROSAFARI_ERROR_INVALID_PAYLOAD);
         return errorResponse;
     }
     
@@ -793,9 +2394,7 @@ MicroSafariResponse MicroSafari::sendCustomData(const String& jsonPayload) {
         
         if (error != DeserializationError::Ok) {
             MicroSafariResponse errorResponse;
-            errorResponse.success = false;
-            errorResponse.httpCode = 0;
-            errorResponse.errorMessage = "Failed to parse JSON payload: " + String(error.c_str());
+            errorResponse.fail(MICROSAFARI_ERROR_INVALID_PAYLOAD, error.c_str());
             return errorResponse;
         }
         
@@ -810,24 +2409,46 @@ MicroSafariResponse MicroSafari::sendCustomData(const String& jsonPayload) {
  * @brief Poll for pending device commands from the platform
  */
 MicroSafariResponse MicroSafari::pollCommands() {
+    MicroSafariMemoryProbe probe(_memoryStats[MICROSAFARI_API_POLL_COMMANDS]);
     debugPrint("Polling for device commands...");
     
     // Create empty payload for GET-style request
     String emptyPayload = "{}";
     
+    // Tell the platform which commands we already have, so it can answer
+    // with a header-only 204/304 when nothing new is pending. The shadow
+    // version does the same for desired state.
+    MicroSafariHttpHeader pollHeaders[] = {
+        { "X-Command-Cursor", String(_commandCursor) },
+        { "X-Shadow-Version", String(_shadow.getVersion()) }
+    };
+    size_t pollHeaderCount = _shadow.getCount() > 0 ? 2 : 1;
+    
     // Use a different endpoint for command polling
     // This assumes the platform has a command polling endpoint
-    MicroSafariResponse response = performHttpRequest("/api/commands/poll", emptyPayload, "GET");
+    MicroSafariResponse response = performHttpRequest("/api/commands/poll", emptyPayload, "GET",
+                                                      pollHeaders, pollHeaderCount);
+    uint32_t receivedUs = micros();
+    uint64_t receivedAt = epochMillis();
     
     if (response.success) {
         debugPrint("Command poll successful");
+        _commandPolls++;
+        
+        if (response.httpCode == HTTP_CODE_NO_CONTENT || response.httpCode == HTTP_CODE_NOT_MODIFIED) {
+            // Nothing pending: no body was read and nothing needs parsing
+            _emptyCommandPolls++;
+            _headerOnlyCommandPolls++;
+            debugPrint("No pending commands found");
+            return response;
+        }
         
         // Try to parse the response to see if there are commands
         DynamicJsonDocument doc(1024);
         DeserializationError error = deserializeJson(doc, response.payload);
         
         if (error == DeserializationError::Ok) {
-            if (doc.containsKey("commands") && doc["commands"].is<JsonArray>()) {
+            if (doc.containsKey("commands") && doc["commands"].is<JsonArray>() && doc["commands"].size() > 0) {
                 JsonArray commands = doc["commands"];
                 debugPrint("Found " + String(commands.size()) + " pending commands");
                 
@@ -840,16 +2461,58 @@ MicroSafariResponse MicroSafari::pollCommands() {
                         
                         debugPrint("Executing command " + String(commandId) + ": " + dataSource + " = " + value);
                         
-                        // Execute the command
-                        bool success = executeCommand(dataSource, value);
+                        if (commandId > _commandCursor) {
+                            _commandCursor = commandId;
+                        }
+                        
+                        // The platform may send a command again until it is acknowledged
+                        if (isCommandHeld(commandId)) {
+                            debugPrint("Command " + String(commandId) + " already held, skipping");
+                            continue;
+                        }
+                        
+                        // Commands for later are held locally and acknowledged after execution.
+                        // One that cannot be held is rejected rather than run early.
+                        uint32_t executeAt = command["execute_at"] | 0UL;
+                        if (executeAt > (uint32_t)time(nullptr)) {
+                            if (!scheduleCommand(commandId, dataSource, value, executeAt)) {
+                                acknowledgeCommand(commandId, false);
+                            }
+                            continue;
+                        }
+                        
+                        // issued_at may be Unix seconds or milliseconds
+                        MicroSafariCommandTrace trace;
+                        double issuedAt = command["issued_at"] | 0.0;
+                        trace.issuedAt = (uint64_t)(issuedAt < 1e11 ? issuedAt * 1000 : issuedAt);
+                        trace.receivedAt = receivedAt;
+                        trace.receivedUs = receivedUs;
+                        trace.dispatchStartUs = micros();
+                        bool success = dispatchCommand(dataSource, command["value"]);
+                        trace.dispatchEndUs = micros();
                         
-                        // Send acknowledgment back to platform
-                        acknowledgeCommand(commandId, success);
+                        // Shadowed actuators are confirmed by their reported state, which
+                        // only changes on success; failures are acknowledged for all
+                        if (!success || !_shadow.contains(dataSource.c_str())) {
+                            acknowledgeCommand(commandId, success, &trace);
+                        } else {
+                            recordCommandLatency(trace, 0);
+                        }
                     }
                 }
             } else {
+                _emptyCommandPolls++;
                 debugPrint("No pending commands found");
             }
+            
+            // Prefer the cursor issued by the platform when it sends one
+            if (doc.containsKey("cursor")) {
+                _commandCursor = doc["cursor"].as<long>();
+            }
+            
+            if (doc.containsKey("shadow")) {
+                handleShadowDelta(doc["shadow"].as<JsonObject>());
+            }
         } else {
             debugPrint("Failed to parse command response: " + String(error.c_str()));
         }
@@ -860,6 +2523,475 @@ MicroSafariResponse MicroSafari::pollCommands() {
     return response;
 }
 
+/**
+ * @brief Run command through reserved handlers or the user callback
+ */
+bool MicroSafari::dispatchCommand(const String& dataSource, const JsonVariant& value) {
+    // Reserved configuration commands never reach the callback
+    if (dataSource.startsWith(CONFIG_COMMAND_PREFIX)) {
+        return handleConfigCommand(dataSource, value);
+    }
+    if (dataSource == RULES_COMMAND) {
+        if (value.is<JsonArray>()) {
+            String rulesJson;
+            serializeJson(value, rulesJson);
+            return setRules(rulesJson);
+        }
+        return setRules(value.as<String>());
+    }
+    
+    String commandValue = value.as<String>();
+    bool success = executeCommand(dataSource, commandValue);
+    if (success) {
+        _shadow.setReported(dataSource.c_str(), commandValue.c_str());
+    }
+    return success;
+}
+
+/**
+ * @brief Reading cache listener: evaluate local rules
+ */
+void MicroSafari::onReading(void* context, const char* name, float value) {
+    static_cast<MicroSafari*>(context)->_ruleEngine.evaluate(name, value);
+}
+
+/**
+ * @brief Rule action handler: dispatch rule command
+ */
+bool MicroSafari::onRuleAction(void* context, const char* dataSource, const char* value) {
+    MicroSafari* self = static_cast<MicroSafari*>(context);
+    self->debugPrint("Rule command: " + String(dataSource) + " = " + String(value));
+    
+    DynamicJsonDocument doc(64);
+    doc.set(value);
+    return self->dispatchCommand(dataSource, doc.as<JsonVariant>());
+}
+
+/**
+ * @brief Shadow action handler: dispatch desired value
+ */
+bool MicroSafari::onShadowAction(void* context, const char* name, const char* value) {
+    MicroSafari* self = static_cast<MicroSafari*>(context);
+    self->debugPrint("Applying desired state: " + String(name) + " = " + String(value));
+    
+    DynamicJsonDocument doc(64);
+    doc.set(value);
+    return self->dispatchCommand(name, doc.as<JsonVariant>());
+}
+
+/**
+ * @brief Add unreported shadow changes to a request
+ */
+uint32_t MicroSafari::attachShadowReport(JsonObject root) {
+    if (!_shadow.hasChanges()) {
+        return 0;
+    }
+    
+    JsonObject shadow = root.createNestedObject("shadow");
+    _lastShadowSync = millis();
+    return _shadow.writeReported(shadow);
+}
+
+/**
+ * @brief Apply desired shadow delta
+ */
+void MicroSafari::handleShadowDelta(const JsonObject& shadow) {
+    if (shadow.isNull() || _shadow.getCount() == 0) {
+        return;
+    }
+    
+    size_t changed = _shadow.readDesired(shadow);
+    if (changed > 0) {
+        debugPrint("Desired state changed for " + String(changed) + " properties (version " +
+                   String(_shadow.getVersion()) + ")");
+    }
+    _lastShadowApply = millis();
+    _shadow.applyDesired();
+}
+
+/**
+ * @brief Pick desired shadow delta out of a response body
+ */
+void MicroSafari::handleShadowResponse(const String& payload) {
+    // Most responses carry no shadow; skip parsing them
+    if (_shadow.getCount() == 0 || payload.indexOf("\"shadow\"") < 0) {
+        return;
+    }
+    
+    DynamicJsonDocument doc(1024);
+    if (deserializeJson(doc, payload) != DeserializationError::Ok) {
+        debugPrint("Failed to parse shadow delta");
+        return;
+    }
+    handleShadowDelta(doc["shadow"].as<JsonObject>());
+}
+
+/**
+ * @brief Add shadow property
+ */
+bool MicroSafari::addShadowProperty(const char* name) {
+    if (!_shadow.addProperty(name)) {
+        debugPrint("Cannot shadow property: " + String(name));
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Report actuator state
+ */
+bool MicroSafari::reportState(const char* name, const String& value) {
+    return _shadow.setReported(name, value.c_str());
+}
+
+/**
+ * @brief Send unreported shadow changes
+ */
+bool MicroSafari::syncShadow() {
+    MicroSafariMemoryProbe probe(_memoryStats[MICROSAFARI_API_SYNC_SHADOW]);
+    if (!_shadow.hasChanges()) {
+        return true;
+    }
+    
+    DynamicJsonDocument doc(JSON_OBJECT_SIZE(2) + MICROSAFARI_SHADOW_REPORT_CAPACITY + _deviceName.length() + 1);
+    doc["device_name"] = _deviceName;
+    uint32_t shadowReported = attachShadowReport(doc.as<JsonObject>());
+    
+    String jsonString;
+    serializeJson(doc, jsonString);
+    
+    MicroSafariResponse response = performHttpRequest("/api/devices/shadow", jsonString);
+    if (!response.success) {
+        debugPrint("Failed to report shadow: " + response.errorMessage);
+        return false;
+    }
+    
+    _shadow.clearChanges(shadowReported);
+    handleShadowResponse(response.payload);
+    return true;
+}
+
+/**
+ * @brief Get device shadow
+ */
+MicroSafariShadow& MicroSafari::getShadow() {
+    return _shadow;
+}
+
+/**
+ * @brief Replace local rule table
+ */
+bool MicroSafari::setRules(const String& rulesJson) {
+    DynamicJsonDocument doc(6144);
+    DeserializationError error = deserializeJson(doc, rulesJson);
+    if (error || !doc.is<JsonArray>()) {
+        debugPrint("Invalid rules document");
+        return false;
+    }
+    
+    int count = _ruleEngine.load(doc.as<JsonArray>());
+    if (count < 0) {
+        debugPrint("Rules rejected, keeping " + String(_ruleEngine.getRuleCount()) + " rules");
+        return false;
+    }
+    
+    saveRules();
+    debugPrint("Loaded " + String(count) + " local rules");
+    return true;
+}
+
+/**
+ * @brief Get the rule engine
+ */
+MicroSafariRuleEngine& MicroSafari::getRuleEngine() {
+    return _ruleEngine;
+}
+
+/**
+ * @brief Report rule hits
+ */
+bool MicroSafari::flushRuleEvents() {
+    size_t count;
+    const MicroSafariRuleEvent* events = _ruleEngine.getEvents(count);
+    if (count == 0) {
+        return true;
+    }
+    _lastRuleEventFlush = millis();
+    
+    DynamicJsonDocument doc(128 + count * 160);
+    doc["device_name"] = _deviceName;
+    JsonArray items = doc.createNestedArray("events");
+    for (size_t i = 0; i < count; i++) {
+        JsonObject item = items.createNestedObject();
+        item["rule_id"] = events[i].ruleId;
+        item["state"] = events[i].triggered ? "triggered" : "released";
+        item["value"] = events[i].value;
+        item["timestamp"] = events[i].timestamp;
+        item["epoch"] = events[i].epoch;
+        item["status"] = events[i].success ? "success" : "failure";
+    }
+    
+    String jsonString;
+    serializeJson(doc, jsonString);
+    
+    MicroSafariResponse response = performHttpRequest("/api/rules/events", jsonString);
+    if (!response.success) {
+        debugPrint("Failed to report rule events: " + response.errorMessage);
+        return false;
+    }
+    
+    _ruleEngine.removeEvents(count);
+    debugPrint("Reported " + String(count) + " rule events");
+    return true;
+}
+
+/**
+ * @brief Store compiled rule table in NVS
+ */
+void MicroSafari::saveRules() {
+    MicroSafariRule rules[MICROSAFARI_MAX_RULES];
+    size_t count = _ruleEngine.getRules(rules, MICROSAFARI_MAX_RULES);
+    
+    Preferences preferences;
+    if (!preferences.begin(PREFERENCES_NAMESPACE, false)) {
+        return;
+    }
+    if (count > 0) {
+        preferences.putBytes("rules", rules, count * sizeof(MicroSafariRule));
+    } else if (preferences.isKey("rules")) {
+        preferences.remove("rules");
+    }
+    preferences.end();
+}
+
+/**
+ * @brief Restore compiled rule table from NVS
+ */
+void MicroSafari::loadRules() {
+    Preferences preferences;
+    if (!preferences.begin(PREFERENCES_NAMESPACE, true)) {
+        return;
+    }
+    
+    MicroSafariRule rules[MICROSAFARI_MAX_RULES];
+    size_t length = preferences.getBytesLength("rules");
+    size_t count = 0;
+    if (length > 0 && length % sizeof(MicroSafariRule) == 0 && length <= sizeof(rules)) {
+        count = preferences.getBytes("rules", rules, length) / sizeof(MicroSafariRule);
+    }
+    preferences.end();
+    
+    if (count > 0 && _ruleEngine.setRules(rules, count)) {
+        debugPrint("Restored " + String(count) + " local rules");
+    }
+}
+
+/**
+ * @brief Hold command until its execute_at time
+ */
+bool MicroSafari::scheduleCommand(long commandId, const String& dataSource, const String& value, uint32_t executeAt) {
+    if (dataSource.length() >= MICROSAFARI_SCHEDULE_SOURCE_LENGTH || value.length() >= MICROSAFARI_SCHEDULE_VALUE_LENGTH) {
+        debugPrint("Scheduled command " + String(commandId) + " too long to hold, rejecting it");
+        return false;
+    }
+    
+    MicroSafariScheduledCommand command;
+    memset(&command, 0, sizeof(command));
+    command.executeAt = executeAt;
+    command.commandId = commandId;
+    strcpy(command.dataSource, dataSource.c_str());
+    strcpy(command.value, value.c_str());
+    
+    if (!_scheduler.schedule(command)) {
+        debugPrint("Command schedule full or " + String(commandId) + " too far ahead, rejecting it");
+        return false;
+    }
+    
+    saveSchedule();
+    debugPrint("Scheduled command " + String(commandId) + " for " + String(executeAt) +
+               " (in " + String((long)(executeAt - time(nullptr))) + "s)");
+    return true;
+}
+
+/**
+ * @brief Check if command is scheduled or waiting for its acknowledgment
+ */
+bool MicroSafari::isCommandHeld(int32_t commandId) {
+    if (_scheduler.contains(commandId)) {
+        return true;
+    }
+    for (size_t i = 0; i < _pendingAckCount; i++) {
+        if (_pendingAcks[i].commandId == commandId) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Execute due scheduled commands
+ */
+void MicroSafari::runScheduledCommands() {
+    time_t now = time(nullptr);
+    if (now < MICROSAFARI_EPOCH_VALID || _scheduler.getCount() == 0) {
+        return; // Clock not set yet or nothing scheduled
+    }
+    
+    _scheduler.advance((uint32_t)now);
+    
+    bool executed = false;
+    MicroSafariScheduledCommand command;
+    while (true) {
+        // An execution without a stored ack would be run again when the platform resends
+        // the command, so due commands wait until the ack buffer has room
+        if (_pendingAckCount == MICROSAFARI_ACK_BATCH && isWiFiConnected() &&
+            millis() - _lastAckFlush > MICROSAFARI_ACK_RETRY_MS) {
+            flushCommandAcks();
+        }
+        if (_pendingAckCount == MICROSAFARI_ACK_BATCH || !_scheduler.popDue(command)) {
+            break;
+        }
+        executed = true;
+        
+        DynamicJsonDocument doc(64);
+        doc.set(command.value);
+        uint32_t startUs = micros();
+        bool success = dispatchCommand(command.dataSource, doc.as<JsonVariant>());
+        uint32_t executeUs = micros() - startUs;
+        _commandLatency[MICROSAFARI_LATENCY_EXECUTE].record(executeUs);
+        debugPrint("Executed scheduled command " + String(command.commandId) +
+                   " (" + String((long)(now - command.executeAt)) + "s late)");
+        
+        if (_pendingAckCount == 0) {
+            _lastAckFlush = millis();
+        }
+        MicroSafariCommandAck& ack = _pendingAcks[_pendingAckCount++];
+        ack.commandId = command.commandId;
+        ack.executedAt = (uint32_t)now;
+        ack.executeUs = executeUs;
+        ack.success = success;
+    }
+    
+    if (executed) {
+        saveSchedule();
+    }
+}
+
+/**
+ * @brief Send batched acknowledgments
+ */
+bool MicroSafari::flushCommandAcks() {
+    if (_pendingAckCount == 0) {
+        return true;
+    }
+    _lastAckFlush = millis();
+    
+    DynamicJsonDocument doc(128 + _pendingAckCount * 160);
+    JsonArray acks = doc.createNestedArray("acks");
+    for (size_t i = 0; i < _pendingAckCount; i++) {
+        JsonObject ack = acks.createNestedObject();
+        ack["command_id"] = _pendingAcks[i].commandId;
+        ack["executed_at"] = _pendingAcks[i].executedAt; // Unix seconds, device clock
+        JsonObject result = ack.createNestedObject("result");
+        result["status"] = _pendingAcks[i].success ? "success" : "failure";
+        ack["trace"]["execute_us"] = _pendingAcks[i].executeUs;
+    }
+    doc["device_uptime"] = millis() / 1000;
+    
+    String jsonString;
+    serializeJson(doc, jsonString);
+    
+    MicroSafariResponse response = performHttpRequest("/api/commands/poll", jsonString, "POST");
+    if (!response.success) {
+        debugPrint("Failed to send command acknowledgments: " + response.errorMessage);
+        return false;
+    }
+    
+    debugPrint("Acknowledged " + String(_pendingAckCount) + " scheduled commands");
+    _pendingAckCount = 0;
+    saveSchedule();
+    return true;
+}
+
+/**
+ * @brief Store scheduled commands and unacknowledged executions in NVS
+ */
+void MicroSafari::saveSchedule() {
+    MicroSafariScheduledCommand commands[MICROSAFARI_SCHEDULE_MAX];
+    size_t count = _scheduler.getPending(commands, MICROSAFARI_SCHEDULE_MAX);
+    
+    Preferences preferences;
+    if (!preferences.begin(PREFERENCES_NAMESPACE, false)) {
+        return;
+    }
+    // Acks first: a reset in between leaves a command both executed and held, and
+    // loadSchedule() drops the held copy instead of running it twice
+    if (_pendingAckCount > 0) {
+        preferences.putBytes("acks", _pendingAcks, _pendingAckCount * sizeof(MicroSafariCommandAck));
+    } else if (preferences.isKey("acks")) {
+        preferences.remove("acks");
+    }
+    if (count > 0) {
+        preferences.putBytes("sched", commands, count * sizeof(MicroSafariScheduledCommand));
+    } else if (preferences.isKey("sched")) {
+        preferences.remove("sched");
+    }
+    preferences.end();
+}
+
+/**
+ * @brief Restore scheduled commands and unacknowledged executions from NVS
+ */
+void MicroSafari::loadSchedule() {
+    Preferences preferences;
+    if (!preferences.begin(PREFERENCES_NAMESPACE, true)) {
+        return;
+    }
+    
+    size_t ackLength = preferences.getBytesLength("acks");
+    _pendingAckCount = 0;
+    if (ackLength > 0 && ackLength % sizeof(MicroSafariCommandAck) == 0 && ackLength <= sizeof(_pendingAcks)) {
+        _pendingAckCount = preferences.getBytes("acks", _pendingAcks, ackLength) / sizeof(MicroSafariCommandAck);
+        _lastAckFlush = millis();
+    }
+    
+    MicroSafariScheduledCommand commands[MICROSAFARI_SCHEDULE_MAX];
+    size_t length = preferences.getBytesLength("sched");
+    size_t count = 0;
+    if (length > 0 && length % sizeof(MicroSafariScheduledCommand) == 0 && length <= sizeof(commands)) {
+        count = preferences.getBytes("sched", commands, length) / sizeof(MicroSafariScheduledCommand);
+    }
+    preferences.end();
+    
+    _scheduler.clear();
+    for (size_t i = 0; i < count; i++) {
+        if (!isCommandHeld(commands[i].commandId)) {
+            _scheduler.schedule(commands[i]);
+        }
+    }
+    if (count > 0 || _pendingAckCount > 0) {
+        debugPrint("Restored " + String(_scheduler.getCount()) + " scheduled commands, " +
+                   String(_pendingAckCount) + " unacknowledged executions");
+    }
+}
+
+/**
+ * @brief Get number of scheduled commands
+ */
+size_t MicroSafari::getScheduledCount() {
+    return _scheduler.getCount();
+}
+
+/**
+ * @brief Get share of command polls without pending commands
+ */
+float MicroSafari::getEmptyPollRatio() {
+    if (_commandPolls == 0) {
+        return 0.0f;
+    }
+    return (float)_emptyCommandPolls / _commandPolls;
+}
+
 /**
  * @brief Execute a device command based on data source and value
  */
@@ -890,7 +3022,7 @@ bool MicroSafari::executeCommand(const String& dataSource, const String& value)
 /**
  * @brief Acknowledge command execution status to the platform
  */
-bool MicroSafari::acknowledgeCommand(int commandId, bool success) {
+bool MicroSafari::acknowledgeCommand(int commandId, bool success, MicroSafariCommandTrace* trace) {
     debugPrint("Acknowledging command " + String(commandId) + " with status: " + (success ? "success" : "failure"));
     
     // Create acknowledgment payload
@@ -907,12 +3039,31 @@ bool MicroSafari::acknowledgeCommand(int commandId, bool success) {
     result["status"] = success ? "success" : "failure";
     result["device_uptime"] = millis() / 1000; // Uptime in seconds
     
+    // Stage durations; Unix times only when known
+    if (trace != nullptr) {
+        trace->ackSentUs = micros();
+        JsonObject traceData = doc.createNestedObject("trace");
+        if (trace->issuedAt != 0) {
+            traceData["issued_at"] = trace->issuedAt;
+        }
+        if (trace->receivedAt != 0) {
+            traceData["received_at"] = trace->receivedAt;
+        }
+        traceData["queue_us"] = trace->dispatchStartUs - trace->receivedUs;
+        traceData["execute_us"] = trace->dispatchEndUs - trace->dispatchStartUs;
+        traceData["ack_delay_us"] = trace->ackSentUs - trace->dispatchEndUs;
+    }
+    
     String jsonString;
     serializeJson(doc, jsonString);
     
     // Send acknowledgment via POST to /api/commands/poll
     MicroSafariResponse response = performHttpRequest("/api/commands/poll", jsonString, "POST");
     
+    if (trace != nullptr) {
+        recordCommandLatency(*trace, response.success ? micros() : 0);
+    }
+    
     if (response.success) {
         debugPrint("Command acknowledgment sent successfully");
         return true;
@@ -922,6 +3073,38 @@ bool MicroSafari::acknowledgeCommand(int commandId, bool success) {
     }
 }
 
+/**
+ * @brief Add command trace to latency histograms
+ */
+void MicroSafari::recordCommandLatency(const MicroSafariCommandTrace& trace, uint32_t ackDoneUs) {
+    if (trace.issuedAt != 0 && trace.receivedAt >= trace.issuedAt) {
+        uint64_t deliveryUs = (trace.receivedAt - trace.issuedAt) * 1000;
+        _commandLatency[MICROSAFARI_LATENCY_DELIVERY].record(deliveryUs > 0xFFFFFFFFULL ? 0xFFFFFFFFUL : (uint32_t)deliveryUs);
+    }
+    _commandLatency[MICROSAFARI_LATENCY_QUEUE].record(trace.dispatchStartUs - trace.receivedUs);
+    _commandLatency[MICROSAFARI_LATENCY_EXECUTE].record(trace.dispatchEndUs - trace.dispatchStartUs);
+    if (ackDoneUs != 0) {
+        _commandLatency[MICROSAFARI_LATENCY_ACK].record(ackDoneUs - trace.dispatchEndUs);
+        _commandLatency[MICROSAFARI_LATENCY_TOTAL].record(ackDoneUs - trace.receivedUs);
+    }
+}
+
+/**
+ * @brief Get command latency histogram
+ */
+const MicroSafariLatencyHistogram& MicroSafari::getCommandLatency(MicroSafariLatencyStage stage) {
+    return _commandLatency[stage < MICROSAFARI_LATENCY_STAGE_COUNT ? stage : MICROSAFARI_LATENCY_TOTAL];
+}
+
+/**
+ * @brief Forget recorded command latencies
+ */
+void MicroSafari::resetCommandLatency() {
+    for (MicroSafariLatencyHistogram& histogram : _commandLatency) {
+        histogram.reset();
+    }
+}
+
 /**
  * @brief Set command callback function for handling device commands
  */
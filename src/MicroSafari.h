@@ -29,6 +29,25 @@
 #include <ArduinoJson.h>
 #include <WiFiClientSecure.h>
 
+#include "MicroSafariAcquisition.h"
+#include "MicroSafariArchive.h"
+#include "MicroSafariCapture.h"
+#include "MicroSafariError.h"
+#include "MicroSafariFlashLog.h"
+#include "MicroSafariFlowControl.h"
+#include "MicroSafariLatency.h"
+#include "MicroSafariLinkController.h"
+#include "MicroSafariLog.h"
+#include "MicroSafariMemory.h"
+#include "MicroSafariReadingCache.h"
+#include "MicroSafariRetentionStore.h"
+#include "MicroSafariRuleEngine.h"
+#include "MicroSafariScheduler.h"
+#include "MicroSafariSensorRegistry.h"
+#include "MicroSafariShadow.h"
+#include "MicroSafariTime.h"
+#include "MicroSafariWaveform.h"
+
 /**
  * @brief Connection status enumeration
  */
@@ -42,28 +61,113 @@ enum MicroSafariStatus {
 
 /**
  * @brief HTTP response structure
+ *
+ * Returning a response allocates nothing on failure: the body of an
+ * error answer is only read in debug mode, and the error message is
+ * formatted when it is read.
  */
 struct MicroSafariResponse {
-    int httpCode;
-    String payload;
-    bool success;
-    String errorMessage;
+    int httpCode = 0;                ///< HTTP status, negative HTTPClient error, 0 if not sent
+    String payload;                  ///< Body of a successful answer, empty if there was none
+    bool success = false;            ///< Request succeeded
+    MicroSafariError error = MICROSAFARI_OK; ///< Cause of the failure, MICROSAFARI_OK on success
+    MicroSafariErrorMessage errorMessage; ///< Error description, formatted on first use
+    
+    /**
+     * @brief Mark the response as failed
+     * @param code Cause of the failure
+     * @param detail Static detail text (default: nullptr)
+     */
+    void fail(MicroSafariError code, const char* detail = nullptr) {
+        success = false;
+        error = code;
+        errorMessage = MicroSafariErrorMessage(code, httpCode > 0 ? httpCode : 0, detail);
+    }
+};
+
+/**
+ * @brief Extra HTTP request header for internal requests
+ */
+struct MicroSafariHttpHeader {
+    const char* name;
+    String value;
 };
 
+/**
+ * @brief Receives a downloaded response body piece by piece
+ * @param context Context pointer given with the request
+ * @param data Received bytes
+ * @param length Number of bytes
+ * @return true to continue, false to abort the download
+ */
+typedef bool (*MicroSafariDownloadSink)(void* context, const uint8_t* data, size_t length);
+
+/**
+ * @brief Heap use of platform connections
+ */
+struct MicroSafariTransportStats {
+    uint32_t transports;             ///< Transports created
+    uint32_t releases;               ///< Transports released, e.g. after idling
+    uint32_t connections;            ///< Connections opened
+    uint32_t heldBytes;              ///< Heap held by the last connection opened
+    uint32_t peakBytes;              ///< Largest heap drop while opening a connection
+};
+
+/**
+ * @brief Connections opened ahead of scheduled requests
+ */
+struct MicroSafariPrewarmStats {
+    uint32_t prewarms;               ///< Connections opened ahead of a request
+    uint32_t used;                   ///< Prewarmed connections a request went out on
+    uint32_t unused;                 ///< Prewarmed connections closed or released before use
+    uint32_t failures;               ///< Prewarm connects that failed
+    uint32_t setupMs;                ///< Learned connection setup time
+    uint32_t lastSetupMs;            ///< Setup time of the last prewarm
+};
+
+class MicroSafariChannel;
+class MicroSafariUpload;
+
 /**
  * @brief Main MicroSafari class for ESP32 connectivity
  */
 class MicroSafari {
+    friend class MicroSafariChannel;
+    friend class MicroSafariUpload;
+    friend class MicroSafariUpdate;
+    
 private:
+    /**
+     * @brief Response headers captured by performHttpRequest
+     */
+    enum ResponseHeader {
+        RESPONSE_HEADER_ETAG = 0,
+        RESPONSE_HEADER_UPLOAD_OFFSET,
+        RESPONSE_HEADER_RETRY_AFTER,
+        RESPONSE_HEADER_INGEST_INTERVAL,
+        RESPONSE_HEADER_COUNT
+    };
+    
     String _ssid;                    ///< WiFi SSID
     String _password;                ///< WiFi password
     String _apiKey;                  ///< Device API key
     String _platformUrl;             ///< MicroSafari platform URL
     String _deviceName;              ///< Device identifier name
     
-    WiFiClient _wifiClientHttp;      ///< Regular WiFi client for HTTP
-    WiFiClientSecure _wifiClientHttps; ///< Secure WiFi client for HTTPS
-    HTTPClient _httpClient;          ///< HTTP client instance
+    WiFiClient* _transport;          ///< Client for the platform URL's scheme, created on first request
+    bool _transportSecure;           ///< _transport is a WiFiClientSecure
+    HTTPClient* _httpClient;         ///< HTTP client, created with the transport
+    unsigned long _lastTransportUse; ///< Last request on the transport
+    unsigned long _transportIdleTimeout; ///< Idle time before the transport is released
+    MicroSafariTransportStats _transportStats; ///< Heap use of connections
+    bool _prewarmEnabled;            ///< Open connections ahead of scheduled requests
+    bool _prewarmPending;            ///< Open connection was prewarmed and not used yet
+    unsigned long _lastPrewarm;      ///< Timestamp of the last prewarm attempt
+    unsigned long _announcedSend;    ///< Time of a send announced by the sketch
+    bool _sendAnnounced;             ///< _announcedSend is set
+    MicroSafariPrewarmStats _prewarmStats; ///< Prewarm counters and learned setup time
+    MicroSafariMemoryStats _memoryStats[MICROSAFARI_API_COUNT]; ///< Memory use per public operation
+    String _responseHeaders[RESPONSE_HEADER_COUNT]; ///< Headers of the last HTTP response
     
     MicroSafariStatus _status;       ///< Current connection status
     unsigned long _lastConnectionAttempt; ///< Last WiFi connection attempt timestamp
@@ -75,11 +179,64 @@ private:
     int _consecutiveFailures;        ///< Count of consecutive connection failures
     int _maxConsecutiveFailures;     ///< Maximum allowed consecutive failures before reset
     unsigned long _lastErrorTime;    ///< Timestamp of last error occurrence
-    String _lastErrorMessage;        ///< Last error message for debugging
+    MicroSafariErrorMessage _lastError; ///< Last error for debugging
     bool _autoReconnect;            ///< Enable automatic reconnection
     
     bool _debug;                     ///< Debug mode flag
     
+    MicroSafariReadingCache _readingCache; ///< Recent readings per metric
+    MicroSafariSensorRegistry _sensorRegistry; ///< Registered non-blocking sensors
+    MicroSafariAcquisition* _acquisition; ///< Optional continuous ADC acquisition
+    MicroSafariCapture* _capture;    ///< Optional ISR sample capture
+    unsigned long _captureWindow;    ///< Capture aggregation window in milliseconds
+    unsigned long _captureWindowStart; ///< Start of the current capture window
+    MicroSafariWaveform* _waveform;  ///< Optional waveform capture with FFT features
+    MicroSafariLog* _log;            ///< Optional asynchronous debug log
+    MicroSafariArchive* _archive;    ///< Optional SD card archive of every reading
+    unsigned long _waveformInterval; ///< Time between waveform captures in milliseconds
+    unsigned long _lastWaveformCapture; ///< Start of the last waveform capture
+    MicroSafariRuleEngine _ruleEngine; ///< Local threshold rules
+    unsigned long _lastRuleEventFlush; ///< Last rule event report attempt timestamp
+    MicroSafariRetentionStore* _retentionStore; ///< Optional store for readings that could not be sent
+    unsigned long _lastRetentionDrain; ///< Last retention drain attempt timestamp
+    size_t _retentionDrainBatch;     ///< Records per retention drain request
+    
+    bool _remoteConfigEnabled;       ///< Fetch configuration from the platform
+    unsigned long _remoteConfigInterval; ///< Remote configuration fetch interval in milliseconds
+    unsigned long _lastRemoteConfigFetch; ///< Last remote configuration fetch timestamp
+    String _remoteConfigEtag;        ///< ETag of the applied remote configuration
+    
+    bool _commandPollingEnabled;     ///< Poll commands from loop()
+    unsigned long _commandPollInterval; ///< Command poll interval in milliseconds
+    unsigned long _lastCommandPoll;  ///< Last automatic command poll timestamp
+    bool _configCommandsEnabled;     ///< Handle reserved __cfg commands
+    bool _persistConfigCommands;     ///< Store values set by __cfg commands in NVS
+    
+    MicroSafariScheduler _scheduler; ///< Commands waiting for their execute_at time
+    MicroSafariCommandAck _pendingAcks[MICROSAFARI_ACK_BATCH]; ///< Scheduled executions not yet acknowledged
+    size_t _pendingAckCount;         ///< Entries in _pendingAcks
+    unsigned long _lastAckFlush;     ///< Last acknowledgment batch attempt timestamp
+    
+    MicroSafariShadow _shadow;       ///< Reported and desired actuator state
+    unsigned long _lastShadowApply;  ///< Last attempt to apply pending desired values
+    unsigned long _lastShadowSync;   ///< Last standalone shadow report attempt
+    
+    long _commandCursor;             ///< Newest command ID received from the platform
+    unsigned long _commandPolls;     ///< Successful command polls
+    unsigned long _emptyCommandPolls; ///< Command polls without pending commands
+    unsigned long _headerOnlyCommandPolls; ///< Empty polls answered with 204/304 and no body
+    MicroSafariLatencyHistogram _commandLatency[MICROSAFARI_LATENCY_STAGE_COUNT]; ///< Command latency per stage
+    
+    String _batchBuffer;             ///< Serialized batch entries, comma separated
+    size_t _batchEntries;            ///< Entries in the batch buffer
+    size_t _batchSize;               ///< Entries that trigger a batch flush
+    unsigned long _batchInterval;    ///< Maximum age of a queued entry in milliseconds
+    unsigned long _batchStarted;     ///< Timestamp of the oldest queued entry
+    MicroSafariLinkController _link; ///< Link quality estimate
+    bool _adaptiveBatching;          ///< Batch size and interval follow the link quality
+    unsigned long _lastRssiSample;   ///< Timestamp of the last RSSI sample
+    MicroSafariFlowControl _flowControl; ///< Ingest budget from the server
+    
     // Command callback function pointer
     bool (*_commandCallback)(const String& dataSource, const String& value);
     
@@ -101,11 +258,320 @@ private:
      * @param endpoint API endpoint to call
      * @param payload JSON payload to send
      * @param method HTTP method (default: POST)
+     * @param headers Extra request headers, replacing defaults of the same name (default: none)
+     * @param headerCount Number of extra request headers
      * @return MicroSafariResponse structure with response details
      */
     MicroSafariResponse performHttpRequest(const String& endpoint, 
                                           const String& payload, 
-                                          const String& method = "POST");
+                                          const String& method = "POST",
+                                          const MicroSafariHttpHeader* headers = nullptr,
+                                          size_t headerCount = 0);
+    
+    /**
+     * @brief Internal method to create the transport for the platform URL's scheme
+     * @return true if the transport exists, false if out of memory
+     */
+    bool acquireTransport();
+    
+    /**
+     * @brief Internal method to open the HTTP client with default and extra headers
+     * @param endpoint API endpoint to call
+     * @param headers Extra request headers, replacing defaults of the same name
+     * @param headerCount Number of extra request headers
+     * @return true if opened, false if the transport could not be created
+     */
+    bool beginHttpRequest(const String& endpoint, const MicroSafariHttpHeader* headers, size_t headerCount);
+    
+    /**
+     * @brief Internal method to send the opened request and measure new connections
+     * @param method HTTP method
+     * @param body Request body, nullptr for none
+     * @param length Body length in bytes
+     * @return HTTP status code, negative on connection errors
+     */
+    int sendHttpRequest(const char* method, const uint8_t* body, size_t length);
+    
+    /**
+     * @brief Internal method to classify a failed request
+     *
+     * Connection failures count as TLS only when the secure client
+     * reports an mbedTLS error, which requires a resolved host and a
+     * connected socket. Otherwise the platform host is resolved once to
+     * tell DNS failures from refused connections.
+     *
+     * @param httpCode HTTP status or negative HTTPClient error
+     * @return Cause of the failure
+     */
+    MicroSafariError classifyHttpError(int httpCode);
+    
+    /**
+     * @brief Internal method to get host and port of the platform URL
+     * @param host Receives the host name
+     * @param port Receives the port, the scheme's default if none is given
+     */
+    void getPlatformHost(String& host, uint16_t& port) const;
+    
+    /**
+     * @brief Internal method to update transport statistics after a new connection
+     * @param freeBefore Free heap before connecting
+     * @param lowestBefore Heap low-water mark before connecting
+     */
+    void noteNewConnection(uint32_t freeBefore, uint32_t lowestBefore);
+    
+    /**
+     * @brief Internal method to get the time until the next scheduled request
+     * @return Milliseconds until due, negative if overdue; the heartbeat is always scheduled,
+     *         so there is always a next request
+     */
+    long getNextRequestDelay() const;
+    
+    /**
+     * @brief Internal method to get the batch size in effect
+     * @return Configured size, adapted to the link if adaptive batching is on
+     */
+    size_t getActiveBatchSize() const;
+    
+    /**
+     * @brief Internal method to get the batch interval in effect
+     * @return Configured interval, adapted to the link if adaptive batching is on
+     */
+    unsigned long getActiveBatchInterval() const;
+    
+    /**
+     * @brief Internal method to sample the link and apply level changes
+     */
+    void updateLinkQuality();
+    
+    /**
+     * @brief Internal method to update the ingest budget from the last response
+     * @param httpCode HTTP status of the ingest request
+     */
+    void applyFlowControl(int httpCode);
+    
+    /**
+     * @brief Internal method to open the connection ahead of the next scheduled request
+     */
+    void prewarmConnection();
+    
+    /**
+     * @brief Internal method to check if a response body is read
+     * @param httpCode HTTP status or negative HTTPClient error
+     * @return true for 2xx answers with a body, and for error answers in debug mode
+     */
+    bool wantsResponseBody(int httpCode) const;
+    
+    /**
+     * @brief Internal method to remove an unread response body from the connection
+     *
+     * Small bodies are read and dropped so the keep-alive connection can be
+     * reused; for others the connection is closed.
+     *
+     * @param httpCode HTTP status or negative HTTPClient error
+     */
+    void discardResponseBody(int httpCode);
+    
+    /**
+     * @brief Internal method to send one request with a binary body, without retries
+     *
+     * Used by resumable uploads, which recover from failures by asking
+     * the server for its offset instead of repeating the request.
+     *
+     * @param endpoint API endpoint to call
+     * @param method HTTP method, e.g. "PATCH" or "HEAD"
+     * @param body Request body, nullptr for none
+     * @param length Body length in bytes
+     * @param headers Extra request headers
+     * @param headerCount Number of extra request headers
+     * @return MicroSafariResponse structure with response details
+     */
+    MicroSafariResponse performBinaryRequest(const String& endpoint,
+                                            const char* method,
+                                            const uint8_t* body,
+                                            size_t length,
+                                            const MicroSafariHttpHeader* headers,
+                                            size_t headerCount);
+    
+    /**
+     * @brief Internal method to download a byte range, streaming the body to a sink
+     *
+     * Used by firmware updates, which apply the body while it arrives
+     * instead of holding it in a String. A server that ignores Range may
+     * answer 200 with the whole body, which is accepted at offset 0 only.
+     *
+     * @param endpoint API endpoint to call
+     * @param offset First byte requested
+     * @param length Bytes requested, at least 1
+     * @param sink Receives the body
+     * @param context Context pointer passed to the sink
+     * @return MicroSafariResponse structure with response details, payload empty
+     */
+    MicroSafariResponse performDownloadRequest(const String& endpoint,
+                                              uint32_t offset,
+                                              uint32_t length,
+                                              MicroSafariDownloadSink sink,
+                                              void* context);
+    
+    /**
+     * @brief Internal method to add an entry to the shared batch
+     * @param apiKey API key of the identity the entry belongs to
+     * @param deviceName Device name added if the data has none
+     * @param sensorData JSON object containing sensor readings
+     * @return true if queued, false if the batch is full
+     */
+    bool enqueueBatchEntry(const char* apiKey, const char* deviceName, const JsonObject& sensorData);
+    
+    /**
+     * @brief Internal method to validate and apply a configuration document
+     * 
+     * All values are validated first; the document is only applied if
+     * every known key is in range. Unknown keys are ignored.
+     * 
+     * @param config JSON object with configuration keys
+     * @return true if configuration applied, false if rejected
+     */
+    bool applyConfig(const JsonObject& config);
+    
+    /**
+     * @brief Internal method to check a single configuration value
+     * @param key Configuration key
+     * @param value Configuration value
+     * @return true if key is known and value is in range
+     */
+    bool validateConfigValue(const char* key, const JsonVariant& value);
+    
+    /**
+     * @brief Internal method to apply a single validated configuration value
+     * @param key Configuration key
+     * @param value Configuration value
+     */
+    void applyConfigValue(const char* key, const JsonVariant& value);
+    
+    /**
+     * @brief Internal method to load the cached remote configuration from NVS
+     */
+    void loadCachedConfig();
+    
+    /**
+     * @brief Internal method to handle a reserved configuration command
+     * 
+     * "__cfg.<key>" sets one configuration key; "__cfg" takes a JSON
+     * object with several keys that are validated together and applied
+     * all or nothing.
+     * 
+     * @param dataSource Command data source starting with "__cfg"
+     * @param value Command value
+     * @return true if the configuration was applied, false if rejected
+     */
+    bool handleConfigCommand(const String& dataSource, const JsonVariant& value);
+    
+    /**
+     * @brief Internal method to apply configuration persisted by __cfg commands
+     */
+    void loadCommandConfig();
+    
+    /**
+     * @brief Internal method to add a command trace to the latency histograms
+     * @param trace Command trace
+     * @param ackDoneUs micros() when the acknowledgment was accepted, 0 if it was not
+     */
+    void recordCommandLatency(const MicroSafariCommandTrace& trace, uint32_t ackDoneUs);
+    
+    /**
+     * @brief Internal method to run a command through reserved handlers or the user callback
+     * @param dataSource Command data source
+     * @param value Command value
+     * @return true if the command succeeded, false otherwise
+     */
+    bool dispatchCommand(const String& dataSource, const JsonVariant& value);
+    
+    /**
+     * @brief Internal reading cache listener that evaluates local rules
+     */
+    static void onReading(void* context, const char* name, float value);
+    
+    /**
+     * @brief Internal rule action handler that dispatches rule commands
+     */
+    static bool onRuleAction(void* context, const char* dataSource, const char* value);
+    
+    /**
+     * @brief Internal shadow action handler that dispatches desired values
+     */
+    static bool onShadowAction(void* context, const char* name, const char* value);
+    
+    /**
+     * @brief Internal method to add unreported shadow changes to a request document
+     * @param root Request document root
+     * @return Bit mask of the added properties, 0 if none
+     */
+    uint32_t attachShadowReport(JsonObject root);
+    
+    /**
+     * @brief Internal method to apply a desired shadow delta
+     * @param shadow JSON object with "version" and "desired"
+     */
+    void handleShadowDelta(const JsonObject& shadow);
+    
+    /**
+     * @brief Internal method to pick a desired shadow delta out of a response body
+     * @param payload Response body
+     */
+    void handleShadowResponse(const String& payload);
+    
+    /**
+     * @brief Internal method to store the compiled rule table in NVS
+     */
+    void saveRules();
+    
+    /**
+     * @brief Internal method to restore the compiled rule table from NVS
+     */
+    void loadRules();
+    
+    /**
+     * @brief Internal method to hold a command until its execute_at time
+     * @param commandId Platform command ID
+     * @param dataSource Command data source
+     * @param value Command value
+     * @param executeAt Unix time in seconds
+     * @return true if scheduled, false if it cannot be held and must be rejected
+     */
+    bool scheduleCommand(long commandId, const String& dataSource, const String& value, uint32_t executeAt);
+    
+    /**
+     * @brief Internal method to check if a command is scheduled or its execution not yet acknowledged
+     * @param commandId Platform command ID
+     * @return true if the command must not run again
+     */
+    bool isCommandHeld(int32_t commandId);
+    
+    /**
+     * @brief Internal method to execute scheduled commands that are due
+     */
+    void runScheduledCommands();
+    
+    /**
+     * @brief Internal method to store scheduled commands and unacknowledged executions in NVS
+     */
+    void saveSchedule();
+    
+    /**
+     * @brief Internal method to restore scheduled commands and unacknowledged executions from NVS
+     */
+    void loadSchedule();
+    
+    /**
+     * @brief Internal method to store numeric readings in the reading cache
+     * @param sensorData JSON object containing sensor readings
+     */
+    void recordReadings(const JsonObject& sensorData);
+    
+    /**
+     * @brief Internal method to keep numeric readings in the retention store
+     * @param sensorData JSON object containing sensor readings
+     */
+    void retainReadings(const JsonObject& sensorData);
     
     /**
      * @brief Internal method to validate JSON payload structure
@@ -122,15 +588,15 @@ private:
     
     /**
      * @brief Internal method to send heartbeat to platform
-     * @return true if heartbeat successful, false otherwise
+     * @return MicroSafariResponse with the result; error tells overload apart from link failures
      */
-    bool sendHeartbeat();
+    MicroSafariResponse sendHeartbeat();
     
     /**
      * @brief Internal method to handle connection failure
-     * @param errorMessage Error message describing the failure
+     * @param error Error describing the failure
      */
-    void handleConnectionFailure(const String& errorMessage);
+    void handleConnectionFailure(const MicroSafariErrorMessage& error);
     
     /**
      * @brief Internal method to reset connection state
@@ -215,6 +681,193 @@ public:
                                        float soilMoisture = -1, 
                                        float lightLevel = -1);
     
+    /**
+     * @brief Register a non-blocking sensor
+     * 
+     * loop() starts a read whenever minInterval has elapsed and calls the
+     * step function until it returns MICROSAFARI_SENSOR_READY or
+     * MICROSAFARI_SENSOR_FAILED. Reads of different sensors overlap, and
+     * the latest value is cached for sendCachedSensorData.
+     * 
+     * @param metric Metric name used in payloads
+     * @param step Non-blocking read state machine
+     * @param context User context passed to the step function (default: nullptr)
+     * @param minInterval Minimum time between reads in milliseconds (default: 2000)
+     * @param ttl Time a cached value stays valid in milliseconds (default: 60000, 0 = forever)
+     * @return true if registered, false if the registry is full or the metric exists
+     */
+    bool registerSensor(const char* metric,
+                        MicroSafariSensorStep step,
+                        void* context = nullptr,
+                        unsigned long minInterval = 2000,
+                        unsigned long ttl = 60000);
+    
+    /**
+     * @brief Send all valid cached sensor values to the platform
+     * 
+     * Builds the payload from the sensor registry cache only; no sensor
+     * is read while sending.
+     * 
+     * @return MicroSafariResponse structure with response details
+     */
+    MicroSafariResponse sendCachedSensorData();
+    
+    /**
+     * @brief Set continuous ADC acquisition
+     * 
+     * loop() consumes the acquired samples and stores the decimated
+     * values in the reading cache under each channel's metric name.
+     * 
+     * @param acquisition Started acquisition, nullptr to detach
+     */
+    void setAcquisition(MicroSafariAcquisition* acquisition);
+    
+    /**
+     * @brief Set ISR sample capture
+     *
+     * loop() drains the capture ring in task context and queues the
+     * aggregates of every window for the next batch request, so pulses
+     * counted in interrupts reach the platform without the ISR touching
+     * String or the heap.
+     *
+     * @param capture Capture with its channels added, nullptr to detach
+     * @param window Aggregation window in milliseconds (default: 60000)
+     */
+    void setCapture(MicroSafariCapture* capture, unsigned long window = 60000);
+    
+    /**
+     * @brief Set waveform capture with FFT features
+     *
+     * loop() starts a capture from the waveform's sample source every
+     * interval, fills the buffer and queues the features for the next
+     * batch request; the raw samples never leave the device. Samples
+     * pushed with addSample() are computed as soon as the buffer is full.
+     *
+     * @param waveform Started waveform, nullptr to detach
+     * @param interval Time between captures in milliseconds (default: 60000)
+     */
+    void setWaveform(MicroSafariWaveform* waveform, unsigned long interval = 60000);
+    
+    /**
+     * @brief Get the sensor registry
+     * @return Reference to the sensor registry
+     */
+    MicroSafariSensorRegistry& getSensorRegistry();
+    
+    /**
+     * @brief Queue sensor data for the next batch request
+     * 
+     * Queued entries of this instance and of all attached
+     * MicroSafariChannel identities are sent together to
+     * /api/ingest/batch, each with its own API key. loop() sends the
+     * batch when it holds the configured number of entries or its
+     * oldest entry reached the batch interval.
+     * 
+     * @param sensorData JSON object containing sensor readings
+     * @return true if queued, false if the batch is full
+     */
+    bool queueSensorData(const JsonObject& sensorData);
+    
+    /**
+     * @brief Send all queued batch entries now
+     * @return MicroSafariResponse structure with response details
+     */
+    MicroSafariResponse flushBatch();
+    
+    /**
+     * @brief Set batch flush thresholds
+     * @param maxEntries Entries that trigger a flush (default: 8, max MICROSAFARI_BATCH_MAX_ENTRIES)
+     * @param interval Maximum age of a queued entry in milliseconds (default: 30000)
+     */
+    void setBatchConfig(size_t maxEntries = 8, unsigned long interval = 30000);
+    
+    /**
+     * @brief Get number of queued batch entries
+     * @return Queued entries
+     */
+    size_t getQueuedCount();
+    
+    /**
+     * @brief Enable or disable link-quality-driven batching
+     *
+     * The batch size and interval set by setBatchConfig() apply on a fair
+     * link. On a poor link both double, so fewer and larger requests go
+     * out; on a good link both halve for fresher data. Every level change
+     * is queued as a metric entry and logged in debug mode.
+     *
+     * @param enabled true to adapt batching (default: true)
+     */
+    void setAdaptiveBatching(bool enabled = true);
+    
+    /**
+     * @brief Get the link quality estimate
+     *
+     * Collected whether or not adaptive batching is enabled.
+     *
+     * @return Reference to the link statistics
+     */
+    const MicroSafariLinkStats& getLinkStats() const;
+    
+    /**
+     * @brief Get the ingest budget state
+     *
+     * While the platform paces ingest requests, loop() holds back batch
+     * flushes, heartbeats and retention drains, and direct sends fail
+     * with MICROSAFARI_ERROR_THROTTLED without touching the network.
+     *
+     * @return Reference to the flow control statistics
+     */
+    const MicroSafariFlowStats& getFlowStats() const;
+    
+    /**
+     * @brief Get the cache of recent readings
+     * 
+     * Every numeric top-level value passed to sendSensorData is stored
+     * here, so the latest readings can be queried without sampling the
+     * sensors again.
+     * 
+     * @return Reference to the reading cache
+     */
+    MicroSafariReadingCache& getReadingCache();
+    
+    /**
+     * @brief Set flash-backed retention store for readings that could not be sent
+     * 
+     * When sendSensorData fails because of the network or the server,
+     * its numeric readings are written to the store. loop() drains the
+     * store through the ingest endpoint once the platform is reachable.
+     * 
+     * @param store Mounted retention store, nullptr to disable retention
+     */
+    void setRetentionStore(MicroSafariRetentionStore* store);
+    
+    /**
+     * @brief Send one batch of retained readings to the platform
+     * @param maxRecords Maximum records per request (default: MICROSAFARI_RETENTION_DRAIN_BATCH)
+     * @return Number of records confirmed by the platform
+     */
+    size_t drainRetention(size_t maxRecords = MICROSAFARI_RETENTION_DRAIN_BATCH);
+    
+    /**
+     * @brief Enable or disable remote configuration
+     * 
+     * The configuration document is fetched from /api/devices/config
+     * once the device is online and then periodically. Requests carry the
+     * ETag of the applied document in If-None-Match, so an unchanged
+     * configuration is answered with 304 Not Modified and no body. The
+     * last document is cached in NVS and applied on the next boot.
+     * 
+     * @param enable true to enable remote configuration, false to disable
+     * @param interval Fetch interval in milliseconds (default: 3600000 = 1 hour)
+     */
+    void setRemoteConfig(bool enable, unsigned long interval = 3600000);
+    
+    /**
+     * @brief Fetch remote configuration now
+     * @return true if the configuration is up to date, false otherwise
+     */
+    bool fetchRemoteConfig();
+    
     /**
      * @brief Get current connection status
      * @return MicroSafariStatus enumeration value
@@ -239,6 +892,28 @@ public:
      */
     void setDebug(bool enable);
     
+    /**
+     * @brief Send debug output through an asynchronous log
+     *
+     * While the log's drain task runs, debug messages are copied into its
+     * ring and written to Serial or syslog in the background, so debug
+     * mode no longer stalls requests on UART output.
+     *
+     * @param log Started log, nullptr to print to Serial directly
+     */
+    void setLog(MicroSafariLog* log);
+    
+    /**
+     * @brief Archive every reading on an SD card
+     *
+     * Every numeric reading passed to sendSensorData() or
+     * queueSensorData() is also queued for the archive's writer task,
+     * whether or not it reaches the platform.
+     *
+     * @param archive Started archive, nullptr to stop archiving
+     */
+    void setArchive(MicroSafariArchive* archive);
+    
     /**
      * @brief Set connection timeout for WiFi
      * @param timeout Timeout in milliseconds
@@ -300,6 +975,12 @@ public:
      */
     String getLastError();
     
+    /**
+     * @brief Get cause of the last error
+     * @return Error code, MICROSAFARI_OK if none recorded
+     */
+    MicroSafariError getLastErrorCode() const;
+    
     /**
      * @brief Clear error history and reset failure counters
      */
@@ -322,6 +1003,83 @@ public:
      */
     void disconnect();
     
+    /**
+     * @brief Close the platform connection and free the transport
+     *
+     * A TLS session holds its record buffers (up to 2 x 16 KB with the
+     * default mbedTLS configuration) while the keep-alive connection is
+     * open. The next request creates the transport again.
+     */
+    void releaseTransport();
+    
+    /**
+     * @brief Set idle time after which loop() releases the transport
+     * @param timeout Idle time in milliseconds, 0 to keep the connection open (default: 30000)
+     */
+    void setTransportIdleTimeout(unsigned long timeout = 30000);
+    
+    /**
+     * @brief Get heap use of platform connections
+     *
+     * Measured around each request that opens a new connection: heldBytes
+     * is the heap the open connection occupies, peakBytes also includes
+     * the handshake when it lowered the heap's low-water mark.
+     *
+     * @return Reference to the transport statistics
+     */
+    const MicroSafariTransportStats& getTransportStats() const;
+    
+    /**
+     * @brief Enable or disable connection prewarming
+     *
+     * loop() opens the connection (DNS, TCP and TLS) shortly before the
+     * next heartbeat, batch flush, command poll or configuration fetch,
+     * so the request goes out on a warm socket. The lead time is learned
+     * from measured setup times.
+     *
+     * @param enabled true to prewarm (default: true)
+     */
+    void setPrewarm(bool enabled);
+    
+    /**
+     * @brief Announce a send the sketch will make itself
+     *
+     * Lets loop() prewarm the connection for sends made outside the
+     * library's own schedule, e.g. sendSensorData() on a sketch timer.
+     *
+     * @param delayMs Milliseconds until the send
+     */
+    void announceSend(unsigned long delayMs);
+    
+    /**
+     * @brief Get prewarm counters and the learned setup time
+     * @return Reference to the prewarm statistics
+     */
+    const MicroSafariPrewarmStats& getPrewarmStats() const;
+    
+    /**
+     * @brief Get memory use of a public operation
+     *
+     * Heap peak, largest block and stack depth measured over all calls
+     * since startup or the last reset. Use the figures of a test run
+     * with the production configuration to size heap and task stack.
+     *
+     * @param api Operation, e.g. MICROSAFARI_API_SEND_SENSOR_DATA
+     * @return Reference to the statistics, all zero if never called
+     */
+    const MicroSafariMemoryStats& getMemoryStats(MicroSafariApi api) const;
+    
+    /**
+     * @brief Get memory use of all operations called so far, one line each
+     * @return String containing the memory report
+     */
+    String getMemoryReport() const;
+    
+    /**
+     * @brief Reset memory statistics of all operations
+     */
+    void resetMemoryStats();
+    
     /**
      * @brief Main loop function - call this regularly in your main loop
      * Handles automatic reconnection and status monitoring
@@ -349,10 +1107,159 @@ public:
     
     /**
      * @brief Poll for pending device commands from the platform
+     * 
+     * The request carries the newest command ID seen so far in the
+     * X-Command-Cursor header. When nothing new is pending the platform
+     * answers with 204 No Content (or 304 Not Modified) and the response
+     * body is neither read nor parsed.
+     * 
+     * Commands with a future execute_at (Unix seconds) are held on the
+     * device, persisted in NVS and executed by loop() at that time, also
+     * while offline. Their results are acknowledged in batches. Commands
+     * that cannot be held are acknowledged as failed, not run early.
+     * 
      * @return MicroSafariResponse with command data if available
      */
     MicroSafariResponse pollCommands();
     
+    /**
+     * @brief Poll commands automatically from loop()
+     * @param enable true to enable automatic polling, false to disable
+     * @param interval Poll interval in milliseconds (default: 30000)
+     */
+    void setCommandPolling(bool enable, unsigned long interval = 30000);
+    
+    /**
+     * @brief Configure reserved configuration commands
+     * 
+     * Commands whose data source starts with "__cfg" are handled by the
+     * library instead of the command callback. They accept the same keys
+     * and limits as remote configuration, e.g. "__cfg.heartbeat_interval_ms"
+     * with value "60000". Persisted values are applied again in begin().
+     * 
+     * @param enable true to handle configuration commands (default), false to reject them
+     * @param persist true to store applied values in NVS (default: false)
+     */
+    void setConfigCommands(bool enable, bool persist = false);
+    
+    /**
+     * @brief Replace the local rule table
+     * 
+     * Rules are compiled into a fixed table, persisted in NVS and
+     * evaluated on every reading stored in the reading cache. Matching
+     * rules run their command through the same handlers as platform
+     * commands. The platform can push rules with the reserved command
+     * data source "__rules" and a JSON array value.
+     * 
+     * @param rulesJson JSON array of rules, "[]" to remove all rules
+     * @return true if all rules compiled and were loaded, false otherwise
+     */
+    bool setRules(const String& rulesJson);
+    
+    /**
+     * @brief Get the local rule engine
+     * @return Reference to the rule engine
+     */
+    MicroSafariRuleEngine& getRuleEngine();
+    
+    /**
+     * @brief Report rule hits to the platform now
+     * 
+     * loop() reports them automatically, at most once a minute unless
+     * MICROSAFARI_RULE_EVENT_BATCH events are waiting, and never more
+     * often than every MICROSAFARI_RULE_EVENT_RETRY_MS.
+     * 
+     * @return true if nothing is pending or the batch was accepted
+     */
+    bool flushRuleEvents();
+    
+    /**
+     * @brief Keep an actuator in the device shadow
+     * 
+     * The reported state of shadowed actuators travels with regular
+     * ingest requests and the platform answers with desired values in
+     * poll and ingest responses. Only changes are sent either way. A
+     * desired value that differs from the reported one runs through the
+     * command callback with the property name as data source; successful
+     * commands for shadowed actuators are confirmed by the reported state
+     * instead of a per-command acknowledgment, failed ones are still
+     * acknowledged as failures. Use it for idempotent actuators
+     * where only the final state matters.
+     * 
+     * @param name Command data source of the actuator, e.g. "pump_control"
+     * @return true if shadowed, false if the shadow is full or the name is too long
+     */
+    bool addShadowProperty(const char* name);
+    
+    /**
+     * @brief Report the current state of a shadowed actuator
+     * 
+     * Call this when the actuator changes outside of commands, e.g. from
+     * a local button or at startup. Successful commands report their
+     * value automatically.
+     * 
+     * @param name Property name
+     * @param value Current actuator value
+     * @return true if the property is shadowed
+     */
+    bool reportState(const char* name, const String& value);
+    
+    /**
+     * @brief Send unreported shadow changes now
+     * 
+     * loop() sends them on its own when no ingest request carried them
+     * within 15 seconds.
+     * 
+     * @return true if nothing is pending or the report was accepted
+     */
+    bool syncShadow();
+    
+    /**
+     * @brief Get the device shadow
+     * @return Reference to the device shadow
+     */
+    MicroSafariShadow& getShadow();
+    
+    /**
+     * @brief Get number of commands waiting for their execute_at time
+     * @return Scheduled command count
+     */
+    size_t getScheduledCount();
+    
+    /**
+     * @brief Send acknowledgments of executed scheduled commands now
+     * 
+     * loop() sends them automatically once MICROSAFARI_ACK_BATCH results
+     * are waiting or the oldest waited for a minute, with at least
+     * MICROSAFARI_ACK_RETRY_MS between attempts.
+     * 
+     * @return true if nothing is pending or the batch was accepted
+     */
+    bool flushCommandAcks();
+    
+    /**
+     * @brief Get command latency histogram of one stage
+     *
+     * Every command received by pollCommands is traced from receipt to
+     * acknowledgment. Commands that carry issued_at (Unix seconds or
+     * milliseconds) also feed the delivery stage once the clock is set.
+     *
+     * @param stage Latency stage
+     * @return Histogram of durations in microseconds
+     */
+    const MicroSafariLatencyHistogram& getCommandLatency(MicroSafariLatencyStage stage);
+    
+    /**
+     * @brief Forget all recorded command latencies
+     */
+    void resetCommandLatency();
+    
+    /**
+     * @brief Get share of successful command polls that found no commands
+     * @return Ratio between 0.0 and 1.0
+     */
+    float getEmptyPollRatio();
+    
     /**
      * @brief Execute a device command based on data source and value
      * @param dataSource The command data source (e.g., "red_light", "pump_control")
@@ -365,9 +1272,11 @@ public:
      * @brief Acknowledge command execution status to the platform
      * @param commandId The ID of the command to acknowledge
      * @param success Whether the command executed successfully
+     * @param trace Optional command trace sent with the acknowledgment and
+     *              added to the latency histograms (default: none)
      * @return true if acknowledgment sent successfully, false otherwise
      */
-    bool acknowledgeCommand(int commandId, bool success);
+    bool acknowledgeCommand(int commandId, bool success, MicroSafariCommandTrace* trace = nullptr);
     
     /**
      * @brief Set command callback function for handling device commands
@@ -376,4 +1285,8 @@ public:
     void setCommandCallback(bool (*callback)(const String& dataSource, const String& value));
 };
 
+#include "MicroSafariChannel.h"
+#include "MicroSafariUpdate.h"
+#include "MicroSafariUpload.h"
+
 #endif // MICROSAFARI_H
\ No newline at end of file
@@ -0,0 +1,412 @@
+/*!
+ * @file MicroSafariAcquisition.cpp
+ * @brief Implementation of the MicroSafari ADC acquisition pipeline
+ * @version 1.0.0
+ * @date 2025-08-22
+ */
+
+#include "MicroSafariAcquisition.h"
+#include <math.h>
+#include <atomic>
+
+// The continuous ADC API (analogContinuous) was added in arduino-esp32 3.0
+#if defined(ESP_ARDUINO_VERSION_MAJOR) && ESP_ARDUINO_VERSION_MAJOR >= 3
+#define MICROSAFARI_HAS_ADC_CONTINUOUS 1
+#endif
+
+// Samples a synthetic source buffers before it reports overruns, like a DMA pool
+static const uint32_t SYNTHETIC_BUFFER_SAMPLES = 1024;
+
+#ifdef MICROSAFARI_HAS_ADC_CONTINUOUS
+static uint8_t s_adcPins[MICROSAFARI_ACQ_MAX_CHANNELS];
+// Incremented by the ISR, so the reader consumes frames with an atomic decrement
+static std::atomic<uint32_t> s_adcFramesReady(0);
+
+/**
+ * @brief ADC frame-complete interrupt
+ */
+static void ARDUINO_ISR_ATTR onAdcFrame() {
+    s_adcFramesReady++;
+}
+#endif
+
+/**
+ * @brief Constructor
+ */
+MicroSafariDmaAdcSource::MicroSafariDmaAdcSource(uint32_t conversionsPerPin) {
+    _conversionsPerPin = conversionsPerPin > 0 ? conversionsPerPin : 1;
+    _pinCount = 0;
+    _running = false;
+}
+
+/**
+ * @brief Start continuous sampling
+ */
+bool MicroSafariDmaAdcSource::begin(const uint8_t* pins, size_t count, uint32_t sampleRateHz) {
+#ifdef MICROSAFARI_HAS_ADC_CONTINUOUS
+    if (_running || pins == nullptr || count == 0 || count > MICROSAFARI_ACQ_MAX_CHANNELS) {
+        return false;
+    }
+
+    memcpy(s_adcPins, pins, count);
+    _pinCount = count;
+    s_adcFramesReady.store(0);
+
+    analogContinuousSetWidth(12);
+    analogContinuousSetAtten(ADC_11db);
+    if (!analogContinuous(pins, count, _conversionsPerPin, sampleRateHz, &onAdcFrame)) {
+        return false;
+    }
+    if (!analogContinuousStart()) {
+        analogContinuousDeinit();
+        return false;
+    }
+
+    _running = true;
+    return true;
+#else
+    // Continuous mode needs arduino-esp32 3.x
+    return false;
+#endif
+}
+
+/**
+ * @brief Read completed frames
+ */
+size_t MicroSafariDmaAdcSource::read(MicroSafariSample* samples, size_t maxSamples) {
+    size_t count = 0;
+
+#ifdef MICROSAFARI_HAS_ADC_CONTINUOUS
+    adc_continuous_data_t* frame = nullptr;
+
+    // Only read when the driver signalled a frame; reads never wait
+    while (_running && s_adcFramesReady.load() > 0 && count + _pinCount <= maxSamples) {
+        if (!analogContinuousRead(&frame, 0)) {
+            // The frame stays signalled for the next call
+            break;
+        }
+        s_adcFramesReady.fetch_sub(1);
+
+        for (size_t i = 0; i < _pinCount; i++) {
+            for (size_t input = 0; input < _pinCount; input++) {
+                if (frame[i].pin == s_adcPins[input]) {
+                    samples[count].input = input;
+                    samples[count].raw = frame[i].avg_read_raw;
+                    count++;
+                    break;
+                }
+            }
+        }
+    }
+#endif
+
+    return count;
+}
+
+/**
+ * @brief Stop continuous sampling
+ */
+void MicroSafariDmaAdcSource::end() {
+#ifdef MICROSAFARI_HAS_ADC_CONTINUOUS
+    if (_running) {
+        analogContinuousStop();
+        analogContinuousDeinit();
+    }
+#endif
+    _running = false;
+}
+
+/**
+ * @brief Constructor
+ */
+MicroSafariSyntheticSource::MicroSafariSyntheticSource() {
+    for (size_t i = 0; i < MICROSAFARI_ACQ_MAX_CHANNELS; i++) {
+        _signals[i].offset = 2048;
+        _signals[i].amplitude = 0;
+        _signals[i].frequency = 0;
+        _signals[i].noise = 0;
+    }
+    _inputCount = 0;
+    _sampleRate = 0;
+    _frame = 0;
+    _nextInput = 0;
+    _noiseState = 0x12345678;
+    _lastMicros = 0;
+    _credit = 0;
+    _overruns = 0;
+    _freeRunning = false;
+}
+
+/**
+ * @brief Set signal of an input
+ */
+void MicroSafariSyntheticSource::setSignal(size_t input, float offset, float amplitude, float frequency, float noise) {
+    if (input >= MICROSAFARI_ACQ_MAX_CHANNELS) {
+        return;
+    }
+    _signals[input].offset = offset;
+    _signals[input].amplitude = amplitude;
+    _signals[input].frequency = frequency;
+    _signals[input].noise = noise;
+}
+
+/**
+ * @brief Enable/disable free-running mode
+ */
+void MicroSafariSyntheticSource::setFreeRunning(bool enable) {
+    _freeRunning = enable;
+}
+
+/**
+ * @brief Start generating samples
+ */
+bool MicroSafariSyntheticSource::begin(const uint8_t* pins, size_t count, uint32_t sampleRateHz) {
+    if (count == 0 || count > MICROSAFARI_ACQ_MAX_CHANNELS || sampleRateHz == 0) {
+        return false;
+    }
+
+    _inputCount = count;
+    _sampleRate = sampleRateHz;
+    _frame = 0;
+    _nextInput = 0;
+    _lastMicros = micros();
+    _credit = 0;
+    _overruns = 0;
+    return true;
+}
+
+/**
+ * @brief Generate next sample of an input
+ */
+uint16_t MicroSafariSyntheticSource::generate(size_t input) {
+    const Signal& signal = _signals[input];
+    float value = signal.offset;
+
+    if (signal.amplitude != 0 && signal.frequency != 0) {
+        double t = (double)_frame * _inputCount / _sampleRate;
+        double phase = fmod(signal.frequency * t, 1.0);
+        value += signal.amplitude * sinf(2.0f * (float)M_PI * (float)phase);
+    }
+
+    if (signal.noise != 0) {
+        _noiseState = _noiseState * 1664525UL + 1013904223UL;
+        value += signal.noise * ((_noiseState >> 8) / 8388608.0f - 1.0f);
+    }
+
+    return (uint16_t)constrain(value + 0.5f, 0.0f, 4095.0f);
+}
+
+/**
+ * @brief Read generated samples
+ */
+size_t MicroSafariSyntheticSource::read(MicroSafariSample* samples, size_t maxSamples) {
+    if (_inputCount == 0) {
+        return 0;
+    }
+
+    size_t count = maxSamples;
+    if (!_freeRunning) {
+        // Accumulate samples due since the last read in units of 1/1000000 sample
+        unsigned long now = micros();
+        _credit += (uint64_t)(now - _lastMicros) * _sampleRate;
+        _lastMicros = now;
+
+        uint64_t due = _credit / 1000000ULL;
+        if (due > SYNTHETIC_BUFFER_SAMPLES) {
+            _overruns += due - SYNTHETIC_BUFFER_SAMPLES;
+            _credit -= (due - SYNTHETIC_BUFFER_SAMPLES) * 1000000ULL;
+            due = SYNTHETIC_BUFFER_SAMPLES;
+        }
+        if (due < count) {
+            count = due;
+        }
+        _credit -= (uint64_t)count * 1000000ULL;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        samples[i].input = _nextInput;
+        samples[i].raw = generate(_nextInput);
+        if (++_nextInput == _inputCount) {
+            _nextInput = 0;
+            _frame++;
+        }
+    }
+
+    return count;
+}
+
+/**
+ * @brief Get lost samples
+ */
+uint32_t MicroSafariSyntheticSource::getOverruns() const {
+    return _overruns;
+}
+
+/**
+ * @brief Constructor
+ */
+MicroSafariAcquisition::MicroSafariAcquisition() {
+    memset(_channels, 0, sizeof(_channels));
+    _channelCount = 0;
+    _source = nullptr;
+    _cache = nullptr;
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+/**
+ * @brief Find channel by metric name
+ */
+int MicroSafariAcquisition::findChannel(const char* metric) const {
+    if (metric == nullptr) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < _channelCount; i++) {
+        if (strcmp(_channels[i].metric, metric) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Add a channel
+ */
+bool MicroSafariAcquisition::addChannel(uint8_t pin, const char* metric, uint32_t decimation, float scale, float offset) {
+    if (_source != nullptr || _channelCount >= MICROSAFARI_ACQ_MAX_CHANNELS ||
+        metric == nullptr || metric[0] == '\0' || decimation == 0 || findChannel(metric) >= 0) {
+        return false;
+    }
+
+    Channel& channel = _channels[_channelCount++];
+    memset(&channel, 0, sizeof(channel));
+    channel.pin = pin;
+    strncpy(channel.metric, metric, MICROSAFARI_CACHE_NAME_LENGTH - 1);
+    channel.decimation = decimation;
+    channel.scale = scale;
+    channel.offset = offset;
+    return true;
+}
+
+/**
+ * @brief Start sampling
+ */
+bool MicroSafariAcquisition::begin(MicroSafariSampleSource* source, uint32_t sampleRateHz) {
+    if (source == nullptr || _source != nullptr || _channelCount == 0) {
+        return false;
+    }
+
+    uint8_t pins[MICROSAFARI_ACQ_MAX_CHANNELS];
+    for (size_t i = 0; i < _channelCount; i++) {
+        pins[i] = _channels[i].pin;
+        _channels[i].sum = 0;
+        _channels[i].count = 0;
+    }
+
+    if (!source->begin(pins, _channelCount, sampleRateHz)) {
+        return false;
+    }
+
+    _source = source;
+    return true;
+}
+
+/**
+ * @brief Stop sampling
+ */
+void MicroSafariAcquisition::end() {
+    if (_source != nullptr) {
+        _source->end();
+        _source = nullptr;
+    }
+}
+
+/**
+ * @brief Consume samples and produce decimated values
+ */
+size_t MicroSafariAcquisition::process(size_t maxSamples) {
+    if (_source == nullptr) {
+        return 0;
+    }
+
+    unsigned long started = micros();
+    MicroSafariSample samples[MICROSAFARI_ACQ_READ_CHUNK];
+    size_t consumed = 0;
+
+    while (consumed < maxSamples) {
+        size_t count = _source->read(samples, min((size_t)MICROSAFARI_ACQ_READ_CHUNK, maxSamples - consumed));
+        if (count == 0) {
+            break;
+        }
+
+        for (size_t i = 0; i < count; i++) {
+            if (samples[i].input >= _channelCount) {
+                continue;
+            }
+
+            Channel& channel = _channels[samples[i].input];
+            channel.sum += samples[i].raw;
+            if (++channel.count < channel.decimation) {
+                continue;
+            }
+
+            channel.value = ((float)channel.sum / channel.count) * channel.scale + channel.offset;
+            channel.valid = true;
+            channel.sum = 0;
+            channel.count = 0;
+            _stats.outputs++;
+
+            if (_cache != nullptr) {
+                _cache->record(channel.metric, channel.value, millis());
+            }
+        }
+
+        consumed += count;
+    }
+
+    _stats.samples += consumed;
+    _stats.overruns = _source->getOverruns();
+    _stats.busyMicros += micros() - started;
+    return consumed;
+}
+
+/**
+ * @brief Set destination reading cache
+ */
+void MicroSafariAcquisition::setReadingCache(MicroSafariReadingCache* cache) {
+    _cache = cache;
+}
+
+/**
+ * @brief Get latest decimated value
+ */
+bool MicroSafariAcquisition::getValue(const char* metric, float& value) const {
+    int index = findChannel(metric);
+    if (index < 0 || !_channels[index].valid) {
+        return false;
+    }
+
+    value = _channels[index].value;
+    return true;
+}
+
+/**
+ * @brief Get number of channels
+ */
+size_t MicroSafariAcquisition::getChannelCount() const {
+    return _channelCount;
+}
+
+/**
+ * @brief Get statistics
+ */
+const MicroSafariAcquisitionStats& MicroSafariAcquisition::getStats() const {
+    return _stats;
+}
+
+/**
+ * @brief Reset statistics
+ */
+void MicroSafariAcquisition::resetStats() {
+    memset(&_stats, 0, sizeof(_stats));
+}
@@ -0,0 +1,279 @@
+/*!
+ * @file MicroSafariAcquisition.h
+ * @brief Continuous ADC acquisition with per-channel decimation
+ * @version 1.0.0
+ * @date 2025-08-22
+ *
+ * The acquisition pipeline reads raw ADC samples from a sample source,
+ * averages every N samples of a channel into one output value
+ * (boxcar decimation), scales it and stores it in the reading cache.
+ *
+ * Two sources are provided:
+ * - MicroSafariDmaAdcSource runs the ESP32 ADC in continuous (DMA) mode,
+ *   so sampling costs no CPU until frames are collected. It needs
+ *   arduino-esp32 3.x (analogContinuous API); on older cores begin()
+ *   fails.
+ * - MicroSafariSyntheticSource generates sine-plus-noise signals, so the
+ *   same pipeline can be benchmarked without analog hardware.
+ *
+ * @section license License
+ * MIT License
+ */
+
+#ifndef MICROSAFARI_ACQUISITION_H
+#define MICROSAFARI_ACQUISITION_H
+
+#include <Arduino.h>
+#include "MicroSafariReadingCache.h"
+
+#ifndef MICROSAFARI_ACQ_MAX_CHANNELS
+#define MICROSAFARI_ACQ_MAX_CHANNELS 8
+#endif
+
+/** @brief Samples read from the source per chunk in process() */
+#define MICROSAFARI_ACQ_READ_CHUNK 64
+
+/**
+ * @brief Raw ADC sample
+ */
+struct MicroSafariSample {
+    uint16_t input;                  ///< Index of the input in the pin list given to begin()
+    uint16_t raw;                    ///< Raw ADC value
+};
+
+/**
+ * @brief Acquisition statistics
+ */
+struct MicroSafariAcquisitionStats {
+    uint32_t samples;                ///< Raw samples processed
+    uint32_t outputs;                ///< Decimated values produced
+    uint32_t overruns;               ///< Samples lost by the source
+    uint32_t busyMicros;             ///< Time spent in process()
+};
+
+/**
+ * @brief Source of raw ADC samples
+ */
+class MicroSafariSampleSource {
+public:
+    virtual ~MicroSafariSampleSource() {}
+
+    /**
+     * @brief Start sampling
+     * @param pins Analog pins, in input order
+     * @param count Number of pins
+     * @param sampleRateHz Total conversions per second over all pins
+     * @return true if sampling started, false otherwise
+     */
+    virtual bool begin(const uint8_t* pins, size_t count, uint32_t sampleRateHz) = 0;
+
+    /**
+     * @brief Read available samples without blocking
+     * @param samples Destination array
+     * @param maxSamples Capacity of destination array
+     * @return Number of samples read
+     */
+    virtual size_t read(MicroSafariSample* samples, size_t maxSamples) = 0;
+
+    /**
+     * @brief Stop sampling
+     */
+    virtual void end() {}
+
+    /**
+     * @brief Get number of samples lost because they were not read in time
+     * @return Lost samples
+     */
+    virtual uint32_t getOverruns() const { return 0; }
+};
+
+/**
+ * @brief ESP32 continuous-mode (DMA) ADC sample source
+ *
+ * The ADC driver averages conversionsPerPin conversions per pin in each
+ * DMA frame; read() returns one sample per pin and frame. Only one
+ * instance can be active because the driver is global.
+ */
+class MicroSafariDmaAdcSource : public MicroSafariSampleSource {
+private:
+    uint32_t _conversionsPerPin;     ///< Conversions averaged by the driver per frame
+    size_t _pinCount;                ///< Number of sampled pins
+    bool _running;                   ///< Driver started
+
+public:
+    /**
+     * @brief Constructor for MicroSafariDmaAdcSource
+     * @param conversionsPerPin Conversions per pin averaged into one sample (default: 16)
+     */
+    MicroSafariDmaAdcSource(uint32_t conversionsPerPin = 16);
+
+    /**
+     * @brief Start continuous sampling
+     *
+     * The sample rate must be within the ADC continuous-mode limits of the
+     * chip (e.g. 20 kHz – 2 MHz on ESP32, 611 Hz – 83.3 kHz on ESP32-S3).
+     */
+    bool begin(const uint8_t* pins, size_t count, uint32_t sampleRateHz) override;
+    size_t read(MicroSafariSample* samples, size_t maxSamples) override;
+    void end() override;
+};
+
+/**
+ * @brief Synthetic sample source for benchmarks and host runs
+ */
+class MicroSafariSyntheticSource : public MicroSafariSampleSource {
+private:
+    /**
+     * @brief Generated signal of one input
+     */
+    struct Signal {
+        float offset;                ///< DC level in raw counts
+        float amplitude;             ///< Sine amplitude in raw counts
+        float frequency;             ///< Sine frequency in Hz
+        float noise;                 ///< Peak uniform noise in raw counts
+    };
+
+    Signal _signals[MICROSAFARI_ACQ_MAX_CHANNELS]; ///< Signal per input
+    size_t _inputCount;              ///< Number of inputs
+    uint32_t _sampleRate;            ///< Total samples per second
+    uint32_t _frame;                 ///< Frames generated so far
+    size_t _nextInput;               ///< Input of the next sample within the frame
+    uint32_t _noiseState;            ///< Noise generator state
+    unsigned long _lastMicros;       ///< micros() of the last read
+    uint64_t _credit;                ///< Samples due, scaled by 1000000
+    uint32_t _overruns;              ///< Samples dropped because reads came too late
+    bool _freeRunning;               ///< Ignore real time and fill every read
+
+    /**
+     * @brief Internal method to generate the next sample
+     */
+    uint16_t generate(size_t input);
+
+public:
+    /**
+     * @brief Constructor for MicroSafariSyntheticSource
+     */
+    MicroSafariSyntheticSource();
+
+    /**
+     * @brief Set the signal of an input
+     * @param input Input index
+     * @param offset DC level in raw counts
+     * @param amplitude Sine amplitude in raw counts
+     * @param frequency Sine frequency in Hz
+     * @param noise Peak uniform noise in raw counts
+     */
+    void setSignal(size_t input, float offset, float amplitude, float frequency, float noise);
+
+    /**
+     * @brief Produce samples as fast as they are read instead of in real time
+     * @param enable true for benchmarks, false to follow the sample rate
+     */
+    void setFreeRunning(bool enable);
+
+    bool begin(const uint8_t* pins, size_t count, uint32_t sampleRateHz) override;
+    size_t read(MicroSafariSample* samples, size_t maxSamples) override;
+    uint32_t getOverruns() const override;
+};
+
+/**
+ * @brief Decimating acquisition pipeline feeding the reading cache
+ */
+class MicroSafariAcquisition {
+private:
+    /**
+     * @brief Acquisition channel
+     */
+    struct Channel {
+        uint8_t pin;                 ///< Analog pin
+        char metric[MICROSAFARI_CACHE_NAME_LENGTH]; ///< Metric name of the output
+        uint32_t decimation;         ///< Samples averaged per output
+        float scale;                 ///< Output = mean * scale + offset
+        float offset;                ///< Output offset
+        uint32_t sum;                ///< Sum of the current block
+        uint32_t count;              ///< Samples in the current block
+        float value;                 ///< Latest output
+        bool valid;                  ///< An output was produced
+    };
+
+    Channel _channels[MICROSAFARI_ACQ_MAX_CHANNELS]; ///< Configured channels
+    size_t _channelCount;            ///< Number of configured channels
+    MicroSafariSampleSource* _source; ///< Active sample source
+    MicroSafariReadingCache* _cache; ///< Destination of decimated values
+    MicroSafariAcquisitionStats _stats; ///< Runtime statistics
+
+    /**
+     * @brief Internal method to find a channel by metric name
+     */
+    int findChannel(const char* metric) const;
+
+public:
+    /**
+     * @brief Constructor for MicroSafariAcquisition
+     */
+    MicroSafariAcquisition();
+
+    /**
+     * @brief Add a channel before begin()
+     * @param pin Analog pin
+     * @param metric Metric name of the decimated value
+     * @param decimation Raw samples averaged into one value
+     * @param scale Multiplier applied to the averaged raw value (default: 1.0)
+     * @param offset Offset added after scaling (default: 0.0)
+     * @return true if added, false if full, running or arguments are invalid
+     */
+    bool addChannel(uint8_t pin, const char* metric, uint32_t decimation, float scale = 1.0f, float offset = 0.0f);
+
+    /**
+     * @brief Start sampling all channels
+     * @param source Sample source to read from
+     * @param sampleRateHz Total conversions per second over all channels
+     * @return true if started, false otherwise
+     */
+    bool begin(MicroSafariSampleSource* source, uint32_t sampleRateHz);
+
+    /**
+     * @brief Stop sampling
+     */
+    void end();
+
+    /**
+     * @brief Consume available samples and produce decimated values
+     * @param maxSamples Upper bound of samples consumed per call (default: 1024)
+     * @return Number of samples consumed
+     */
+    size_t process(size_t maxSamples = 1024);
+
+    /**
+     * @brief Set the reading cache receiving decimated values
+     * @param cache Reading cache, nullptr to keep values only in the channels
+     */
+    void setReadingCache(MicroSafariReadingCache* cache);
+
+    /**
+     * @brief Get the latest decimated value of a channel
+     * @param metric Metric name
+     * @param value Receives the value
+     * @return true if a value was produced, false otherwise
+     */
+    bool getValue(const char* metric, float& value) const;
+
+    /**
+     * @brief Get number of configured channels
+     * @return Channel count
+     */
+    size_t getChannelCount() const;
+
+    /**
+     * @brief Get acquisition statistics
+     * @return Reference to statistics structure
+     */
+    const MicroSafariAcquisitionStats& getStats() const;
+
+    /**
+     * @brief Reset acquisition statistics
+     */
+    void resetStats();
+};
+
+#endif // MICROSAFARI_ACQUISITION_H
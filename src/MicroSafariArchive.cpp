@@ -0,0 +1,369 @@
+/*!
+ * @file MicroSafariArchive.cpp
+ * @brief Implementation of the MicroSafari SD card archive
+ * @version 1.0.0
+ * @date 2025-08-22
+ */
+
+#include "MicroSafariArchive.h"
+#include "MicroSafariTime.h"
+
+/** @brief Records per 512-byte block */
+#define ARCHIVE_RECORDS_PER_BLOCK (MICROSAFARI_ARCHIVE_BLOCK_SIZE / sizeof(MicroSafariArchiveRecord))
+
+/** @brief Records per write call */
+#define ARCHIVE_RECORDS_PER_WRITE (MICROSAFARI_ARCHIVE_WRITE_BLOCKS * ARCHIVE_RECORDS_PER_BLOCK)
+
+static_assert(sizeof(MicroSafariArchiveRecord) == 32, "MicroSafariArchiveRecord is stored on the card; its size must not change");
+
+/**
+ * @brief First block of every archive file
+ */
+struct ArchiveFileHeader {
+    char magic[4];
+    uint16_t version;
+    uint16_t recordSize;
+    uint16_t blockSize;
+    uint16_t reserved;
+    uint32_t day;
+};
+
+/**
+ * @brief Constructor
+ */
+MicroSafariArchive::MicroSafariArchive()
+    : _head(0), _tail(0), _records(0), _dropped(0), _flushRequested(0), _flushCompleted(0), _running(false), _task(nullptr),
+      _fs(nullptr), _fileOpen(false), _day(0), _blockOffset(0), _fill(0), _counted(0), _lastWrite(0), _written(0),
+      _lost(0), _bytes(0), _files(0), _errors(0), _queuePeak(0), _busyUs(0) {
+    _directory[0] = '\0';
+}
+
+/**
+ * @brief Destructor
+ */
+MicroSafariArchive::~MicroSafariArchive() {
+    end();
+}
+
+/**
+ * @brief Start writer task
+ */
+bool MicroSafariArchive::begin(fs::FS& fs, const char* directory, UBaseType_t priority) {
+    if (_task != nullptr) {
+        return true;
+    }
+    if (directory == nullptr || directory[0] != '/' || strlen(directory) >= MICROSAFARI_ARCHIVE_PATH_LENGTH) {
+        return false;
+    }
+
+    _fs = &fs;
+    strcpy(_directory, directory);
+    size_t length = strlen(_directory);
+    if (length > 1 && _directory[length - 1] == '/') {
+        _directory[length - 1] = '\0';
+    }
+    // Fails harmlessly if the directory exists
+    _fs->mkdir(_directory);
+
+    _running = true;
+    if (xTaskCreate(writerTask, "msafari_sd", MICROSAFARI_ARCHIVE_TASK_STACK, this, priority, &_task) != pdPASS) {
+        _running = false;
+        _task = nullptr;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Write remaining readings and stop task
+ */
+void MicroSafariArchive::end() {
+    if (_task == nullptr) {
+        return;
+    }
+    _running = false;
+    xTaskNotifyGive(_task);
+    // The task writes once more, closes the file, clears _task and deletes itself
+    while (_task != nullptr) {
+        delay(1);
+    }
+}
+
+/**
+ * @brief Check if writer task is running
+ */
+bool MicroSafariArchive::isRunning() const {
+    return _task != nullptr;
+}
+
+/**
+ * @brief Add reading without blocking
+ */
+bool MicroSafariArchive::record(const char* metric, float value) {
+    if (_task == nullptr || metric == nullptr || metric[0] == '\0') {
+        return false;
+    }
+
+    uint32_t head = _head.load(std::memory_order_relaxed);
+    uint32_t tail = _tail.load(std::memory_order_acquire);
+    if (head - tail >= MICROSAFARI_ARCHIVE_QUEUE_SIZE) {
+        // Only the producer writes the counter, so no read-modify-write is needed
+        _dropped.store(_dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return false;
+    }
+
+    MicroSafariArchiveRecord& record = _queue[head & (MICROSAFARI_ARCHIVE_QUEUE_SIZE - 1)];
+    time_t now = time(nullptr);
+    record.epoch = now > MICROSAFARI_EPOCH_VALID ? (uint32_t)now : 0;
+    record.uptimeMs = millis();
+    record.value = value;
+    // strncpy zero-fills the rest, so the bytes on the card do not depend on old queue contents
+    strncpy(record.metric, metric, MICROSAFARI_ARCHIVE_NAME_LENGTH - 1);
+    record.metric[MICROSAFARI_ARCHIVE_NAME_LENGTH - 1] = '\0';
+    _head.store(head + 1, std::memory_order_release);
+    _records.store(_records.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+    // Wake the writer early once a full write is waiting
+    if (head + 1 - tail == ARCHIVE_RECORDS_PER_WRITE) {
+        xTaskNotifyGive(_task);
+    }
+    return true;
+}
+
+/**
+ * @brief Write partial blocks and wait for the writer task
+ */
+bool MicroSafariArchive::flush(uint32_t timeoutMs) {
+    if (_task == nullptr) {
+        return false;
+    }
+
+    // Only the producer writes the counter, so no read-modify-write is needed
+    uint32_t request = _flushRequested.load(std::memory_order_relaxed) + 1;
+    _flushRequested.store(request, std::memory_order_release);
+    xTaskNotifyGive(_task);
+
+    unsigned long started = millis();
+    while ((int32_t)(_flushCompleted.load(std::memory_order_acquire) - request) < 0) {
+        if (_task == nullptr || millis() - started >= timeoutMs) {
+            return false;
+        }
+        delay(1);
+    }
+    return true;
+}
+
+/**
+ * @brief Pack waiting readings and write full buffers
+ */
+void MicroSafariArchive::drain() {
+    uint32_t tail = _tail.load(std::memory_order_relaxed);
+    uint32_t head = _head.load(std::memory_order_acquire);
+    if (head - tail > _queuePeak) {
+        _queuePeak = head - tail;
+    }
+
+    while (tail != head) {
+        const MicroSafariArchiveRecord& record = _queue[tail & (MICROSAFARI_ARCHIVE_QUEUE_SIZE - 1)];
+        uint32_t day = record.epoch / 86400;
+        if (_fileOpen && day != _day) {
+            closeFile();
+        }
+        if (!_fileOpen && !openFile(day)) {
+            // Leave the readings queued; the card may come back before the queue fills
+            break;
+        }
+
+        _blocks[_fill++] = record;
+        tail++;
+        _tail.store(tail, std::memory_order_release);
+        if (_fill == ARCHIVE_RECORDS_PER_WRITE) {
+            writeBlocks();
+        }
+        head = _head.load(std::memory_order_acquire);
+    }
+
+    // Read before writing: a flush requested while this pass runs is finished by the next one
+    uint32_t flushRequest = _flushRequested.load(std::memory_order_acquire);
+    bool flushRequested = flushRequest != _flushCompleted.load(std::memory_order_relaxed);
+    if (_fileOpen && _fill > _counted && (flushRequested || millis() - _lastWrite >= MICROSAFARI_ARCHIVE_FLUSH_MS)) {
+        writeBlocks();
+        if (_fileOpen) {
+            _file.flush();
+        }
+    }
+    if (flushRequested) {
+        _flushCompleted.store(flushRequest, std::memory_order_release);
+    }
+}
+
+/**
+ * @brief Write block buffer padded to block boundary
+ */
+void MicroSafariArchive::writeBlocks() {
+    if (_fill == 0) {
+        return;
+    }
+
+    size_t blocks = (_fill + ARCHIVE_RECORDS_PER_BLOCK - 1) / ARCHIVE_RECORDS_PER_BLOCK;
+    memset(&_blocks[_fill], 0, (blocks * ARCHIVE_RECORDS_PER_BLOCK - _fill) * sizeof(MicroSafariArchiveRecord));
+    if (!_file.seek(_blockOffset) || !writeFile(_blocks, blocks * MICROSAFARI_ARCHIVE_BLOCK_SIZE)) {
+        _errors++;
+        _lost += _fill - _counted;
+        _fill = 0;
+        _counted = 0;
+        _file.close();
+        _fileOpen = false;
+        return;
+    }
+    _lastWrite = millis();
+    _written += _fill - _counted;
+
+    // A partial last block stays in the buffer and is written again, in place, once it has more records
+    size_t complete = _fill / ARCHIVE_RECORDS_PER_BLOCK * ARCHIVE_RECORDS_PER_BLOCK;
+    _blockOffset += complete * sizeof(MicroSafariArchiveRecord);
+    memmove(_blocks, &_blocks[complete], (_fill - complete) * sizeof(MicroSafariArchiveRecord));
+    _fill -= complete;
+    _counted = _fill;
+}
+
+/**
+ * @brief Write bytes and measure call
+ */
+bool MicroSafariArchive::writeFile(const void* data, size_t length) {
+    uint32_t started = micros();
+    size_t written = _file.write(static_cast<const uint8_t*>(data), length);
+    uint32_t elapsed = micros() - started;
+    _writeLatency.record(elapsed);
+    _busyUs += elapsed;
+    _bytes += written;
+    return written == length;
+}
+
+/**
+ * @brief Open file for day
+ */
+bool MicroSafariArchive::openFile(uint32_t day) {
+    char path[MICROSAFARI_ARCHIVE_PATH_LENGTH + 16];
+    if (day == 0) {
+        snprintf(path, sizeof(path), "%s/nodate.msa", _directory);
+    } else {
+        time_t start = (time_t)day * 86400;
+        struct tm date;
+        gmtime_r(&start, &date);
+        snprintf(path, sizeof(path), "%s/%04d%02d%02d.msa", _directory,
+                 date.tm_year + 1900, date.tm_mon + 1, date.tm_mday);
+    }
+
+    // "a" would ignore seek(), which rewriting the last block needs
+    _file = _fs->open(path, _fs->exists(path) ? "r+" : "w");
+    if (!_file) {
+        _errors++;
+        return false;
+    }
+    _fileOpen = true;
+    _day = day;
+    _files++;
+
+    uint32_t size = _file.size();
+    if (size < MICROSAFARI_ARCHIVE_BLOCK_SIZE) {
+        // New file, or a header cut short by a power loss
+        uint8_t block[MICROSAFARI_ARCHIVE_BLOCK_SIZE];
+        memset(block, 0, sizeof(block));
+        ArchiveFileHeader header = { { 'M', 'S', 'A', '1' }, 1, sizeof(MicroSafariArchiveRecord),
+                                     MICROSAFARI_ARCHIVE_BLOCK_SIZE, 0, day };
+        memcpy(block, &header, sizeof(header));
+        if (!_file.seek(0) || !writeFile(block, sizeof(block))) {
+            _errors++;
+            _file.close();
+            _fileOpen = false;
+            return false;
+        }
+        _blockOffset = sizeof(block);
+        return true;
+    }
+
+    // Continue in the last block, which is padded after a restart or a failed write, or cut
+    // short by a power loss. Its records are read back so it fills up instead of leaving
+    // padding in the middle of the file; a record cut in half is dropped.
+    uint32_t blockStart = (size - 1) / MICROSAFARI_ARCHIVE_BLOCK_SIZE * MICROSAFARI_ARCHIVE_BLOCK_SIZE;
+    size_t length = size - blockStart;
+    if (blockStart >= MICROSAFARI_ARCHIVE_BLOCK_SIZE) {
+        if (!_file.seek(blockStart) || _file.read(reinterpret_cast<uint8_t*>(_blocks), length) != length) {
+            _errors++;
+            _file.close();
+            _fileOpen = false;
+            return false;
+        }
+        size_t records = length / sizeof(MicroSafariArchiveRecord);
+        while (_fill < records && _blocks[_fill].metric[0] != '\0') {
+            _fill++;
+        }
+    }
+    if (_fill == ARCHIVE_RECORDS_PER_BLOCK || blockStart < MICROSAFARI_ARCHIVE_BLOCK_SIZE) {
+        // Full last block, or a header without records
+        _fill = 0;
+        blockStart += MICROSAFARI_ARCHIVE_BLOCK_SIZE;
+    }
+    // These records are on the card already; rewriting them does not count them as written again
+    _counted = _fill;
+    _blockOffset = blockStart;
+    return true;
+}
+
+/**
+ * @brief Close open file
+ */
+void MicroSafariArchive::closeFile() {
+    if (!_fileOpen) {
+        return;
+    }
+    writeBlocks();
+    if (!_fileOpen) {
+        return;
+    }
+    // The partial last block stays padded in the file until it is reopened
+    _fill = 0;
+    _counted = 0;
+    _file.close();
+    _fileOpen = false;
+}
+
+/**
+ * @brief Writer task loop
+ */
+void MicroSafariArchive::writerTask(void* arg) {
+    MicroSafariArchive* archive = static_cast<MicroSafariArchive*>(arg);
+    while (archive->_running) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(MICROSAFARI_ARCHIVE_FLUSH_MS));
+        archive->drain();
+    }
+    archive->drain();
+    archive->closeFile();
+    archive->_task = nullptr;
+    vTaskDelete(nullptr);
+}
+
+/**
+ * @brief Get archive counters
+ */
+MicroSafariArchiveStats MicroSafariArchive::getStats() const {
+    MicroSafariArchiveStats stats;
+    stats.records = _records.load(std::memory_order_relaxed);
+    stats.dropped = _dropped.load(std::memory_order_relaxed);
+    stats.written = _written;
+    stats.lost = _lost;
+    stats.bytes = _bytes;
+    stats.files = _files;
+    stats.errors = _errors;
+    stats.throughput = _busyUs > 0 ? (uint32_t)((uint64_t)_bytes * 1000000 / _busyUs) : 0;
+    stats.queuePeak = _queuePeak;
+    return stats;
+}
+
+/**
+ * @brief Get write latency histogram
+ */
+const MicroSafariLatencyHistogram& MicroSafariArchive::getWriteLatency() const {
+    return _writeLatency;
+}
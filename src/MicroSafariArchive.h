@@ -0,0 +1,229 @@
+/*!
+ * @file MicroSafariArchive.h
+ * @brief Full-resolution reading archive on SD card, written by a background task
+ * @version 1.0.0
+ * @date 2025-08-22
+ *
+ * Readings reach the platform batched, downsampled by the retention
+ * store during outages, or not at all when the platform rejects them.
+ * MicroSafariArchive keeps every reading passed to sendSensorData() or
+ * queueSensorData() on an SD card as well. The library's task copies
+ * each reading into a RAM queue and returns. A writer task packs the
+ * readings into 512-byte blocks and writes MICROSAFARI_ARCHIVE_WRITE_BLOCKS
+ * of them per call, so the card sees large block-aligned writes instead
+ * of one small write per reading.
+ *
+ * Files rotate by UTC day: <directory>/YYYYMMDD.msa, or nodate.msa
+ * while the clock is not set. Each file starts with a 512-byte header
+ * block ("MSA1", format version, record size, block size), followed
+ * by 32-byte MicroSafariArchiveRecord entries. A partly filled block
+ * is written padded with records whose metric is empty and rewritten
+ * in place as it fills up. A file reopened after a restart or a failed
+ * write continues in its last block, so only the last block of a file
+ * keeps padding. Readers skip records with an empty metric.
+ *
+ * The queue has a single producer: readings must come from one task,
+ * normally the one running MicroSafari::loop(). When the queue is full,
+ * readings are dropped and counted rather than waited for. The file
+ * system must not be used by other tasks while the archive runs.
+ *
+ * @section license License
+ * MIT License
+ */
+
+#ifndef MICROSAFARI_ARCHIVE_H
+#define MICROSAFARI_ARCHIVE_H
+
+#include <Arduino.h>
+#include <FS.h>
+#include <atomic>
+#include "MicroSafariLatency.h"
+
+/** @brief Readings the RAM queue holds, a power of two */
+#ifndef MICROSAFARI_ARCHIVE_QUEUE_SIZE
+#define MICROSAFARI_ARCHIVE_QUEUE_SIZE 256
+#endif
+
+#if (MICROSAFARI_ARCHIVE_QUEUE_SIZE & (MICROSAFARI_ARCHIVE_QUEUE_SIZE - 1)) != 0
+#error "MICROSAFARI_ARCHIVE_QUEUE_SIZE must be a power of two"
+#endif
+
+/** @brief 512-byte blocks per write call */
+#ifndef MICROSAFARI_ARCHIVE_WRITE_BLOCKS
+#define MICROSAFARI_ARCHIVE_WRITE_BLOCKS 8
+#endif
+
+/** @brief Time after which a partly filled block is written, in milliseconds */
+#ifndef MICROSAFARI_ARCHIVE_FLUSH_MS
+#define MICROSAFARI_ARCHIVE_FLUSH_MS 2000
+#endif
+
+/** @brief Stack of the writer task in bytes */
+#ifndef MICROSAFARI_ARCHIVE_TASK_STACK
+#define MICROSAFARI_ARCHIVE_TASK_STACK 4096
+#endif
+
+/** @brief SD block size; every write starts and ends on a block boundary */
+#define MICROSAFARI_ARCHIVE_BLOCK_SIZE 512
+
+/** @brief Maximum metric name length stored per record, including terminator */
+#define MICROSAFARI_ARCHIVE_NAME_LENGTH 20
+
+/** @brief Maximum archive directory length, including terminator */
+#define MICROSAFARI_ARCHIVE_PATH_LENGTH 32
+
+/**
+ * @brief One archived reading as stored on the card
+ */
+struct MicroSafariArchiveRecord {
+    uint32_t epoch;                  ///< Unix seconds, 0 if the clock was not set
+    uint32_t uptimeMs;               ///< millis() when the reading was recorded
+    float value;                     ///< Reading value
+    char metric[MICROSAFARI_ARCHIVE_NAME_LENGTH]; ///< Metric name, empty for padding
+};
+
+/**
+ * @brief Archive counters
+ */
+struct MicroSafariArchiveStats {
+    uint32_t records;                ///< Readings accepted by the queue
+    uint32_t dropped;                ///< Readings rejected because the queue was full
+    uint32_t written;                ///< Readings written to the card
+    uint32_t lost;                   ///< Readings lost to failed writes
+    uint32_t bytes;                  ///< Bytes written, including headers and padding
+    uint32_t files;                  ///< Files opened
+    uint32_t errors;                 ///< Failed opens and writes
+    uint32_t throughput;             ///< Bytes per second while writing
+    uint32_t queuePeak;              ///< Most readings waiting in the queue
+};
+
+/**
+ * @brief Reading queue with a background SD writer task
+ */
+class MicroSafariArchive {
+private:
+    MicroSafariArchiveRecord _queue[MICROSAFARI_ARCHIVE_QUEUE_SIZE]; ///< Readings not yet packed
+    std::atomic<uint32_t> _head;     ///< Next slot to fill, owned by the producer
+    std::atomic<uint32_t> _tail;     ///< Next slot to pack, owned by the writer task
+    std::atomic<uint32_t> _records;  ///< Readings accepted, written by the producer only
+    std::atomic<uint32_t> _dropped;  ///< Readings rejected, written by the producer only
+    std::atomic<uint32_t> _flushRequested; ///< Flush requests made, counted by the producer
+    std::atomic<uint32_t> _flushCompleted; ///< Last flush request the writer task finished
+    std::atomic<bool> _running;      ///< Cleared to stop the writer task
+    TaskHandle_t _task;              ///< Writer task, nullptr if not running
+    fs::FS* _fs;                     ///< File system holding the archive
+    char _directory[MICROSAFARI_ARCHIVE_PATH_LENGTH]; ///< Archive directory
+    File _file;                      ///< Open day file
+    bool _fileOpen;                  ///< _file is valid
+    uint32_t _day;                   ///< Day of the open file, Unix days or 0 for nodate
+    uint32_t _blockOffset;           ///< File offset of the first block in the buffer
+    size_t _fill;                    ///< Records in the block buffer
+    size_t _counted;                 ///< Records at the start of the buffer already on the card
+    unsigned long _lastWrite;        ///< millis() of the last write
+    uint32_t _written;               ///< Readings written, writer task only
+    uint32_t _lost;                  ///< Readings lost, writer task only
+    uint32_t _bytes;                 ///< Bytes written, writer task only
+    uint32_t _files;                 ///< Files opened, writer task only
+    uint32_t _errors;                ///< Failed opens and writes, writer task only
+    uint32_t _queuePeak;             ///< Most readings waiting, writer task only
+    uint64_t _busyUs;                ///< Time spent in write calls
+    MicroSafariLatencyHistogram _writeLatency; ///< Duration of write calls
+    MicroSafariArchiveRecord _blocks[MICROSAFARI_ARCHIVE_WRITE_BLOCKS * MICROSAFARI_ARCHIVE_BLOCK_SIZE /
+                                     sizeof(MicroSafariArchiveRecord)]; ///< Block buffer
+
+    /**
+     * @brief Internal method to pack waiting readings and write full buffers
+     */
+    void drain();
+
+    /**
+     * @brief Internal method to write the block buffer, padding it to a block boundary
+     */
+    void writeBlocks();
+
+    /**
+     * @brief Internal method to write bytes and measure the call
+     * @return true if all bytes were written
+     */
+    bool writeFile(const void* data, size_t length);
+
+    /**
+     * @brief Internal method to open the file for a day
+     * @return true if the file is open
+     */
+    bool openFile(uint32_t day);
+
+    /**
+     * @brief Internal method to close the open file
+     */
+    void closeFile();
+
+    /**
+     * @brief Writer task entry point
+     */
+    static void writerTask(void* arg);
+
+public:
+    /**
+     * @brief Constructor for MicroSafariArchive
+     */
+    MicroSafariArchive();
+
+    /**
+     * @brief Destructor, stops the writer task
+     */
+    ~MicroSafariArchive();
+
+    /**
+     * @brief Start the writer task
+     * @param fs Mounted file system, e.g. SD or SD_MMC
+     * @param directory Archive directory, created if missing (default: "/archive")
+     * @param priority Task priority (default: 1, just above idle)
+     * @return true if running, false if arguments are invalid or the task could not be created
+     */
+    bool begin(fs::FS& fs, const char* directory = "/archive", UBaseType_t priority = 1);
+
+    /**
+     * @brief Write what is left, close the file and stop the writer task
+     */
+    void end();
+
+    /**
+     * @brief Check if the writer task is running
+     * @return true if readings are archived
+     */
+    bool isRunning() const;
+
+    /**
+     * @brief Add a reading without blocking
+     * @param metric Metric name, truncated to MICROSAFARI_ARCHIVE_NAME_LENGTH - 1 characters
+     * @param value Reading value
+     * @return true if queued, false if the queue was full or the archive is not running
+     */
+    bool record(const char* metric, float value);
+
+    /**
+     * @brief Write queued readings, padding the last block, and wait until they are on the card
+     *
+     * Call before removing the card or cutting power. Must not be called
+     * from the writer task. Readings a failed write could not store are
+     * counted in getStats().lost.
+     * @param timeoutMs Maximum time to wait in milliseconds (default: 5000)
+     * @return true if the writer task finished the flush in time, false on timeout or if not running
+     */
+    bool flush(uint32_t timeoutMs = 5000);
+
+    /**
+     * @brief Get archive counters
+     * @return Statistics snapshot
+     */
+    MicroSafariArchiveStats getStats() const;
+
+    /**
+     * @brief Get the duration of write calls
+     * @return Reference to the write latency histogram
+     */
+    const MicroSafariLatencyHistogram& getWriteLatency() const;
+};
+
+#endif // MICROSAFARI_ARCHIVE_H
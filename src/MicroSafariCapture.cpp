@@ -0,0 +1,229 @@
+/*!
+ * @file MicroSafariCapture.cpp
+ * @brief Implementation of MicroSafari ISR-safe sample capture
+ * @version 1.0.0
+ * @date 2025-08-22
+ */
+
+#include "MicroSafariCapture.h"
+
+/** @brief Samples drained per chunk in process() */
+#define MICROSAFARI_CAPTURE_DRAIN_CHUNK 32
+
+/**
+ * @brief Constructor
+ */
+MicroSafariCaptureRing::MicroSafariCaptureRing() : _head(0), _tail(0), _dropped(0) {
+    memset(_samples, 0, sizeof(_samples));
+    _highWater = 0;
+}
+
+/**
+ * @brief Add sample stamped now
+ */
+bool IRAM_ATTR MicroSafariCaptureRing::push(uint8_t channel, int32_t value) {
+    MicroSafariCaptureSample sample;
+    sample.timestamp = micros();
+    sample.value = value;
+    sample.channel = channel;
+    return push(sample);
+}
+
+/**
+ * @brief Add sample
+ */
+bool IRAM_ATTR MicroSafariCaptureRing::push(const MicroSafariCaptureSample& sample) {
+    uint32_t head = _head.load(std::memory_order_relaxed);
+    uint32_t tail = _tail.load(std::memory_order_acquire);
+
+    if (head - tail >= MICROSAFARI_CAPTURE_RING_SIZE) {
+        // Only the producer writes the counter, so no read-modify-write is needed
+        _dropped.store(_dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return false;
+    }
+
+    _samples[head & (MICROSAFARI_CAPTURE_RING_SIZE - 1)] = sample;
+    // Publish the slot only after it is written
+    _head.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+/**
+ * @brief Take samples out of the ring
+ */
+size_t MicroSafariCaptureRing::pop(MicroSafariCaptureSample* samples, size_t maxSamples) {
+    uint32_t tail = _tail.load(std::memory_order_relaxed);
+    uint32_t head = _head.load(std::memory_order_acquire);
+    uint32_t fill = head - tail;
+
+    if (fill > _highWater) {
+        _highWater = fill;
+    }
+
+    size_t count = fill < maxSamples ? fill : maxSamples;
+    for (size_t i = 0; i < count; i++) {
+        samples[i] = _samples[(tail + i) & (MICROSAFARI_CAPTURE_RING_SIZE - 1)];
+    }
+
+    // Hand the slots back to the producer only after they are copied
+    _tail.store(tail + count, std::memory_order_release);
+    return count;
+}
+
+/**
+ * @brief Get ring fill
+ */
+size_t MicroSafariCaptureRing::available() const {
+    return _head.load(std::memory_order_acquire) - _tail.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Get dropped sample count
+ */
+uint32_t MicroSafariCaptureRing::getDropped() const {
+    return _dropped.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Get largest fill
+ */
+uint32_t MicroSafariCaptureRing::getHighWater() const {
+    return _highWater;
+}
+
+/**
+ * @brief Constructor
+ */
+MicroSafariCapture::MicroSafariCapture() {
+    memset(_channels, 0, sizeof(_channels));
+    _channelCount = 0;
+    _windowStart = micros();
+    _consumed = 0;
+    _invalid = 0;
+}
+
+/**
+ * @brief Add capture channel
+ */
+int MicroSafariCapture::addChannel(const char* metric, MicroSafariCaptureMode mode, float scale) {
+    if (metric == nullptr || metric[0] == '\0' || strlen(metric) >= MICROSAFARI_CAPTURE_NAME_LENGTH ||
+        _channelCount >= MICROSAFARI_CAPTURE_MAX_CHANNELS) {
+        return -1;
+    }
+
+    CaptureChannel& channel = _channels[_channelCount];
+    memset(&channel, 0, sizeof(channel));
+    strcpy(channel.metric, metric);
+    channel.mode = mode;
+    channel.scale = scale;
+    return _channelCount++;
+}
+
+/**
+ * @brief Capture sample from ISR
+ */
+bool IRAM_ATTR MicroSafariCapture::capture(uint8_t channel, int32_t value) {
+    return _ring.push(channel, value);
+}
+
+/**
+ * @brief Drain ring into window aggregates
+ */
+size_t MicroSafariCapture::process() {
+    MicroSafariCaptureSample samples[MICROSAFARI_CAPTURE_DRAIN_CHUNK];
+    size_t total = 0;
+    size_t count;
+
+    // Drain at most one ring's worth, so a fast producer cannot keep us here
+    while (total < MICROSAFARI_CAPTURE_RING_SIZE &&
+           (count = _ring.pop(samples, MICROSAFARI_CAPTURE_DRAIN_CHUNK)) > 0) {
+        for (size_t i = 0; i < count; i++) {
+            if (samples[i].channel >= _channelCount) {
+                _invalid++;
+                continue;
+            }
+
+            CaptureChannel& channel = _channels[samples[i].channel];
+            if (channel.count == 0 || samples[i].value > channel.max) {
+                channel.max = samples[i].value;
+            }
+            channel.sum += samples[i].value;
+            channel.count++;
+        }
+        total += count;
+    }
+
+    _consumed += total;
+    return total;
+}
+
+/**
+ * @brief Write window aggregates and start new window
+ */
+size_t MicroSafariCapture::populate(JsonObject& payload) {
+    process();
+
+    uint32_t now = micros();
+    float seconds = (now - _windowStart) / 1000000.0f;
+    size_t written = 0;
+
+    for (size_t i = 0; i < _channelCount; i++) {
+        CaptureChannel& channel = _channels[i];
+
+        switch (channel.mode) {
+            case MICROSAFARI_CAPTURE_COUNT:
+                payload[channel.metric] = channel.sum * channel.scale;
+                written++;
+                break;
+            case MICROSAFARI_CAPTURE_RATE:
+                payload[channel.metric] = seconds > 0 ? channel.sum * channel.scale / seconds : 0.0f;
+                written++;
+                break;
+            case MICROSAFARI_CAPTURE_MEAN:
+                if (channel.count > 0) {
+                    payload[channel.metric] = (float)channel.sum / channel.count * channel.scale;
+                    written++;
+                }
+                break;
+            case MICROSAFARI_CAPTURE_MAX:
+                if (channel.count > 0) {
+                    payload[channel.metric] = channel.max * channel.scale;
+                    written++;
+                }
+                break;
+        }
+
+        channel.sum = 0;
+        channel.max = 0;
+        channel.count = 0;
+    }
+
+    _windowStart = now;
+    return written;
+}
+
+/**
+ * @brief Get sample ring
+ */
+MicroSafariCaptureRing& MicroSafariCapture::getRing() {
+    return _ring;
+}
+
+/**
+ * @brief Get channel count
+ */
+size_t MicroSafariCapture::getChannelCount() const {
+    return _channelCount;
+}
+
+/**
+ * @brief Get capture statistics
+ */
+MicroSafariCaptureStats MicroSafariCapture::getStats() const {
+    MicroSafariCaptureStats stats;
+    stats.pushed = _ring.available() + _consumed;
+    stats.dropped = _ring.getDropped();
+    stats.consumed = _consumed;
+    stats.highWater = _ring.getHighWater();
+    return stats;
+}
@@ -0,0 +1,224 @@
+/*!
+ * @file MicroSafariCapture.h
+ * @brief ISR-safe capture of timestamped samples
+ * @version 1.0.0
+ * @date 2025-08-22
+ *
+ * Pulse-counting flow meters, rain gauges and similar inputs have to be
+ * captured in interrupt context, where String, the heap and every
+ * blocking call are off limits. MicroSafariCaptureRing is a single
+ * producer, single consumer ring of fixed-size samples: push() is
+ * wait-free and runs from IRAM, so an ISR can call it on either core.
+ * MicroSafariCapture drains the ring in task context, aggregates the
+ * samples per channel over a window and writes the results into
+ * ingest payloads.
+ *
+ * Only one ISR (or one task) may push into a ring, and only one task
+ * may drain it. Give every interrupt source its own ring if several
+ * produce samples concurrently.
+ *
+ * @section license License
+ * MIT License
+ */
+
+#ifndef MICROSAFARI_CAPTURE_H
+#define MICROSAFARI_CAPTURE_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <atomic>
+
+#ifndef MICROSAFARI_CAPTURE_RING_SIZE
+#define MICROSAFARI_CAPTURE_RING_SIZE 512
+#endif
+
+#if (MICROSAFARI_CAPTURE_RING_SIZE & (MICROSAFARI_CAPTURE_RING_SIZE - 1)) != 0
+#error "MICROSAFARI_CAPTURE_RING_SIZE must be a power of two"
+#endif
+
+#ifndef MICROSAFARI_CAPTURE_MAX_CHANNELS
+#define MICROSAFARI_CAPTURE_MAX_CHANNELS 8
+#endif
+
+/** @brief Maximum metric name length of a capture channel, including terminator */
+#define MICROSAFARI_CAPTURE_NAME_LENGTH 24
+
+/**
+ * @brief Sample captured in interrupt context
+ */
+struct MicroSafariCaptureSample {
+    uint32_t timestamp;              ///< micros() at capture
+    int32_t value;                   ///< Sample value, e.g. 1 per pulse
+    uint8_t channel;                 ///< Capture channel index
+};
+
+/**
+ * @brief Aggregation of a capture channel over one window
+ */
+enum MicroSafariCaptureMode {
+    MICROSAFARI_CAPTURE_COUNT = 0,   ///< Sum of values times scale, e.g. rain in mm
+    MICROSAFARI_CAPTURE_RATE = 1,    ///< Sum of values times scale per second, e.g. flow
+    MICROSAFARI_CAPTURE_MEAN = 2,    ///< Mean value times scale
+    MICROSAFARI_CAPTURE_MAX = 3      ///< Largest value times scale
+};
+
+/**
+ * @brief Capture statistics
+ */
+struct MicroSafariCaptureStats {
+    uint32_t pushed;                 ///< Samples accepted by the ring
+    uint32_t dropped;                ///< Samples rejected because the ring was full
+    uint32_t consumed;               ///< Samples drained by the consumer
+    uint32_t highWater;              ///< Largest ring fill seen by the consumer
+};
+
+/**
+ * @brief Wait-free single producer, single consumer sample ring
+ */
+class MicroSafariCaptureRing {
+private:
+    MicroSafariCaptureSample _samples[MICROSAFARI_CAPTURE_RING_SIZE]; ///< Sample slots
+    std::atomic<uint32_t> _head;     ///< Next slot to write, owned by the producer
+    std::atomic<uint32_t> _tail;     ///< Next slot to read, owned by the consumer
+    std::atomic<uint32_t> _dropped;  ///< Samples rejected, written by the producer only
+    uint32_t _highWater;             ///< Largest fill seen by the consumer
+
+public:
+    /**
+     * @brief Constructor for MicroSafariCaptureRing
+     */
+    MicroSafariCaptureRing();
+
+    /**
+     * @brief Add a sample, callable from an ISR
+     *
+     * Takes the same few steps whether the ring is empty or full; a full
+     * ring counts the sample as dropped instead of waiting.
+     *
+     * @param channel Capture channel index
+     * @param value Sample value
+     * @return true if stored, false if the ring was full
+     */
+    bool push(uint8_t channel, int32_t value);
+
+    /**
+     * @brief Add a sample with its own timestamp, callable from an ISR
+     * @param sample Sample to store
+     * @return true if stored, false if the ring was full
+     */
+    bool push(const MicroSafariCaptureSample& sample);
+
+    /**
+     * @brief Take samples out of the ring, task context only
+     * @param samples Receives the samples
+     * @param maxSamples Capacity of samples
+     * @return Number of samples taken
+     */
+    size_t pop(MicroSafariCaptureSample* samples, size_t maxSamples);
+
+    /**
+     * @brief Get number of samples waiting
+     * @return Ring fill
+     */
+    size_t available() const;
+
+    /**
+     * @brief Get number of samples rejected because the ring was full
+     * @return Dropped samples since construction
+     */
+    uint32_t getDropped() const;
+
+    /**
+     * @brief Get largest fill seen by pop()
+     * @return Samples
+     */
+    uint32_t getHighWater() const;
+};
+
+/**
+ * @brief Task-context consumer that aggregates captured samples per window
+ */
+class MicroSafariCapture {
+private:
+    /**
+     * @brief Capture channel and its running aggregate
+     */
+    struct CaptureChannel {
+        char metric[MICROSAFARI_CAPTURE_NAME_LENGTH]; ///< Metric name in payloads
+        uint8_t mode;                ///< MicroSafariCaptureMode
+        float scale;                 ///< Factor applied to the aggregate
+        int64_t sum;                 ///< Sum of values in the window
+        int32_t max;                 ///< Largest value in the window
+        uint32_t count;              ///< Samples in the window
+    };
+
+    MicroSafariCaptureRing _ring;    ///< Samples from interrupt context
+    CaptureChannel _channels[MICROSAFARI_CAPTURE_MAX_CHANNELS]; ///< Capture channels
+    size_t _channelCount;            ///< Number of channels
+    uint32_t _windowStart;           ///< micros() when the current window started
+    uint32_t _consumed;              ///< Samples drained
+    uint32_t _invalid;               ///< Samples with an unknown channel
+
+public:
+    /**
+     * @brief Constructor for MicroSafariCapture
+     */
+    MicroSafariCapture();
+
+    /**
+     * @brief Add a capture channel
+     * @param metric Metric name used in payloads
+     * @param mode Aggregation over a window (default: MICROSAFARI_CAPTURE_COUNT)
+     * @param scale Factor applied to the aggregate, e.g. liters per pulse (default: 1.0)
+     * @return Channel index to pass to capture(), -1 if full or invalid
+     */
+    int addChannel(const char* metric,
+                   MicroSafariCaptureMode mode = MICROSAFARI_CAPTURE_COUNT,
+                   float scale = 1.0f);
+
+    /**
+     * @brief Capture a sample, callable from an ISR
+     * @param channel Channel index returned by addChannel
+     * @param value Sample value (default: 1, one pulse)
+     * @return true if stored, false if the ring was full
+     */
+    bool capture(uint8_t channel, int32_t value = 1);
+
+    /**
+     * @brief Drain the ring into the window aggregates, task context only
+     * @return Number of samples drained
+     */
+    size_t process();
+
+    /**
+     * @brief Write the window aggregates into a payload and start a new window
+     *
+     * Drains the ring first. Count and rate channels are always written,
+     * so an input without pulses reports 0; mean and max channels are
+     * left out of windows without samples.
+     *
+     * @param payload JSON object to populate
+     * @return Number of channels written
+     */
+    size_t populate(JsonObject& payload);
+
+    /**
+     * @brief Get the sample ring, e.g. to push samples with own timestamps
+     * @return Reference to the ring
+     */
+    MicroSafariCaptureRing& getRing();
+
+    /**
+     * @brief Get number of channels
+     * @return Channel count
+     */
+    size_t getChannelCount() const;
+
+    /**
+     * @brief Get capture statistics
+     * @return Statistics since construction
+     */
+    MicroSafariCaptureStats getStats() const;
+};
+
+#endif // MICROSAFARI_CAPTURE_H
@@ -0,0 +1,111 @@
+/*!
+ * @file MicroSafariChannel.cpp
+ * @brief Implementation of MicroSafari logical device channels
+ * @version 1.0.0
+ * @date 2025-08-22
+ */
+
+#include "MicroSafariChannel.h"
+
+/**
+ * @brief Constructor
+ */
+MicroSafariChannel::MicroSafariChannel() {
+    _connection = nullptr;
+    _apiKey[0] = '\0';
+    _deviceName[0] = '\0';
+    _sent = 0;
+    _failed = 0;
+}
+
+/**
+ * @brief Attach identity to a shared connection
+ */
+bool MicroSafariChannel::begin(MicroSafari& connection, const char* apiKey, const char* deviceName) {
+    if (apiKey == nullptr || deviceName == nullptr ||
+        apiKey[0] == '\0' || deviceName[0] == '\0' ||
+        strlen(apiKey) >= MICROSAFARI_CHANNEL_KEY_LENGTH ||
+        strlen(deviceName) >= MICROSAFARI_CHANNEL_NAME_LENGTH) {
+        return false;
+    }
+
+    _connection = &connection;
+    strcpy(_apiKey, apiKey);
+    strcpy(_deviceName, deviceName);
+    _connection->debugPrint("Channel attached: " + String(_deviceName));
+    return true;
+}
+
+/**
+ * @brief Send sensor data immediately
+ */
+MicroSafariResponse MicroSafariChannel::sendSensorData(const JsonObject& sensorData) {
+    MicroSafariResponse response;
+
+    if (_connection == nullptr) {
+        response.fail(MICROSAFARI_ERROR_NOT_ATTACHED);
+        return response;
+    }
+
+    DynamicJsonDocument doc(1024);
+    JsonObject payload = doc.createNestedObject("payload");
+    payload.set(sensorData);
+    if (!payload.containsKey("device_name")) {
+        payload["device_name"] = (const char*)_deviceName;
+    }
+
+    String jsonString;
+    serializeJson(doc, jsonString);
+
+    // Same HTTP client and TLS session as the owning instance, own API key
+    MicroSafariHttpHeader header = { "X-API-Key", String(_apiKey) };
+    response = _connection->performHttpRequest("/api/ingest", jsonString, "POST", &header, 1);
+
+    if (response.success) {
+        _sent++;
+    } else {
+        _failed++;
+    }
+    return response;
+}
+
+/**
+ * @brief Queue sensor data for the shared batch
+ */
+bool MicroSafariChannel::queueSensorData(const JsonObject& sensorData) {
+    if (_connection == nullptr || !_connection->enqueueBatchEntry(_apiKey, _deviceName, sensorData)) {
+        _failed++;
+        return false;
+    }
+
+    _sent++;
+    return true;
+}
+
+/**
+ * @brief Get device name
+ */
+const char* MicroSafariChannel::getDeviceName() const {
+    return _deviceName;
+}
+
+/**
+ * @brief Get success count
+ */
+uint32_t MicroSafariChannel::getSentCount() const {
+    return _sent;
+}
+
+/**
+ * @brief Get failure count
+ */
+uint32_t MicroSafariChannel::getFailedCount() const {
+    return _failed;
+}
+
+/**
+ * @brief Get memory used by this identity
+ */
+size_t MicroSafariChannel::getMemoryUsage() const {
+    return sizeof(*this);
+}
@@ -0,0 +1,104 @@
+/*!
+ * @file MicroSafariChannel.h
+ * @brief Logical device identities sharing one MicroSafari connection
+ * @version 1.0.0
+ * @date 2025-08-22
+ *
+ * A channel is a lightweight device identity (API key and device name)
+ * that sends through an existing MicroSafari instance. All channels use
+ * the instance's WiFi clients, HTTP client and TLS session, so an extra
+ * logical device costs only the channel object itself, without heap
+ * allocations. Queued readings of all identities are multiplexed into
+ * shared batch requests; every batch entry carries its own API key.
+ *
+ * @section license License
+ * MIT License
+ */
+
+#ifndef MICROSAFARI_CHANNEL_H
+#define MICROSAFARI_CHANNEL_H
+
+#include "MicroSafari.h"
+
+/** @brief Maximum API key length of a channel, including terminator */
+#define MICROSAFARI_CHANNEL_KEY_LENGTH 72
+
+/** @brief Maximum device name length of a channel, including terminator */
+#define MICROSAFARI_CHANNEL_NAME_LENGTH 32
+
+/** @brief Maximum entries in one shared batch request */
+#define MICROSAFARI_BATCH_MAX_ENTRIES 16
+
+/** @brief Maximum serialized size of queued batch entries in bytes */
+#define MICROSAFARI_BATCH_MAX_BYTES 4096
+
+/**
+ * @brief Logical device identity sending through a shared MicroSafari connection
+ */
+class MicroSafariChannel {
+private:
+    MicroSafari* _connection;        ///< Shared connection
+    char _apiKey[MICROSAFARI_CHANNEL_KEY_LENGTH]; ///< Device API key of this identity
+    char _deviceName[MICROSAFARI_CHANNEL_NAME_LENGTH]; ///< Device name of this identity
+    uint32_t _sent;                  ///< Readings sent or queued successfully
+    uint32_t _failed;                ///< Readings rejected or not queued
+
+public:
+    /**
+     * @brief Constructor for MicroSafariChannel
+     */
+    MicroSafariChannel();
+
+    /**
+     * @brief Attach the identity to a shared connection
+     * @param connection Initialized MicroSafari instance
+     * @param apiKey Device API key of this identity
+     * @param deviceName Device name of this identity
+     * @return true if attached, false if arguments are empty or too long
+     */
+    bool begin(MicroSafari& connection, const char* apiKey, const char* deviceName);
+
+    /**
+     * @brief Send sensor data immediately using this identity's API key
+     * @param sensorData JSON object containing sensor readings
+     * @return MicroSafariResponse structure with response details
+     */
+    MicroSafariResponse sendSensorData(const JsonObject& sensorData);
+
+    /**
+     * @brief Queue sensor data for the next shared batch request
+     * @param sensorData JSON object containing sensor readings
+     * @return true if queued, false if the batch queue is full
+     */
+    bool queueSensorData(const JsonObject& sensorData);
+
+    /**
+     * @brief Get device name of this identity
+     * @return Device name
+     */
+    const char* getDeviceName() const;
+
+    /**
+     * @brief Get readings sent or queued successfully
+     * @return Success count
+     */
+    uint32_t getSentCount() const;
+
+    /**
+     * @brief Get readings rejected or not queued
+     * @return Failure count
+     */
+    uint32_t getFailedCount() const;
+
+    /**
+     * @brief Get memory used by this identity
+     *
+     * Channels allocate nothing on the heap, so this is the size of the
+     * object itself.
+     *
+     * @return Bytes used
+     */
+    size_t getMemoryUsage() const;
+};
+
+#endif // MICROSAFARI_CHANNEL_H
@@ -0,0 +1,156 @@
+/*!
+ * @file MicroSafariError.cpp
+ * @brief Implementation of MicroSafari error codes and messages
+ * @version 1.0.0
+ * @date 2025-08-22
+ */
+
+#include "MicroSafariError.h"
+
+static const char* ERROR_NAMES[] = {
+    "",
+    "WiFi not connected",
+    "Network error - check connection",
+    "DNS lookup failed - check platform URL",
+    "TLS handshake failed",
+    "Request timed out",
+    "Authentication failed - check API key",
+    "Request rejected",
+    "Server error",
+    "Throttled by server",
+    "Out of memory",
+    "Invalid JSON payload structure",
+    "Nothing to send",
+    "Channel not attached"
+};
+
+/**
+ * @brief Get description of error code
+ */
+const char* microSafariErrorName(MicroSafariError error) {
+    if ((size_t)error >= sizeof(ERROR_NAMES) / sizeof(ERROR_NAMES[0])) {
+        return "Unknown error";
+    }
+    return ERROR_NAMES[error];
+}
+
+/**
+ * @brief Map HTTP status to error code
+ */
+MicroSafariError microSafariErrorForStatus(int httpCode) {
+    if ((httpCode >= 200 && httpCode < 300) || httpCode == 304) {
+        return MICROSAFARI_OK;
+    }
+    if (httpCode == 401 || httpCode == 403) {
+        return MICROSAFARI_ERROR_AUTH;
+    }
+    if (httpCode == 408) {
+        return MICROSAFARI_ERROR_TIMEOUT;
+    }
+    if (httpCode == 429) {
+        return MICROSAFARI_ERROR_THROTTLED;
+    }
+    if (httpCode >= 400 && httpCode < 500) {
+        return MICROSAFARI_ERROR_CLIENT;
+    }
+    return MICROSAFARI_ERROR_SERVER;
+}
+
+/**
+ * @brief Create empty message
+ */
+MicroSafariErrorMessage::MicroSafariErrorMessage()
+    : _error(MICROSAFARI_OK), _status(0), _detail(nullptr) {
+}
+
+/**
+ * @brief Create message for error
+ */
+MicroSafariErrorMessage::MicroSafariErrorMessage(MicroSafariError error, int status, const char* detail)
+    : _error(error), _status(status), _detail(detail) {
+}
+
+/**
+ * @brief Get error code
+ */
+MicroSafariError MicroSafariErrorMessage::error() const {
+    return _error;
+}
+
+/**
+ * @brief Get message, formatting on first use
+ */
+const char* MicroSafariErrorMessage::c_str() const {
+    if (_status == 0 && _detail == nullptr) {
+        return microSafariErrorName(_error);
+    }
+    if (_text.isEmpty()) {
+        char status[24] = "";
+        if (_status != 0) {
+            snprintf(status, sizeof(status), _error == MICROSAFARI_ERROR_WIFI ? " (status: %d)" : " (HTTP %d)", _status);
+        }
+        const char* name = microSafariErrorName(_error);
+        _text.reserve(strlen(name) + strlen(status) + (_detail != nullptr ? strlen(_detail) + 2 : 0));
+        _text = name;
+        _text += status;
+        if (_detail != nullptr) {
+            _text += ": ";
+            _text += _detail;
+        }
+    }
+    return _text.c_str();
+}
+
+/**
+ * @brief Get message length
+ */
+unsigned int MicroSafariErrorMessage::length() const {
+    return strlen(c_str());
+}
+
+/**
+ * @brief Check if no error is recorded
+ */
+bool MicroSafariErrorMessage::isEmpty() const {
+    return _error == MICROSAFARI_OK;
+}
+
+/**
+ * @brief Convert to String
+ */
+MicroSafariErrorMessage::operator String() const {
+    return String(c_str());
+}
+
+/**
+ * @brief Compare with text
+ */
+bool MicroSafariErrorMessage::operator==(const char* text) const {
+    // String treats nullptr as empty; so does this
+    return strcmp(c_str(), text != nullptr ? text : "") == 0;
+}
+
+/**
+ * @brief Compare with text
+ */
+bool MicroSafariErrorMessage::operator!=(const char* text) const {
+    return !(*this == text);
+}
+
+/**
+ * @brief Append message to String
+ */
+String operator+(const String& lhs, const MicroSafariErrorMessage& rhs) {
+    String result(lhs);
+    result += rhs.c_str();
+    return result;
+}
+
+/**
+ * @brief Append message to C string
+ */
+String operator+(const char* lhs, const MicroSafariErrorMessage& rhs) {
+    String result(lhs);
+    result += rhs.c_str();
+    return result;
+}
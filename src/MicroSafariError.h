@@ -0,0 +1,148 @@
+/*!
+ * @file MicroSafariError.h
+ * @brief Error codes with lazily formatted messages
+ * @version 1.0.0
+ * @date 2025-08-22
+ *
+ * Failed requests report a MicroSafariError code that tells apart
+ * network, DNS, TLS, timeout, authentication, client, server and
+ * throttling failures, so sketches can react to the cause without
+ * parsing text. The human-readable message is only put together when
+ * it is read: a failure costs no heap unless the sketch prints it.
+ *
+ * MicroSafariErrorMessage stands in for the String errorMessage of
+ * earlier releases; c_str(), isEmpty(), comparisons and concatenation
+ * with Strings keep working unchanged.
+ *
+ * @section license License
+ * MIT License
+ */
+
+#ifndef MICROSAFARI_ERROR_H
+#define MICROSAFARI_ERROR_H
+
+#include <Arduino.h>
+
+/**
+ * @brief Cause of a failed operation
+ */
+enum MicroSafariError {
+    MICROSAFARI_OK = 0,              ///< No error
+    MICROSAFARI_ERROR_WIFI,          ///< WiFi not connected
+    MICROSAFARI_ERROR_NETWORK,       ///< Connection refused or lost
+    MICROSAFARI_ERROR_DNS,           ///< Platform host name did not resolve
+    MICROSAFARI_ERROR_TLS,           ///< TLS handshake failed
+    MICROSAFARI_ERROR_TIMEOUT,       ///< No answer within the timeout
+    MICROSAFARI_ERROR_AUTH,          ///< HTTP 401 or 403, check the API key
+    MICROSAFARI_ERROR_CLIENT,        ///< Other HTTP 4xx, the request was rejected
+    MICROSAFARI_ERROR_SERVER,        ///< HTTP 5xx or an unexpected status
+    MICROSAFARI_ERROR_THROTTLED,     ///< HTTP 429, the server asks to slow down
+    MICROSAFARI_ERROR_NO_MEMORY,     ///< Not enough heap for the request
+    MICROSAFARI_ERROR_INVALID_PAYLOAD, ///< Payload is not valid JSON
+    MICROSAFARI_ERROR_NO_DATA,       ///< Nothing to send
+    MICROSAFARI_ERROR_NOT_ATTACHED   ///< Channel not attached to a connection
+};
+
+/**
+ * @brief Get the short description of an error code
+ * @param error Error code
+ * @return Static description, e.g. "Request timed out"
+ */
+const char* microSafariErrorName(MicroSafariError error);
+
+/**
+ * @brief Map an HTTP status to an error code
+ * @param httpCode HTTP status, above 0
+ * @return MICROSAFARI_OK for 2xx and 304, the matching error otherwise
+ */
+MicroSafariError microSafariErrorForStatus(int httpCode);
+
+/**
+ * @brief Error message formatted on first use
+ *
+ * Holds the error code, the HTTP status and an optional static detail.
+ * Codes without status or detail return their description without
+ * allocating; otherwise the text is built once and kept.
+ */
+class MicroSafariErrorMessage {
+private:
+    MicroSafariError _error;         ///< Error code
+    int _status;                     ///< HTTP status or WiFi status, 0 if none
+    const char* _detail;             ///< Static detail text, nullptr if none
+    mutable String _text;            ///< Formatted message, empty until needed
+
+public:
+    /**
+     * @brief Create an empty message
+     */
+    MicroSafariErrorMessage();
+
+    /**
+     * @brief Create a message for an error
+     * @param error Error code
+     * @param status HTTP status or WiFi status, 0 if none (default: 0)
+     * @param detail Static detail text, e.g. a literal (default: nullptr)
+     */
+    MicroSafariErrorMessage(MicroSafariError error, int status = 0, const char* detail = nullptr);
+
+    /**
+     * @brief Get the error code
+     * @return Error code, MICROSAFARI_OK if empty
+     */
+    MicroSafariError error() const;
+
+    /**
+     * @brief Get the message, formatting it if needed
+     * @return Message, "" if empty; valid while this object lives
+     */
+    const char* c_str() const;
+
+    /**
+     * @brief Get the message length
+     * @return Length in characters
+     */
+    unsigned int length() const;
+
+    /**
+     * @brief Check if no error is recorded
+     * @return true if empty
+     */
+    bool isEmpty() const;
+
+    /**
+     * @brief Convert to String
+     */
+    operator String() const;
+
+    /**
+     * @brief Compare with text, like String
+     * @param text Text to compare, nullptr counts as ""
+     * @return true if the message equals the text
+     */
+    bool operator==(const char* text) const;
+
+    /**
+     * @brief Compare with text, like String
+     * @param text Text to compare, nullptr counts as ""
+     * @return true if the message differs from the text
+     */
+    bool operator!=(const char* text) const;
+};
+
+/**
+ * @brief Append a message to a String
+ * @param lhs Leading text
+ * @param rhs Message
+ * @return Concatenated text
+ */
+String operator+(const String& lhs, const MicroSafariErrorMessage& rhs);
+
+/**
+ * @brief Append a message to a C string
+ * @param lhs Leading text
+ * @param rhs Message
+ * @return Concatenated text
+ */
+String operator+(const char* lhs, const MicroSafariErrorMessage& rhs);
+
+#endif // MICROSAFARI_ERROR_H
@@ -0,0 +1,715 @@
+/*!
+ * @file MicroSafariFlashLog.cpp
+ * @brief Implementation of the MicroSafari flash ring log
+ * @version 1.0.0
+ * @date 2025-08-22
+ */
+
+#include "MicroSafariFlashLog.h"
+
+// Sector header magic ("MSFL" little endian)
+static const uint32_t FLASH_LOG_MAGIC = 0x4C46534D;
+
+// Record states, each transition only clears bits
+static const uint16_t RECORD_LENGTH_FREE = 0xFFFF;
+static const uint8_t RECORD_STATE_VALID = 0xFE;
+static const uint8_t RECORD_STATE_CONSUMED = 0xFC;
+
+struct FlashSectorHeader {
+    uint32_t magic;
+    uint32_t sequence;
+    uint32_t reserved;
+    uint32_t crc;
+};
+
+struct FlashRecordHeader {
+    uint16_t length;
+    uint8_t state;
+    uint8_t reserved;
+    uint32_t crc;
+};
+
+static_assert(sizeof(FlashSectorHeader) == MICROSAFARI_FLASH_SECTOR_HEADER_SIZE, "Sector header size mismatch");
+static_assert(sizeof(FlashRecordHeader) == MICROSAFARI_FLASH_RECORD_HEADER_SIZE, "Record header size mismatch");
+
+/**
+ * @brief Bytes occupied by a record including header and 4-byte padding
+ */
+static uint32_t recordSpan(uint16_t length) {
+    return (MICROSAFARI_FLASH_RECORD_HEADER_SIZE + length + 3) & ~3UL;
+}
+
+/**
+ * @brief Check that a record header describes a plausible record
+ */
+static bool recordHeaderPlausible(const FlashRecordHeader& header, uint32_t offset) {
+    return header.length != RECORD_LENGTH_FREE &&
+           header.length != 0 &&
+           header.length <= MICROSAFARI_FLASH_MAX_RECORD_SIZE &&
+           offset + recordSpan(header.length) <= MICROSAFARI_FLASH_SECTOR_SIZE;
+}
+
+/**
+ * @brief CRC32 (IEEE 802.3) with a 16-entry table
+ */
+uint32_t microSafariCrc32(const void* data, size_t length, uint32_t crc) {
+    static const uint32_t table[16] = {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC,
+        0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+        0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+        0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+    };
+
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    crc = ~crc;
+    for (size_t i = 0; i < length; i++) {
+        crc = table[(crc ^ bytes[i]) & 0x0F] ^ (crc >> 4);
+        crc = table[(crc ^ (bytes[i] >> 4)) & 0x0F] ^ (crc >> 4);
+    }
+    return ~crc;
+}
+
+/**
+ * @brief Constructor
+ */
+MicroSafariPartitionFlash::MicroSafariPartitionFlash() {
+    _partition = nullptr;
+}
+
+/**
+ * @brief Look up the data partition
+ */
+bool MicroSafariPartitionFlash::begin(const char* label) {
+    _partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, label);
+    return _partition != nullptr;
+}
+
+/**
+ * @brief Read from partition
+ */
+bool MicroSafariPartitionFlash::read(uint32_t address, void* buffer, size_t length) {
+    return _partition != nullptr && esp_partition_read(_partition, address, buffer, length) == ESP_OK;
+}
+
+/**
+ * @brief Write to partition
+ */
+bool MicroSafariPartitionFlash::write(uint32_t address, const void* data, size_t length) {
+    return _partition != nullptr && esp_partition_write(_partition, address, data, length) == ESP_OK;
+}
+
+/**
+ * @brief Erase one partition sector
+ */
+bool MicroSafariPartitionFlash::eraseSector(uint32_t address) {
+    return _partition != nullptr &&
+           esp_partition_erase_range(_partition, address, MICROSAFARI_FLASH_SECTOR_SIZE) == ESP_OK;
+}
+
+/**
+ * @brief Get partition size
+ */
+uint32_t MicroSafariPartitionFlash::size() const {
+    return _partition != nullptr ? _partition->size : 0;
+}
+
+/**
+ * @brief Constructor
+ */
+MicroSafariEmulatedFlash::MicroSafariEmulatedFlash() {
+    _memory = nullptr;
+    _eraseCounts = nullptr;
+    _size = 0;
+    _writeViolations = 0;
+}
+
+/**
+ * @brief Destructor
+ */
+MicroSafariEmulatedFlash::~MicroSafariEmulatedFlash() {
+    free(_memory);
+    free(_eraseCounts);
+}
+
+/**
+ * @brief Allocate emulated flash
+ */
+bool MicroSafariEmulatedFlash::begin(uint32_t size) {
+    free(_memory);
+    free(_eraseCounts);
+
+    _size = size - (size % MICROSAFARI_FLASH_SECTOR_SIZE);
+    _memory = static_cast<uint8_t*>(malloc(_size));
+    _eraseCounts = static_cast<uint32_t*>(calloc(_size / MICROSAFARI_FLASH_SECTOR_SIZE, sizeof(uint32_t)));
+    _writeViolations = 0;
+
+    if (_memory == nullptr || _eraseCounts == nullptr) {
+        free(_memory);
+        free(_eraseCounts);
+        _memory = nullptr;
+        _eraseCounts = nullptr;
+        _size = 0;
+        return false;
+    }
+
+    memset(_memory, 0xFF, _size);
+    return true;
+}
+
+/**
+ * @brief Read from emulated flash
+ */
+bool MicroSafariEmulatedFlash::read(uint32_t address, void* buffer, size_t length) {
+    if (_memory == nullptr || address + length > _size) {
+        return false;
+    }
+    memcpy(buffer, _memory + address, length);
+    return true;
+}
+
+/**
+ * @brief Write to emulated flash, clearing bits only
+ */
+bool MicroSafariEmulatedFlash::write(uint32_t address, const void* data, size_t length) {
+    if (_memory == nullptr || address + length > _size) {
+        return false;
+    }
+
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < length; i++) {
+        if ((bytes[i] & ~_memory[address + i]) != 0) {
+            _writeViolations++;
+        }
+        _memory[address + i] &= bytes[i];
+    }
+    return true;
+}
+
+/**
+ * @brief Erase one emulated sector
+ */
+bool MicroSafariEmulatedFlash::eraseSector(uint32_t address) {
+    if (_memory == nullptr || (address % MICROSAFARI_FLASH_SECTOR_SIZE) != 0 || address >= _size) {
+        return false;
+    }
+    memset(_memory + address, 0xFF, MICROSAFARI_FLASH_SECTOR_SIZE);
+    _eraseCounts[address / MICROSAFARI_FLASH_SECTOR_SIZE]++;
+    return true;
+}
+
+/**
+ * @brief Get emulated size
+ */
+uint32_t MicroSafariEmulatedFlash::size() const {
+    return _size;
+}
+
+/**
+ * @brief Get erase count of a sector
+ */
+uint32_t MicroSafariEmulatedFlash::getEraseCount(uint32_t sector) const {
+    if (_eraseCounts == nullptr || sector >= _size / MICROSAFARI_FLASH_SECTOR_SIZE) {
+        return 0;
+    }
+    return _eraseCounts[sector];
+}
+
+/**
+ * @brief Get NOR semantic violations
+ */
+uint32_t MicroSafariEmulatedFlash::getWriteViolations() const {
+    return _writeViolations;
+}
+
+/**
+ * @brief Constructor
+ */
+MicroSafariFlashLog::MicroSafariFlashLog() {
+    _flash = nullptr;
+    _baseAddress = 0;
+    _sectorCount = 0;
+    _headSector = 0;
+    _headOffset = MICROSAFARI_FLASH_SECTOR_HEADER_SIZE;
+    _headSequence = 0;
+    _tailSector = 0;
+    _tailOffset = MICROSAFARI_FLASH_SECTOR_HEADER_SIZE;
+    _ready = false;
+    _evictionCallback = nullptr;
+    _evictionContext = nullptr;
+    resetStats();
+}
+
+/**
+ * @brief Get flash address of a sector
+ */
+uint32_t MicroSafariFlashLog::sectorAddress(uint32_t sector) const {
+    return _baseAddress + sector * MICROSAFARI_FLASH_SECTOR_SIZE;
+}
+
+/**
+ * @brief Read and validate sector header
+ */
+bool MicroSafariFlashLog::readSectorHeader(uint32_t sector, uint32_t& sequence) {
+    FlashSectorHeader header;
+    if (!_flash->read(sectorAddress(sector), &header, sizeof(header))) {
+        return false;
+    }
+
+    if (header.magic != FLASH_LOG_MAGIC ||
+        header.crc != microSafariCrc32(&header, offsetof(FlashSectorHeader, crc))) {
+        return false;
+    }
+
+    sequence = header.sequence;
+    return true;
+}
+
+/**
+ * @brief Erase sector and write its header
+ */
+bool MicroSafariFlashLog::formatSector(uint32_t sector, uint32_t sequence) {
+    if (!_flash->eraseSector(sectorAddress(sector))) {
+        return false;
+    }
+    _stats.sectorErases++;
+
+    FlashSectorHeader header;
+    header.magic = FLASH_LOG_MAGIC;
+    header.sequence = sequence;
+    header.reserved = 0xFFFFFFFF;
+    header.crc = microSafariCrc32(&header, offsetof(FlashSectorHeader, crc));
+
+    return _flash->write(sectorAddress(sector), &header, sizeof(header));
+}
+
+/**
+ * @brief Find first free offset in a sector
+ */
+uint32_t MicroSafariFlashLog::findWriteOffset(uint32_t sector) {
+    uint32_t offset = MICROSAFARI_FLASH_SECTOR_HEADER_SIZE;
+    uint8_t chunk[64];
+
+    while (offset + MICROSAFARI_FLASH_RECORD_HEADER_SIZE <= MICROSAFARI_FLASH_SECTOR_SIZE) {
+        FlashRecordHeader header;
+        if (!_flash->read(sectorAddress(sector) + offset, &header, sizeof(header))) {
+            return MICROSAFARI_FLASH_SECTOR_SIZE;
+        }
+
+        if (header.length == RECORD_LENGTH_FREE) {
+            return offset;
+        }
+
+        if (!recordHeaderPlausible(header, offset)) {
+            // Torn header, close the sector so the next append starts a fresh one
+            return MICROSAFARI_FLASH_SECTOR_SIZE;
+        }
+
+        // Verify the payload so a write torn by power loss is not appended after
+        uint32_t crc = microSafariCrc32(&header.length, sizeof(header.length));
+        uint32_t dataAddress = sectorAddress(sector) + offset + MICROSAFARI_FLASH_RECORD_HEADER_SIZE;
+        for (uint16_t done = 0; done < header.length; ) {
+            uint16_t count = min((uint16_t)sizeof(chunk), (uint16_t)(header.length - done));
+            if (!_flash->read(dataAddress + done, chunk, count)) {
+                return MICROSAFARI_FLASH_SECTOR_SIZE;
+            }
+            crc = microSafariCrc32(chunk, count, crc);
+            done += count;
+        }
+
+        if (crc != header.crc) {
+            _stats.corruptRecords++;
+            return MICROSAFARI_FLASH_SECTOR_SIZE;
+        }
+
+        offset += recordSpan(header.length);
+    }
+
+    return MICROSAFARI_FLASH_SECTOR_SIZE;
+}
+
+/**
+ * @brief Mount the log
+ */
+bool MicroSafariFlashLog::begin(MicroSafariFlashBackend* flash, uint32_t offset, uint32_t length) {
+    _ready = false;
+
+    if (flash == nullptr || (offset % MICROSAFARI_FLASH_SECTOR_SIZE) != 0 || offset >= flash->size()) {
+        return false;
+    }
+
+    if (length == 0 || offset + length > flash->size()) {
+        length = flash->size() - offset;
+    }
+
+    _flash = flash;
+    _baseAddress = offset;
+    _sectorCount = length / MICROSAFARI_FLASH_SECTOR_SIZE;
+
+    if (_sectorCount < 2) {
+        return false;
+    }
+
+    // Boot scan: one header read per sector finds newest (head) and oldest (tail)
+    bool found = false;
+    uint32_t tailSequence = 0;
+    for (uint32_t sector = 0; sector < _sectorCount; sector++) {
+        uint32_t sequence;
+        if (!readSectorHeader(sector, sequence)) {
+            continue;
+        }
+
+        if (!found || sequence > _headSequence) {
+            _headSector = sector;
+            _headSequence = sequence;
+        }
+        if (!found || sequence < tailSequence) {
+            _tailSector = sector;
+            tailSequence = sequence;
+        }
+        found = true;
+    }
+
+    if (!found) {
+        return format();
+    }
+
+    _headOffset = findWriteOffset(_headSector);
+    _tailOffset = MICROSAFARI_FLASH_SECTOR_HEADER_SIZE;
+    _ready = true;
+
+    seekTail();
+    return true;
+}
+
+/**
+ * @brief Erase all sectors and start an empty log
+ */
+bool MicroSafariFlashLog::format() {
+    if (_flash == nullptr || _sectorCount < 2) {
+        return false;
+    }
+
+    // Invalidating the magic is enough; stale sectors are erased before reuse
+    const uint32_t cleared = 0;
+    for (uint32_t sector = 1; sector < _sectorCount; sector++) {
+        uint32_t sequence;
+        if (readSectorHeader(sector, sequence)) {
+            _flash->write(sectorAddress(sector), &cleared, sizeof(cleared));
+        }
+    }
+
+    _headSector = 0;
+    _headSequence = 1;
+    _headOffset = MICROSAFARI_FLASH_SECTOR_HEADER_SIZE;
+    _tailSector = 0;
+    _tailOffset = MICROSAFARI_FLASH_SECTOR_HEADER_SIZE;
+
+    _ready = formatSector(0, _headSequence);
+    return _ready;
+}
+
+/**
+ * @brief Pass unread records of a sector to the eviction callback
+ */
+void MicroSafariFlashLog::evictSector(uint32_t sector, uint32_t offset) {
+    while (offset + MICROSAFARI_FLASH_RECORD_HEADER_SIZE <= MICROSAFARI_FLASH_SECTOR_SIZE) {
+        FlashRecordHeader header;
+        if (!_flash->read(sectorAddress(sector) + offset, &header, sizeof(header)) ||
+            !recordHeaderPlausible(header, offset)) {
+            return;
+        }
+
+        if (header.state == RECORD_STATE_VALID) {
+            _stats.droppedRecords++;
+
+            if (_evictionCallback != nullptr) {
+                uint8_t* data = static_cast<uint8_t*>(malloc(header.length));
+                if (data != nullptr) {
+                    uint32_t dataAddress = sectorAddress(sector) + offset + MICROSAFARI_FLASH_RECORD_HEADER_SIZE;
+                    if (_flash->read(dataAddress, data, header.length) &&
+                        microSafariCrc32(data, header.length,
+                                         microSafariCrc32(&header.length, sizeof(header.length))) == header.crc) {
+                        _evictionCallback(_evictionContext, data, header.length);
+                    }
+                    free(data);
+                }
+            }
+        }
+
+        offset += recordSpan(header.length);
+    }
+}
+
+/**
+ * @brief Move head into the next sector
+ */
+bool MicroSafariFlashLog::advanceHead() {
+    uint32_t next = (_headSector + 1) % _sectorCount;
+
+    // Head caught up with unread data: the oldest sector is overwritten
+    if (seekTail() && next == _tailSector) {
+        evictSector(_tailSector, _tailOffset);
+        _tailSector = (next + 1) % _sectorCount;
+        _tailOffset = MICROSAFARI_FLASH_SECTOR_HEADER_SIZE;
+    }
+
+    if (!formatSector(next, _headSequence + 1)) {
+        return false;
+    }
+
+    _headSector = next;
+    _headSequence++;
+    _headOffset = MICROSAFARI_FLASH_SECTOR_HEADER_SIZE;
+    return true;
+}
+
+/**
+ * @brief Move tail to the next unread record
+ */
+bool MicroSafariFlashLog::seekTail() {
+    if (!_ready) {
+        return false;
+    }
+
+    while (true) {
+        if (_tailSector == _headSector && _tailOffset >= _headOffset) {
+            return false;
+        }
+
+        if (_tailOffset + MICROSAFARI_FLASH_RECORD_HEADER_SIZE <= MICROSAFARI_FLASH_SECTOR_SIZE) {
+            FlashRecordHeader header;
+            if (_flash->read(sectorAddress(_tailSector) + _tailOffset, &header, sizeof(header)) &&
+                recordHeaderPlausible(header, _tailOffset)) {
+                if (header.state == RECORD_STATE_VALID) {
+                    return true;
+                }
+                if (header.state == RECORD_STATE_CONSUMED) {
+                    _tailOffset += recordSpan(header.length);
+                    continue;
+                }
+            }
+        }
+
+        // End of written data in this sector
+        if (_tailSector == _headSector) {
+            return false;
+        }
+        _tailSector = (_tailSector + 1) % _sectorCount;
+        _tailOffset = MICROSAFARI_FLASH_SECTOR_HEADER_SIZE;
+    }
+}
+
+/**
+ * @brief Append a record
+ */
+bool MicroSafariFlashLog::append(const void* data, uint16_t length) {
+    if (!_ready || data == nullptr || length == 0 || length > MICROSAFARI_FLASH_MAX_RECORD_SIZE) {
+        return false;
+    }
+
+    unsigned long startMicros = micros();
+
+    if (_headOffset + recordSpan(length) > MICROSAFARI_FLASH_SECTOR_SIZE) {
+        if (!advanceHead()) {
+            return false;
+        }
+    }
+
+    FlashRecordHeader header;
+    header.length = length;
+    header.state = RECORD_STATE_VALID;
+    header.reserved = 0xFF;
+    header.crc = microSafariCrc32(data, length, microSafariCrc32(&header.length, sizeof(header.length)));
+
+    uint32_t address = sectorAddress(_headSector) + _headOffset;
+    if (!_flash->write(address, &header, sizeof(header)) ||
+        !_flash->write(address + sizeof(header), data, length)) {
+        // Leave the damaged record behind; the CRC check skips it
+        _headOffset = MICROSAFARI_FLASH_SECTOR_SIZE;
+        return false;
+    }
+
+    _headOffset += recordSpan(length);
+
+    uint32_t elapsed = micros() - startMicros;
+    _stats.appends++;
+    _stats.bytesAppended += length;
+    _stats.totalAppendMicros += elapsed;
+    if (elapsed > _stats.maxAppendMicros) {
+        _stats.maxAppendMicros = elapsed;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Read oldest unread record
+ */
+bool MicroSafariFlashLog::peek(void* buffer, size_t bufferSize, uint16_t& length) {
+    while (seekTail()) {
+        FlashRecordHeader header;
+        uint32_t address = sectorAddress(_tailSector) + _tailOffset;
+        if (!_flash->read(address, &header, sizeof(header))) {
+            return false;
+        }
+
+        length = header.length;
+        if (header.length > bufferSize) {
+            return false;
+        }
+
+        if (!_flash->read(address + sizeof(header), buffer, header.length)) {
+            return false;
+        }
+
+        if (microSafariCrc32(buffer, header.length,
+                             microSafariCrc32(&header.length, sizeof(header.length))) == header.crc) {
+            return true;
+        }
+
+        // Corrupt record: consume it and try the next one
+        _stats.corruptRecords++;
+        pop();
+    }
+
+    length = 0;
+    return false;
+}
+
+/**
+ * @brief Position cursor at tail
+ */
+bool MicroSafariFlashLog::beginRead(Cursor& cursor) {
+    bool available = seekTail();
+    cursor.sector = _tailSector;
+    cursor.offset = _tailOffset;
+    cursor.records = 0;
+    return available;
+}
+
+/**
+ * @brief Read record at cursor and advance
+ */
+bool MicroSafariFlashLog::readNext(Cursor& cursor, void* buffer, size_t bufferSize, uint16_t& length) {
+    if (!_ready) {
+        return false;
+    }
+
+    while (true) {
+        if (cursor.sector == _headSector && cursor.offset >= _headOffset) {
+            return false;
+        }
+
+        FlashRecordHeader header;
+        uint32_t address = sectorAddress(cursor.sector) + cursor.offset;
+        if (cursor.offset + MICROSAFARI_FLASH_RECORD_HEADER_SIZE > MICROSAFARI_FLASH_SECTOR_SIZE ||
+            !_flash->read(address, &header, sizeof(header)) ||
+            !recordHeaderPlausible(header, cursor.offset)) {
+            // End of written data in this sector
+            if (cursor.sector == _headSector) {
+                return false;
+            }
+            cursor.sector = (cursor.sector + 1) % _sectorCount;
+            cursor.offset = MICROSAFARI_FLASH_SECTOR_HEADER_SIZE;
+            continue;
+        }
+
+        if (header.state != RECORD_STATE_VALID) {
+            cursor.offset += recordSpan(header.length);
+            continue;
+        }
+
+        length = header.length;
+        if (header.length > bufferSize) {
+            return false;
+        }
+
+        cursor.offset += recordSpan(header.length);
+        cursor.records++;
+
+        if (_flash->read(address + sizeof(header), buffer, header.length) &&
+            microSafariCrc32(buffer, header.length,
+                             microSafariCrc32(&header.length, sizeof(header.length))) == header.crc) {
+            return true;
+        }
+
+        _stats.corruptRecords++;
+    }
+}
+
+/**
+ * @brief Consume oldest unread record
+ */
+bool MicroSafariFlashLog::pop() {
+    if (!seekTail()) {
+        return false;
+    }
+
+    FlashRecordHeader header;
+    uint32_t address = sectorAddress(_tailSector) + _tailOffset;
+    if (!_flash->read(address, &header, sizeof(header))) {
+        return false;
+    }
+
+    const uint8_t state = RECORD_STATE_CONSUMED;
+    _flash->write(address + offsetof(FlashRecordHeader, state), &state, sizeof(state));
+    _tailOffset += recordSpan(header.length);
+    return true;
+}
+
+/**
+ * @brief Check for unread records
+ */
+bool MicroSafariFlashLog::isEmpty() {
+    return !seekTail();
+}
+
+/**
+ * @brief Check if next append overwrites unread data
+ */
+bool MicroSafariFlashLog::wouldEvict(uint16_t length) {
+    if (!_ready || _headOffset + recordSpan(length) <= MICROSAFARI_FLASH_SECTOR_SIZE) {
+        return false;
+    }
+    return seekTail() && (_headSector + 1) % _sectorCount == _tailSector;
+}
+
+/**
+ * @brief Set eviction callback
+ */
+void MicroSafariFlashLog::setEvictionCallback(EvictionCallback callback, void* context) {
+    _evictionCallback = callback;
+    _evictionContext = context;
+}
+
+/**
+ * @brief Get sector count
+ */
+uint32_t MicroSafariFlashLog::getSectorCount() const {
+    return _sectorCount;
+}
+
+/**
+ * @brief Get bytes between tail and head
+ */
+uint32_t MicroSafariFlashLog::getUsedBytes() const {
+    if (!_ready) {
+        return 0;
+    }
+    uint32_t sectors = (_headSector + _sectorCount - _tailSector) % _sectorCount;
+    return sectors * MICROSAFARI_FLASH_SECTOR_SIZE + _headOffset - _tailOffset;
+}
+
+/**
+ * @brief Get statistics
+ */
+const MicroSafariFlashLogStats& MicroSafariFlashLog::getStats() const {
+    return _stats;
+}
+
+/**
+ * @brief Reset statistics
+ */
+void MicroSafariFlashLog::resetStats() {
+    memset(&_stats, 0, sizeof(_stats));
+}
@@ -0,0 +1,377 @@
+/*!
+ * @file MicroSafariFlashLog.h
+ * @brief Sector-based flash ring log for high-rate telemetry records
+ * @version 1.0.0
+ * @date 2025-08-22
+ *
+ * The ring log writes telemetry records straight into a raw flash
+ * region instead of a filesystem. Records are packed into 4 KB sectors,
+ * every sector carries a sequence-stamped header and every record is
+ * protected by a CRC32, so a boot scan only has to read one header per
+ * sector to find the head and the tail of the log.
+ *
+ * Storage is accessed through MicroSafariFlashBackend, which has two
+ * implementations: MicroSafariPartitionFlash for a data partition on the
+ * ESP32 and MicroSafariEmulatedFlash, a RAM-backed NOR flash emulator
+ * used for benchmarking and for testing without real hardware.
+ *
+ * @section license License
+ * MIT License
+ */
+
+#ifndef MICROSAFARI_FLASH_LOG_H
+#define MICROSAFARI_FLASH_LOG_H
+
+#include <Arduino.h>
+#include <esp_partition.h>
+
+/** @brief Flash erase unit used by the ring log */
+#define MICROSAFARI_FLASH_SECTOR_SIZE 4096
+
+/** @brief Size of the header at the start of every ring log sector */
+#define MICROSAFARI_FLASH_SECTOR_HEADER_SIZE 16
+
+/** @brief Size of the header in front of every ring log record */
+#define MICROSAFARI_FLASH_RECORD_HEADER_SIZE 8
+
+/** @brief Largest record payload that fits into a single sector */
+#define MICROSAFARI_FLASH_MAX_RECORD_SIZE \
+    (MICROSAFARI_FLASH_SECTOR_SIZE - MICROSAFARI_FLASH_SECTOR_HEADER_SIZE - MICROSAFARI_FLASH_RECORD_HEADER_SIZE)
+
+/**
+ * @brief Compute a CRC32 (IEEE 802.3) checksum
+ * @param data Data to checksum
+ * @param length Number of bytes
+ * @param crc Running CRC from a previous call (default: start a new CRC)
+ * @return Updated CRC32 value
+ */
+uint32_t microSafariCrc32(const void* data, size_t length, uint32_t crc = 0);
+
+/**
+ * @brief Abstract NOR flash region used by the ring log
+ *
+ * Implementations must follow NOR flash semantics: erasing a sector sets
+ * all of its bytes to 0xFF and writes can only clear bits.
+ */
+class MicroSafariFlashBackend {
+public:
+    virtual ~MicroSafariFlashBackend() {}
+
+    /**
+     * @brief Read bytes from flash
+     * @param address Byte offset inside the region
+     * @param buffer Destination buffer
+     * @param length Number of bytes to read
+     * @return true if read successful, false otherwise
+     */
+    virtual bool read(uint32_t address, void* buffer, size_t length) = 0;
+
+    /**
+     * @brief Program bytes into previously erased flash
+     * @param address Byte offset inside the region
+     * @param data Source data
+     * @param length Number of bytes to write
+     * @return true if write successful, false otherwise
+     */
+    virtual bool write(uint32_t address, const void* data, size_t length) = 0;
+
+    /**
+     * @brief Erase one sector
+     * @param address Sector-aligned byte offset inside the region
+     * @return true if erase successful, false otherwise
+     */
+    virtual bool eraseSector(uint32_t address) = 0;
+
+    /**
+     * @brief Get region size in bytes
+     * @return Size of the flash region
+     */
+    virtual uint32_t size() const = 0;
+};
+
+/**
+ * @brief Flash backend on top of a raw ESP32 data partition
+ *
+ * Add a data partition to your partitions.csv, for example:
+ * @code
+ * mslog, data, 0x99, , 0x40000,
+ * @endcode
+ */
+class MicroSafariPartitionFlash : public MicroSafariFlashBackend {
+private:
+    const esp_partition_t* _partition; ///< Partition handle (nullptr until begin)
+
+public:
+    /**
+     * @brief Constructor for MicroSafariPartitionFlash
+     */
+    MicroSafariPartitionFlash();
+
+    /**
+     * @brief Look up the data partition to use
+     * @param label Partition label from partitions.csv (default: "mslog")
+     * @return true if partition found, false otherwise
+     */
+    bool begin(const char* label = "mslog");
+
+    bool read(uint32_t address, void* buffer, size_t length) override;
+    bool write(uint32_t address, const void* data, size_t length) override;
+    bool eraseSector(uint32_t address) override;
+    uint32_t size() const override;
+};
+
+/**
+ * @brief RAM-backed NOR flash emulator
+ *
+ * Enforces erase-before-write semantics and counts erase cycles per
+ * sector so that wear distribution can be inspected.
+ */
+class MicroSafariEmulatedFlash : public MicroSafariFlashBackend {
+private:
+    uint8_t* _memory;                ///< Emulated flash contents
+    uint32_t* _eraseCounts;          ///< Erase cycles per sector
+    uint32_t _size;                  ///< Emulated size in bytes
+    uint32_t _writeViolations;       ///< Writes that tried to set bits from 0 to 1
+
+public:
+    /**
+     * @brief Constructor for MicroSafariEmulatedFlash
+     */
+    MicroSafariEmulatedFlash();
+
+    /**
+     * @brief Destructor for MicroSafariEmulatedFlash
+     */
+    ~MicroSafariEmulatedFlash();
+
+    /**
+     * @brief Allocate the emulated flash region in erased state
+     * @param size Region size in bytes (rounded down to whole sectors)
+     * @return true if allocation successful, false otherwise
+     */
+    bool begin(uint32_t size);
+
+    bool read(uint32_t address, void* buffer, size_t length) override;
+    bool write(uint32_t address, const void* data, size_t length) override;
+    bool eraseSector(uint32_t address) override;
+    uint32_t size() const override;
+
+    /**
+     * @brief Get erase cycle count of a sector
+     * @param sector Sector index
+     * @return Number of times the sector was erased
+     */
+    uint32_t getEraseCount(uint32_t sector) const;
+
+    /**
+     * @brief Get number of writes that violated NOR semantics
+     * @return Violation count (should always be 0)
+     */
+    uint32_t getWriteViolations() const;
+};
+
+/**
+ * @brief Ring log statistics
+ */
+struct MicroSafariFlashLogStats {
+    uint32_t appends;                ///< Records appended since begin
+    uint32_t bytesAppended;          ///< Payload bytes appended since begin
+    uint32_t sectorErases;           ///< Sectors erased since begin
+    uint32_t droppedRecords;         ///< Unread records overwritten because the log was full
+    uint32_t corruptRecords;         ///< Records skipped because of a CRC mismatch
+    uint32_t maxAppendMicros;        ///< Worst-case append latency
+    uint32_t totalAppendMicros;      ///< Accumulated append latency
+};
+
+/**
+ * @brief Sector-based ring log with O(1) append
+ *
+ * Records are appended at the head and consumed from the tail. When the
+ * head needs a sector that still holds unread records, the oldest sector
+ * is erased; its records are handed to the eviction callback first.
+ */
+class MicroSafariFlashLog {
+public:
+    /**
+     * @brief Callback for records that are about to be overwritten
+     * @param context User context pointer given to setEvictionCallback
+     * @param data Record payload
+     * @param length Payload length in bytes
+     */
+    typedef void (*EvictionCallback)(void* context, const uint8_t* data, uint16_t length);
+
+    /**
+     * @brief Read position for walking unread records without consuming them
+     */
+    struct Cursor {
+        uint32_t sector;             ///< Sector of the next record
+        uint32_t offset;             ///< Offset of the next record
+        uint32_t records;            ///< Unread records stepped over so far
+    };
+
+private:
+    MicroSafariFlashBackend* _flash; ///< Underlying flash region
+    uint32_t _baseAddress;           ///< First byte of the log inside the region
+    uint32_t _sectorCount;           ///< Number of sectors owned by the log
+    uint32_t _headSector;            ///< Sector currently being written
+    uint32_t _headOffset;            ///< Write offset inside the head sector
+    uint32_t _headSequence;          ///< Sequence number of the head sector
+    uint32_t _tailSector;            ///< Sector holding the oldest unread record
+    uint32_t _tailOffset;            ///< Offset of the oldest unread record
+    bool _ready;                     ///< Log mounted successfully
+
+    EvictionCallback _evictionCallback; ///< Called for unread records on overwrite
+    void* _evictionContext;          ///< User context for the eviction callback
+
+    MicroSafariFlashLogStats _stats; ///< Runtime statistics
+
+    /**
+     * @brief Internal method to get the flash address of a sector
+     */
+    uint32_t sectorAddress(uint32_t sector) const;
+
+    /**
+     * @brief Internal method to read and validate a sector header
+     * @param sector Sector index
+     * @param sequence Receives the sector sequence number
+     * @return true if header is valid, false otherwise
+     */
+    bool readSectorHeader(uint32_t sector, uint32_t& sequence);
+
+    /**
+     * @brief Internal method to erase a sector and stamp its header
+     */
+    bool formatSector(uint32_t sector, uint32_t sequence);
+
+    /**
+     * @brief Internal method to find the first free offset inside a sector
+     */
+    uint32_t findWriteOffset(uint32_t sector);
+
+    /**
+     * @brief Internal method to move the head into the next sector
+     */
+    bool advanceHead();
+
+    /**
+     * @brief Internal method to move the tail to the next unread record
+     * @return true if an unread record is available at the tail
+     */
+    bool seekTail();
+
+    /**
+     * @brief Internal method to pass unread records of a sector to the eviction callback
+     */
+    void evictSector(uint32_t sector, uint32_t offset);
+
+public:
+    /**
+     * @brief Constructor for MicroSafariFlashLog
+     */
+    MicroSafariFlashLog();
+
+    /**
+     * @brief Mount the log and locate head and tail
+     * @param flash Flash backend to use
+     * @param offset Sector-aligned start offset inside the backend (default: 0)
+     * @param length Bytes to use, 0 for the rest of the backend (default: 0)
+     * @return true if log mounted successfully, false otherwise
+     */
+    bool begin(MicroSafariFlashBackend* flash, uint32_t offset = 0, uint32_t length = 0);
+
+    /**
+     * @brief Append a record at the head of the log
+     * @param data Record payload
+     * @param length Payload length (1..MICROSAFARI_FLASH_MAX_RECORD_SIZE)
+     * @return true if record written, false otherwise
+     */
+    bool append(const void* data, uint16_t length);
+
+    /**
+     * @brief Read the oldest unread record without consuming it
+     * @param buffer Destination buffer
+     * @param bufferSize Size of destination buffer
+     * @param length Receives the record length
+     * @return true if a record was read, false if log is empty or buffer too small
+     */
+    bool peek(void* buffer, size_t bufferSize, uint16_t& length);
+
+    /**
+     * @brief Position a cursor at the oldest unread record
+     * @param cursor Cursor to initialize
+     * @return true if the log holds unread records
+     */
+    bool beginRead(Cursor& cursor);
+
+    /**
+     * @brief Read the record at a cursor and advance it
+     * 
+     * Records with a CRC mismatch are skipped but still counted in
+     * Cursor::records, so popping that many records afterwards consumes
+     * exactly what the cursor walked over.
+     * 
+     * @param cursor Cursor from beginRead
+     * @param buffer Destination buffer
+     * @param bufferSize Size of destination buffer
+     * @param length Receives the record length
+     * @return true if a record was read, false at the head or if buffer too small
+     */
+    bool readNext(Cursor& cursor, void* buffer, size_t bufferSize, uint16_t& length);
+
+    /**
+     * @brief Mark the oldest unread record as consumed
+     * @return true if a record was consumed, false if log is empty
+     */
+    bool pop();
+
+    /**
+     * @brief Check if the log holds unread records
+     * @return true if no unread records remain
+     */
+    bool isEmpty();
+
+    /**
+     * @brief Check if appending a record would overwrite unread records
+     * @param length Payload length of the next record
+     * @return true if the next append evicts the oldest sector
+     */
+    bool wouldEvict(uint16_t length);
+
+    /**
+     * @brief Erase all sectors and start an empty log
+     * @return true if successful, false otherwise
+     */
+    bool format();
+
+    /**
+     * @brief Set callback for unread records that are about to be overwritten
+     * @param callback Function pointer, nullptr to drop records silently
+     * @param context User context passed to the callback
+     */
+    void setEvictionCallback(EvictionCallback callback, void* context = nullptr);
+
+    /**
+     * @brief Get number of sectors owned by the log
+     * @return Sector count
+     */
+    uint32_t getSectorCount() const;
+
+    /**
+     * @brief Get approximate number of bytes between tail and head
+     * @return Used bytes, including headers and consumed records in partly read sectors
+     */
+    uint32_t getUsedBytes() const;
+
+    /**
+     * @brief Get ring log statistics
+     * @return Reference to statistics structure
+     */
+    const MicroSafariFlashLogStats& getStats() const;
+
+    /**
+     * @brief Reset ring log statistics
+     */
+    void resetStats();
+};
+
+#endif // MICROSAFARI_FLASH_LOG_H
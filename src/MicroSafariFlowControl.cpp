@@ -0,0 +1,121 @@
+/*!
+ * @file MicroSafariFlowControl.cpp
+ * @brief Implementation of MicroSafari ingest flow control
+ * @version 1.0.0
+ * @date 2025-08-22
+ */
+
+#include "MicroSafariFlowControl.h"
+
+/**
+ * @brief Constructor
+ */
+MicroSafariFlowControl::MicroSafariFlowControl()
+    : _serverSince(0), _holdUntil(0), _holding(false), _lastSend(0), _sent(false) {
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+/**
+ * @brief Apply server interval
+ */
+void MicroSafariFlowControl::setServerInterval(unsigned long intervalMs, unsigned long now) {
+    _stats.serverInterval = min(intervalMs, (unsigned long)MICROSAFARI_FLOW_MAX_INTERVAL_MS);
+    _serverSince = now;
+    _stats.budgets++;
+    // An explicit budget replaces the guesswork of AIMD
+    _stats.rate = 0;
+}
+
+/**
+ * @brief Hold ingest requests
+ */
+void MicroSafariFlowControl::holdFor(unsigned long delayMs, unsigned long now) {
+    _holdUntil = now + min(delayMs, (unsigned long)MICROSAFARI_FLOW_MAX_INTERVAL_MS);
+    _holding = true;
+    _stats.budgets++;
+}
+
+/**
+ * @brief Record overload without budget
+ */
+void MicroSafariFlowControl::onOverload() {
+    _stats.overloads++;
+    if (_stats.rate <= 0) {
+        _stats.rate = MICROSAFARI_FLOW_INITIAL_RATE;
+    } else {
+        _stats.rate = max(_stats.rate / 2, 60000.0f / MICROSAFARI_FLOW_MAX_INTERVAL_MS);
+    }
+}
+
+/**
+ * @brief Record accepted ingest request
+ */
+void MicroSafariFlowControl::onAccepted() {
+    if (_stats.rate <= 0) {
+        return;
+    }
+    _stats.rate += MICROSAFARI_FLOW_RATE_STEP;
+    if (_stats.rate >= MICROSAFARI_FLOW_RELEASE_RATE) {
+        _stats.rate = 0;
+    }
+}
+
+/**
+ * @brief Record ingest request being sent
+ */
+void MicroSafariFlowControl::onSend(unsigned long now) {
+    _lastSend = now;
+    _sent = true;
+}
+
+/**
+ * @brief Record deferred ingest request
+ */
+void MicroSafariFlowControl::onDeferred() {
+    _stats.deferred++;
+}
+
+/**
+ * @brief Get interval in force
+ */
+unsigned long MicroSafariFlowControl::getInterval(unsigned long now) const {
+    unsigned long interval = 0;
+    if (_stats.serverInterval > 0 && now - _serverSince < MICROSAFARI_FLOW_DECAY_MS) {
+        // Linear decay back to unthrottled unless the server renews the budget
+        float remaining = 1.0f - (float)(now - _serverSince) / MICROSAFARI_FLOW_DECAY_MS;
+        interval = _stats.serverInterval * remaining;
+    }
+    if (_stats.rate > 0) {
+        interval = max(interval, (unsigned long)(60000.0f / _stats.rate));
+    }
+    return interval;
+}
+
+/**
+ * @brief Get time until next ingest request
+ */
+unsigned long MicroSafariFlowControl::getWait(unsigned long now) const {
+    unsigned long wait = 0;
+    if (_holding && (long)(_holdUntil - now) > 0) {
+        wait = _holdUntil - now;
+    }
+    unsigned long interval = getInterval(now);
+    if (_sent && interval > 0 && now - _lastSend < interval) {
+        wait = max(wait, interval - (now - _lastSend));
+    }
+    return wait;
+}
+
+/**
+ * @brief Check if pacing is in force
+ */
+bool MicroSafariFlowControl::isActive(unsigned long now) const {
+    return getInterval(now) > 0 || (_holding && (long)(_holdUntil - now) > 0);
+}
+
+/**
+ * @brief Get state and counters
+ */
+const MicroSafariFlowStats& MicroSafariFlowControl::getStats() const {
+    return _stats;
+}
@@ -0,0 +1,146 @@
+/*!
+ * @file MicroSafariFlowControl.h
+ * @brief Server-driven flow control for ingest requests
+ * @version 1.0.0
+ * @date 2025-08-22
+ *
+ * When the platform is overloaded, devices that keep sending at their
+ * configured rate and retry every 503 multiply the load. The platform
+ * can instead hand out an ingest budget: an X-Ingest-Min-Interval
+ * header (milliseconds between ingest requests) on any answer, or a
+ * Retry-After header (seconds) on 429 and 503. A budget applies at once
+ * and decays linearly back to unthrottled over MICROSAFARI_FLOW_DECAY_MS
+ * unless the platform renews it.
+ *
+ * When a 429 or 503 carries neither header, the request rate follows
+ * AIMD: every overload halves it, every accepted request adds
+ * MICROSAFARI_FLOW_RATE_STEP requests per minute, and control ends once
+ * the rate reaches MICROSAFARI_FLOW_RELEASE_RATE.
+ *
+ * @section license License
+ * MIT License
+ */
+
+#ifndef MICROSAFARI_FLOW_CONTROL_H
+#define MICROSAFARI_FLOW_CONTROL_H
+
+#include <Arduino.h>
+
+/** @brief Time over which a server budget decays to nothing, in milliseconds */
+#ifndef MICROSAFARI_FLOW_DECAY_MS
+#define MICROSAFARI_FLOW_DECAY_MS 300000
+#endif
+
+/** @brief Longest interval between ingest requests, in milliseconds */
+#ifndef MICROSAFARI_FLOW_MAX_INTERVAL_MS
+#define MICROSAFARI_FLOW_MAX_INTERVAL_MS 600000
+#endif
+
+/** @brief Ingest requests per minute after the first overload without budget */
+#ifndef MICROSAFARI_FLOW_INITIAL_RATE
+#define MICROSAFARI_FLOW_INITIAL_RATE 6.0f
+#endif
+
+/** @brief Requests per minute added by every accepted request */
+#ifndef MICROSAFARI_FLOW_RATE_STEP
+#define MICROSAFARI_FLOW_RATE_STEP 1.0f
+#endif
+
+/** @brief Requests per minute at which AIMD control ends */
+#ifndef MICROSAFARI_FLOW_RELEASE_RATE
+#define MICROSAFARI_FLOW_RELEASE_RATE 60.0f
+#endif
+
+/**
+ * @brief Flow control state and counters
+ */
+struct MicroSafariFlowStats {
+    uint32_t budgets;                ///< Budgets received from the server
+    uint32_t overloads;              ///< 429 or 503 answers without budget (AIMD decreases)
+    uint32_t deferred;               ///< Ingest requests held back by the budget
+    float rate;                      ///< AIMD rate in requests per minute, 0 if inactive
+    unsigned long serverInterval;    ///< Last budget interval from the server in ms
+};
+
+/**
+ * @brief Ingest budget from server headers, AIMD otherwise
+ */
+class MicroSafariFlowControl {
+private:
+    MicroSafariFlowStats _stats;     ///< State and counters
+    unsigned long _serverSince;      ///< millis() when the server budget was set
+    unsigned long _holdUntil;        ///< millis() before which nothing may be sent (Retry-After)
+    bool _holding;                   ///< _holdUntil is set
+    unsigned long _lastSend;         ///< millis() of the last ingest request
+    bool _sent;                      ///< _lastSend is set
+
+public:
+    /**
+     * @brief Constructor for MicroSafariFlowControl
+     */
+    MicroSafariFlowControl();
+
+    /**
+     * @brief Apply a minimum interval announced by the server
+     * @param intervalMs Milliseconds between ingest requests, 0 to lift the budget
+     * @param now Current millis()
+     */
+    void setServerInterval(unsigned long intervalMs, unsigned long now);
+
+    /**
+     * @brief Hold all ingest requests for a while (Retry-After)
+     * @param delayMs Milliseconds to wait
+     * @param now Current millis()
+     */
+    void holdFor(unsigned long delayMs, unsigned long now);
+
+    /**
+     * @brief Record an overload answer without budget (multiplicative decrease)
+     */
+    void onOverload();
+
+    /**
+     * @brief Record an accepted ingest request (additive increase)
+     */
+    void onAccepted();
+
+    /**
+     * @brief Record that an ingest request is being sent
+     * @param now Current millis()
+     */
+    void onSend(unsigned long now);
+
+    /**
+     * @brief Record an ingest request held back by the budget
+     */
+    void onDeferred();
+
+    /**
+     * @brief Get the minimum interval between ingest requests now in force
+     * @param now Current millis()
+     * @return Interval in milliseconds, 0 if unthrottled
+     */
+    unsigned long getInterval(unsigned long now) const;
+
+    /**
+     * @brief Get the time until the next ingest request may go out
+     * @param now Current millis()
+     * @return Milliseconds to wait, 0 if a request may go out now
+     */
+    unsigned long getWait(unsigned long now) const;
+
+    /**
+     * @brief Check if any budget or backoff is in force
+     * @param now Current millis()
+     * @return true if ingest requests are paced
+     */
+    bool isActive(unsigned long now) const;
+
+    /**
+     * @brief Get state and counters
+     * @return Reference to the flow control statistics
+     */
+    const MicroSafariFlowStats& getStats() const;
+};
+
+#endif // MICROSAFARI_FLOW_CONTROL_H
@@ -0,0 +1,105 @@
+/*!
+ * @file MicroSafariLatency.cpp
+ * @brief Implementation of MicroSafari latency histograms
+ * @version 1.0.0
+ * @date 2025-08-22
+ */
+
+#include "MicroSafariLatency.h"
+
+/**
+ * @brief Constructor
+ */
+MicroSafariLatencyHistogram::MicroSafariLatencyHistogram() {
+    reset();
+}
+
+/**
+ * @brief Record duration
+ */
+void MicroSafariLatencyHistogram::record(uint32_t us) {
+    size_t bucket = us == 0 ? 0 : 32 - __builtin_clz(us);
+    _buckets[bucket]++;
+
+    if (_count == 0 || us < _min) {
+        _min = us;
+    }
+    if (us > _max) {
+        _max = us;
+    }
+    _sum += us;
+    _count++;
+}
+
+/**
+ * @brief Estimate percentile
+ */
+uint32_t MicroSafariLatencyHistogram::getPercentile(float percent) const {
+    if (_count == 0) {
+        return 0;
+    }
+
+    // Rank of the percentile, 1-based, rounded up
+    uint32_t rank = (uint32_t)((percent / 100.0f) * _count + 0.999f);
+    if (rank < 1) {
+        rank = 1;
+    } else if (rank > _count) {
+        rank = _count;
+    }
+
+    uint32_t seen = 0;
+    for (size_t bucket = 0; bucket < MICROSAFARI_LATENCY_BUCKETS; bucket++) {
+        seen += _buckets[bucket];
+        if (seen >= rank) {
+            uint32_t upper = bucket == 0 ? 0 : (bucket == 32 ? 0xFFFFFFFFUL : (1UL << bucket) - 1);
+            return upper < _max ? upper : _max;
+        }
+    }
+    return _max;
+}
+
+/**
+ * @brief Get value count
+ */
+uint32_t MicroSafariLatencyHistogram::getCount() const {
+    return _count;
+}
+
+/**
+ * @brief Get smallest value
+ */
+uint32_t MicroSafariLatencyHistogram::getMin() const {
+    return _min;
+}
+
+/**
+ * @brief Get largest value
+ */
+uint32_t MicroSafariLatencyHistogram::getMax() const {
+    return _max;
+}
+
+/**
+ * @brief Get mean value
+ */
+uint32_t MicroSafariLatencyHistogram::getMean() const {
+    return _count > 0 ? (uint32_t)(_sum / _count) : 0;
+}
+
+/**
+ * @brief Get bucket count
+ */
+uint32_t MicroSafariLatencyHistogram::getBucket(size_t bucket) const {
+    return bucket < MICROSAFARI_LATENCY_BUCKETS ? _buckets[bucket] : 0;
+}
+
+/**
+ * @brief Forget recorded values
+ */
+void MicroSafariLatencyHistogram::reset() {
+    memset(_buckets, 0, sizeof(_buckets));
+    _count = 0;
+    _min = 0;
+    _max = 0;
+    _sum = 0;
+}
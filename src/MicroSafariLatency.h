@@ -0,0 +1,121 @@
+/*!
+ * @file MicroSafariLatency.h
+ * @brief Command latency traces and histograms
+ * @version 1.0.0
+ * @date 2025-08-22
+ *
+ * Every command received from the platform carries a trace of when it
+ * was issued (if the platform says so), received, dispatched, finished
+ * and acknowledged. The trace travels back in the acknowledgment, and
+ * the stage durations are aggregated on the device into fixed-size
+ * log2 histograms, so percentiles are available without keeping
+ * individual samples.
+ *
+ * @section license License
+ * MIT License
+ */
+
+#ifndef MICROSAFARI_LATENCY_H
+#define MICROSAFARI_LATENCY_H
+
+#include <Arduino.h>
+
+/** @brief Buckets of a latency histogram: 0 and one per power of two up to 2^32 */
+#define MICROSAFARI_LATENCY_BUCKETS 33
+
+/**
+ * @brief Command latency stages
+ */
+enum MicroSafariLatencyStage {
+    MICROSAFARI_LATENCY_DELIVERY = 0, ///< Platform issue to receipt, needs issued_at and a set clock
+    MICROSAFARI_LATENCY_QUEUE = 1,    ///< Receipt to dispatch start
+    MICROSAFARI_LATENCY_EXECUTE = 2,  ///< Dispatch start to end (command handler)
+    MICROSAFARI_LATENCY_ACK = 3,      ///< Dispatch end to acknowledgment accepted
+    MICROSAFARI_LATENCY_TOTAL = 4,    ///< Receipt to acknowledgment accepted
+    MICROSAFARI_LATENCY_STAGE_COUNT
+};
+
+/**
+ * @brief Timestamps of one command on its way through the device
+ *
+ * Device timestamps are micros() values; only their differences are
+ * meaningful. issuedAt and receivedAt are Unix milliseconds and are 0
+ * when unknown.
+ */
+struct MicroSafariCommandTrace {
+    uint64_t issuedAt;               ///< Platform issue time in Unix milliseconds, 0 if not sent
+    uint64_t receivedAt;             ///< Receipt in Unix milliseconds, 0 if the clock is not set
+    uint32_t receivedUs;             ///< micros() when the poll response arrived
+    uint32_t dispatchStartUs;        ///< micros() before the command handler ran
+    uint32_t dispatchEndUs;          ///< micros() after the command handler returned
+    uint32_t ackSentUs;              ///< micros() when the acknowledgment was sent
+};
+
+/**
+ * @brief Log2 histogram of durations in microseconds
+ */
+class MicroSafariLatencyHistogram {
+private:
+    uint32_t _buckets[MICROSAFARI_LATENCY_BUCKETS]; ///< Bucket k counts values in [2^(k-1), 2^k)
+    uint32_t _count;                 ///< Recorded values
+    uint32_t _min;                   ///< Smallest recorded value
+    uint32_t _max;                   ///< Largest recorded value
+    uint64_t _sum;                   ///< Sum of recorded values
+
+public:
+    /**
+     * @brief Constructor for MicroSafariLatencyHistogram
+     */
+    MicroSafariLatencyHistogram();
+
+    /**
+     * @brief Record a duration
+     * @param us Duration in microseconds
+     */
+    void record(uint32_t us);
+
+    /**
+     * @brief Estimate a percentile
+     * @param percent Percentile between 0 and 100
+     * @return Upper bound of the bucket holding the percentile in microseconds, 0 if empty
+     */
+    uint32_t getPercentile(float percent) const;
+
+    /**
+     * @brief Get number of recorded values
+     * @return Value count
+     */
+    uint32_t getCount() const;
+
+    /**
+     * @brief Get smallest recorded value
+     * @return Microseconds, 0 if empty
+     */
+    uint32_t getMin() const;
+
+    /**
+     * @brief Get largest recorded value
+     * @return Microseconds
+     */
+    uint32_t getMax() const;
+
+    /**
+     * @brief Get mean of recorded values
+     * @return Microseconds, 0 if empty
+     */
+    uint32_t getMean() const;
+
+    /**
+     * @brief Get count of one bucket
+     * @param bucket Bucket index, 0 for 0 us and k for [2^(k-1), 2^k) us
+     * @return Values in the bucket
+     */
+    uint32_t getBucket(size_t bucket) const;
+
+    /**
+     * @brief Forget all recorded values
+     */
+    void reset();
+};
+
+#endif // MICROSAFARI_LATENCY_H
@@ -0,0 +1,175 @@
+/*!
+ * @file MicroSafariLinkController.cpp
+ * @brief Implementation of the MicroSafari link-quality controller
+ * @version 1.0.0
+ * @date 2025-08-22
+ */
+
+#include "MicroSafariLinkController.h"
+
+// Moving average weights of new samples
+#define LINK_RSSI_WEIGHT 0.2f
+#define LINK_RTT_WEIGHT 0.25f
+#define LINK_LOSS_WEIGHT 0.1f
+
+// Score thresholds; the gaps between entering and leaving a level are the hysteresis
+#define LINK_GOOD_ENTER 0.7f
+#define LINK_GOOD_LEAVE 0.6f
+#define LINK_POOR_ENTER 0.3f
+#define LINK_POOR_LEAVE 0.4f
+
+/**
+ * @brief Map value linearly to 0..1 between bad and good
+ */
+static float normalize(float value, float bad, float good) {
+    float score = (value - bad) / (good - bad);
+    return constrain(score, 0.0f, 1.0f);
+}
+
+/**
+ * @brief Constructor
+ */
+MicroSafariLinkController::MicroSafariLinkController() : _hasRssi(false), _hasRtt(false) {
+    memset(&_stats, 0, sizeof(_stats));
+    _stats.score = 0.5f;
+    _stats.level = MICROSAFARI_LINK_FAIR;
+}
+
+/**
+ * @brief Record RSSI sample
+ */
+void MicroSafariLinkController::addRssi(int rssi) {
+    if (!_hasRssi) {
+        _stats.rssi = rssi;
+        _hasRssi = true;
+    } else {
+        _stats.rssi += LINK_RSSI_WEIGHT * (rssi - _stats.rssi);
+    }
+}
+
+/**
+ * @brief Record request outcome
+ */
+void MicroSafariLinkController::addRequest(bool answered, uint32_t rttMs) {
+    _stats.requests++;
+    if (!answered) {
+        _stats.lost++;
+    }
+    _stats.loss += LINK_LOSS_WEIGHT * ((answered ? 0.0f : 1.0f) - _stats.loss);
+
+    if (answered && rttMs > 0) {
+        if (!_hasRtt) {
+            _stats.rttMs = rttMs;
+            _hasRtt = true;
+        } else {
+            _stats.rttMs += LINK_RTT_WEIGHT * (rttMs - _stats.rttMs);
+        }
+    }
+}
+
+/**
+ * @brief Recompute score and level
+ */
+bool MicroSafariLinkController::update(unsigned long now) {
+    // Components not measured yet do not count; loss is known from the start
+    float weighted = 0.3f * normalize(_stats.loss, 0.25f, 0.0f);
+    float weights = 0.3f;
+    if (_hasRssi) {
+        weighted += 0.4f * normalize(_stats.rssi, -90.0f, -55.0f);
+        weights += 0.4f;
+    }
+    if (_hasRtt) {
+        weighted += 0.3f * normalize(_stats.rttMs, 2000.0f, 200.0f);
+        weights += 0.3f;
+    }
+    _stats.score = weighted / weights;
+
+    MicroSafariLinkLevel level = _stats.level;
+    if (level == MICROSAFARI_LINK_GOOD) {
+        if (_stats.score < LINK_GOOD_LEAVE) {
+            level = _stats.score <= LINK_POOR_ENTER ? MICROSAFARI_LINK_POOR : MICROSAFARI_LINK_FAIR;
+        }
+    } else if (level == MICROSAFARI_LINK_POOR) {
+        if (_stats.score > LINK_POOR_LEAVE) {
+            level = _stats.score >= LINK_GOOD_ENTER ? MICROSAFARI_LINK_GOOD : MICROSAFARI_LINK_FAIR;
+        }
+    } else if (_stats.score >= LINK_GOOD_ENTER) {
+        level = MICROSAFARI_LINK_GOOD;
+    } else if (_stats.score <= LINK_POOR_ENTER) {
+        level = MICROSAFARI_LINK_POOR;
+    }
+
+    if (level == _stats.level || now - _stats.lastDecision < MICROSAFARI_LINK_DWELL_MS) {
+        return false;
+    }
+    _stats.level = level;
+    _stats.lastDecision = now;
+    _stats.decisions++;
+    return true;
+}
+
+/**
+ * @brief Get current level
+ */
+MicroSafariLinkLevel MicroSafariLinkController::getLevel() const {
+    return _stats.level;
+}
+
+/**
+ * @brief Get batch size for current level
+ */
+size_t MicroSafariLinkController::getBatchSize(size_t base, size_t maxSize) const {
+    if (_stats.level == MICROSAFARI_LINK_GOOD) {
+        return max(base / 2, (size_t)1);
+    }
+    if (_stats.level == MICROSAFARI_LINK_POOR) {
+        return min(base * 2, maxSize);
+    }
+    return base;
+}
+
+/**
+ * @brief Get batch interval for current level
+ */
+unsigned long MicroSafariLinkController::getBatchInterval(unsigned long base) const {
+    if (_stats.level == MICROSAFARI_LINK_GOOD) {
+        return base / 2;
+    }
+    if (_stats.level == MICROSAFARI_LINK_POOR) {
+        return base * 2;
+    }
+    return base;
+}
+
+/**
+ * @brief Get estimate and counters
+ */
+const MicroSafariLinkStats& MicroSafariLinkController::getStats() const {
+    return _stats;
+}
+
+/**
+ * @brief Write estimate into payload
+ */
+void MicroSafariLinkController::populate(JsonObject& payload) const {
+    payload["link_level"] = getLevelName(_stats.level);
+    payload["link_score"] = _stats.score;
+    if (_hasRssi) {
+        payload["link_rssi"] = _stats.rssi;
+    }
+    if (_hasRtt) {
+        payload["link_rtt_ms"] = _stats.rttMs;
+    }
+    payload["link_loss"] = _stats.loss;
+}
+
+/**
+ * @brief Get name of level
+ */
+const char* MicroSafariLinkController::getLevelName(MicroSafariLinkLevel level) {
+    switch (level) {
+        case MICROSAFARI_LINK_POOR: return "poor";
+        case MICROSAFARI_LINK_GOOD: return "good";
+        default: return "fair";
+    }
+}
@@ -0,0 +1,137 @@
+/*!
+ * @file MicroSafariLinkController.h
+ * @brief Link-quality estimate driving batch size and cadence
+ * @version 1.0.0
+ * @date 2025-08-22
+ *
+ * Every transmission costs radio time, protocol overhead and, on a weak
+ * link, retries. MicroSafariLinkController keeps moving averages of the
+ * WiFi RSSI, of the round-trip time of requests on open connections and
+ * of the share of requests that got no answer, and combines them into a
+ * score between 0 (unusable) and 1 (excellent).
+ *
+ * The score is mapped to three levels with hysteresis and a minimum
+ * dwell time, so a single bad reading does not flip the batching. On a
+ * poor link batches grow and their interval stretches (fewer, larger
+ * transmissions); on a good link both shrink for fresher data.
+ *
+ * @section license License
+ * MIT License
+ */
+
+#ifndef MICROSAFARI_LINK_CONTROLLER_H
+#define MICROSAFARI_LINK_CONTROLLER_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+/** @brief Shortest time between two level changes in milliseconds */
+#ifndef MICROSAFARI_LINK_DWELL_MS
+#define MICROSAFARI_LINK_DWELL_MS 60000
+#endif
+
+/**
+ * @brief Link quality level
+ */
+enum MicroSafariLinkLevel {
+    MICROSAFARI_LINK_POOR = 0,       ///< Larger batches, longer interval
+    MICROSAFARI_LINK_FAIR = 1,       ///< Configured batch size and interval
+    MICROSAFARI_LINK_GOOD = 2        ///< Smaller batches, shorter interval
+};
+
+/**
+ * @brief Link quality estimate
+ */
+struct MicroSafariLinkStats {
+    float rssi;                      ///< RSSI moving average in dBm, 0 before the first sample
+    float rttMs;                     ///< Round-trip moving average in ms, 0 before the first sample
+    float loss;                      ///< Moving average of requests without answer, 0 to 1
+    float score;                     ///< Combined score, 0 (unusable) to 1 (excellent)
+    MicroSafariLinkLevel level;      ///< Current level
+    uint32_t requests;               ///< Requests recorded
+    uint32_t lost;                   ///< Requests without answer
+    uint32_t decisions;              ///< Level changes
+    unsigned long lastDecision;      ///< millis() of the last level change
+};
+
+/**
+ * @brief Link-quality controller for adaptive batching
+ */
+class MicroSafariLinkController {
+private:
+    MicroSafariLinkStats _stats;     ///< Estimate and counters
+    bool _hasRssi;                   ///< At least one RSSI sample recorded
+    bool _hasRtt;                    ///< At least one round trip recorded
+
+public:
+    /**
+     * @brief Constructor for MicroSafariLinkController
+     */
+    MicroSafariLinkController();
+
+    /**
+     * @brief Record an RSSI sample
+     * @param rssi Signal strength in dBm
+     */
+    void addRssi(int rssi);
+
+    /**
+     * @brief Record the outcome of a request
+     * @param answered true if the server answered, whatever the status
+     * @param rttMs Round-trip time on an open connection, 0 if not measured
+     */
+    void addRequest(bool answered, uint32_t rttMs);
+
+    /**
+     * @brief Recompute the score and decide the level
+     * @param now Current millis()
+     * @return true if the level changed
+     */
+    bool update(unsigned long now);
+
+    /**
+     * @brief Get the current level
+     * @return Link quality level
+     */
+    MicroSafariLinkLevel getLevel() const;
+
+    /**
+     * @brief Get batch size for the current level
+     * @param base Configured batch size
+     * @param maxSize Largest allowed batch size
+     * @return Half the size on a good link, twice on a poor one
+     */
+    size_t getBatchSize(size_t base, size_t maxSize) const;
+
+    /**
+     * @brief Get batch interval for the current level
+     * @param base Configured batch interval in milliseconds
+     * @return Half the interval on a good link, twice on a poor one
+     */
+    unsigned long getBatchInterval(unsigned long base) const;
+
+    /**
+     * @brief Get the estimate and counters
+     * @return Reference to the link statistics
+     */
+    const MicroSafariLinkStats& getStats() const;
+
+    /**
+     * @brief Write the estimate into a payload
+     *
+     * Keys are link_level, link_score, link_rssi, link_rtt_ms and
+     * link_loss; RSSI and RTT only once measured.
+     *
+     * @param payload JSON object to populate
+     */
+    void populate(JsonObject& payload) const;
+
+    /**
+     * @brief Get the name of a level
+     * @param level Link quality level
+     * @return "poor", "fair" or "good"
+     */
+    static const char* getLevelName(MicroSafariLinkLevel level);
+};
+
+#endif // MICROSAFARI_LINK_CONTROLLER_H
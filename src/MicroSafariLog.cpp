@@ -0,0 +1,229 @@
+/*!
+ * @file MicroSafariLog.cpp
+ * @brief Implementation of the MicroSafari asynchronous debug log
+ * @version 1.0.0
+ * @date 2025-08-22
+ */
+
+#include "MicroSafariLog.h"
+
+/** @brief Record header: 16-bit text length and 32-bit millis() timestamp */
+#define MICROSAFARI_LOG_HEADER 6
+
+/**
+ * @brief Constructor
+ */
+MicroSafariLog::MicroSafariLog()
+    : _head(0), _tail(0), _written(0), _dropped(0), _drained(0), _datagrams(0), _highWater(0),
+      _sinks(MICROSAFARI_LOG_SERIAL), _task(nullptr), _running(false), _syslogPort(514), _syslogResolved(false) {
+    _syslogHost[0] = '\0';
+    strcpy(_hostname, "microsafari");
+}
+
+/**
+ * @brief Destructor
+ */
+MicroSafariLog::~MicroSafariLog() {
+    end();
+}
+
+/**
+ * @brief Start drain task
+ */
+bool MicroSafariLog::begin(uint8_t sinks, UBaseType_t priority) {
+    _sinks = sinks;
+    if (_task != nullptr) {
+        return true;
+    }
+    _running = true;
+    if (xTaskCreate(drainTask, "msafari_log", MICROSAFARI_LOG_TASK_STACK, this, priority, &_task) != pdPASS) {
+        _running = false;
+        _task = nullptr;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Drain remaining records and stop task
+ */
+void MicroSafariLog::end() {
+    if (_task == nullptr) {
+        return;
+    }
+    _running = false;
+    xTaskNotifyGive(_task);
+    // The task drains once more, clears _task and deletes itself
+    while (_task != nullptr) {
+        delay(1);
+    }
+}
+
+/**
+ * @brief Check if drain task is running
+ */
+bool MicroSafariLog::isRunning() const {
+    return _task != nullptr;
+}
+
+/**
+ * @brief Set syslog collector
+ */
+void MicroSafariLog::setSyslog(const char* host, uint16_t port, const char* hostname) {
+    strncpy(_syslogHost, host, sizeof(_syslogHost) - 1);
+    _syslogHost[sizeof(_syslogHost) - 1] = '\0';
+    strncpy(_hostname, hostname, sizeof(_hostname) - 1);
+    _hostname[sizeof(_hostname) - 1] = '\0';
+    _syslogPort = port;
+    _syslogResolved = false;
+}
+
+/**
+ * @brief Copy bytes into ring
+ */
+void MicroSafariLog::copyIn(uint32_t position, const void* data, size_t length) {
+    size_t offset = position & (MICROSAFARI_LOG_RING_SIZE - 1);
+    size_t first = min(length, (size_t)MICROSAFARI_LOG_RING_SIZE - offset);
+    memcpy(_ring + offset, data, first);
+    memcpy(_ring, (const uint8_t*)data + first, length - first);
+}
+
+/**
+ * @brief Copy bytes out of ring
+ */
+void MicroSafariLog::copyOut(uint32_t position, void* data, size_t length) const {
+    size_t offset = position & (MICROSAFARI_LOG_RING_SIZE - 1);
+    size_t first = min(length, (size_t)MICROSAFARI_LOG_RING_SIZE - offset);
+    memcpy(data, _ring + offset, first);
+    memcpy((uint8_t*)data + first, _ring, length - first);
+}
+
+/**
+ * @brief Add record without blocking
+ */
+bool MicroSafariLog::write(const char* text, size_t length) {
+    uint16_t size = min(length, (size_t)MICROSAFARI_LOG_MAX_RECORD);
+    uint32_t head = _head.load(std::memory_order_relaxed);
+    uint32_t tail = _tail.load(std::memory_order_acquire);
+
+    if (MICROSAFARI_LOG_RING_SIZE - (head - tail) < (uint32_t)(MICROSAFARI_LOG_HEADER + size)) {
+        // Only the producer writes the counter, so no read-modify-write is needed
+        _dropped.store(_dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return false;
+    }
+
+    uint32_t timestamp = millis();
+    copyIn(head, &size, sizeof(size));
+    copyIn(head + sizeof(size), &timestamp, sizeof(timestamp));
+    copyIn(head + MICROSAFARI_LOG_HEADER, text, size);
+    _head.store(head + MICROSAFARI_LOG_HEADER + size, std::memory_order_release);
+    _written.store(_written.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+    // Wake the drain task early once the ring is half full
+    if (_task != nullptr && head - tail + MICROSAFARI_LOG_HEADER + size >= MICROSAFARI_LOG_RING_SIZE / 2) {
+        xTaskNotifyGive(_task);
+    }
+    return true;
+}
+
+/**
+ * @brief Add String record without blocking
+ */
+bool MicroSafariLog::write(const String& text) {
+    return write(text.c_str(), text.length());
+}
+
+/**
+ * @brief Send record to syslog
+ */
+void MicroSafariLog::sendSyslog(const char* text, size_t length, uint32_t timestamp) {
+    if (_syslogHost[0] == '\0' || WiFi.status() != WL_CONNECTED) {
+        return;
+    }
+    if (!_syslogResolved) {
+        _syslogResolved = WiFi.hostByName(_syslogHost, _syslogAddress) == 1;
+        if (!_syslogResolved) {
+            return;
+        }
+    }
+
+    // RFC 5424 with facility user and severity debug; the device clock may be unset, so no TIMESTAMP
+    char header[MICROSAFARI_LOG_HOST_LENGTH + 48];
+    int headerLength = snprintf(header, sizeof(header), "<15>1 - %s microsafari - - [uptime ms=\"%lu\"] ",
+                                _hostname, (unsigned long)timestamp);
+    if (!_udp.beginPacket(_syslogAddress, _syslogPort)) {
+        _syslogResolved = false;
+        return;
+    }
+    _udp.write((const uint8_t*)header, headerLength);
+    _udp.write((const uint8_t*)text, length);
+    if (_udp.endPacket()) {
+        _datagrams++;
+    } else {
+        _syslogResolved = false; // Resolve again in case the collector moved
+    }
+}
+
+/**
+ * @brief Write waiting records to sinks
+ */
+size_t MicroSafariLog::drain() {
+    char text[MICROSAFARI_LOG_MAX_RECORD];
+    size_t count = 0;
+    uint32_t tail = _tail.load(std::memory_order_relaxed);
+    uint32_t head = _head.load(std::memory_order_acquire);
+
+    if (head - tail > _highWater) {
+        _highWater = head - tail;
+    }
+    while (tail != head) {
+        uint16_t size;
+        uint32_t timestamp;
+        copyOut(tail, &size, sizeof(size));
+        copyOut(tail + sizeof(size), &timestamp, sizeof(timestamp));
+        copyOut(tail + MICROSAFARI_LOG_HEADER, text, size);
+        // Free the slot before the slow sinks run, so the producer can reuse it
+        tail += MICROSAFARI_LOG_HEADER + size;
+        _tail.store(tail, std::memory_order_release);
+
+        if (_sinks & MICROSAFARI_LOG_SERIAL) {
+            Serial.print("[MicroSafari] ");
+            Serial.write((const uint8_t*)text, size);
+            Serial.println();
+        }
+        if (_sinks & MICROSAFARI_LOG_SYSLOG) {
+            sendSyslog(text, size, timestamp);
+        }
+        count++;
+        head = _head.load(std::memory_order_acquire);
+    }
+    _drained += count;
+    return count;
+}
+
+/**
+ * @brief Drain task loop
+ */
+void MicroSafariLog::drainTask(void* arg) {
+    MicroSafariLog* log = static_cast<MicroSafariLog*>(arg);
+    while (log->_running) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(MICROSAFARI_LOG_FLUSH_MS));
+        log->drain();
+    }
+    log->drain();
+    log->_task = nullptr;
+    vTaskDelete(nullptr);
+}
+
+/**
+ * @brief Get ring statistics
+ */
+MicroSafariLogStats MicroSafariLog::getStats() const {
+    MicroSafariLogStats stats;
+    stats.written = _written.load(std::memory_order_relaxed);
+    stats.dropped = _dropped.load(std::memory_order_relaxed);
+    stats.drained = _drained;
+    stats.datagrams = _datagrams;
+    stats.highWater = _highWater;
+    return stats;
+}
@@ -0,0 +1,189 @@
+/*!
+ * @file MicroSafariLog.h
+ * @brief Asynchronous debug log drained by a background task
+ * @version 1.0.0
+ * @date 2025-08-22
+ *
+ * Debug output written straight to Serial blocks the caller once the
+ * UART buffer is full: at 115200 baud a single request with debug
+ * enabled can stall the loop for tens of milliseconds. MicroSafariLog
+ * copies each record into a lock-free byte ring instead and returns. A
+ * low-priority task drains the ring to Serial, to a UDP syslog
+ * collector (RFC 5424), or to both.
+ *
+ * The ring has a single producer and a single consumer: records must
+ * come from one task, normally the one running MicroSafari::loop().
+ * When the ring is full, records are dropped and counted rather than
+ * waited for, so logging never blocks the producer.
+ *
+ * @section license License
+ * MIT License
+ */
+
+#ifndef MICROSAFARI_LOG_H
+#define MICROSAFARI_LOG_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <WiFiUdp.h>
+#include <atomic>
+
+#ifndef MICROSAFARI_LOG_RING_SIZE
+#define MICROSAFARI_LOG_RING_SIZE 4096
+#endif
+
+#if (MICROSAFARI_LOG_RING_SIZE & (MICROSAFARI_LOG_RING_SIZE - 1)) != 0
+#error "MICROSAFARI_LOG_RING_SIZE must be a power of two"
+#endif
+
+/** @brief Longest record text; longer records are truncated */
+#ifndef MICROSAFARI_LOG_MAX_RECORD
+#define MICROSAFARI_LOG_MAX_RECORD 256
+#endif
+
+/** @brief Stack of the drain task in bytes */
+#ifndef MICROSAFARI_LOG_TASK_STACK
+#define MICROSAFARI_LOG_TASK_STACK 3072
+#endif
+
+/** @brief Longest time a record waits in the ring, in milliseconds */
+#ifndef MICROSAFARI_LOG_FLUSH_MS
+#define MICROSAFARI_LOG_FLUSH_MS 100
+#endif
+
+/** @brief Maximum syslog host name length, including terminator */
+#define MICROSAFARI_LOG_HOST_LENGTH 64
+
+/**
+ * @brief Log sinks, combinable as a bit mask
+ */
+enum MicroSafariLogSink {
+    MICROSAFARI_LOG_SERIAL = 1,      ///< Serial, prefixed with "[MicroSafari]"
+    MICROSAFARI_LOG_SYSLOG = 2       ///< UDP syslog, see setSyslog()
+};
+
+/**
+ * @brief Log ring statistics
+ */
+struct MicroSafariLogStats {
+    uint32_t written;                ///< Records accepted by the ring
+    uint32_t dropped;                ///< Records rejected because the ring was full
+    uint32_t drained;                ///< Records written to the sinks
+    uint32_t datagrams;              ///< Syslog datagrams sent
+    uint32_t highWater;              ///< Largest ring fill in bytes seen by the drain task
+};
+
+/**
+ * @brief Lock-free log ring with a background drain task
+ */
+class MicroSafariLog {
+private:
+    uint8_t _ring[MICROSAFARI_LOG_RING_SIZE]; ///< Length-prefixed records
+    std::atomic<uint32_t> _head;     ///< Next byte to write, owned by the producer
+    std::atomic<uint32_t> _tail;     ///< Next byte to read, owned by the drain task
+    std::atomic<uint32_t> _written;  ///< Records accepted, written by the producer only
+    std::atomic<uint32_t> _dropped;  ///< Records rejected, written by the producer only
+    uint32_t _drained;               ///< Records drained, drain task only
+    uint32_t _datagrams;             ///< Syslog datagrams sent, drain task only
+    uint32_t _highWater;             ///< Largest fill seen by the drain task
+    uint8_t _sinks;                  ///< MicroSafariLogSink bit mask
+    TaskHandle_t _task;              ///< Drain task, nullptr if not running
+    std::atomic<bool> _running;      ///< Cleared to stop the drain task
+    WiFiUDP _udp;                    ///< Syslog socket
+    char _syslogHost[MICROSAFARI_LOG_HOST_LENGTH]; ///< Syslog collector, empty if none
+    uint16_t _syslogPort;            ///< Syslog collector port
+    IPAddress _syslogAddress;        ///< Resolved collector address
+    bool _syslogResolved;            ///< _syslogAddress is valid
+    char _hostname[MICROSAFARI_LOG_HOST_LENGTH]; ///< HOSTNAME field of syslog messages
+
+    /**
+     * @brief Internal method to copy bytes into the ring at a position
+     */
+    void copyIn(uint32_t position, const void* data, size_t length);
+
+    /**
+     * @brief Internal method to copy bytes out of the ring at a position
+     */
+    void copyOut(uint32_t position, void* data, size_t length) const;
+
+    /**
+     * @brief Internal method to send one record to syslog
+     */
+    void sendSyslog(const char* text, size_t length, uint32_t timestamp);
+
+    /**
+     * @brief Drain task entry point
+     */
+    static void drainTask(void* arg);
+
+public:
+    /**
+     * @brief Constructor for MicroSafariLog
+     */
+    MicroSafariLog();
+
+    /**
+     * @brief Destructor, stops the drain task
+     */
+    ~MicroSafariLog();
+
+    /**
+     * @brief Start the drain task
+     * @param sinks MicroSafariLogSink bit mask (default: MICROSAFARI_LOG_SERIAL)
+     * @param priority Task priority (default: 1, just above idle)
+     * @return true if running, false if the task could not be created
+     */
+    bool begin(uint8_t sinks = MICROSAFARI_LOG_SERIAL, UBaseType_t priority = 1);
+
+    /**
+     * @brief Drain what is left and stop the drain task
+     */
+    void end();
+
+    /**
+     * @brief Check if the drain task is running
+     * @return true if records are drained in the background
+     */
+    bool isRunning() const;
+
+    /**
+     * @brief Set the syslog collector for MICROSAFARI_LOG_SYSLOG
+     * @param host Collector host name or IP address
+     * @param port Collector UDP port (default: 514)
+     * @param hostname HOSTNAME field, e.g. the device name (default: "microsafari")
+     */
+    void setSyslog(const char* host, uint16_t port = 514, const char* hostname = "microsafari");
+
+    /**
+     * @brief Add a record without blocking
+     * @param text Record text, truncated to MICROSAFARI_LOG_MAX_RECORD
+     * @param length Text length in bytes
+     * @return true if stored, false if the ring was full
+     */
+    bool write(const char* text, size_t length);
+
+    /**
+     * @brief Add a record without blocking
+     * @param text Record text
+     * @return true if stored, false if the ring was full
+     */
+    bool write(const String& text);
+
+    /**
+     * @brief Write waiting records to the sinks
+     *
+     * Called by the drain task; call it directly only when the task is
+     * not running, from the producer task.
+     *
+     * @return Number of records drained
+     */
+    size_t drain();
+
+    /**
+     * @brief Get ring statistics
+     * @return Statistics snapshot
+     */
+    MicroSafariLogStats getStats() const;
+};
+
+#endif // MICROSAFARI_LOG_H
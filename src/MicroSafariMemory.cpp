@@ -0,0 +1,159 @@
+/*!
+ * @file MicroSafariMemory.cpp
+ * @brief Implementation of MicroSafari memory budget probes
+ * @version 1.0.0
+ * @date 2025-08-22
+ */
+
+#include "MicroSafariMemory.h"
+#include "MicroSafari.h"
+#include "MicroSafariChannel.h"
+
+#if MICROSAFARI_MEMORY_PROBES && defined(CONFIG_HEAP_USE_HOOKS)
+#include <esp_heap_caps.h>
+#endif
+
+/** @brief RAM budget of a MicroSafari instance with the default configuration, checked on 32-bit targets */
+#ifndef MICROSAFARI_INSTANCE_BUDGET
+#define MICROSAFARI_INSTANCE_BUDGET 10240
+#endif
+
+// Size budgets of the core structs. Records stored in flash or NVS must
+// keep their exact size, otherwise data written by older firmware is lost.
+static_assert(sizeof(MicroSafariRetentionRecord) == 36, "MicroSafariRetentionRecord is stored in flash; its size must not change");
+static_assert(sizeof(MicroSafariRule) == 100, "MicroSafariRule is stored in NVS; its size must not change");
+static_assert(sizeof(MicroSafariScheduledCommand) == 72, "MicroSafariScheduledCommand is stored in NVS; its size must not change");
+static_assert(sizeof(MicroSafariCaptureSample) <= 12, "MicroSafariCaptureSample grew; every ring slot pays for it");
+static_assert(sizeof(MicroSafariSample) <= 4, "MicroSafariSample grew; every acquisition read chunk pays for it");
+static_assert(sizeof(MicroSafariRuleEvent) <= 16, "MicroSafariRuleEvent grew past its budget");
+static_assert(sizeof(MicroSafariCommandAck) <= 16, "MicroSafariCommandAck grew past its budget");
+static_assert(sizeof(MicroSafariCommandTrace) <= 32, "MicroSafariCommandTrace grew past its budget");
+static_assert(sizeof(void*) != 4 || sizeof(MicroSafariReading) <= 8, "MicroSafariReading grew; every cache slot pays for it");
+static_assert(sizeof(void*) != 4 || sizeof(MicroSafariChannel) <= 128, "MicroSafariChannel grew past its budget");
+static_assert(sizeof(void*) != 4 || sizeof(MicroSafari) <= MICROSAFARI_INSTANCE_BUDGET,
+              "MicroSafari grew past MICROSAFARI_INSTANCE_BUDGET; raise it if the configuration was enlarged on purpose");
+
+static const char* API_NAMES[MICROSAFARI_API_COUNT] = {
+    "begin",
+    "connectWiFi",
+    "testConnection",
+    "sendSensorData",
+    "sendRawData",
+    "sendCachedSensorData",
+    "sendCustomData",
+    "sendHeartbeat",
+    "pollCommands",
+    "flushBatch",
+    "fetchRemoteConfig",
+    "syncShadow",
+    "drainRetention",
+    "loop"
+};
+
+/**
+ * @brief Get name of public operation
+ */
+const char* microSafariApiName(MicroSafariApi api) {
+    return api < MICROSAFARI_API_COUNT ? API_NAMES[api] : "unknown";
+}
+
+#if MICROSAFARI_MEMORY_PROBES
+
+// Innermost probe; the library runs in one task, so a plain pointer suffices
+static MicroSafariMemoryProbe* s_activeProbe = nullptr;
+
+/**
+ * @brief Get free stack below the caller's frame
+ */
+static uint32_t freeStackHere(TaskHandle_t task) {
+    // Stacks grow down from the end of the block that starts at the stack start
+    const uint8_t* start = (const uint8_t*)pxTaskGetStackStart(task);
+    const uint8_t* frame = (const uint8_t*)__builtin_frame_address(0);
+    return frame > start ? frame - start : 0;
+}
+
+/**
+ * @brief Start measuring
+ */
+MicroSafariMemoryProbe::MicroSafariMemoryProbe(MicroSafariMemoryStats& stats) : _stats(stats) {
+    _parent = s_activeProbe;
+    _task = xTaskGetCurrentTaskHandle();
+    _freeAtEntry = ESP.getFreeHeap();
+    _lowWaterAtEntry = ESP.getMinFreeHeap();
+    _lowestFree = _freeAtEntry;
+    _largestBlock = 0;
+    _stackAtEntry = freeStackHere(_task);
+    _stackMarkAtEntry = uxTaskGetStackHighWaterMark(_task);
+    s_activeProbe = this;
+}
+
+/**
+ * @brief Stop measuring and update statistics
+ */
+MicroSafariMemoryProbe::~MicroSafariMemoryProbe() {
+    s_activeProbe = _parent;
+
+    uint32_t freeAfter = ESP.getFreeHeap();
+    uint32_t lowWater = ESP.getMinFreeHeap();
+    uint32_t stackMark = uxTaskGetStackHighWaterMark(_task);
+
+    // A lower low-water mark was set during this call, so it is this call's minimum
+    uint32_t lowest = min(_lowestFree, freeAfter);
+    if (lowWater < _lowWaterAtEntry && lowWater < lowest) {
+        lowest = lowWater;
+    }
+
+    uint32_t heapPeak = _freeAtEntry - lowest;
+    if (heapPeak > _stats.heapPeak) {
+        _stats.heapPeak = heapPeak;
+    }
+    _stats.heapRetained = (int32_t)(_freeAtEntry - freeAfter);
+    if (_largestBlock > _stats.largestBlock) {
+        _stats.largestBlock = _largestBlock;
+    }
+
+    // Same for the stack: only a new high-water mark tells how deep this call went
+    if (stackMark < _stackMarkAtEntry && _stackAtEntry > stackMark && _stackAtEntry - stackMark > _stats.stackPeak) {
+        _stats.stackPeak = _stackAtEntry - stackMark;
+    }
+    if (_stats.calls == 0 || stackMark < _stats.stackHighWater) {
+        _stats.stackHighWater = stackMark;
+    }
+    _stats.calls++;
+
+    if (_parent != nullptr) {
+        _parent->_lowestFree = min(_parent->_lowestFree, lowest);
+        _parent->_largestBlock = max(_parent->_largestBlock, _largestBlock);
+    }
+}
+
+/**
+ * @brief Record allocation of measured task
+ */
+void MicroSafariMemoryProbe::noteBlock(size_t size) {
+    MicroSafariMemoryProbe* probe = s_activeProbe;
+    if (probe == nullptr || xTaskGetCurrentTaskHandle() != probe->_task) {
+        return;
+    }
+
+    if (size > probe->_largestBlock) {
+        probe->_largestBlock = size;
+    }
+    uint32_t freeNow = ESP.getFreeHeap();
+    if (freeNow < probe->_lowestFree) {
+        probe->_lowestFree = freeNow;
+    }
+}
+
+#ifdef CONFIG_HEAP_USE_HOOKS
+/**
+ * @brief Allocation hook of the ESP-IDF heap, called for every successful allocation
+ */
+extern "C" void esp_heap_trace_alloc_hook(void* ptr, size_t size, uint32_t caps) {
+    if (ptr != nullptr && (caps & MALLOC_CAP_8BIT)) {
+        MicroSafariMemoryProbe::noteBlock(size);
+    }
+}
+#endif
+
+#endif // MICROSAFARI_MEMORY_PROBES
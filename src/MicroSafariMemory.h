@@ -0,0 +1,123 @@
+/*!
+ * @file MicroSafariMemory.h
+ * @brief Memory budget probes for the public API
+ * @version 1.0.0
+ * @date 2025-08-22
+ *
+ * Every public MicroSafari operation that talks to the platform runs
+ * under a MicroSafariMemoryProbe, which records how far the call drove
+ * the heap below its level at entry, the largest block it needed and
+ * how deep it went into the calling task's stack. The numbers are
+ * collected per API, so a production build can be sized from the
+ * figures of a test run instead of by trial and error.
+ *
+ * Heap and stack depth are exact whenever the call set a new low-water
+ * mark of the heap or of the task stack; otherwise the call stayed
+ * within a depth already reached and the last measurement stands. With
+ * CONFIG_HEAP_USE_HOOKS enabled in the core's sdkconfig, every
+ * allocation is observed and both heap figures are always exact.
+ * Without it, the largest block covers HTTP request and response bodies.
+ *
+ * Define MICROSAFARI_MEMORY_PROBES as 0 to compile the probes out.
+ *
+ * @section license License
+ * MIT License
+ */
+
+#ifndef MICROSAFARI_MEMORY_H
+#define MICROSAFARI_MEMORY_H
+
+#include <Arduino.h>
+
+#ifndef MICROSAFARI_MEMORY_PROBES
+#define MICROSAFARI_MEMORY_PROBES 1
+#endif
+
+/**
+ * @brief Public operations with a memory probe
+ */
+enum MicroSafariApi {
+    MICROSAFARI_API_BEGIN = 0,
+    MICROSAFARI_API_CONNECT_WIFI,
+    MICROSAFARI_API_TEST_CONNECTION,
+    MICROSAFARI_API_SEND_SENSOR_DATA,
+    MICROSAFARI_API_SEND_RAW_DATA,
+    MICROSAFARI_API_SEND_CACHED_SENSOR_DATA,
+    MICROSAFARI_API_SEND_CUSTOM_DATA,
+    MICROSAFARI_API_SEND_HEARTBEAT,
+    MICROSAFARI_API_POLL_COMMANDS,
+    MICROSAFARI_API_FLUSH_BATCH,
+    MICROSAFARI_API_FETCH_REMOTE_CONFIG,
+    MICROSAFARI_API_SYNC_SHADOW,
+    MICROSAFARI_API_DRAIN_RETENTION,
+    MICROSAFARI_API_LOOP,
+    MICROSAFARI_API_COUNT
+};
+
+/**
+ * @brief Memory use of one public operation
+ */
+struct MicroSafariMemoryStats {
+    uint32_t calls;                  ///< Calls measured
+    uint32_t heapPeak;               ///< Largest heap drop below the free heap at entry
+    int32_t heapRetained;            ///< Heap still held after the last call, negative if freed
+    uint32_t largestBlock;           ///< Largest single allocation observed during a call
+    uint32_t stackPeak;              ///< Deepest stack use below the caller's frame
+    uint32_t stackHighWater;         ///< Least free stack of the calling task after a call
+};
+
+/**
+ * @brief Get the name of a public operation
+ * @param api Operation
+ * @return Method name, e.g. "sendSensorData"
+ */
+const char* microSafariApiName(MicroSafariApi api);
+
+/**
+ * @brief Scope guard measuring the memory use of one call
+ *
+ * Probes nest: an operation called from loop() is recorded under its
+ * own name and also counts towards loop(). Only the task that created
+ * the probe is measured.
+ */
+class MicroSafariMemoryProbe {
+#if MICROSAFARI_MEMORY_PROBES
+private:
+    MicroSafariMemoryStats& _stats;  ///< Statistics updated on exit
+    MicroSafariMemoryProbe* _parent; ///< Enclosing probe, nullptr at the outermost call
+    TaskHandle_t _task;              ///< Task being measured
+    uint32_t _freeAtEntry;           ///< Free heap at entry
+    uint32_t _lowWaterAtEntry;       ///< Heap low-water mark at entry
+    uint32_t _lowestFree;            ///< Lowest free heap observed during the call
+    uint32_t _largestBlock;          ///< Largest allocation observed during the call
+    uint32_t _stackAtEntry;          ///< Free stack below the probe's frame at entry
+    uint32_t _stackMarkAtEntry;      ///< Task stack high-water mark at entry
+
+public:
+    /**
+     * @brief Start measuring
+     * @param stats Statistics of the operation
+     */
+    explicit MicroSafariMemoryProbe(MicroSafariMemoryStats& stats);
+
+    /**
+     * @brief Stop measuring and update the statistics
+     */
+    ~MicroSafariMemoryProbe();
+
+    /**
+     * @brief Record an allocation made by the measured task
+     * @param size Bytes allocated
+     */
+    static void noteBlock(size_t size);
+#else
+public:
+    explicit MicroSafariMemoryProbe(MicroSafariMemoryStats&) {}
+    static void noteBlock(size_t) {}
+#endif
+
+    MicroSafariMemoryProbe(const MicroSafariMemoryProbe&) = delete;
+    MicroSafariMemoryProbe& operator=(const MicroSafariMemoryProbe&) = delete;
+};
+
+#endif // MICROSAFARI_MEMORY_H
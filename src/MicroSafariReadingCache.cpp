@@ -0,0 +1,217 @@
+/*!
+ * @file MicroSafariReadingCache.cpp
+ * @brief Implementation of the MicroSafari reading cache
+ * @version 1.0.0
+ * @date 2025-08-22
+ */
+
+#include "MicroSafariReadingCache.h"
+
+/**
+ * @brief Constructor
+ */
+MicroSafariReadingCache::MicroSafariReadingCache() {
+    _listener = nullptr;
+    _listenerContext = nullptr;
+    clear();
+}
+
+/**
+ * @brief Find metric slot
+ */
+MicroSafariReadingCache::MetricRing* MicroSafariReadingCache::findMetric(const char* name, bool create) {
+    if (name == nullptr || name[0] == '\0') {
+        return nullptr;
+    }
+
+    for (size_t i = 0; i < MICROSAFARI_CACHE_MAX_METRICS; i++) {
+        MetricRing& ring = _metrics[i];
+
+        if (ring.name[0] == '\0') {
+            // Slots are claimed in order, so the first empty slot ends the search
+            if (!create) {
+                return nullptr;
+            }
+            strncpy(ring.name, name, MICROSAFARI_CACHE_NAME_LENGTH - 1);
+            ring.name[MICROSAFARI_CACHE_NAME_LENGTH - 1] = '\0';
+            ring.head = 0;
+            ring.count = 0;
+            return &ring;
+        }
+
+        if (strncmp(ring.name, name, MICROSAFARI_CACHE_NAME_LENGTH - 1) == 0) {
+            return &ring;
+        }
+    }
+
+    return nullptr;
+}
+
+/**
+ * @brief Get reading by age
+ */
+const MicroSafariReading& MicroSafariReadingCache::readingAt(const MetricRing& ring, size_t age) const {
+    size_t index = (ring.head + MICROSAFARI_CACHE_DEPTH - 1 - age) % MICROSAFARI_CACHE_DEPTH;
+    return ring.readings[index];
+}
+
+/**
+ * @brief Store a reading
+ */
+bool MicroSafariReadingCache::record(const char* name, float value, unsigned long timestamp) {
+    MetricRing* ring = findMetric(name, true);
+    if (ring == nullptr) {
+        _droppedMetrics++;
+        return false;
+    }
+
+    ring->readings[ring->head].value = value;
+    ring->readings[ring->head].timestamp = timestamp;
+    ring->head = (ring->head + 1) % MICROSAFARI_CACHE_DEPTH;
+    if (ring->count < MICROSAFARI_CACHE_DEPTH) {
+        ring->count++;
+    }
+
+    if (_listener != nullptr) {
+        _listener(_listenerContext, ring->name, value);
+    }
+
+    return true;
+}
+
+/**
+ * @brief Set reading listener
+ */
+void MicroSafariReadingCache::setListener(MicroSafariReadingListener listener, void* context) {
+    _listener = listener;
+    _listenerContext = context;
+}
+
+/**
+ * @brief Get newest reading
+ */
+bool MicroSafariReadingCache::getLatest(const char* name, MicroSafariReading& reading) {
+    return getReading(name, 0, reading);
+}
+
+/**
+ * @brief Get reading by age
+ */
+bool MicroSafariReadingCache::getReading(const char* name, size_t age, MicroSafariReading& reading) {
+    MetricRing* ring = findMetric(name, false);
+    if (ring == nullptr || age >= ring->count) {
+        return false;
+    }
+
+    reading = readingAt(*ring, age);
+    return true;
+}
+
+/**
+ * @brief Copy readings in a time range
+ */
+size_t MicroSafariReadingCache::getRange(const char* name,
+                                         unsigned long from,
+                                         unsigned long to,
+                                         MicroSafariReading* readings,
+                                         size_t maxReadings) {
+    MetricRing* ring = findMetric(name, false);
+    if (ring == nullptr || readings == nullptr) {
+        return 0;
+    }
+
+    size_t copied = 0;
+    for (size_t age = ring->count; age > 0 && copied < maxReadings; age--) {
+        const MicroSafariReading& reading = readingAt(*ring, age - 1);
+        if (reading.timestamp >= from && reading.timestamp <= to) {
+            readings[copied++] = reading;
+        }
+    }
+
+    return copied;
+}
+
+/**
+ * @brief Aggregate readings of the last window
+ */
+bool MicroSafariReadingCache::getStats(const char* name, unsigned long windowMs, MicroSafariReadingStats& stats) {
+    MetricRing* ring = findMetric(name, false);
+    if (ring == nullptr || ring->count == 0) {
+        return false;
+    }
+
+    unsigned long now = millis();
+    float sum = 0;
+    stats.count = 0;
+
+    // Walk from newest to oldest so the window check can stop early
+    for (size_t age = 0; age < ring->count; age++) {
+        const MicroSafariReading& reading = readingAt(*ring, age);
+        if (windowMs != 0 && now - reading.timestamp > windowMs) {
+            break;
+        }
+
+        if (stats.count == 0) {
+            stats.min = reading.value;
+            stats.max = reading.value;
+            stats.last = reading.value;
+        } else {
+            stats.min = min(stats.min, reading.value);
+            stats.max = max(stats.max, reading.value);
+        }
+        stats.first = reading.value;
+        sum += reading.value;
+        stats.count++;
+    }
+
+    if (stats.count == 0) {
+        return false;
+    }
+
+    stats.mean = sum / stats.count;
+    return true;
+}
+
+/**
+ * @brief Get reading count of a metric
+ */
+size_t MicroSafariReadingCache::getCount(const char* name) {
+    MetricRing* ring = findMetric(name, false);
+    return ring != nullptr ? ring->count : 0;
+}
+
+/**
+ * @brief Get number of cached metrics
+ */
+size_t MicroSafariReadingCache::getMetricCount() const {
+    size_t count = 0;
+    while (count < MICROSAFARI_CACHE_MAX_METRICS && _metrics[count].name[0] != '\0') {
+        count++;
+    }
+    return count;
+}
+
+/**
+ * @brief Get metric name by index
+ */
+const char* MicroSafariReadingCache::getMetricName(size_t index) const {
+    if (index >= MICROSAFARI_CACHE_MAX_METRICS || _metrics[index].name[0] == '\0') {
+        return nullptr;
+    }
+    return _metrics[index].name;
+}
+
+/**
+ * @brief Get dropped reading count
+ */
+uint32_t MicroSafariReadingCache::getDroppedCount() const {
+    return _droppedMetrics;
+}
+
+/**
+ * @brief Clear all metrics
+ */
+void MicroSafariReadingCache::clear() {
+    memset(_metrics, 0, sizeof(_metrics));
+    _droppedMetrics = 0;
+}
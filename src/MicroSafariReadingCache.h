@@ -0,0 +1,196 @@
+/*!
+ * @file MicroSafariReadingCache.h
+ * @brief Fixed-memory cache of the most recent readings per metric
+ * @version 1.0.0
+ * @date 2025-08-22
+ *
+ * Every numeric value sent through MicroSafari::sendSensorData is kept
+ * in a small ring per metric, so displays and rule logic can reuse the
+ * last readings instead of sampling slow sensors again.
+ *
+ * Memory is reserved at compile time. Override the limits before
+ * including MicroSafari.h or with build flags:
+ * - MICROSAFARI_CACHE_MAX_METRICS (default: 8)
+ * - MICROSAFARI_CACHE_DEPTH (default: 16)
+ * - MICROSAFARI_CACHE_NAME_LENGTH (default: 24, including terminator)
+ *
+ * @section license License
+ * MIT License
+ */
+
+#ifndef MICROSAFARI_READING_CACHE_H
+#define MICROSAFARI_READING_CACHE_H
+
+#include <Arduino.h>
+
+#ifndef MICROSAFARI_CACHE_MAX_METRICS
+#define MICROSAFARI_CACHE_MAX_METRICS 8
+#endif
+
+#ifndef MICROSAFARI_CACHE_DEPTH
+#define MICROSAFARI_CACHE_DEPTH 16
+#endif
+
+#ifndef MICROSAFARI_CACHE_NAME_LENGTH
+#define MICROSAFARI_CACHE_NAME_LENGTH 24
+#endif
+
+/**
+ * @brief Single cached reading
+ */
+struct MicroSafariReading {
+    float value;                     ///< Reading value
+    unsigned long timestamp;         ///< millis() when the reading was recorded
+};
+
+/**
+ * @brief Aggregate over a set of cached readings
+ */
+struct MicroSafariReadingStats {
+    size_t count;                    ///< Number of readings aggregated
+    float min;                       ///< Smallest value
+    float max;                       ///< Largest value
+    float mean;                      ///< Arithmetic mean
+    float first;                     ///< Oldest value in the window
+    float last;                      ///< Newest value in the window
+};
+
+/**
+ * @brief Called for every reading stored in the cache
+ * @param context User context pointer given to setListener
+ * @param name Metric name
+ * @param value Reading value
+ */
+typedef void (*MicroSafariReadingListener)(void* context, const char* name, float value);
+
+/**
+ * @brief Per-metric ring buffers of recent readings
+ */
+class MicroSafariReadingCache {
+private:
+    /**
+     * @brief Ring of readings for one metric
+     */
+    struct MetricRing {
+        char name[MICROSAFARI_CACHE_NAME_LENGTH];      ///< Metric name, empty if slot unused
+        MicroSafariReading readings[MICROSAFARI_CACHE_DEPTH]; ///< Ring storage
+        uint16_t head;               ///< Index of the next write
+        uint16_t count;              ///< Number of valid readings
+    };
+
+    MetricRing _metrics[MICROSAFARI_CACHE_MAX_METRICS]; ///< Metric slots
+    uint32_t _droppedMetrics;        ///< Readings dropped because all slots are taken
+    MicroSafariReadingListener _listener; ///< Notified of every new reading
+    void* _listenerContext;          ///< Context passed to the listener
+
+    /**
+     * @brief Internal method to find the slot of a metric
+     * @param name Metric name
+     * @param create Claim a free slot if the metric is unknown
+     * @return Pointer to the ring, nullptr if not found
+     */
+    MetricRing* findMetric(const char* name, bool create);
+
+    /**
+     * @brief Internal method to get a reading by age
+     * @param ring Metric ring
+     * @param age 0 for the newest reading
+     */
+    const MicroSafariReading& readingAt(const MetricRing& ring, size_t age) const;
+
+public:
+    /**
+     * @brief Constructor for MicroSafariReadingCache
+     */
+    MicroSafariReadingCache();
+
+    /**
+     * @brief Store a reading
+     * @param name Metric name (truncated to MICROSAFARI_CACHE_NAME_LENGTH - 1)
+     * @param value Reading value
+     * @param timestamp millis() timestamp of the reading
+     * @return true if stored, false if no metric slot is free
+     */
+    bool record(const char* name, float value, unsigned long timestamp);
+
+    /**
+     * @brief Set a listener notified of every new reading
+     * @param listener Listener function, nullptr to remove
+     * @param context User context passed to the listener
+     */
+    void setListener(MicroSafariReadingListener listener, void* context);
+
+    /**
+     * @brief Get the newest reading of a metric in O(1)
+     * @param name Metric name
+     * @param reading Receives the reading
+     * @return true if the metric has readings, false otherwise
+     */
+    bool getLatest(const char* name, MicroSafariReading& reading);
+
+    /**
+     * @brief Get a reading by age
+     * @param name Metric name
+     * @param age 0 for the newest reading, 1 for the one before, ...
+     * @param reading Receives the reading
+     * @return true if the reading exists, false otherwise
+     */
+    bool getReading(const char* name, size_t age, MicroSafariReading& reading);
+
+    /**
+     * @brief Copy readings inside a time range, oldest first
+     * @param name Metric name
+     * @param from Earliest millis() timestamp (inclusive)
+     * @param to Latest millis() timestamp (inclusive)
+     * @param readings Destination array
+     * @param maxReadings Capacity of destination array
+     * @return Number of readings copied
+     */
+    size_t getRange(const char* name,
+                    unsigned long from,
+                    unsigned long to,
+                    MicroSafariReading* readings,
+                    size_t maxReadings);
+
+    /**
+     * @brief Aggregate readings of the last window
+     * @param name Metric name
+     * @param windowMs Window length in milliseconds, 0 for all cached readings
+     * @param stats Receives the aggregate
+     * @return true if at least one reading falls into the window
+     */
+    bool getStats(const char* name, unsigned long windowMs, MicroSafariReadingStats& stats);
+
+    /**
+     * @brief Get number of cached readings of a metric
+     * @param name Metric name
+     * @return Reading count (0..MICROSAFARI_CACHE_DEPTH)
+     */
+    size_t getCount(const char* name);
+
+    /**
+     * @brief Get number of metrics currently cached
+     * @return Metric count
+     */
+    size_t getMetricCount() const;
+
+    /**
+     * @brief Get name of a cached metric
+     * @param index Metric index (0..getMetricCount() - 1)
+     * @return Metric name, nullptr if index is out of range
+     */
+    const char* getMetricName(size_t index) const;
+
+    /**
+     * @brief Get number of readings dropped because all metric slots were taken
+     * @return Dropped reading count
+     */
+    uint32_t getDroppedCount() const;
+
+    /**
+     * @brief Remove all cached readings and metrics
+     */
+    void clear();
+};
+
+#endif // MICROSAFARI_READING_CACHE_H
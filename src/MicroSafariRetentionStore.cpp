@@ -0,0 +1,272 @@
+/*!
+ * @file MicroSafariRetentionStore.cpp
+ * @brief Implementation of the MicroSafari tiered retention store
+ * @version 1.0.0
+ * @date 2025-08-22
+ */
+
+#include "MicroSafariRetentionStore.h"
+#include "MicroSafariTime.h"
+
+/**
+ * @brief Constructor
+ */
+MicroSafariRetentionStore::MicroSafariRetentionStore() {
+    for (uint8_t tier = 0; tier < MICROSAFARI_RETENTION_TIER_COUNT; tier++) {
+        _contexts[tier].store = this;
+        _contexts[tier].tier = tier;
+        _pendingCount[tier] = 0;
+    }
+    _batchTier = MICROSAFARI_RETENTION_RAW;
+    _batchRecords = 0;
+    _ready = false;
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+/**
+ * @brief Mount all tiers
+ */
+bool MicroSafariRetentionStore::begin(MicroSafariFlashBackend* flash,
+                                      uint32_t rawBytes,
+                                      uint32_t minuteBytes,
+                                      uint32_t quarterBytes) {
+    const uint32_t budgets[MICROSAFARI_RETENTION_TIER_COUNT] = { rawBytes, minuteBytes, quarterBytes };
+
+    _ready = false;
+    if (flash == nullptr) {
+        return false;
+    }
+
+    uint32_t offset = 0;
+    for (uint8_t tier = 0; tier < MICROSAFARI_RETENTION_TIER_COUNT; tier++) {
+        uint32_t length = budgets[tier] - (budgets[tier] % MICROSAFARI_FLASH_SECTOR_SIZE);
+        if (length < 2 * MICROSAFARI_FLASH_SECTOR_SIZE || offset + length > flash->size()) {
+            return false;
+        }
+
+        if (!_tiers[tier].begin(flash, offset, length)) {
+            return false;
+        }
+        _tiers[tier].setEvictionCallback(onEvict, &_contexts[tier]);
+        offset += length;
+    }
+
+    _ready = true;
+    return true;
+}
+
+/**
+ * @brief Eviction callback: roll evicted records into the next tier
+ */
+void MicroSafariRetentionStore::onEvict(void* context, const uint8_t* data, uint16_t length) {
+    TierContext* tierContext = static_cast<TierContext*>(context);
+    MicroSafariRetentionStore* store = tierContext->store;
+
+    if (length != sizeof(MicroSafariRetentionRecord)) {
+        return;
+    }
+
+    MicroSafariRetentionRecord record;
+    memcpy(&record, data, sizeof(record));
+
+    if (tierContext->tier + 1 < MICROSAFARI_RETENTION_TIER_COUNT) {
+        store->rollup(tierContext->tier + 1, record);
+    } else {
+        store->_stats.dropped++;
+    }
+}
+
+/**
+ * @brief Merge record into an open rollup
+ */
+void MicroSafariRetentionStore::rollup(uint8_t tier, const MicroSafariRetentionRecord& record) {
+    uint32_t resolution = getResolutionSeconds(static_cast<MicroSafariRetentionTier>(tier));
+    uint32_t bucket = record.timestamp - (record.timestamp % resolution);
+
+    for (uint8_t i = 0; i < _pendingCount[tier]; i++) {
+        MicroSafariRetentionRecord& open = _pending[tier][i];
+        if (open.timestamp == bucket &&
+            open.flags == record.flags &&
+            strncmp(open.metric, record.metric, MICROSAFARI_RETENTION_NAME_LENGTH) == 0) {
+            uint32_t count = (uint32_t)open.count + record.count;
+            if (count > 0xFFFF) {
+                count = 0xFFFF;
+            }
+            open.mean = (open.mean * open.count + record.mean * record.count) / (open.count + record.count);
+            open.min = min(open.min, record.min);
+            open.max = max(open.max, record.max);
+            open.count = count;
+            return;
+        }
+    }
+
+    if (_pendingCount[tier] == MICROSAFARI_RETENTION_ROLLUP_SLOTS) {
+        flushPending(tier);
+    }
+
+    MicroSafariRetentionRecord& open = _pending[tier][_pendingCount[tier]++];
+    open = record;
+    open.timestamp = bucket;
+    open.tier = tier;
+}
+
+/**
+ * @brief Write open rollups of a tier
+ */
+void MicroSafariRetentionStore::flushPending(uint8_t tier) {
+    for (uint8_t i = 0; i < _pendingCount[tier]; i++) {
+        if (appendRecord(tier, _pending[tier][i])) {
+            _stats.rollups[tier]++;
+        }
+    }
+    _pendingCount[tier] = 0;
+}
+
+/**
+ * @brief Append record to a tier
+ */
+bool MicroSafariRetentionStore::appendRecord(uint8_t tier, const MicroSafariRetentionRecord& record) {
+    return _tiers[tier].append(&record, sizeof(record));
+}
+
+/**
+ * @brief Retain reading stamped with the current time
+ */
+bool MicroSafariRetentionStore::record(const char* metric, float value) {
+    time_t now = time(nullptr);
+    if (now > MICROSAFARI_EPOCH_VALID) {
+        return record(metric, value, (uint32_t)now, true);
+    }
+    return record(metric, value, millis() / 1000, false);
+}
+
+/**
+ * @brief Retain reading with explicit timestamp
+ */
+bool MicroSafariRetentionStore::record(const char* metric, float value, uint32_t timestamp, bool epoch) {
+    if (!_ready || metric == nullptr || metric[0] == '\0') {
+        return false;
+    }
+
+    MicroSafariRetentionRecord record;
+    memset(&record, 0, sizeof(record));
+    record.timestamp = timestamp;
+    record.mean = value;
+    record.min = value;
+    record.max = value;
+    record.count = 1;
+    record.tier = MICROSAFARI_RETENTION_RAW;
+    record.flags = epoch ? MICROSAFARI_RETENTION_FLAG_EPOCH : 0;
+    strncpy(record.metric, metric, MICROSAFARI_RETENTION_NAME_LENGTH - 1);
+
+    bool stored = appendRecord(MICROSAFARI_RETENTION_RAW, record);
+    if (stored) {
+        _stats.recorded++;
+    }
+
+    // Rollups produced by evictions during the append, finest tier first
+    for (uint8_t tier = MICROSAFARI_RETENTION_MINUTE; tier < MICROSAFARI_RETENTION_TIER_COUNT; tier++) {
+        flushPending(tier);
+    }
+
+    return stored;
+}
+
+/**
+ * @brief Check if all tiers are empty
+ */
+bool MicroSafariRetentionStore::isEmpty() {
+    if (!_ready) {
+        return true;
+    }
+
+    for (uint8_t tier = 0; tier < MICROSAFARI_RETENTION_TIER_COUNT; tier++) {
+        if (!_tiers[tier].isEmpty()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Read oldest records, coarsest tier first
+ */
+size_t MicroSafariRetentionStore::peekBatch(MicroSafariRetentionRecord* records, size_t maxRecords) {
+    _batchRecords = 0;
+    if (!_ready || records == nullptr || maxRecords == 0) {
+        return 0;
+    }
+
+    for (int tier = MICROSAFARI_RETENTION_TIER_COUNT - 1; tier >= 0; tier--) {
+        MicroSafariFlashLog::Cursor cursor;
+        if (!_tiers[tier].beginRead(cursor)) {
+            continue;
+        }
+
+        size_t count = 0;
+        uint16_t length;
+        while (count < maxRecords &&
+               _tiers[tier].readNext(cursor, &records[count], sizeof(MicroSafariRetentionRecord), length)) {
+            if (length == sizeof(MicroSafariRetentionRecord)) {
+                count++;
+            }
+        }
+
+        if (count == 0) {
+            // Only unreadable records left in this tier, discard them
+            for (uint32_t i = 0; i < cursor.records; i++) {
+                _tiers[tier].pop();
+            }
+            continue;
+        }
+
+        _batchTier = tier;
+        _batchRecords = cursor.records;
+        return count;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Remove records of the last batch
+ */
+void MicroSafariRetentionStore::commitBatch() {
+    for (size_t i = 0; i < _batchRecords; i++) {
+        if (_tiers[_batchTier].pop()) {
+            _stats.drained++;
+        }
+    }
+    _batchRecords = 0;
+}
+
+/**
+ * @brief Get used bytes of a tier
+ */
+uint32_t MicroSafariRetentionStore::getUsedBytes(MicroSafariRetentionTier tier) const {
+    if (tier >= MICROSAFARI_RETENTION_TIER_COUNT) {
+        return 0;
+    }
+    return _tiers[tier].getUsedBytes();
+}
+
+/**
+ * @brief Get bucket length of a tier
+ */
+uint32_t MicroSafariRetentionStore::getResolutionSeconds(MicroSafariRetentionTier tier) {
+    switch (tier) {
+        case MICROSAFARI_RETENTION_MINUTE:
+            return 60;
+        case MICROSAFARI_RETENTION_QUARTER:
+            return 900;
+        default:
+            return 0;
+    }
+}
+
+/**
+ * @brief Get statistics
+ */
+const MicroSafariRetentionStats& MicroSafariRetentionStore::getStats() const {
+    return _stats;
+}
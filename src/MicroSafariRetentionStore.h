@@ -0,0 +1,206 @@
+/*!
+ * @file MicroSafariRetentionStore.h
+ * @brief Tiered on-flash retention of readings with automatic downsampling
+ * @version 1.0.0
+ * @date 2025-08-22
+ *
+ * The retention store keeps readings that could not be sent in three
+ * flash ring logs with separate byte budgets:
+ * - raw readings
+ * - 1-minute rollups (mean, min, max, count)
+ * - 15-minute rollups
+ *
+ * When the raw tier runs out of space, its oldest sector is rolled up
+ * into the 1-minute tier instead of being dropped; the 1-minute tier
+ * rolls up into the 15-minute tier in the same way. Only the 15-minute
+ * tier discards data. Long outages therefore lose resolution before
+ * they lose history.
+ *
+ * @section license License
+ * MIT License
+ */
+
+#ifndef MICROSAFARI_RETENTION_STORE_H
+#define MICROSAFARI_RETENTION_STORE_H
+
+#include <Arduino.h>
+#include "MicroSafariFlashLog.h"
+
+/** @brief Maximum metric name length stored per record, including terminator */
+#define MICROSAFARI_RETENTION_NAME_LENGTH 16
+
+/** @brief Default number of records sent per drain request */
+#define MICROSAFARI_RETENTION_DRAIN_BATCH 16
+
+/** @brief Rollups kept open in RAM per tier while a sector is downsampled */
+#define MICROSAFARI_RETENTION_ROLLUP_SLOTS 8
+
+/**
+ * @brief Retention resolution tiers
+ */
+enum MicroSafariRetentionTier {
+    MICROSAFARI_RETENTION_RAW = 0,
+    MICROSAFARI_RETENTION_MINUTE = 1,
+    MICROSAFARI_RETENTION_QUARTER = 2,
+    MICROSAFARI_RETENTION_TIER_COUNT = 3
+};
+
+/** @brief Record timestamp is Unix time; otherwise it is device uptime */
+#define MICROSAFARI_RETENTION_FLAG_EPOCH 0x01
+
+/**
+ * @brief Retained reading or rollup as stored in flash
+ */
+struct MicroSafariRetentionRecord {
+    uint32_t timestamp;              ///< Seconds (bucket start for rollups)
+    float mean;                      ///< Mean value (the value itself for raw records)
+    float min;                       ///< Smallest value in the bucket
+    float max;                       ///< Largest value in the bucket
+    uint16_t count;                  ///< Number of raw readings aggregated
+    uint8_t tier;                    ///< MicroSafariRetentionTier of the record
+    uint8_t flags;                   ///< MICROSAFARI_RETENTION_FLAG_* bits
+    char metric[MICROSAFARI_RETENTION_NAME_LENGTH]; ///< Metric name
+};
+
+/**
+ * @brief Retention statistics
+ */
+struct MicroSafariRetentionStats {
+    uint32_t recorded;               ///< Raw readings recorded
+    uint32_t rollups[MICROSAFARI_RETENTION_TIER_COUNT]; ///< Rollup records written per tier
+    uint32_t dropped;                ///< Records discarded by the coarsest tier
+    uint32_t drained;                ///< Records confirmed by drain
+};
+
+/**
+ * @brief Flash-backed retention store with raw, 1-minute and 15-minute tiers
+ */
+class MicroSafariRetentionStore {
+private:
+    /**
+     * @brief Eviction callback context, one per tier
+     */
+    struct TierContext {
+        MicroSafariRetentionStore* store; ///< Owning store
+        uint8_t tier;                ///< Tier whose sector is evicted
+    };
+
+    MicroSafariFlashLog _tiers[MICROSAFARI_RETENTION_TIER_COUNT]; ///< One ring log per tier
+    TierContext _contexts[MICROSAFARI_RETENTION_TIER_COUNT]; ///< Eviction contexts
+    MicroSafariRetentionRecord _pending[MICROSAFARI_RETENTION_TIER_COUNT][MICROSAFARI_RETENTION_ROLLUP_SLOTS]; ///< Open rollups
+    uint8_t _pendingCount[MICROSAFARI_RETENTION_TIER_COUNT]; ///< Open rollups per tier
+    uint8_t _batchTier;              ///< Tier read by the last peekBatch
+    size_t _batchRecords;            ///< Flash records covered by the last peekBatch
+    bool _ready;                     ///< All tiers mounted
+    MicroSafariRetentionStats _stats; ///< Runtime statistics
+
+    /**
+     * @brief Internal eviction callback shared by all tiers
+     */
+    static void onEvict(void* context, const uint8_t* data, uint16_t length);
+
+    /**
+     * @brief Internal method to merge a record into an open rollup of a tier
+     */
+    void rollup(uint8_t tier, const MicroSafariRetentionRecord& record);
+
+    /**
+     * @brief Internal method to write open rollups of a tier to flash
+     */
+    void flushPending(uint8_t tier);
+
+    /**
+     * @brief Internal method to append a record to a tier
+     */
+    bool appendRecord(uint8_t tier, const MicroSafariRetentionRecord& record);
+
+public:
+    /**
+     * @brief Constructor for MicroSafariRetentionStore
+     */
+    MicroSafariRetentionStore();
+
+    /**
+     * @brief Mount the store on a flash region
+     *
+     * Budgets are rounded down to whole sectors and every tier needs at
+     * least two sectors. Tiers are laid out back to back from offset 0.
+     *
+     * @param flash Flash backend to use
+     * @param rawBytes Byte budget of the raw tier
+     * @param minuteBytes Byte budget of the 1-minute tier
+     * @param quarterBytes Byte budget of the 15-minute tier
+     * @return true if all tiers mounted, false otherwise
+     */
+    bool begin(MicroSafariFlashBackend* flash,
+               uint32_t rawBytes,
+               uint32_t minuteBytes,
+               uint32_t quarterBytes);
+
+    /**
+     * @brief Retain a reading stamped with the current time
+     *
+     * Unix time is used once the clock is set (e.g. via configTime),
+     * device uptime otherwise.
+     *
+     * @param metric Metric name (truncated to MICROSAFARI_RETENTION_NAME_LENGTH - 1)
+     * @param value Reading value
+     * @return true if stored, false otherwise
+     */
+    bool record(const char* metric, float value);
+
+    /**
+     * @brief Retain a reading with an explicit timestamp
+     * @param metric Metric name
+     * @param value Reading value
+     * @param timestamp Timestamp in seconds
+     * @param epoch true if timestamp is Unix time, false for uptime seconds
+     * @return true if stored, false otherwise
+     */
+    bool record(const char* metric, float value, uint32_t timestamp, bool epoch);
+
+    /**
+     * @brief Check if the store holds undrained records
+     * @return true if all tiers are empty
+     */
+    bool isEmpty();
+
+    /**
+     * @brief Read the oldest records without removing them
+     *
+     * Coarse tiers are returned first because they hold the oldest data.
+     * All records of one batch come from the same tier.
+     *
+     * @param records Destination array
+     * @param maxRecords Capacity of destination array
+     * @return Number of records read
+     */
+    size_t peekBatch(MicroSafariRetentionRecord* records, size_t maxRecords);
+
+    /**
+     * @brief Remove the records returned by the last peekBatch
+     */
+    void commitBatch();
+
+    /**
+     * @brief Get approximate bytes used by a tier
+     * @param tier Retention tier
+     * @return Used bytes
+     */
+    uint32_t getUsedBytes(MicroSafariRetentionTier tier) const;
+
+    /**
+     * @brief Get bucket length of a tier
+     * @param tier Retention tier
+     * @return Bucket length in seconds (0 for raw)
+     */
+    static uint32_t getResolutionSeconds(MicroSafariRetentionTier tier);
+
+    /**
+     * @brief Get retention statistics
+     * @return Reference to statistics structure
+     */
+    const MicroSafariRetentionStats& getStats() const;
+};
+
+#endif // MICROSAFARI_RETENTION_STORE_H
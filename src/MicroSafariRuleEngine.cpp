@@ -0,0 +1,282 @@
+/*!
+ * @file MicroSafariRuleEngine.cpp
+ * @brief Implementation of the MicroSafari threshold rule engine
+ * @version 1.0.0
+ * @date 2025-08-22
+ */
+
+#include "MicroSafariRuleEngine.h"
+#include "MicroSafariTime.h"
+
+// Operator spellings accepted in rule JSON, indexed by MicroSafariRuleOp
+static const char* RULE_OPERATORS[] = { "<", "<=", ">", ">=" };
+
+// Data sources starting with this prefix are library commands (__rules, __cfg.*); running
+// them from a rule would replace the rule table or configuration while it is evaluated
+static const char* RULE_RESERVED_PREFIX = "__";
+
+/**
+ * @brief Check if a data source is a reserved library command
+ */
+static bool isReservedSource(const char* dataSource) {
+    return strncmp(dataSource, RULE_RESERVED_PREFIX, strlen(RULE_RESERVED_PREFIX)) == 0;
+}
+
+/**
+ * @brief Constructor
+ */
+MicroSafariRuleEngine::MicroSafariRuleEngine() {
+    _ruleCount = 0;
+    _eventCount = 0;
+    _droppedEvents = 0;
+    _action = nullptr;
+    _actionContext = nullptr;
+    _evaluating = false;
+    memset(_states, 0, sizeof(_states));
+}
+
+/**
+ * @brief Hash a metric name
+ */
+uint16_t MicroSafariRuleEngine::hashName(const char* name) {
+    uint32_t hash = 2166136261UL;
+    while (*name != '\0') {
+        hash ^= (uint8_t)*name++;
+        hash *= 16777619UL;
+    }
+    return (uint16_t)(hash ^ (hash >> 16));
+}
+
+/**
+ * @brief Compile one JSON rule
+ */
+bool MicroSafariRuleEngine::compile(const JsonObject& source, MicroSafariRule& rule) {
+    memset(&rule, 0, sizeof(rule));
+
+    const char* metric = source["metric"];
+    const char* op = source["op"];
+    const char* dataSource = source["data_source"];
+    const char* value = source["value"];
+    const char* releaseValue = source["release_value"];
+
+    if (metric == nullptr || op == nullptr || dataSource == nullptr || value == nullptr ||
+        !source["threshold"].is<float>() ||
+        strlen(metric) >= MICROSAFARI_RULE_NAME_LENGTH ||
+        strlen(dataSource) >= MICROSAFARI_RULE_NAME_LENGTH ||
+        strlen(value) >= MICROSAFARI_RULE_VALUE_LENGTH ||
+        (releaseValue != nullptr && strlen(releaseValue) >= MICROSAFARI_RULE_VALUE_LENGTH) ||
+        isReservedSource(dataSource)) {
+        return false;
+    }
+
+    bool knownOp = false;
+    for (uint8_t i = 0; i < sizeof(RULE_OPERATORS) / sizeof(RULE_OPERATORS[0]); i++) {
+        if (strcmp(op, RULE_OPERATORS[i]) == 0) {
+            rule.op = i;
+            knownOp = true;
+        }
+    }
+    if (!knownOp) {
+        return false;
+    }
+
+    long id = source["id"] | 0L;
+    float hysteresis = source["hysteresis"] | 0.0f;
+    long cooldown = source["cooldown_s"] | 0L;
+    // Larger IDs would be truncated and larger cooldowns overflow cooldownMs
+    if (id < 0 || id > 0xFFFF || hysteresis < 0 || cooldown < 0 || (unsigned long)cooldown > 0xFFFFFFFFUL / 1000) {
+        return false;
+    }
+
+    rule.id = id;
+    rule.threshold = source["threshold"];
+    rule.hysteresis = hysteresis;
+    rule.cooldownMs = cooldown * 1000UL;
+    rule.hasRelease = releaseValue != nullptr;
+    strcpy(rule.metric, metric);
+    strcpy(rule.dataSource, dataSource);
+    strcpy(rule.value, value);
+    if (releaseValue != nullptr) {
+        strcpy(rule.releaseValue, releaseValue);
+    }
+    rule.metricHash = hashName(rule.metric);
+    return true;
+}
+
+/**
+ * @brief Replace rule table from JSON
+ */
+int MicroSafariRuleEngine::load(const JsonArray& rules) {
+    if (rules.isNull() || rules.size() > MICROSAFARI_MAX_RULES) {
+        return -1;
+    }
+
+    MicroSafariRule compiled[MICROSAFARI_MAX_RULES];
+    size_t count = 0;
+    for (JsonObject source : rules) {
+        if (!compile(source, compiled[count])) {
+            return -1;
+        }
+        count++;
+    }
+
+    setRules(compiled, count);
+    return count;
+}
+
+/**
+ * @brief Replace rule table with compiled rules
+ */
+bool MicroSafariRuleEngine::setRules(const MicroSafariRule* rules, size_t count) {
+    if (count > MICROSAFARI_MAX_RULES || (count > 0 && rules == nullptr)) {
+        return false;
+    }
+    // Tables restored from NVS skip compile(), so they are revalidated here
+    for (size_t i = 0; i < count; i++) {
+        if (isReservedSource(rules[i].dataSource)) {
+            return false;
+        }
+    }
+
+    if (count > 0) {
+        memcpy(_rules, rules, count * sizeof(MicroSafariRule));
+    }
+    memset(_states, 0, sizeof(_states));
+    _ruleCount = count;
+    return true;
+}
+
+/**
+ * @brief Copy compiled rule table
+ */
+size_t MicroSafariRuleEngine::getRules(MicroSafariRule* rules, size_t maxRules) const {
+    size_t count = min(_ruleCount, maxRules);
+    if (count > 0) {
+        memcpy(rules, _rules, count * sizeof(MicroSafariRule));
+    }
+    return count;
+}
+
+/**
+ * @brief Set command handler
+ */
+void MicroSafariRuleEngine::setActionHandler(MicroSafariRuleAction action, void* context) {
+    _action = action;
+    _actionContext = context;
+}
+
+/**
+ * @brief Evaluate rules of a metric
+ */
+size_t MicroSafariRuleEngine::evaluate(const char* metric, float value) {
+    if (_ruleCount == 0 || _evaluating || metric == nullptr) {
+        return 0;
+    }
+
+    _evaluating = true;
+    uint16_t hash = hashName(metric);
+    size_t commands = 0;
+
+    for (size_t i = 0; i < _ruleCount; i++) {
+        const MicroSafariRule& rule = _rules[i];
+        RuleState& state = _states[i];
+
+        if (rule.metricHash != hash || strcmp(rule.metric, metric) != 0) {
+            continue;
+        }
+
+        bool below = rule.op == MICROSAFARI_RULE_LT || rule.op == MICROSAFARI_RULE_LE;
+        bool holds;
+        switch (rule.op) {
+            case MICROSAFARI_RULE_LT: holds = value < rule.threshold; break;
+            case MICROSAFARI_RULE_LE: holds = value <= rule.threshold; break;
+            case MICROSAFARI_RULE_GT: holds = value > rule.threshold; break;
+            default:                  holds = value >= rule.threshold; break;
+        }
+
+        if (!state.active && holds) {
+            if (state.fired && millis() - state.lastTrigger < rule.cooldownMs) {
+                continue;
+            }
+
+            state.active = true;
+            state.fired = true;
+            state.lastTrigger = millis();
+            bool success = _action != nullptr && _action(_actionContext, rule.dataSource, rule.value);
+            addEvent(rule, true, success, value);
+            commands++;
+        } else if (state.active && !holds) {
+            // Release only once the reading left the hysteresis band
+            bool cleared = below ? value >= rule.threshold + rule.hysteresis
+                                 : value <= rule.threshold - rule.hysteresis;
+            if (!cleared) {
+                continue;
+            }
+
+            state.active = false;
+            if (rule.hasRelease) {
+                bool success = _action != nullptr && _action(_actionContext, rule.dataSource, rule.releaseValue);
+                addEvent(rule, false, success, value);
+                commands++;
+            }
+        }
+    }
+
+    _evaluating = false;
+    return commands;
+}
+
+/**
+ * @brief Record a rule hit
+ */
+void MicroSafariRuleEngine::addEvent(const MicroSafariRule& rule, bool triggered, bool success, float value) {
+    if (_eventCount == MICROSAFARI_RULE_EVENT_BATCH) {
+        // Keep the newest events: drop the oldest
+        memmove(&_events[0], &_events[1], (MICROSAFARI_RULE_EVENT_BATCH - 1) * sizeof(MicroSafariRuleEvent));
+        _eventCount--;
+        _droppedEvents++;
+    }
+
+    MicroSafariRuleEvent& event = _events[_eventCount++];
+    time_t now = time(nullptr);
+    event.ruleId = rule.id;
+    event.triggered = triggered;
+    event.success = success;
+    event.value = value;
+    event.epoch = now > MICROSAFARI_EPOCH_VALID;
+    event.timestamp = event.epoch ? (uint32_t)now : millis() / 1000;
+}
+
+/**
+ * @brief Get unreported events
+ */
+const MicroSafariRuleEvent* MicroSafariRuleEngine::getEvents(size_t& count) const {
+    count = _eventCount;
+    return _events;
+}
+
+/**
+ * @brief Remove reported events
+ */
+void MicroSafariRuleEngine::removeEvents(size_t count) {
+    if (count >= _eventCount) {
+        _eventCount = 0;
+        return;
+    }
+    memmove(&_events[0], &_events[count], (_eventCount - count) * sizeof(MicroSafariRuleEvent));
+    _eventCount -= count;
+}
+
+/**
+ * @brief Get number of rules
+ */
+size_t MicroSafariRuleEngine::getRuleCount() const {
+    return _ruleCount;
+}
+
+/**
+ * @brief Get number of dropped events
+ */
+uint32_t MicroSafariRuleEngine::getDroppedEvents() const {
+    return _droppedEvents;
+}
@@ -0,0 +1,216 @@
+/*!
+ * @file MicroSafariRuleEngine.h
+ * @brief Local threshold rules for closed-loop control
+ * @version 1.0.0
+ * @date 2025-08-22
+ *
+ * Rules such as "soil_moisture < 30 -> pump_control = on" are pushed
+ * from the platform as JSON, compiled into a fixed table of plain
+ * structs and evaluated on every new reading, without a round trip and
+ * also while offline. Each rule has a hysteresis band and an optional
+ * release value, so "on" and "off" do not chatter around the threshold.
+ * Rule hits are kept as events and reported in batches.
+ *
+ * Rule JSON:
+ * {"id":1,"metric":"soil_moisture","op":"<","threshold":30,
+ *  "hysteresis":2,"cooldown_s":60,
+ *  "data_source":"pump_control","value":"on","release_value":"off"}
+ *
+ * @section license License
+ * MIT License
+ */
+
+#ifndef MICROSAFARI_RULE_ENGINE_H
+#define MICROSAFARI_RULE_ENGINE_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+#ifndef MICROSAFARI_MAX_RULES
+#define MICROSAFARI_MAX_RULES 16
+#endif
+
+/** @brief Rule events kept until they are reported */
+#define MICROSAFARI_RULE_EVENT_BATCH 16
+
+/** @brief Minimum time between rule event reports in milliseconds, also when the buffer is full */
+#ifndef MICROSAFARI_RULE_EVENT_RETRY_MS
+#define MICROSAFARI_RULE_EVENT_RETRY_MS 10000
+#endif
+
+/** @brief Maximum metric and data source length of a rule, including terminator */
+#define MICROSAFARI_RULE_NAME_LENGTH 24
+
+/** @brief Maximum action value length of a rule, including terminator */
+#define MICROSAFARI_RULE_VALUE_LENGTH 16
+
+/**
+ * @brief Rule comparison operators
+ */
+enum MicroSafariRuleOp {
+    MICROSAFARI_RULE_LT = 0,         ///< value < threshold
+    MICROSAFARI_RULE_LE = 1,         ///< value <= threshold
+    MICROSAFARI_RULE_GT = 2,         ///< value > threshold
+    MICROSAFARI_RULE_GE = 3          ///< value >= threshold
+};
+
+/**
+ * @brief Compiled rule as stored in the rule table and in NVS
+ */
+struct MicroSafariRule {
+    uint16_t id;                     ///< Platform rule ID
+    uint16_t metricHash;             ///< Hash of the metric name for quick rejection
+    uint8_t op;                      ///< MicroSafariRuleOp
+    bool hasRelease;                 ///< Run releaseValue when the condition clears
+    float threshold;                 ///< Trigger threshold
+    float hysteresis;                ///< Distance past the threshold needed to release
+    uint32_t cooldownMs;             ///< Minimum time between two triggers
+    char metric[MICROSAFARI_RULE_NAME_LENGTH]; ///< Metric the rule watches
+    char dataSource[MICROSAFARI_RULE_NAME_LENGTH]; ///< Command data source to drive
+    char value[MICROSAFARI_RULE_VALUE_LENGTH]; ///< Command value on trigger
+    char releaseValue[MICROSAFARI_RULE_VALUE_LENGTH]; ///< Command value on release
+};
+
+/**
+ * @brief Rule hit waiting to be reported
+ */
+struct MicroSafariRuleEvent {
+    uint16_t ruleId;                 ///< Rule that changed state
+    bool triggered;                  ///< true on trigger, false on release
+    bool success;                    ///< Command handler result
+    float value;                     ///< Reading that caused the change
+    uint32_t timestamp;              ///< Unix seconds, or uptime seconds if the clock is not set
+    bool epoch;                      ///< timestamp is Unix time
+};
+
+/**
+ * @brief Runs the command of a rule
+ * @param context User context pointer given to setActionHandler
+ * @param dataSource Command data source
+ * @param value Command value
+ * @return true if the command succeeded, false otherwise
+ */
+typedef bool (*MicroSafariRuleAction)(void* context, const char* dataSource, const char* value);
+
+/**
+ * @brief Table-driven threshold rule engine
+ */
+class MicroSafariRuleEngine {
+private:
+    /**
+     * @brief Runtime state of a rule
+     */
+    struct RuleState {
+        bool active;                 ///< Condition currently holds
+        bool fired;                  ///< Triggered at least once
+        unsigned long lastTrigger;   ///< millis() of the last trigger
+    };
+
+    MicroSafariRule _rules[MICROSAFARI_MAX_RULES]; ///< Compiled rule table
+    RuleState _states[MICROSAFARI_MAX_RULES]; ///< State per rule
+    size_t _ruleCount;               ///< Rules in the table
+    MicroSafariRuleEvent _events[MICROSAFARI_RULE_EVENT_BATCH]; ///< Unreported rule hits
+    size_t _eventCount;              ///< Entries in _events
+    uint32_t _droppedEvents;         ///< Events lost because the batch was full
+    MicroSafariRuleAction _action;   ///< Command handler
+    void* _actionContext;            ///< Context passed to the command handler
+    bool _evaluating;                ///< Guards against rules triggered by their own commands
+
+    /**
+     * @brief Internal method to record a rule hit
+     */
+    void addEvent(const MicroSafariRule& rule, bool triggered, bool success, float value);
+
+public:
+    /**
+     * @brief Constructor for MicroSafariRuleEngine
+     */
+    MicroSafariRuleEngine();
+
+    /**
+     * @brief Compile one JSON rule
+     * @param source Rule object
+     * @param rule Receives the compiled rule
+     * @return true if the rule is valid, false otherwise (also for a
+     *         reserved data source such as __rules or __cfg.*, an ID
+     *         above 65535 or a cooldown_s above 4294967)
+     */
+    static bool compile(const JsonObject& source, MicroSafariRule& rule);
+
+    /**
+     * @brief Hash a metric name as stored in MicroSafariRule::metricHash
+     * @param name Metric name
+     * @return 16-bit FNV-1a hash
+     */
+    static uint16_t hashName(const char* name);
+
+    /**
+     * @brief Replace the rule table with compiled JSON rules
+     *
+     * All rules are compiled first; the table only changes if every rule
+     * is valid.
+     *
+     * @param rules JSON array of rule objects
+     * @return Number of rules loaded, -1 if any rule is invalid
+     */
+    int load(const JsonArray& rules);
+
+    /**
+     * @brief Replace the rule table with already compiled rules
+     * @param rules Compiled rules
+     * @param count Number of rules
+     * @return true if loaded, false if count exceeds MICROSAFARI_MAX_RULES
+     *         or a rule targets a reserved data source
+     */
+    bool setRules(const MicroSafariRule* rules, size_t count);
+
+    /**
+     * @brief Copy the compiled rule table
+     * @param rules Destination array
+     * @param maxRules Capacity of destination array
+     * @return Number of rules copied
+     */
+    size_t getRules(MicroSafariRule* rules, size_t maxRules) const;
+
+    /**
+     * @brief Set the handler that runs rule commands
+     * @param action Command handler
+     * @param context User context passed to the handler
+     */
+    void setActionHandler(MicroSafariRuleAction action, void* context);
+
+    /**
+     * @brief Evaluate all rules of a metric against a new reading
+     * @param metric Metric name
+     * @param value Reading value
+     * @return Number of commands run
+     */
+    size_t evaluate(const char* metric, float value);
+
+    /**
+     * @brief Get unreported rule events, oldest first
+     * @param count Receives the number of events
+     * @return Pointer to the events
+     */
+    const MicroSafariRuleEvent* getEvents(size_t& count) const;
+
+    /**
+     * @brief Remove the oldest reported events
+     * @param count Number of events to remove
+     */
+    void removeEvents(size_t count);
+
+    /**
+     * @brief Get number of rules in the table
+     * @return Rule count
+     */
+    size_t getRuleCount() const;
+
+    /**
+     * @brief Get number of events lost because the batch was full
+     * @return Dropped event count
+     */
+    uint32_t getDroppedEvents() const;
+};
+
+#endif // MICROSAFARI_RULE_ENGINE_H
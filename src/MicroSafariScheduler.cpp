@@ -0,0 +1,287 @@
+/*!
+ * @file MicroSafariScheduler.cpp
+ * @brief Implementation of the MicroSafari command timer wheel
+ * @version 1.0.0
+ * @date 2025-08-22
+ */
+
+#include "MicroSafariScheduler.h"
+
+// Clock jumps beyond one level-1 revolution rebuild the wheel
+static const uint32_t SCHEDULER_MAX_STEP = 4096;
+
+// Latest schedulable time relative to now: one revolution of the top level
+static const uint32_t SCHEDULER_HORIZON = 1UL << 24;
+
+/**
+ * @brief Constructor
+ */
+MicroSafariScheduler::MicroSafariScheduler() {
+    clear();
+}
+
+/**
+ * @brief Remove all commands
+ */
+void MicroSafariScheduler::clear() {
+    memset(_slots, NONE, sizeof(_slots));
+    for (uint8_t i = 0; i < MICROSAFARI_SCHEDULE_MAX; i++) {
+        _entries[i].used = false;
+        _entries[i].next = NONE;
+    }
+    _parked = NONE;
+    _dueHead = NONE;
+    _dueTail = NONE;
+    _current = 0;
+    _started = false;
+    _count = 0;
+}
+
+/**
+ * @brief Append entry to the due list
+ */
+void MicroSafariScheduler::appendDue(uint8_t index) {
+    _entries[index].next = NONE;
+    if (_dueTail == NONE) {
+        _dueHead = index;
+    } else {
+        _entries[_dueTail].next = index;
+    }
+    _dueTail = index;
+}
+
+/**
+ * @brief Place entry relative to the last processed second
+ */
+void MicroSafariScheduler::insert(uint8_t index) {
+    uint32_t at = _entries[index].command.executeAt;
+    if (at <= _current) {
+        appendDue(index);
+        return;
+    }
+
+    // Lowest level whose range covers the delay
+    uint32_t delta = at - _current;
+    uint8_t level = 0;
+    while (level < LEVELS - 1 && delta >= (1UL << (SLOT_BITS * (level + 1)))) {
+        level++;
+    }
+
+    uint8_t slot = (at >> (SLOT_BITS * level)) & (SLOTS - 1);
+    _entries[index].next = _slots[level][slot];
+    _slots[level][slot] = index;
+}
+
+/**
+ * @brief Re-insert entries of a slot
+ */
+void MicroSafariScheduler::cascade(uint8_t level, uint8_t slot) {
+    uint8_t index = _slots[level][slot];
+    _slots[level][slot] = NONE;
+
+    while (index != NONE) {
+        uint8_t next = _entries[index].next;
+        insert(index);
+        index = next;
+    }
+}
+
+/**
+ * @brief Process one second
+ */
+void MicroSafariScheduler::tick(uint32_t time) {
+    // Cascaded entries are placed relative to this second; those due now go straight to the due list
+    _current = time;
+
+    // Bring coarser slots down when their range starts, coarsest first
+    if ((time & (SLOTS - 1)) == 0) {
+        uint8_t level = 1;
+        while (level < LEVELS - 1 && ((time >> (SLOT_BITS * level)) & (SLOTS - 1)) == 0) {
+            level++;
+        }
+        for (; level >= 1; level--) {
+            cascade(level, (time >> (SLOT_BITS * level)) & (SLOTS - 1));
+        }
+    }
+
+    uint8_t slot = time & (SLOTS - 1);
+    uint8_t index = _slots[0][slot];
+    _slots[0][slot] = NONE;
+    while (index != NONE) {
+        uint8_t next = _entries[index].next;
+        appendDue(index);
+        index = next;
+    }
+}
+
+/**
+ * @brief Re-insert every waiting entry relative to a new time
+ */
+void MicroSafariScheduler::rebuild(uint32_t now) {
+    // Commands already due stay due, even if the clock moved back
+    bool due[MICROSAFARI_SCHEDULE_MAX] = { false };
+    for (uint8_t index = _dueHead; index != NONE; index = _entries[index].next) {
+        due[index] = true;
+    }
+
+    memset(_slots, NONE, sizeof(_slots));
+    _parked = NONE;
+    _current = now;
+
+    for (uint8_t i = 0; i < MICROSAFARI_SCHEDULE_MAX; i++) {
+        if (_entries[i].used && !due[i]) {
+            insert(i);
+        }
+    }
+}
+
+/**
+ * @brief Schedule a command
+ */
+bool MicroSafariScheduler::schedule(const MicroSafariScheduledCommand& command) {
+    if (_started && command.executeAt > _current && command.executeAt - _current >= SCHEDULER_HORIZON) {
+        return false;
+    }
+
+    for (uint8_t i = 0; i < MICROSAFARI_SCHEDULE_MAX; i++) {
+        if (_entries[i].used) {
+            continue;
+        }
+
+        _entries[i].command = command;
+        _entries[i].used = true;
+        _count++;
+
+        if (_started) {
+            insert(i);
+        } else {
+            _entries[i].next = _parked;
+            _parked = i;
+        }
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * @brief Cancel a scheduled command
+ */
+bool MicroSafariScheduler::cancel(int32_t commandId) {
+    for (uint8_t i = 0; i < MICROSAFARI_SCHEDULE_MAX; i++) {
+        if (_entries[i].used && _entries[i].command.commandId == commandId) {
+            // Unlink from the due list if it is already due
+            uint8_t previous = NONE;
+            for (uint8_t index = _dueHead; index != NONE; index = _entries[index].next) {
+                if (index == i) {
+                    if (previous == NONE) {
+                        _dueHead = _entries[i].next;
+                    } else {
+                        _entries[previous].next = _entries[i].next;
+                    }
+                    if (_dueTail == i) {
+                        _dueTail = previous;
+                    }
+                    break;
+                }
+                previous = index;
+            }
+
+            _entries[i].used = false;
+            _count--;
+
+            // Relink the waiting entries without the cancelled one
+            if (_started) {
+                rebuild(_current);
+            } else {
+                _parked = NONE;
+                for (uint8_t j = 0; j < MICROSAFARI_SCHEDULE_MAX; j++) {
+                    if (_entries[j].used) {
+                        _entries[j].next = _parked;
+                        _parked = j;
+                    }
+                }
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Check if command is held
+ */
+bool MicroSafariScheduler::contains(int32_t commandId) const {
+    for (uint8_t i = 0; i < MICROSAFARI_SCHEDULE_MAX; i++) {
+        if (_entries[i].used && _entries[i].command.commandId == commandId) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Advance wheel to current time
+ */
+void MicroSafariScheduler::advance(uint32_t now) {
+    if (!_started) {
+        _started = true;
+        rebuild(now);
+        return;
+    }
+
+    if (now == _current) {
+        return;
+    }
+
+    // Clock set backwards or far forwards: place everything again
+    if (now < _current || now - _current > SCHEDULER_MAX_STEP) {
+        rebuild(now);
+        return;
+    }
+
+    while (_current != now) {
+        tick(_current + 1);
+    }
+}
+
+/**
+ * @brief Take next due command
+ */
+bool MicroSafariScheduler::popDue(MicroSafariScheduledCommand& command) {
+    if (_dueHead == NONE) {
+        return false;
+    }
+
+    uint8_t index = _dueHead;
+    _dueHead = _entries[index].next;
+    if (_dueHead == NONE) {
+        _dueTail = NONE;
+    }
+
+    command = _entries[index].command;
+    _entries[index].used = false;
+    _entries[index].next = NONE;
+    _count--;
+    return true;
+}
+
+/**
+ * @brief Copy all held commands
+ */
+size_t MicroSafariScheduler::getPending(MicroSafariScheduledCommand* commands, size_t maxCommands) const {
+    size_t count = 0;
+    for (uint8_t i = 0; i < MICROSAFARI_SCHEDULE_MAX && count < maxCommands; i++) {
+        if (_entries[i].used) {
+            commands[count++] = _entries[i].command;
+        }
+    }
+    return count;
+}
+
+/**
+ * @brief Get number of held commands
+ */
+size_t MicroSafariScheduler::getCount() const {
+    return _count;
+}
@@ -0,0 +1,180 @@
+/*!
+ * @file MicroSafariScheduler.h
+ * @brief Hierarchical timer wheel for commands scheduled on the device
+ * @version 1.0.0
+ * @date 2025-08-22
+ *
+ * Commands carrying an execute_at time are held on the device and run
+ * locally when their time comes, independent of poll latency and
+ * connectivity. The wheel has four levels of 64 one-second, 64-second,
+ * 4096-second and 262144-second slots, so scheduling and advancing are
+ * O(1) per command and second, for times up to 194 days ahead.
+ *
+ * Times are Unix seconds; the wheel starts turning once the clock is set
+ * (e.g. via configTime). Commands scheduled before that are parked.
+ *
+ * @section license License
+ * MIT License
+ */
+
+#ifndef MICROSAFARI_SCHEDULER_H
+#define MICROSAFARI_SCHEDULER_H
+
+#include <Arduino.h>
+
+#ifndef MICROSAFARI_SCHEDULE_MAX
+#define MICROSAFARI_SCHEDULE_MAX 16
+#endif
+
+/** @brief Maximum data source length of a scheduled command, including terminator */
+#define MICROSAFARI_SCHEDULE_SOURCE_LENGTH 32
+
+/** @brief Maximum value length of a scheduled command, including terminator */
+#define MICROSAFARI_SCHEDULE_VALUE_LENGTH 32
+
+/** @brief Scheduled command executions acknowledged per request */
+#define MICROSAFARI_ACK_BATCH 16
+
+/** @brief Minimum time between acknowledgment attempts in milliseconds, also when the batch is full */
+#ifndef MICROSAFARI_ACK_RETRY_MS
+#define MICROSAFARI_ACK_RETRY_MS 10000
+#endif
+
+/**
+ * @brief Command held for local execution
+ */
+struct MicroSafariScheduledCommand {
+    uint32_t executeAt;              ///< Unix time in seconds
+    int32_t commandId;               ///< Platform command ID
+    char dataSource[MICROSAFARI_SCHEDULE_SOURCE_LENGTH]; ///< Command data source
+    char value[MICROSAFARI_SCHEDULE_VALUE_LENGTH]; ///< Command value
+};
+
+/**
+ * @brief Execution result waiting for a batched acknowledgment
+ */
+struct MicroSafariCommandAck {
+    int32_t commandId;               ///< Platform command ID
+    uint32_t executedAt;             ///< Unix time of execution
+    uint32_t executeUs;              ///< Time the command handler ran in microseconds
+    bool success;                    ///< Command handler result
+};
+
+/**
+ * @brief Four-level hierarchical timer wheel of scheduled commands
+ */
+class MicroSafariScheduler {
+private:
+    static const uint8_t LEVELS = 4;     ///< Wheel levels
+    static const uint8_t SLOTS = 64;     ///< Slots per level
+    static const uint8_t SLOT_BITS = 6;  ///< log2(SLOTS)
+    static const uint8_t NONE = 0xFF;    ///< End of an entry list
+
+    /**
+     * @brief Pooled command with list link
+     */
+    struct Entry {
+        MicroSafariScheduledCommand command; ///< Scheduled command
+        uint8_t next;                ///< Next entry in the same list
+        bool used;                   ///< Entry holds a command
+    };
+
+    Entry _entries[MICROSAFARI_SCHEDULE_MAX]; ///< Entry pool
+    uint8_t _slots[LEVELS][SLOTS];   ///< List heads per slot
+    uint8_t _parked;                 ///< Commands waiting for the clock
+    uint8_t _dueHead;                ///< Commands ready to run, oldest first
+    uint8_t _dueTail;                ///< Last command ready to run
+    uint32_t _current;               ///< Last processed second
+    bool _started;                   ///< Clock is known
+    size_t _count;                   ///< Commands held
+
+    /**
+     * @brief Internal method to place an entry in the wheel or due list
+     */
+    void insert(uint8_t index);
+
+    /**
+     * @brief Internal method to append an entry to the due list
+     */
+    void appendDue(uint8_t index);
+
+    /**
+     * @brief Internal method to re-insert all entries of a slot
+     */
+    void cascade(uint8_t level, uint8_t slot);
+
+    /**
+     * @brief Internal method to process one second
+     */
+    void tick(uint32_t time);
+
+    /**
+     * @brief Internal method to re-insert every entry relative to a new time
+     */
+    void rebuild(uint32_t now);
+
+public:
+    /**
+     * @brief Constructor for MicroSafariScheduler
+     */
+    MicroSafariScheduler();
+
+    /**
+     * @brief Schedule a command
+     * @param command Command with execution time
+     * @return true if scheduled, false if full or too far ahead
+     */
+    bool schedule(const MicroSafariScheduledCommand& command);
+
+    /**
+     * @brief Cancel a scheduled command
+     * @param commandId Platform command ID
+     * @return true if the command was held and is removed
+     */
+    bool cancel(int32_t commandId);
+
+    /**
+     * @brief Check if a command is held
+     * @param commandId Platform command ID
+     * @return true if the command is waiting or due
+     */
+    bool contains(int32_t commandId) const;
+
+    /**
+     * @brief Advance the wheel to the current time
+     *
+     * Commands whose time has passed move to the due list. Large clock
+     * jumps rebuild the wheel instead of stepping every second.
+     *
+     * @param now Current Unix time in seconds
+     */
+    void advance(uint32_t now);
+
+    /**
+     * @brief Take the next command that is due
+     * @param command Receives the command
+     * @return true if a command was due, false otherwise
+     */
+    bool popDue(MicroSafariScheduledCommand& command);
+
+    /**
+     * @brief Copy all held commands, e.g. for persisting them
+     * @param commands Destination array
+     * @param maxCommands Capacity of destination array
+     * @return Number of commands copied
+     */
+    size_t getPending(MicroSafariScheduledCommand* commands, size_t maxCommands) const;
+
+    /**
+     * @brief Get number of held commands
+     * @return Command count
+     */
+    size_t getCount() const;
+
+    /**
+     * @brief Remove all commands
+     */
+    void clear();
+};
+
+#endif // MICROSAFARI_SCHEDULER_H
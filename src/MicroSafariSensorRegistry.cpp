@@ -0,0 +1,155 @@
+/*!
+ * @file MicroSafariSensorRegistry.cpp
+ * @brief Implementation of the MicroSafari sensor registry
+ * @version 1.0.0
+ * @date 2025-08-22
+ */
+
+#include "MicroSafariSensorRegistry.h"
+#include <limits.h>
+
+/**
+ * @brief Constructor
+ */
+MicroSafariSensorRegistry::MicroSafariSensorRegistry() {
+    memset(_sensors, 0, sizeof(_sensors));
+    _sensorCount = 0;
+}
+
+/**
+ * @brief Find sensor by metric name
+ */
+int MicroSafariSensorRegistry::findSensor(const char* metric) const {
+    if (metric == nullptr) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < _sensorCount; i++) {
+        if (strcmp(_sensors[i].metric, metric) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Check cached value validity
+ */
+bool MicroSafariSensorRegistry::isFresh(const SensorSlot& sensor, unsigned long now) const {
+    return sensor.valid && (sensor.ttl == 0 || now - sensor.lastUpdate <= sensor.ttl);
+}
+
+/**
+ * @brief Register a sensor
+ */
+int MicroSafariSensorRegistry::registerSensor(const char* metric,
+                                              MicroSafariSensorStep step,
+                                              void* context,
+                                              unsigned long minInterval,
+                                              unsigned long ttl) {
+    if (metric == nullptr || metric[0] == '\0' || step == nullptr ||
+        _sensorCount >= MICROSAFARI_MAX_SENSORS || findSensor(metric) >= 0) {
+        return -1;
+    }
+
+    SensorSlot& sensor = _sensors[_sensorCount];
+    memset(&sensor, 0, sizeof(sensor));
+    strncpy(sensor.metric, metric, MICROSAFARI_SENSOR_NAME_LENGTH - 1);
+    sensor.step = step;
+    sensor.context = context;
+    sensor.minInterval = minInterval;
+    sensor.ttl = ttl;
+
+    return _sensorCount++;
+}
+
+/**
+ * @brief Advance all sensors by one step
+ */
+void MicroSafariSensorRegistry::update() {
+    for (size_t i = 0; i < _sensorCount; i++) {
+        SensorSlot& sensor = _sensors[i];
+        unsigned long now = millis();
+
+        if (!sensor.reading) {
+            // First read starts immediately, later ones after the minimum interval
+            if (sensor.reads + sensor.failures > 0 && now - sensor.lastStart < sensor.minInterval) {
+                continue;
+            }
+            sensor.reading = true;
+            sensor.started = false;
+            sensor.lastStart = now;
+        }
+
+        float value = 0;
+        MicroSafariSensorState state = sensor.step(sensor.context, !sensor.started, value);
+        sensor.started = true;
+
+        if (state == MICROSAFARI_SENSOR_READY) {
+            sensor.value = value;
+            sensor.lastUpdate = millis();
+            sensor.valid = true;
+            sensor.reading = false;
+            sensor.reads++;
+        } else if (state == MICROSAFARI_SENSOR_FAILED) {
+            sensor.reading = false;
+            sensor.failures++;
+        }
+    }
+}
+
+/**
+ * @brief Get cached value
+ */
+bool MicroSafariSensorRegistry::getValue(const char* metric, float& value) {
+    int index = findSensor(metric);
+    if (index < 0 || !isFresh(_sensors[index], millis())) {
+        return false;
+    }
+
+    value = _sensors[index].value;
+    return true;
+}
+
+/**
+ * @brief Get age of cached value
+ */
+unsigned long MicroSafariSensorRegistry::getAge(const char* metric) {
+    int index = findSensor(metric);
+    if (index < 0 || !_sensors[index].valid) {
+        return ULONG_MAX;
+    }
+    return millis() - _sensors[index].lastUpdate;
+}
+
+/**
+ * @brief Add valid cached values to a payload
+ */
+size_t MicroSafariSensorRegistry::populate(JsonObject& payload) {
+    unsigned long now = millis();
+    size_t added = 0;
+
+    for (size_t i = 0; i < _sensorCount; i++) {
+        if (isFresh(_sensors[i], now)) {
+            payload[_sensors[i].metric] = _sensors[i].value;
+            added++;
+        }
+    }
+
+    return added;
+}
+
+/**
+ * @brief Get number of registered sensors
+ */
+size_t MicroSafariSensorRegistry::getSensorCount() const {
+    return _sensorCount;
+}
+
+/**
+ * @brief Get failed read count
+ */
+uint32_t MicroSafariSensorRegistry::getFailureCount(const char* metric) {
+    int index = findSensor(metric);
+    return index >= 0 ? _sensors[index].failures : 0;
+}
@@ -0,0 +1,155 @@
+/*!
+ * @file MicroSafariSensorRegistry.h
+ * @brief Registry of non-blocking sensors with cached readings
+ * @version 1.0.0
+ * @date 2025-08-22
+ *
+ * Sensors are registered as small state machines that never block:
+ * the registry calls each sensor's step function from loop() until it
+ * reports a value, respects a minimum interval between reads and keeps
+ * the latest value with a time-to-live. Payloads are built from the
+ * cache, so sending data never waits on sensor hardware.
+ *
+ * @section license License
+ * MIT License
+ */
+
+#ifndef MICROSAFARI_SENSOR_REGISTRY_H
+#define MICROSAFARI_SENSOR_REGISTRY_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+#ifndef MICROSAFARI_MAX_SENSORS
+#define MICROSAFARI_MAX_SENSORS 8
+#endif
+
+/** @brief Maximum metric name length of a registered sensor, including terminator */
+#define MICROSAFARI_SENSOR_NAME_LENGTH 24
+
+/**
+ * @brief Result of one sensor step
+ */
+enum MicroSafariSensorState {
+    MICROSAFARI_SENSOR_PENDING = 0,  ///< Read in progress, call again later
+    MICROSAFARI_SENSOR_READY = 1,    ///< Value is available
+    MICROSAFARI_SENSOR_FAILED = 2    ///< Read failed, retry after the minimum interval
+};
+
+/**
+ * @brief Non-blocking sensor read step
+ *
+ * Called repeatedly from loop() while a read is in progress. The
+ * function must return quickly: trigger a conversion, check whether it
+ * finished, take one sample of an average, and so on.
+ *
+ * @param context User context pointer given at registration
+ * @param start true on the first call of a new read
+ * @param value Receives the reading when returning MICROSAFARI_SENSOR_READY
+ * @return Read state
+ */
+typedef MicroSafariSensorState (*MicroSafariSensorStep)(void* context, bool start, float& value);
+
+/**
+ * @brief Schedules non-blocking sensor reads and caches their values
+ */
+class MicroSafariSensorRegistry {
+private:
+    /**
+     * @brief Registered sensor
+     */
+    struct SensorSlot {
+        char metric[MICROSAFARI_SENSOR_NAME_LENGTH]; ///< Metric name used in payloads
+        MicroSafariSensorStep step;  ///< Read state machine
+        void* context;               ///< User context for the step function
+        unsigned long minInterval;   ///< Minimum time between read starts
+        unsigned long ttl;           ///< Time a cached value stays valid
+        unsigned long lastStart;     ///< millis() when the current/last read started
+        unsigned long lastUpdate;    ///< millis() of the last successful read
+        float value;                 ///< Cached value
+        bool reading;                ///< Read in progress
+        bool started;                ///< Step function was called for the current read
+        bool valid;                  ///< Cached value was ever set
+        uint32_t reads;              ///< Successful reads
+        uint32_t failures;           ///< Failed reads
+    };
+
+    SensorSlot _sensors[MICROSAFARI_MAX_SENSORS]; ///< Registered sensors
+    size_t _sensorCount;             ///< Number of registered sensors
+
+    /**
+     * @brief Internal method to find a sensor by metric name
+     */
+    int findSensor(const char* metric) const;
+
+    /**
+     * @brief Internal method to check whether a cached value is still valid
+     */
+    bool isFresh(const SensorSlot& sensor, unsigned long now) const;
+
+public:
+    /**
+     * @brief Constructor for MicroSafariSensorRegistry
+     */
+    MicroSafariSensorRegistry();
+
+    /**
+     * @brief Register a sensor
+     * @param metric Metric name used in payloads
+     * @param step Non-blocking read state machine
+     * @param context User context passed to the step function
+     * @param minInterval Minimum time between read starts in milliseconds
+     * @param ttl Time a cached value stays valid in milliseconds (0: never expires)
+     * @return Sensor index, -1 if the registry is full or arguments are invalid
+     */
+    int registerSensor(const char* metric,
+                       MicroSafariSensorStep step,
+                       void* context,
+                       unsigned long minInterval,
+                       unsigned long ttl);
+
+    /**
+     * @brief Advance all sensors by one step
+     *
+     * Starts reads whose interval elapsed and steps every read in
+     * progress once, so slow sensors proceed in parallel.
+     */
+    void update();
+
+    /**
+     * @brief Get a cached value if it is still valid
+     * @param metric Metric name
+     * @param value Receives the value
+     * @return true if a valid value is cached, false otherwise
+     */
+    bool getValue(const char* metric, float& value);
+
+    /**
+     * @brief Get age of a cached value
+     * @param metric Metric name
+     * @return Milliseconds since the last successful read, ULONG_MAX if never read
+     */
+    unsigned long getAge(const char* metric);
+
+    /**
+     * @brief Add all valid cached values to a payload
+     * @param payload JSON object to populate
+     * @return Number of values added
+     */
+    size_t populate(JsonObject& payload);
+
+    /**
+     * @brief Get number of registered sensors
+     * @return Sensor count
+     */
+    size_t getSensorCount() const;
+
+    /**
+     * @brief Get failed read count of a sensor
+     * @param metric Metric name
+     * @return Failed reads since registration
+     */
+    uint32_t getFailureCount(const char* metric);
+};
+
+#endif // MICROSAFARI_SENSOR_REGISTRY_H
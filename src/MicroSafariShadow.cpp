@@ -0,0 +1,273 @@
+/*!
+ * @file MicroSafariShadow.cpp
+ * @brief Implementation of the MicroSafari device shadow
+ * @version 1.0.0
+ * @date 2025-08-22
+ */
+
+#include "MicroSafariShadow.h"
+
+/**
+ * @brief Constructor
+ */
+MicroSafariShadow::MicroSafariShadow() {
+    memset(_properties, 0, sizeof(_properties));
+    _count = 0;
+    _changed = 0;
+    _changedSince = 0;
+    _version = 0;
+    _action = nullptr;
+    _actionContext = nullptr;
+}
+
+/**
+ * @brief Find property by name
+ */
+int MicroSafariShadow::findProperty(const char* name) const {
+    if (name == nullptr) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < _count; i++) {
+        if (strcmp(_properties[i].name, name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Mark property as changed
+ */
+void MicroSafariShadow::markChanged(size_t index) {
+    if (_changed == 0) {
+        _changedSince = millis();
+    }
+    _changed |= 1UL << index;
+}
+
+/**
+ * @brief Add property
+ */
+bool MicroSafariShadow::addProperty(const char* name) {
+    if (name == nullptr || name[0] == '\0' || strlen(name) >= MICROSAFARI_SHADOW_NAME_LENGTH) {
+        return false;
+    }
+    if (findProperty(name) >= 0) {
+        return true;
+    }
+    if (_count >= MICROSAFARI_SHADOW_MAX_PROPERTIES) {
+        return false;
+    }
+
+    Property& property = _properties[_count++];
+    memset(&property, 0, sizeof(property));
+    strcpy(property.name, name);
+    return true;
+}
+
+/**
+ * @brief Check whether property is shadowed
+ */
+bool MicroSafariShadow::contains(const char* name) const {
+    return findProperty(name) >= 0;
+}
+
+/**
+ * @brief Set reported value
+ */
+bool MicroSafariShadow::setReported(const char* name, const char* value) {
+    int index = findProperty(name);
+    if (index < 0 || value == nullptr) {
+        return false;
+    }
+
+    Property& property = _properties[index];
+    if (!property.hasReported || strncmp(property.reported, value, MICROSAFARI_SHADOW_VALUE_LENGTH - 1) != 0) {
+        strncpy(property.reported, value, MICROSAFARI_SHADOW_VALUE_LENGTH - 1);
+        property.reported[MICROSAFARI_SHADOW_VALUE_LENGTH - 1] = '\0';
+        property.hasReported = true;
+        markChanged(index);
+    }
+
+    // The actuator reached the desired value by other means
+    if (property.pending && strcmp(property.reported, property.desired) == 0) {
+        property.pending = false;
+    }
+    return true;
+}
+
+/**
+ * @brief Report property again
+ */
+void MicroSafariShadow::touch(const char* name) {
+    int index = findProperty(name);
+    if (index >= 0 && _properties[index].hasReported) {
+        markChanged(index);
+    }
+}
+
+/**
+ * @brief Get reported value
+ */
+const char* MicroSafariShadow::getReported(const char* name) const {
+    int index = findProperty(name);
+    if (index < 0 || !_properties[index].hasReported) {
+        return nullptr;
+    }
+    return _properties[index].reported;
+}
+
+/**
+ * @brief Get desired value
+ */
+const char* MicroSafariShadow::getDesired(const char* name) const {
+    int index = findProperty(name);
+    if (index < 0 || _properties[index].desired[0] == '\0') {
+        return nullptr;
+    }
+    return _properties[index].desired;
+}
+
+/**
+ * @brief Write unreported changes
+ */
+uint32_t MicroSafariShadow::writeReported(JsonObject& shadow) const {
+    if (!shadow["version"].set(_version)) {
+        return 0;
+    }
+    JsonObject reported = shadow.createNestedObject("reported");
+    if (reported.isNull()) {
+        return 0;
+    }
+
+    // A property left out by a full document must stay marked as changed
+    uint32_t written = 0;
+    for (size_t i = 0; i < _count; i++) {
+        if ((_changed & (1UL << i)) && reported[_properties[i].name].set(_properties[i].reported)) {
+            written |= 1UL << i;
+        }
+    }
+    return written;
+}
+
+/**
+ * @brief Forget accepted changes
+ */
+void MicroSafariShadow::clearChanges(uint32_t mask) {
+    _changed &= ~mask;
+}
+
+/**
+ * @brief Merge desired delta
+ */
+size_t MicroSafariShadow::readDesired(const JsonObject& shadow) {
+    uint32_t version = shadow["version"] | 0UL;
+    if (version != 0 && version <= _version) {
+        return 0; // Already applied, e.g. a delta repeated on ingest and poll
+    }
+    if (version != 0) {
+        _version = version;
+    }
+
+    JsonObject desired = shadow["desired"];
+    if (desired.isNull()) {
+        return 0;
+    }
+
+    size_t changed = 0;
+    for (JsonPair pair : desired) {
+        int index = findProperty(pair.key().c_str());
+        if (index < 0) {
+            continue;
+        }
+
+        // Strings are taken as is, numbers and booleans in their JSON form
+        char value[MICROSAFARI_SHADOW_VALUE_LENGTH] = "";
+        if (pair.value().is<const char*>()) {
+            strncpy(value, pair.value().as<const char*>(), MICROSAFARI_SHADOW_VALUE_LENGTH - 1);
+        } else if (!pair.value().isNull()) {
+            serializeJson(pair.value(), value, MICROSAFARI_SHADOW_VALUE_LENGTH);
+        }
+
+        Property& property = _properties[index];
+        if (strcmp(property.desired, value) != 0) {
+            strcpy(property.desired, value);
+            changed++;
+        }
+        property.pending = value[0] != '\0' &&
+                           (!property.hasReported || strcmp(property.reported, value) != 0);
+    }
+    return changed;
+}
+
+/**
+ * @brief Set action handler
+ */
+void MicroSafariShadow::setActionHandler(MicroSafariShadowAction action, void* context) {
+    _action = action;
+    _actionContext = context;
+}
+
+/**
+ * @brief Apply pending desired values
+ */
+size_t MicroSafariShadow::applyDesired() {
+    size_t pending = 0;
+
+    for (size_t i = 0; i < _count; i++) {
+        Property& property = _properties[i];
+        if (!property.pending) {
+            continue;
+        }
+
+        // The handler may report the new value itself, which clears pending
+        if (_action != nullptr && _action(_actionContext, property.name, property.desired)) {
+            setReported(property.name, property.desired);
+            property.pending = false;
+        } else {
+            pending++;
+        }
+    }
+    return pending;
+}
+
+/**
+ * @brief Check for unreported changes
+ */
+bool MicroSafariShadow::hasChanges() const {
+    return _changed != 0;
+}
+
+/**
+ * @brief Get age of oldest unreported change
+ */
+unsigned long MicroSafariShadow::getChangeAge(unsigned long now) const {
+    return _changed != 0 ? now - _changedSince : 0;
+}
+
+/**
+ * @brief Check for pending desired values
+ */
+bool MicroSafariShadow::hasPendingDesired() const {
+    for (size_t i = 0; i < _count; i++) {
+        if (_properties[i].pending) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Get newest desired version
+ */
+uint32_t MicroSafariShadow::getVersion() const {
+    return _version;
+}
+
+/**
+ * @brief Get property count
+ */
+size_t MicroSafariShadow::getCount() const {
+    return _count;
+}
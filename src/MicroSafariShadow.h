@@ -0,0 +1,215 @@
+/*!
+ * @file MicroSafariShadow.h
+ * @brief Device shadow of actuator state
+ * @version 1.0.0
+ * @date 2025-08-22
+ *
+ * The shadow keeps the reported state of idempotent actuators on the
+ * device and the desired state last received from the platform. Only
+ * deltas travel: reported values that changed since the last exchange
+ * ride along with regular ingest requests, and desired values newer
+ * than the version the device has seen come back in poll and ingest
+ * responses. A desired value that differs from the reported one is
+ * applied through the command handlers, so the reported state doubles
+ * as acknowledgment.
+ *
+ * Device report:   "shadow":{"version":12,"reported":{"pump_control":"on"}}
+ * Platform delta:  "shadow":{"version":13,"desired":{"pump_control":"off"}}
+ *
+ * @section license License
+ * MIT License
+ */
+
+#ifndef MICROSAFARI_SHADOW_H
+#define MICROSAFARI_SHADOW_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+#ifndef MICROSAFARI_SHADOW_MAX_PROPERTIES
+#define MICROSAFARI_SHADOW_MAX_PROPERTIES 16
+#endif
+
+#if MICROSAFARI_SHADOW_MAX_PROPERTIES > 32
+#error "MICROSAFARI_SHADOW_MAX_PROPERTIES must not exceed 32"
+#endif
+
+/** @brief Maximum property name length, including terminator */
+#define MICROSAFARI_SHADOW_NAME_LENGTH 24
+
+/** @brief Maximum property value length, including terminator */
+#define MICROSAFARI_SHADOW_VALUE_LENGTH 32
+
+/** @brief JSON capacity of a report with every property: version, reported object, names and values */
+#define MICROSAFARI_SHADOW_REPORT_CAPACITY                                                          \
+    (JSON_OBJECT_SIZE(2) + JSON_OBJECT_SIZE(MICROSAFARI_SHADOW_MAX_PROPERTIES) +                  \
+     MICROSAFARI_SHADOW_MAX_PROPERTIES * (MICROSAFARI_SHADOW_NAME_LENGTH + MICROSAFARI_SHADOW_VALUE_LENGTH))
+
+/**
+ * @brief Handler that drives an actuator to a desired value
+ * @param context Context pointer given to setActionHandler
+ * @param name Property name, used as command data source
+ * @param value Desired value
+ * @return true if the actuator now has the value
+ */
+typedef bool (*MicroSafariShadowAction)(void* context, const char* name, const char* value);
+
+/**
+ * @brief Reported and desired state of shadowed properties
+ */
+class MicroSafariShadow {
+private:
+    /**
+     * @brief Shadowed property
+     */
+    struct Property {
+        char name[MICROSAFARI_SHADOW_NAME_LENGTH]; ///< Property name
+        char reported[MICROSAFARI_SHADOW_VALUE_LENGTH]; ///< Value the actuator has
+        char desired[MICROSAFARI_SHADOW_VALUE_LENGTH]; ///< Value the platform asked for
+        bool hasReported;            ///< reported holds a value
+        bool pending;                ///< desired still has to be applied
+    };
+
+    Property _properties[MICROSAFARI_SHADOW_MAX_PROPERTIES]; ///< Shadowed properties
+    size_t _count;                   ///< Number of properties
+    uint32_t _changed;               ///< Bit per property with an unreported change
+    unsigned long _changedSince;     ///< millis() when the oldest unreported change happened
+    uint32_t _version;               ///< Newest desired version received
+    MicroSafariShadowAction _action; ///< Applies desired values
+    void* _actionContext;            ///< Context for the action handler
+
+    /**
+     * @brief Internal method to find a property by name
+     */
+    int findProperty(const char* name) const;
+
+    /**
+     * @brief Internal method to mark a property as changed
+     */
+    void markChanged(size_t index);
+
+public:
+    /**
+     * @brief Constructor for MicroSafariShadow
+     */
+    MicroSafariShadow();
+
+    /**
+     * @brief Add a property to the shadow
+     * @param name Property name, the command data source of the actuator
+     * @return true if added or already present, false if the table is full or the name is invalid
+     */
+    bool addProperty(const char* name);
+
+    /**
+     * @brief Check whether a property is shadowed
+     * @param name Property name
+     * @return true if the property is in the shadow
+     */
+    bool contains(const char* name) const;
+
+    /**
+     * @brief Set the reported value of a property
+     *
+     * The value is reported with the next exchange if it differs from
+     * the last reported value.
+     *
+     * @param name Property name
+     * @param value Current actuator value
+     * @return true if the property is shadowed
+     */
+    bool setReported(const char* name, const char* value);
+
+    /**
+     * @brief Report a property again with the next exchange
+     * @param name Property name
+     */
+    void touch(const char* name);
+
+    /**
+     * @brief Get the reported value of a property
+     * @param name Property name
+     * @return Reported value, nullptr if unknown
+     */
+    const char* getReported(const char* name) const;
+
+    /**
+     * @brief Get the desired value of a property
+     * @param name Property name
+     * @return Desired value, nullptr if the platform sent none
+     */
+    const char* getDesired(const char* name) const;
+
+    /**
+     * @brief Write unreported changes into a shadow object
+     * @param shadow JSON object receiving "version" and "reported"
+     * @return Bit mask of the properties that fit into the document, for clearChanges
+     */
+    uint32_t writeReported(JsonObject& shadow) const;
+
+    /**
+     * @brief Forget changes that the platform accepted
+     * @param mask Bit mask returned by writeReported
+     */
+    void clearChanges(uint32_t mask);
+
+    /**
+     * @brief Merge a desired delta from the platform
+     *
+     * Deltas with a version older than the newest one seen are ignored.
+     * Desired values for properties that are not shadowed are skipped.
+     *
+     * @param shadow JSON object with "version" and "desired"
+     * @return Number of properties whose desired value changed
+     */
+    size_t readDesired(const JsonObject& shadow);
+
+    /**
+     * @brief Set handler that applies desired values
+     * @param action Handler, nullptr to disable applying
+     * @param context Context pointer passed to the handler
+     */
+    void setActionHandler(MicroSafariShadowAction action, void* context);
+
+    /**
+     * @brief Apply desired values that differ from the reported ones
+     *
+     * Values that fail stay pending and are tried again on the next call.
+     *
+     * @return Number of properties still pending
+     */
+    size_t applyDesired();
+
+    /**
+     * @brief Check for unreported changes
+     * @return true if a change waits to be reported
+     */
+    bool hasChanges() const;
+
+    /**
+     * @brief Get age of the oldest unreported change
+     * @param now Current millis()
+     * @return Milliseconds, 0 if nothing is pending
+     */
+    unsigned long getChangeAge(unsigned long now) const;
+
+    /**
+     * @brief Check for desired values not yet applied
+     * @return true if a desired value is pending
+     */
+    bool hasPendingDesired() const;
+
+    /**
+     * @brief Get newest desired version received
+     * @return Desired version, 0 if none was received since boot
+     */
+    uint32_t getVersion() const;
+
+    /**
+     * @brief Get number of shadowed properties
+     * @return Property count
+     */
+    size_t getCount() const;
+};
+
+#endif // MICROSAFARI_SHADOW_H
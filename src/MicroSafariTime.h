@@ -0,0 +1,24 @@
+/*!
+ * @file MicroSafariTime.h
+ * @brief Wall clock validity threshold shared by the library modules
+ * @version 1.0.0
+ * @date 2025-08-22
+ *
+ * The clock starts at 1970 after boot until the application sets it,
+ * e.g. with configTime(). Modules that stamp readings, events or
+ * archive records with Unix time check it against the same threshold,
+ * so they agree on whether the clock is set.
+ *
+ * @section license License
+ * MIT License
+ */
+
+#ifndef MICROSAFARI_TIME_H
+#define MICROSAFARI_TIME_H
+
+#include <Arduino.h>
+
+/** @brief Unix time from which the clock counts as set, 2020-09-13 */
+#define MICROSAFARI_EPOCH_VALID 1600000000
+
+#endif // MICROSAFARI_TIME_H
@@ -0,0 +1,620 @@
+/*!
+ * @file MicroSafariUpdate.cpp
+ * @brief Implementation of MicroSafari delta firmware updates
+ * @version 1.0.0
+ * @date 2025-08-22
+ */
+
+#include "MicroSafariUpdate.h"
+#include <Preferences.h>
+#include <esp_ota_ops.h>
+
+// Same NVS namespace as the rest of the library
+static const char* UPDATE_PREFERENCES_NAMESPACE = "microsafari";
+static const char* UPDATE_SESSION_KEY = "ota";
+static const char* UPDATE_CURSOR_KEY = "ota_pos";
+
+// Parser states
+#define UPDATE_STATE_HEADER 0
+#define UPDATE_STATE_OPCODE 1
+#define UPDATE_STATE_OPERANDS 2
+#define UPDATE_STATE_DATA 3
+#define UPDATE_STATE_RAW 4
+#define UPDATE_STATE_DONE 5
+
+// Delta operations
+#define DELTA_COPY 1
+#define DELTA_ADD 2
+#define DELTA_INSERT 3
+
+/**
+ * @brief Update as stored in NVS; the apply position is stored separately
+ */
+struct StoredUpdateSession {
+    char version[MICROSAFARI_UPDATE_VERSION_LENGTH];
+    char url[MICROSAFARI_UPDATE_URL_LENGTH];
+    uint8_t delta;
+    uint32_t patchSize;
+    uint32_t imageSize;
+    uint32_t imageCrc;
+    uint32_t targetAddress;
+};
+
+/**
+ * @brief Read little-endian 32-bit value
+ */
+static uint32_t readLe32(const uint8_t* bytes) {
+    return (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) | ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+}
+
+/**
+ * @brief Constructor
+ */
+MicroSafariUpdate::MicroSafariUpdate() {
+    _connection = nullptr;
+    _currentVersion[0] = '\0';
+    _version[0] = '\0';
+    _url[0] = '\0';
+    _delta = false;
+    _fullOnly = false;
+    _imageCrc = 0;
+    memset(&_cursor, 0, sizeof(_cursor));
+    _source = nullptr;
+    _target = nullptr;
+    _status = MICROSAFARI_UPDATE_IDLE;
+    _failure = nullptr;
+    _nextAttempt = 0;
+    _backoff = 0;
+    _interrupted = false;
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+/**
+ * @brief Start checking for updates
+ */
+bool MicroSafariUpdate::begin(MicroSafari& connection, const char* currentVersion) {
+    if (currentVersion == nullptr || currentVersion[0] == '\0' ||
+        strlen(currentVersion) >= MICROSAFARI_UPDATE_VERSION_LENGTH) {
+        return false;
+    }
+
+    _connection = &connection;
+    _source = esp_ota_get_running_partition();
+    _target = esp_ota_get_next_update_partition(nullptr);
+    if (_source == nullptr || _target == nullptr) {
+        _connection->debugPrint("Update: partition table has no OTA partition");
+        return false;
+    }
+    if (_target->encrypted) {
+        // Encrypted partitions only take 16-byte aligned writes
+        _connection->debugPrint("Update: flash encryption is not supported");
+        return false;
+    }
+
+    strcpy(_currentVersion, currentVersion);
+    _version[0] = '\0';
+    _fullOnly = false;
+    _status = MICROSAFARI_UPDATE_IDLE;
+    _nextAttempt = millis();
+    _backoff = 0;
+    _interrupted = false;
+    memset(&_stats, 0, sizeof(_stats));
+
+    // Pick up an update left by an interrupted run
+    StoredUpdateSession stored;
+    bool found = false;
+    Preferences preferences;
+    if (preferences.begin(UPDATE_PREFERENCES_NAMESPACE, true)) {
+        found = preferences.getBytes(UPDATE_SESSION_KEY, &stored, sizeof(stored)) == sizeof(stored) &&
+                preferences.getBytes(UPDATE_CURSOR_KEY, &_cursor, sizeof(_cursor)) == sizeof(_cursor);
+        preferences.end();
+    }
+    if (!found) {
+        memset(&_cursor, 0, sizeof(_cursor));
+        return true;
+    }
+
+    stored.version[MICROSAFARI_UPDATE_VERSION_LENGTH - 1] = '\0';
+    stored.url[MICROSAFARI_UPDATE_URL_LENGTH - 1] = '\0';
+    // After the new image booted, or once another image was flashed, the session is stale
+    if (strcmp(stored.version, _currentVersion) == 0 || stored.targetAddress != _target->address ||
+        _cursor.patchOffset > stored.patchSize || _cursor.imageOffset > stored.imageSize) {
+        clearSession();
+        memset(&_cursor, 0, sizeof(_cursor));
+        return true;
+    }
+
+    strcpy(_version, stored.version);
+    strcpy(_url, stored.url);
+    _delta = stored.delta != 0;
+    _imageCrc = stored.imageCrc;
+    _stats.patchBytes = stored.patchSize;
+    _stats.imageBytes = stored.imageSize;
+    _stats.savedBytes = _delta && stored.imageSize > stored.patchSize ? stored.imageSize - stored.patchSize : 0;
+    _status = MICROSAFARI_UPDATE_IN_PROGRESS;
+    _interrupted = _cursor.patchOffset > 0;
+    _connection->debugPrint("Update to " + String(_version) + " resumes at " + String(_cursor.patchOffset) + "/" +
+                            String(_stats.patchBytes));
+    return true;
+}
+
+/**
+ * @brief Make progress with one request
+ */
+MicroSafariUpdateStatus MicroSafariUpdate::step() {
+    if (_connection == nullptr || _status == MICROSAFARI_UPDATE_READY || _status == MICROSAFARI_UPDATE_FAILED ||
+        !_connection->isWiFiConnected() || (long)(millis() - _nextAttempt) < 0) {
+        return _status;
+    }
+
+    bool progressed = _status == MICROSAFARI_UPDATE_IN_PROGRESS ? applyWindow() : checkForUpdate();
+
+    if (_status == MICROSAFARI_UPDATE_READY || _status == MICROSAFARI_UPDATE_FAILED) {
+        return _status;
+    }
+
+    if (progressed) {
+        _backoff = 0;
+    } else {
+        // Back off from 2 seconds up to a minute while the link is unstable
+        _backoff = _backoff == 0 ? 2000 : min(_backoff * 2, 60000UL);
+        _nextAttempt = millis() + _backoff;
+    }
+    return _status;
+}
+
+/**
+ * @brief Ask server for update
+ */
+bool MicroSafariUpdate::checkForUpdate() {
+    DynamicJsonDocument doc(256);
+    doc["device_name"] = _connection->_deviceName;
+    doc["version"] = (const char*)_currentVersion;
+    doc["delta"] = !_fullOnly;
+
+    String jsonString;
+    serializeJson(doc, jsonString);
+
+    MicroSafariResponse response = _connection->performBinaryRequest("/api/firmware/update", "POST",
+                                                                     (const uint8_t*)jsonString.c_str(),
+                                                                     jsonString.length(), nullptr, 0);
+    if (response.httpCode == HTTP_CODE_NO_CONTENT || response.httpCode == HTTP_CODE_NOT_MODIFIED) {
+        _status = MICROSAFARI_UPDATE_UP_TO_DATE;
+        _nextAttempt = millis() + MICROSAFARI_UPDATE_CHECK_INTERVAL;
+        return true;
+    }
+    if (!response.success) {
+        return false;
+    }
+
+    DynamicJsonDocument offer(512);
+    if (deserializeJson(offer, response.payload) != DeserializationError::Ok) {
+        _status = MICROSAFARI_UPDATE_FAILED;
+        _connection->debugPrint("Update: invalid offer");
+        return false;
+    }
+    const char* version = offer["version"];
+    const char* format = offer["format"];
+    const char* url = offer["url"];
+    uint32_t patchSize = offer["size"] | 0UL;
+    uint32_t imageSize = offer["image_size"] | 0UL;
+    bool delta = format != nullptr && strcmp(format, "delta") == 0;
+
+    if (version == nullptr || version[0] == '\0' || strlen(version) >= MICROSAFARI_UPDATE_VERSION_LENGTH ||
+        url == nullptr || url[0] == '\0' || strlen(url) >= MICROSAFARI_UPDATE_URL_LENGTH ||
+        (!delta && (format == nullptr || strcmp(format, "full") != 0)) || patchSize == 0 || imageSize == 0 ||
+        (!delta && patchSize != imageSize)) {
+        _status = MICROSAFARI_UPDATE_FAILED;
+        _connection->debugPrint("Update: invalid offer");
+        return false;
+    }
+    if (imageSize > _target->size) {
+        _status = MICROSAFARI_UPDATE_FAILED;
+        _connection->debugPrint("Update: " + String(imageSize) + " byte image does not fit partition " +
+                                String(_target->label));
+        return false;
+    }
+
+    strcpy(_version, version);
+    strcpy(_url, url);
+    _delta = delta;
+    _imageCrc = offer["image_crc32"] | 0UL;
+    memset(&_cursor, 0, sizeof(_cursor));
+    _cursor.state = _delta ? UPDATE_STATE_HEADER : UPDATE_STATE_RAW;
+    _cursor.remaining = _delta ? 0 : imageSize;
+    memset(&_stats, 0, sizeof(_stats));
+    _stats.patchBytes = patchSize;
+    _stats.imageBytes = imageSize;
+    _stats.savedBytes = _delta && imageSize > patchSize ? imageSize - patchSize : 0;
+    _interrupted = false;
+    _status = MICROSAFARI_UPDATE_IN_PROGRESS;
+    saveSession();
+
+    _connection->debugPrint("Update to " + String(_version) + ": " + String(patchSize) + " byte " +
+                            (_delta ? "delta" : "image") + " for a " + String(imageSize) + " byte image");
+    return true;
+}
+
+/**
+ * @brief Download and apply next window
+ */
+bool MicroSafariUpdate::applyWindow() {
+    // A checkpoint taken after the last window restores a fully applied patch
+    if (_cursor.patchOffset >= _stats.patchBytes) {
+        finish();
+        return true;
+    }
+    if (_interrupted) {
+        _stats.resumes++;
+        _interrupted = false;
+    }
+
+    uint32_t offset = _cursor.patchOffset;
+    uint32_t length = min((uint32_t)MICROSAFARI_UPDATE_WINDOW, _stats.patchBytes - offset);
+    bool fullOnly = _fullOnly;
+    _failure = nullptr;
+    MicroSafariResponse response = _connection->performDownloadRequest(_url, offset, length, receive, this);
+
+    if (_failure != nullptr) {
+        _connection->debugPrint("Update to " + String(_version) + " rejected: " + _failure);
+        if (_fullOnly && !fullOnly) {
+            // The server does not know the running image; ask for the full one once
+            restartSession();
+        } else {
+            _status = MICROSAFARI_UPDATE_FAILED;
+            clearSession();
+        }
+        return false;
+    }
+    if (response.httpCode == 404 || response.httpCode == 410 || response.httpCode == 416) {
+        // Patch withdrawn or replaced; ask for the current offer
+        _connection->debugPrint("Update to " + String(_version) + " withdrawn, checking again");
+        restartSession();
+        return false;
+    }
+    if (!response.success || _cursor.patchOffset == offset) {
+        // Bytes applied so far stay applied; the next window starts after them
+        _interrupted = true;
+        return false;
+    }
+
+    if (_cursor.patchOffset >= _stats.patchBytes) {
+        finish();
+    }
+    return true;
+}
+
+/**
+ * @brief Verify and select new image
+ */
+void MicroSafariUpdate::finish() {
+    uint32_t crc = 0;
+    const char* failure = nullptr;
+    if (_cursor.state != UPDATE_STATE_DONE) {
+        failure = "patch ended before the image was complete";
+    } else if (!partitionCrc(_target, _stats.imageBytes, crc) || crc != _imageCrc) {
+        failure = "image CRC mismatch";
+    } else if (esp_ota_set_boot_partition(_target) != ESP_OK) {
+        failure = "image failed validation";
+    }
+    clearSession();
+
+    if (failure != nullptr) {
+        _status = MICROSAFARI_UPDATE_FAILED;
+        _connection->debugPrint("Update to " + String(_version) + " failed: " + failure);
+        return;
+    }
+
+    _status = MICROSAFARI_UPDATE_READY;
+    _connection->debugPrint("Update to " + String(_version) + " ready in " + String(_target->label) + " (" +
+                            String(_stats.downloadedBytes) + " bytes downloaded, " + String(_stats.savedBytes) +
+                            " saved, " + String(_stats.resumes) + " resumes)");
+    sendReport();
+}
+
+/**
+ * @brief Send transfer counters to server
+ */
+void MicroSafariUpdate::sendReport() {
+    DynamicJsonDocument doc(384);
+    doc["device_name"] = _connection->_deviceName;
+    doc["version"] = (const char*)_version;
+    doc["format"] = _delta ? "delta" : "full";
+    doc["patch_bytes"] = _stats.patchBytes;
+    doc["image_bytes"] = _stats.imageBytes;
+    doc["downloaded_bytes"] = _stats.downloadedBytes;
+    doc["saved_bytes"] = _stats.savedBytes;
+    doc["resumes"] = _stats.resumes;
+
+    String jsonString;
+    serializeJson(doc, jsonString);
+
+    // Best effort; the update does not depend on it
+    _connection->performBinaryRequest("/api/firmware/update/report", "POST", (const uint8_t*)jsonString.c_str(),
+                                      jsonString.length(), nullptr, 0);
+}
+
+/**
+ * @brief Pass downloaded bytes to apply()
+ */
+bool MicroSafariUpdate::receive(void* context, const uint8_t* data, size_t length) {
+    MicroSafariUpdate* update = static_cast<MicroSafariUpdate*>(context);
+    update->_stats.downloadedBytes += length;
+    return update->apply(data, length);
+}
+
+/**
+ * @brief Apply patch bytes
+ */
+bool MicroSafariUpdate::apply(const uint8_t* data, size_t length) {
+    if (length > _stats.patchBytes - _cursor.patchOffset) {
+        _failure = "patch longer than announced";
+        return false;
+    }
+
+    // COPY produces image bytes without patch bytes, also after the last one
+    while (length > 0 || (_cursor.state == UPDATE_STATE_DATA && _cursor.opcode == DELTA_COPY)) {
+        size_t used = 0;
+
+        if (_cursor.state == UPDATE_STATE_HEADER || _cursor.state == UPDATE_STATE_OPCODE ||
+            _cursor.state == UPDATE_STATE_OPERANDS) {
+            size_t size = _cursor.state == UPDATE_STATE_HEADER ? MICROSAFARI_UPDATE_HEADER_SIZE :
+                          _cursor.state == UPDATE_STATE_OPCODE ? 1 :
+                          _cursor.opcode == DELTA_INSERT ? 4 : 8;
+            used = collect(data, length, size);
+            _cursor.patchOffset += used;
+            if (_cursor.fill == size && !parseField()) {
+                return false;
+            }
+        } else if (_cursor.state == UPDATE_STATE_DATA || _cursor.state == UPDATE_STATE_RAW) {
+            bool fromPatch = _cursor.state == UPDATE_STATE_RAW || _cursor.opcode != DELTA_COPY;
+            bool fromSource = _cursor.state == UPDATE_STATE_DATA && _cursor.opcode != DELTA_INSERT;
+
+            // Pieces never cross a sector, so every sector is erased right before its first write
+            size_t piece = min(_cursor.remaining,
+                               (uint32_t)(MICROSAFARI_FLASH_SECTOR_SIZE - _cursor.imageOffset % MICROSAFARI_FLASH_SECTOR_SIZE));
+            if (fromPatch) {
+                piece = min(piece, length);
+            }
+            const uint8_t* bytes = data;
+            if (fromSource) {
+                piece = min(piece, sizeof(_buffer));
+                if (esp_partition_read(_source, _cursor.sourceOffset, _buffer, piece) != ESP_OK) {
+                    _failure = "cannot read the running image";
+                    return false;
+                }
+                if (_cursor.opcode == DELTA_ADD) {
+                    for (size_t i = 0; i < piece; i++) {
+                        _buffer[i] += data[i];
+                    }
+                }
+                _cursor.sourceOffset += piece;
+                bytes = _buffer;
+            }
+            if (!writeImage(bytes, piece)) {
+                return false;
+            }
+
+            used = fromPatch ? piece : 0;
+            _cursor.patchOffset += used;
+            _cursor.imageOffset += piece;
+            _cursor.remaining -= piece;
+            if (_cursor.remaining == 0) {
+                _cursor.state = _cursor.state == UPDATE_STATE_RAW || _cursor.imageOffset == _stats.imageBytes ?
+                                UPDATE_STATE_DONE : UPDATE_STATE_OPCODE;
+            }
+            if (_cursor.imageOffset % MICROSAFARI_UPDATE_CHECKPOINT == 0) {
+                saveCursor();
+            }
+        } else {
+            _failure = "data after the end of the image";
+            return false;
+        }
+
+        data += used;
+        length -= used;
+    }
+    return true;
+}
+
+/**
+ * @brief Collect header or operand bytes
+ */
+size_t MicroSafariUpdate::collect(const uint8_t* data, size_t length, size_t size) {
+    size_t count = min(length, size - _cursor.fill);
+    memcpy(_cursor.field + _cursor.fill, data, count);
+    _cursor.fill += count;
+    return count;
+}
+
+/**
+ * @brief Act on complete field
+ */
+bool MicroSafariUpdate::parseField() {
+    const uint8_t* field = _cursor.field;
+    _cursor.fill = 0;
+
+    if (_cursor.state == UPDATE_STATE_HEADER) {
+        uint32_t sourceSize = readLe32(field + 4);
+        uint32_t sourceCrc = readLe32(field + 8);
+        if (memcmp(field, "MSD1", 4) != 0 || readLe32(field + 12) != _stats.imageBytes ||
+            readLe32(field + 16) != _imageCrc) {
+            _failure = "delta header does not match the offer";
+            return false;
+        }
+        uint32_t crc = 0;
+        if (sourceSize > _source->size || !partitionCrc(_source, sourceSize, crc) || crc != sourceCrc) {
+            _failure = "running image does not match the delta";
+            _fullOnly = true;
+            return false;
+        }
+        _cursor.state = UPDATE_STATE_OPCODE;
+        return true;
+    }
+
+    if (_cursor.state == UPDATE_STATE_OPCODE) {
+        _cursor.opcode = field[0];
+        if (_cursor.opcode != DELTA_COPY && _cursor.opcode != DELTA_ADD && _cursor.opcode != DELTA_INSERT) {
+            _failure = "unknown delta operation";
+            return false;
+        }
+        _cursor.state = UPDATE_STATE_OPERANDS;
+        return true;
+    }
+
+    if (_cursor.opcode == DELTA_INSERT) {
+        _cursor.remaining = readLe32(field);
+    } else {
+        _cursor.sourceOffset = readLe32(field);
+        _cursor.remaining = readLe32(field + 4);
+        if (_cursor.remaining > _source->size || _cursor.sourceOffset > _source->size - _cursor.remaining) {
+            _failure = "delta operation outside the running image";
+            return false;
+        }
+    }
+    if (_cursor.remaining > _stats.imageBytes - _cursor.imageOffset) {
+        _failure = "delta operation past the end of the image";
+        return false;
+    }
+    _cursor.state = _cursor.remaining > 0 ? UPDATE_STATE_DATA : UPDATE_STATE_OPCODE;
+    return true;
+}
+
+/**
+ * @brief Write image bytes within one sector
+ */
+bool MicroSafariUpdate::writeImage(const uint8_t* data, size_t length) {
+    if (_cursor.imageOffset % MICROSAFARI_FLASH_SECTOR_SIZE == 0 &&
+        esp_partition_erase_range(_target, _cursor.imageOffset, MICROSAFARI_FLASH_SECTOR_SIZE) != ESP_OK) {
+        _failure = "flash erase failed";
+        return false;
+    }
+    if (esp_partition_write(_target, _cursor.imageOffset, data, length) != ESP_OK) {
+        _failure = "flash write failed";
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Compute CRC-32 of partition range
+ */
+bool MicroSafariUpdate::partitionCrc(const esp_partition_t* partition, uint32_t length, uint32_t& crc) {
+    crc = 0;
+    for (uint32_t offset = 0; offset < length; offset += sizeof(_buffer)) {
+        size_t count = min((uint32_t)sizeof(_buffer), length - offset);
+        if (esp_partition_read(partition, offset, _buffer, count) != ESP_OK) {
+            return false;
+        }
+        crc = microSafariCrc32(_buffer, count, crc);
+    }
+    return true;
+}
+
+/**
+ * @brief Forget update and start over
+ */
+void MicroSafariUpdate::restartSession() {
+    clearSession();
+    _version[0] = '\0';
+    memset(&_cursor, 0, sizeof(_cursor));
+    _interrupted = false;
+    _status = MICROSAFARI_UPDATE_IDLE;
+}
+
+/**
+ * @brief Store session in NVS
+ */
+void MicroSafariUpdate::saveSession() {
+    StoredUpdateSession stored;
+    memset(&stored, 0, sizeof(stored));
+    strcpy(stored.version, _version);
+    strcpy(stored.url, _url);
+    stored.delta = _delta ? 1 : 0;
+    stored.patchSize = _stats.patchBytes;
+    stored.imageSize = _stats.imageBytes;
+    stored.imageCrc = _imageCrc;
+    stored.targetAddress = _target->address;
+
+    Preferences preferences;
+    if (preferences.begin(UPDATE_PREFERENCES_NAMESPACE, false)) {
+        preferences.putBytes(UPDATE_SESSION_KEY, &stored, sizeof(stored));
+        preferences.putBytes(UPDATE_CURSOR_KEY, &_cursor, sizeof(_cursor));
+        preferences.end();
+    }
+}
+
+/**
+ * @brief Store apply position in NVS
+ */
+void MicroSafariUpdate::saveCursor() {
+    Preferences preferences;
+    if (preferences.begin(UPDATE_PREFERENCES_NAMESPACE, false)) {
+        preferences.putBytes(UPDATE_CURSOR_KEY, &_cursor, sizeof(_cursor));
+        preferences.end();
+        _stats.checkpoints++;
+    }
+}
+
+/**
+ * @brief Remove session from NVS
+ */
+void MicroSafariUpdate::clearSession() {
+    Preferences preferences;
+    if (preferences.begin(UPDATE_PREFERENCES_NAMESPACE, false)) {
+        preferences.remove(UPDATE_SESSION_KEY);
+        preferences.remove(UPDATE_CURSOR_KEY);
+        preferences.end();
+    }
+}
+
+/**
+ * @brief Check on next step
+ */
+void MicroSafariUpdate::checkNow() {
+    if (_status != MICROSAFARI_UPDATE_IN_PROGRESS) {
+        _status = MICROSAFARI_UPDATE_IDLE;
+        _fullOnly = false;
+    }
+    _nextAttempt = millis();
+}
+
+/**
+ * @brief Abandon update
+ */
+void MicroSafariUpdate::cancel() {
+    if (_status == MICROSAFARI_UPDATE_IN_PROGRESS) {
+        clearSession();
+    }
+    _version[0] = '\0';
+    _status = MICROSAFARI_UPDATE_IDLE;
+    _nextAttempt = millis() + MICROSAFARI_UPDATE_CHECK_INTERVAL;
+}
+
+/**
+ * @brief Get update state
+ */
+MicroSafariUpdateStatus MicroSafariUpdate::getStatus() const {
+    return _status;
+}
+
+/**
+ * @brief Get version being installed
+ */
+const char* MicroSafariUpdate::getVersion() const {
+    return _version;
+}
+
+/**
+ * @brief Get patch offset
+ */
+uint32_t MicroSafariUpdate::getOffset() const {
+    return _cursor.patchOffset;
+}
+
+/**
+ * @brief Get transfer counters
+ */
+const MicroSafariUpdateStats& MicroSafariUpdate::getStats() const {
+    return _stats;
+}
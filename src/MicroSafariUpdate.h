@@ -0,0 +1,273 @@
+/*!
+ * @file MicroSafariUpdate.h
+ * @brief Resumable delta firmware updates over the platform connection
+ * @version 1.0.0
+ * @date 2025-08-22
+ *
+ * A full application image is 1-2 MB, which takes minutes over a weak
+ * link and starts over on every drop. MicroSafariUpdate downloads a
+ * binary delta against the running image instead, through the same
+ * authenticated keep-alive connection as the rest of the library. The
+ * delta is applied while it streams in: every operation copies bytes
+ * from the running partition, adds patch bytes to them, or inserts
+ * patch bytes, and the result is written straight into the next OTA
+ * partition. RAM use is constant and independent of the image size.
+ *
+ * The patch is fetched in ranged windows. After a dropped link the next
+ * window starts at the first byte not yet applied. The position in the
+ * patch and the image is stored in NVS every
+ * MICROSAFARI_UPDATE_CHECKPOINT image bytes, so an update also resumes
+ * after a reboot.
+ *
+ * Protocol:
+ * - POST /api/firmware/update {"device_name","version","delta"}
+ *   -> 204, or {"version","format","url","size","image_size","image_crc32"}
+ * - GET <url> with Range: bytes=a-b -> 206 patch bytes
+ * - POST /api/firmware/update/report {"device_name","version","format",
+ *   "patch_bytes","image_bytes","downloaded_bytes","saved_bytes","resumes"}
+ *
+ * Delta format ("format": "delta", little endian):
+ * - Header: "MSD1", source size, source CRC-32, image size, image CRC-32
+ * - 0x01 COPY   source offset, length:        image += source[offset, offset + length)
+ * - 0x02 ADD    source offset, length, bytes: image += source[offset + i] + bytes[i]
+ * - 0x03 INSERT length, bytes:                image += bytes
+ *
+ * A "full" update is the plain application image. When the running
+ * image does not match the source CRC of a delta, the update starts
+ * over with a full image.
+ *
+ * @section license License
+ * MIT License
+ */
+
+#ifndef MICROSAFARI_UPDATE_H
+#define MICROSAFARI_UPDATE_H
+
+#include "MicroSafari.h"
+#include <esp_partition.h>
+
+/** @brief Patch bytes requested per window */
+#ifndef MICROSAFARI_UPDATE_WINDOW
+#define MICROSAFARI_UPDATE_WINDOW 16384
+#endif
+
+/** @brief Image bytes between NVS checkpoints, a multiple of the flash sector size */
+#ifndef MICROSAFARI_UPDATE_CHECKPOINT
+#define MICROSAFARI_UPDATE_CHECKPOINT 65536
+#endif
+
+#if MICROSAFARI_UPDATE_CHECKPOINT % MICROSAFARI_FLASH_SECTOR_SIZE != 0
+#error "MICROSAFARI_UPDATE_CHECKPOINT must be a multiple of MICROSAFARI_FLASH_SECTOR_SIZE"
+#endif
+
+/** @brief Time between update checks in milliseconds */
+#ifndef MICROSAFARI_UPDATE_CHECK_INTERVAL
+#define MICROSAFARI_UPDATE_CHECK_INTERVAL 3600000
+#endif
+
+/** @brief Size of the source read buffer */
+#define MICROSAFARI_UPDATE_BUFFER_SIZE 512
+
+/** @brief Size of the delta header */
+#define MICROSAFARI_UPDATE_HEADER_SIZE 20
+
+/** @brief Maximum firmware version length, including terminator */
+#define MICROSAFARI_UPDATE_VERSION_LENGTH 32
+
+/** @brief Maximum patch URL length, including terminator */
+#define MICROSAFARI_UPDATE_URL_LENGTH 128
+
+/**
+ * @brief Update state
+ */
+enum MicroSafariUpdateStatus {
+    MICROSAFARI_UPDATE_IDLE = 0,         ///< Not started
+    MICROSAFARI_UPDATE_UP_TO_DATE = 1,   ///< No update offered; checked again later
+    MICROSAFARI_UPDATE_IN_PROGRESS = 2,  ///< Call step() until the update ends
+    MICROSAFARI_UPDATE_READY = 3,        ///< Image verified and selected; restart to run it
+    MICROSAFARI_UPDATE_FAILED = 4        ///< Rejected, invalid or no room for the image
+};
+
+/**
+ * @brief Update transfer counters
+ */
+struct MicroSafariUpdateStats {
+    uint32_t patchBytes;             ///< Size of the download offered by the server
+    uint32_t imageBytes;             ///< Size of the new image
+    uint32_t downloadedBytes;        ///< Patch bytes received, including ones received again
+    uint32_t savedBytes;             ///< Image bytes not downloaded thanks to the delta
+    uint32_t resumes;                ///< Windows restarted after an interruption or reboot
+    uint32_t checkpoints;            ///< Positions stored in NVS
+};
+
+/**
+ * @brief Delta firmware update through a MicroSafari connection
+ */
+class MicroSafariUpdate {
+private:
+    /**
+     * @brief Position in the patch and the image, stored in NVS at checkpoints
+     */
+    struct Cursor {
+        uint32_t patchOffset;        ///< Patch bytes applied
+        uint32_t imageOffset;        ///< Image bytes written
+        uint8_t state;               ///< Parser state
+        uint8_t opcode;              ///< Operation being applied
+        uint8_t fill;                ///< Bytes collected in field
+        uint8_t field[MICROSAFARI_UPDATE_HEADER_SIZE]; ///< Header or operands being collected
+        uint32_t sourceOffset;       ///< Next source byte of the operation
+        uint32_t remaining;          ///< Image bytes left in the operation
+    };
+
+    MicroSafari* _connection;        ///< Connection used for requests
+    char _currentVersion[MICROSAFARI_UPDATE_VERSION_LENGTH]; ///< Version of the running image
+    char _version[MICROSAFARI_UPDATE_VERSION_LENGTH]; ///< Version being installed, empty if none
+    char _url[MICROSAFARI_UPDATE_URL_LENGTH]; ///< Patch endpoint
+    bool _delta;                     ///< Patch is a delta, not a full image
+    bool _fullOnly;                  ///< Ask for full images only (running image unknown to the server)
+    uint32_t _imageCrc;              ///< CRC-32 of the new image
+    Cursor _cursor;                  ///< Apply position
+    const esp_partition_t* _source;  ///< Running partition
+    const esp_partition_t* _target;  ///< Partition receiving the new image
+    MicroSafariUpdateStatus _status; ///< Update state
+    const char* _failure;            ///< Reason the patch was rejected, nullptr if none
+    unsigned long _nextAttempt;      ///< millis() of the next request
+    unsigned long _backoff;          ///< Current retry delay in milliseconds
+    bool _interrupted;               ///< Last window ended early
+    MicroSafariUpdateStats _stats;   ///< Transfer counters
+    uint8_t _buffer[MICROSAFARI_UPDATE_BUFFER_SIZE]; ///< Source bytes of COPY and ADD
+
+    /**
+     * @brief Internal method to ask the server for an update
+     */
+    bool checkForUpdate();
+
+    /**
+     * @brief Internal method to download and apply the next window
+     */
+    bool applyWindow();
+
+    /**
+     * @brief Internal method to verify and select the new image
+     */
+    void finish();
+
+    /**
+     * @brief Internal method to send the transfer counters to the server
+     */
+    void sendReport();
+
+    /**
+     * @brief Download sink passing patch bytes to apply()
+     */
+    static bool receive(void* context, const uint8_t* data, size_t length);
+
+    /**
+     * @brief Internal method to apply patch bytes
+     * @return false if the patch is invalid or the flash write failed
+     */
+    bool apply(const uint8_t* data, size_t length);
+
+    /**
+     * @brief Internal method to collect header or operand bytes
+     * @return Bytes consumed
+     */
+    size_t collect(const uint8_t* data, size_t length, size_t size);
+
+    /**
+     * @brief Internal method to act on a complete header or operand field
+     */
+    bool parseField();
+
+    /**
+     * @brief Internal method to write image bytes that do not cross a sector boundary
+     */
+    bool writeImage(const uint8_t* data, size_t length);
+
+    /**
+     * @brief Internal method to compute the CRC-32 of a partition range
+     */
+    bool partitionCrc(const esp_partition_t* partition, uint32_t length, uint32_t& crc);
+
+    /**
+     * @brief Internal method to forget the update and start over
+     */
+    void restartSession();
+
+    /**
+     * @brief Internal method to store the session in NVS
+     */
+    void saveSession();
+
+    /**
+     * @brief Internal method to store the apply position in NVS
+     */
+    void saveCursor();
+
+    /**
+     * @brief Internal method to remove the session from NVS
+     */
+    void clearSession();
+
+public:
+    /**
+     * @brief Constructor for MicroSafariUpdate
+     */
+    MicroSafariUpdate();
+
+    /**
+     * @brief Start checking for updates, resuming one stored in NVS
+     * @param connection Initialized MicroSafari instance
+     * @param currentVersion Version of the running firmware, e.g. "1.4.2"
+     * @return true if started, false if arguments are invalid or there is no OTA partition
+     */
+    bool begin(MicroSafari& connection, const char* currentVersion);
+
+    /**
+     * @brief Make progress with at most one request
+     *
+     * Call from loop(). Checks for an update every
+     * MICROSAFARI_UPDATE_CHECK_INTERVAL and downloads one window per
+     * call while an update is in progress. Nothing is sent while WiFi is
+     * down or a retry delay is running.
+     *
+     * @return Update state
+     */
+    MicroSafariUpdateStatus step();
+
+    /**
+     * @brief Check for an update on the next step()
+     */
+    void checkNow();
+
+    /**
+     * @brief Abandon the update in progress
+     */
+    void cancel();
+
+    /**
+     * @brief Get update state
+     * @return Update state
+     */
+    MicroSafariUpdateStatus getStatus() const;
+
+    /**
+     * @brief Get version being installed
+     * @return Version, empty if no update was offered
+     */
+    const char* getVersion() const;
+
+    /**
+     * @brief Get patch bytes applied
+     * @return Offset in the patch
+     */
+    uint32_t getOffset() const;
+
+    /**
+     * @brief Get transfer counters
+     * @return Reference to the update statistics
+     */
+    const MicroSafariUpdateStats& getStats() const;
+};
+
+#endif // MICROSAFARI_UPDATE_H
@@ -0,0 +1,392 @@
+/*!
+ * @file MicroSafariUpload.cpp
+ * @brief Implementation of MicroSafari resumable uploads
+ * @version 1.0.0
+ * @date 2025-08-22
+ */
+
+#include "MicroSafariUpload.h"
+#include <Preferences.h>
+
+// Same NVS namespace as the rest of the library
+static const char* UPLOAD_PREFERENCES_NAMESPACE = "microsafari";
+
+/**
+ * @brief Session as stored in NVS
+ */
+struct StoredUploadSession {
+    char sessionId[MICROSAFARI_UPLOAD_ID_LENGTH];
+    uint32_t size;
+    uint32_t contentCrc;
+};
+
+/**
+ * @brief Constructor
+ */
+MicroSafariUpload::MicroSafariUpload() {
+    _connection = nullptr;
+    _reader = nullptr;
+    _readerContext = nullptr;
+    _name[0] = '\0';
+    _sessionId[0] = '\0';
+    _size = 0;
+    _contentCrc = 0;
+    _offset = 0;
+    _offsetKnown = false;
+    _status = MICROSAFARI_UPLOAD_IDLE;
+    _nextAttempt = 0;
+    _backoff = 0;
+    _bytesSent = 0;
+    _resumes = 0;
+}
+
+/**
+ * @brief Start or resume upload
+ */
+bool MicroSafariUpload::begin(MicroSafari& connection,
+                              const char* name,
+                              uint32_t size,
+                              MicroSafariUploadReader reader,
+                              void* context) {
+    if (name == nullptr || name[0] == '\0' || strlen(name) >= MICROSAFARI_UPLOAD_NAME_LENGTH ||
+        size == 0 || reader == nullptr) {
+        return false;
+    }
+
+    _connection = &connection;
+    _reader = reader;
+    _readerContext = context;
+    strcpy(_name, name);
+    _sessionId[0] = '\0';
+    _size = size;
+    _offset = 0;
+    _offsetKnown = false;
+    _status = MICROSAFARI_UPLOAD_IN_PROGRESS;
+    _nextAttempt = millis();
+    _backoff = 0;
+    _bytesSent = 0;
+    _resumes = 0;
+
+    if (!readContentCrc()) {
+        _status = MICROSAFARI_UPLOAD_IDLE;
+        return false;
+    }
+
+    // Pick up a session left by an interrupted run of the same data
+    char key[16];
+    getStorageKey(key);
+    StoredUploadSession stored;
+    Preferences preferences;
+    if (preferences.begin(UPLOAD_PREFERENCES_NAMESPACE, true)) {
+        if (preferences.getBytes(key, &stored, sizeof(stored)) == sizeof(stored) && stored.size == size &&
+            stored.contentCrc == _contentCrc) {
+            stored.sessionId[MICROSAFARI_UPLOAD_ID_LENGTH - 1] = '\0';
+            strcpy(_sessionId, stored.sessionId);
+        }
+        preferences.end();
+    }
+
+    _connection->debugPrint("Upload " + String(_name) + ": " + String(size) + " bytes" +
+                            (_sessionId[0] != '\0' ? ", resuming session " + String(_sessionId) : String("")));
+    return true;
+}
+
+/**
+ * @brief Make progress with one request
+ */
+MicroSafariUploadStatus MicroSafariUpload::step() {
+    if (_status != MICROSAFARI_UPLOAD_IN_PROGRESS || !_connection->isWiFiConnected() ||
+        (long)(millis() - _nextAttempt) < 0) {
+        return _status;
+    }
+
+    bool progressed;
+    if (_sessionId[0] == '\0') {
+        progressed = createSession();
+    } else if (!_offsetKnown) {
+        progressed = queryOffset();
+    } else {
+        progressed = sendChunk();
+    }
+
+    if (_status != MICROSAFARI_UPLOAD_IN_PROGRESS) {
+        return _status;
+    }
+
+    if (progressed) {
+        _backoff = 0;
+    } else {
+        // Back off from 2 seconds up to a minute while the link is unstable
+        _backoff = _backoff == 0 ? 2000 : min(_backoff * 2, 60000UL);
+        _nextAttempt = millis() + _backoff;
+    }
+
+    if (_offsetKnown && _offset >= _size) {
+        _status = MICROSAFARI_UPLOAD_COMPLETE;
+        clearSession();
+        _connection->debugPrint("Upload " + String(_name) + " complete (" + String(_bytesSent) +
+                                " bytes sent, " + String(_resumes) + " resumes)");
+    }
+    return _status;
+}
+
+/**
+ * @brief Create upload session
+ */
+bool MicroSafariUpload::createSession() {
+    DynamicJsonDocument doc(256);
+    doc["name"] = (const char*)_name;
+    doc["size"] = _size;
+    doc["device_name"] = _connection->_deviceName;
+
+    String jsonString;
+    serializeJson(doc, jsonString);
+
+    MicroSafariResponse response = _connection->performBinaryRequest("/api/uploads", "POST",
+                                                                     (const uint8_t*)jsonString.c_str(),
+                                                                     jsonString.length(), nullptr, 0);
+    if (!response.success) {
+        if (response.httpCode == 400 || response.httpCode == 401 || response.httpCode == 413) {
+            _status = MICROSAFARI_UPLOAD_FAILED;
+            _connection->debugPrint("Upload " + String(_name) + " rejected: " + response.errorMessage);
+        }
+        return false;
+    }
+
+    DynamicJsonDocument result(256);
+    const char* sessionId = nullptr;
+    if (deserializeJson(result, response.payload) == DeserializationError::Ok) {
+        sessionId = result["upload_id"];
+    }
+    if (sessionId == nullptr || sessionId[0] == '\0' || strlen(sessionId) >= MICROSAFARI_UPLOAD_ID_LENGTH) {
+        _status = MICROSAFARI_UPLOAD_FAILED;
+        _connection->debugPrint("Upload " + String(_name) + ": invalid session response");
+        return false;
+    }
+
+    strcpy(_sessionId, sessionId);
+    saveSession();
+
+    // A new session starts at 0 unless the server says otherwise
+    if (!readConfirmedOffset()) {
+        _offset = 0;
+        _offsetKnown = true;
+    }
+    _connection->debugPrint("Upload session " + String(_sessionId) + " created");
+    return true;
+}
+
+/**
+ * @brief Ask server for committed offset
+ */
+bool MicroSafariUpload::queryOffset() {
+    MicroSafariResponse response = _connection->performBinaryRequest("/api/uploads/" + String(_sessionId),
+                                                                     "HEAD", nullptr, 0, nullptr, 0);
+    if (response.httpCode == 404 || response.httpCode == 410) {
+        restartSession();
+        return false;
+    }
+    if (!response.success || !readConfirmedOffset()) {
+        return false;
+    }
+
+    _resumes++;
+    _connection->debugPrint("Upload " + String(_name) + " resumes at " + String(_offset) + "/" + String(_size));
+    return true;
+}
+
+/**
+ * @brief Send next chunk
+ */
+bool MicroSafariUpload::sendChunk() {
+    size_t length = min((uint32_t)MICROSAFARI_UPLOAD_CHUNK_SIZE, _size - _offset);
+    if (_reader(_readerContext, _offset, _buffer, length) != length) {
+        _status = MICROSAFARI_UPLOAD_FAILED;
+        _connection->debugPrint("Upload " + String(_name) + ": read failed at " + String(_offset));
+        return false;
+    }
+
+    char crc[9];
+    snprintf(crc, sizeof(crc), "%08lx", (unsigned long)microSafariCrc32(_buffer, length));
+    MicroSafariHttpHeader headers[] = {
+        { "Content-Type", "application/offset+octet-stream" },
+        { "Upload-Offset", String(_offset) },
+        { "X-Chunk-CRC32", crc }
+    };
+
+    MicroSafariResponse response = _connection->performBinaryRequest("/api/uploads/" + String(_sessionId),
+                                                                     "PATCH", _buffer, length, headers, 3);
+    _bytesSent += length;
+
+    if (response.httpCode == 404 || response.httpCode == 410) {
+        restartSession();
+        return false;
+    }
+    if (response.httpCode == 409) {
+        // Offset mismatch: the answer carries the server's offset, otherwise ask
+        if (!readConfirmedOffset()) {
+            _offsetKnown = false;
+        }
+        return false;
+    }
+    if (!response.success) {
+        if (response.httpCode == 400 || response.httpCode == 401 || response.httpCode == 413) {
+            _status = MICROSAFARI_UPLOAD_FAILED;
+            _connection->debugPrint("Upload " + String(_name) + " rejected: " + response.errorMessage);
+        } else {
+            // Part of the chunk may have been committed; ask before sending again
+            _offsetKnown = false;
+        }
+        return false;
+    }
+
+    // Only the offset confirmed by the server counts
+    if (!readConfirmedOffset()) {
+        _offsetKnown = false;
+    }
+    return true;
+}
+
+/**
+ * @brief Take committed offset from last response
+ */
+bool MicroSafariUpload::readConfirmedOffset() {
+    const String& header = _connection->_responseHeaders[MicroSafari::RESPONSE_HEADER_UPLOAD_OFFSET];
+    if (header.isEmpty()) {
+        return false;
+    }
+
+    char* end;
+    unsigned long offset = strtoul(header.c_str(), &end, 10);
+    if (*end != '\0' || offset > _size) {
+        return false;
+    }
+
+    _offset = offset;
+    _offsetKnown = true;
+    return true;
+}
+
+/**
+ * @brief Forget session dropped by the server
+ */
+void MicroSafariUpload::restartSession() {
+    _connection->debugPrint("Upload session " + String(_sessionId) + " expired, starting over");
+    clearSession();
+    _sessionId[0] = '\0';
+    _offset = 0;
+    _offsetKnown = false;
+}
+
+/**
+ * @brief Checksum first and last chunk
+ */
+bool MicroSafariUpload::readContentCrc() {
+    size_t length = min(_size, (uint32_t)MICROSAFARI_UPLOAD_CHUNK_SIZE);
+    if (_reader(_readerContext, 0, _buffer, length) != length) {
+        return false;
+    }
+    _contentCrc = microSafariCrc32(_buffer, length);
+
+    if (_size > length) {
+        if (_reader(_readerContext, _size - length, _buffer, length) != length) {
+            return false;
+        }
+        _contentCrc = microSafariCrc32(_buffer, length, _contentCrc);
+    }
+    return true;
+}
+
+/**
+ * @brief Get NVS key of this upload
+ */
+void MicroSafariUpload::getStorageKey(char* key) const {
+    // NVS keys are limited to 15 characters
+    snprintf(key, 16, "upl%08lx", (unsigned long)microSafariCrc32(_name, strlen(_name)));
+}
+
+/**
+ * @brief Store session in NVS
+ */
+void MicroSafariUpload::saveSession() {
+    StoredUploadSession stored;
+    memset(&stored, 0, sizeof(stored));
+    strcpy(stored.sessionId, _sessionId);
+    stored.size = _size;
+    stored.contentCrc = _contentCrc;
+
+    char key[16];
+    getStorageKey(key);
+    Preferences preferences;
+    if (preferences.begin(UPLOAD_PREFERENCES_NAMESPACE, false)) {
+        preferences.putBytes(key, &stored, sizeof(stored));
+        preferences.end();
+    }
+}
+
+/**
+ * @brief Remove session from NVS
+ */
+void MicroSafariUpload::clearSession() {
+    char key[16];
+    getStorageKey(key);
+    Preferences preferences;
+    if (preferences.begin(UPLOAD_PREFERENCES_NAMESPACE, false)) {
+        preferences.remove(key);
+        preferences.end();
+    }
+}
+
+/**
+ * @brief Abandon upload
+ */
+void MicroSafariUpload::cancel() {
+    if (_status == MICROSAFARI_UPLOAD_IN_PROGRESS && _sessionId[0] != '\0') {
+        _connection->performBinaryRequest("/api/uploads/" + String(_sessionId), "DELETE", nullptr, 0, nullptr, 0);
+        clearSession();
+    }
+    _sessionId[0] = '\0';
+    _status = MICROSAFARI_UPLOAD_IDLE;
+}
+
+/**
+ * @brief Get upload state
+ */
+MicroSafariUploadStatus MicroSafariUpload::getStatus() const {
+    return _status;
+}
+
+/**
+ * @brief Get confirmed offset
+ */
+uint32_t MicroSafariUpload::getOffset() const {
+    return _offset;
+}
+
+/**
+ * @brief Get upload size
+ */
+uint32_t MicroSafariUpload::getSize() const {
+    return _size;
+}
+
+/**
+ * @brief Get session ID
+ */
+const char* MicroSafariUpload::getSessionId() const {
+    return _sessionId;
+}
+
+/**
+ * @brief Get bytes sent
+ */
+uint32_t MicroSafariUpload::getBytesSent() const {
+    return _bytesSent;
+}
+
+/**
+ * @brief Get resume count
+ */
+uint32_t MicroSafariUpload::getResumeCount() const {
+    return _resumes;
+}
@@ -0,0 +1,210 @@
+/*!
+ * @file MicroSafariUpload.h
+ * @brief Resumable bulk upload with server-confirmed offsets
+ * @version 1.0.0
+ * @date 2025-08-22
+ *
+ * Large backlogs (log files, exported flash records) are uploaded in
+ * chunks to an upload session instead of one request. Every chunk
+ * carries its byte offset in Upload-Offset and the server answers with
+ * the offset it has committed. When the link drops, the next attempt
+ * asks the server for its offset with HEAD and continues from there,
+ * also after a reboot, because the session ID is kept in NVS.
+ *
+ * Protocol:
+ * - POST  /api/uploads        {"name","size","device_name"} -> {"upload_id"}
+ * - HEAD  /api/uploads/<id>   -> Upload-Offset
+ * - PATCH /api/uploads/<id>   Upload-Offset: n, chunk bytes -> Upload-Offset: n + committed
+ *
+ * @section license License
+ * MIT License
+ */
+
+#ifndef MICROSAFARI_UPLOAD_H
+#define MICROSAFARI_UPLOAD_H
+
+#include "MicroSafari.h"
+
+#ifndef MICROSAFARI_UPLOAD_CHUNK_SIZE
+#define MICROSAFARI_UPLOAD_CHUNK_SIZE 2048
+#endif
+
+/** @brief Maximum upload session ID length, including terminator */
+#define MICROSAFARI_UPLOAD_ID_LENGTH 48
+
+/** @brief Maximum upload name length, including terminator */
+#define MICROSAFARI_UPLOAD_NAME_LENGTH 32
+
+/**
+ * @brief Reads part of the data being uploaded
+ *
+ * The same offset must always yield the same bytes, also after a
+ * reboot, so upload a snapshot (e.g. a closed file) rather than data
+ * that is still growing.
+ *
+ * @param context Context pointer given to begin
+ * @param offset Byte offset to read from
+ * @param buffer Receives the data
+ * @param length Bytes to read
+ * @return Bytes read, 0 on error
+ */
+typedef size_t (*MicroSafariUploadReader)(void* context, uint32_t offset, uint8_t* buffer, size_t length);
+
+/**
+ * @brief Upload state
+ */
+enum MicroSafariUploadStatus {
+    MICROSAFARI_UPLOAD_IDLE = 0,         ///< No upload started
+    MICROSAFARI_UPLOAD_IN_PROGRESS = 1,  ///< Call step() until the upload ends
+    MICROSAFARI_UPLOAD_COMPLETE = 2,     ///< Server confirmed all bytes
+    MICROSAFARI_UPLOAD_FAILED = 3        ///< Rejected by the server or the reader failed
+};
+
+/**
+ * @brief Resumable upload through a MicroSafari connection
+ */
+class MicroSafariUpload {
+private:
+    MicroSafari* _connection;        ///< Connection used for requests
+    MicroSafariUploadReader _reader; ///< Source of the uploaded bytes
+    void* _readerContext;            ///< Context for the reader
+    char _name[MICROSAFARI_UPLOAD_NAME_LENGTH]; ///< Upload name, identifies the session in NVS
+    char _sessionId[MICROSAFARI_UPLOAD_ID_LENGTH]; ///< Server session ID, empty until created
+    uint32_t _size;                  ///< Total bytes
+    uint32_t _contentCrc;            ///< CRC-32 of the first and last chunk, tells stored sessions apart
+    uint32_t _offset;                ///< Bytes committed by the server
+    bool _offsetKnown;               ///< _offset matches the server
+    MicroSafariUploadStatus _status; ///< Upload state
+    unsigned long _nextAttempt;      ///< millis() of the next request after a failure
+    unsigned long _backoff;          ///< Current retry delay in milliseconds
+    uint32_t _bytesSent;             ///< Chunk bytes sent, including resent ones
+    uint32_t _resumes;               ///< Offset queries after interruptions
+    uint8_t _buffer[MICROSAFARI_UPLOAD_CHUNK_SIZE]; ///< Chunk buffer
+
+    /**
+     * @brief Internal method to create the upload session
+     */
+    bool createSession();
+
+    /**
+     * @brief Internal method to ask the server for its committed offset
+     */
+    bool queryOffset();
+
+    /**
+     * @brief Internal method to send the next chunk
+     */
+    bool sendChunk();
+
+    /**
+     * @brief Internal method to take the committed offset from the last response
+     * @return true if the response carried a valid offset
+     */
+    bool readConfirmedOffset();
+
+    /**
+     * @brief Internal method to forget the session after the server dropped it
+     */
+    void restartSession();
+
+    /**
+     * @brief Internal method to checksum the first and last chunk of the data
+     * @return true if the reader returned both chunks
+     */
+    bool readContentCrc();
+
+    /**
+     * @brief Internal method to get the NVS key of this upload
+     */
+    void getStorageKey(char* key) const;
+
+    /**
+     * @brief Internal method to store the session in NVS
+     */
+    void saveSession();
+
+    /**
+     * @brief Internal method to remove the session from NVS
+     */
+    void clearSession();
+
+public:
+    /**
+     * @brief Constructor for MicroSafariUpload
+     */
+    MicroSafariUpload();
+
+    /**
+     * @brief Start or resume an upload
+     *
+     * If a session for the same name, size and content is stored in NVS,
+     * the upload continues from the offset the server confirms. The
+     * content is compared by a CRC-32 of the first and last chunk, so
+     * different data under an old name starts a new session.
+     *
+     * @param connection Initialized MicroSafari instance
+     * @param name Upload name, e.g. "log-2025-08-22"
+     * @param size Total bytes to upload
+     * @param reader Source of the uploaded bytes
+     * @param context Context pointer passed to the reader (default: nullptr)
+     * @return true if started, false if arguments are invalid or the reader failed
+     */
+    bool begin(MicroSafari& connection,
+               const char* name,
+               uint32_t size,
+               MicroSafariUploadReader reader,
+               void* context = nullptr);
+
+    /**
+     * @brief Make progress with at most one request
+     *
+     * Call from loop() while the result is MICROSAFARI_UPLOAD_IN_PROGRESS.
+     * Nothing is sent while WiFi is down or a retry delay is running.
+     *
+     * @return Upload state
+     */
+    MicroSafariUploadStatus step();
+
+    /**
+     * @brief Abandon the upload and its session
+     */
+    void cancel();
+
+    /**
+     * @brief Get upload state
+     * @return Upload state
+     */
+    MicroSafariUploadStatus getStatus() const;
+
+    /**
+     * @brief Get bytes committed by the server
+     * @return Confirmed offset
+     */
+    uint32_t getOffset() const;
+
+    /**
+     * @brief Get total bytes
+     * @return Upload size
+     */
+    uint32_t getSize() const;
+
+    /**
+     * @brief Get server session ID
+     * @return Session ID, empty until the session is created
+     */
+    const char* getSessionId() const;
+
+    /**
+     * @brief Get chunk bytes sent, including chunks sent again after an interruption
+     * @return Bytes sent
+     */
+    uint32_t getBytesSent() const;
+
+    /**
+     * @brief Get number of resumes after interruptions
+     * @return Resume count
+     */
+    uint32_t getResumeCount() const;
+};
+
+#endif // MICROSAFARI_UPLOAD_H
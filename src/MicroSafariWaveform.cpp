@@ -0,0 +1,413 @@
+/*!
+ * @file MicroSafariWaveform.cpp
+ * @brief Implementation of MicroSafari waveform capture and FFT features
+ * @version 1.0.0
+ * @date 2025-08-22
+ */
+
+#include "MicroSafariWaveform.h"
+
+#ifdef MICROSAFARI_WAVEFORM_ESP_DSP
+#include <esp_dsp.h>
+#endif
+
+/**
+ * @brief Constructor
+ */
+MicroSafariWaveform::MicroSafariWaveform(const char* prefix) {
+    memset(_bands, 0, sizeof(_bands));
+    memset(&_features, 0, sizeof(_features));
+    _prefix[0] = '\0';
+    if (prefix != nullptr && strlen(prefix) < MICROSAFARI_WAVEFORM_NAME_LENGTH) {
+        strcpy(_prefix, prefix);
+    }
+    _windowSum = 0;
+    _windowPower = 0;
+    _bandCount = 0;
+    _source = nullptr;
+    _pin = 0;
+    _scale = 1.0f;
+    _sampleRate = 0;
+    _fill = 0;
+    _armed = false;
+    _ready = false;
+    _computed = false;
+    _captures = 0;
+}
+
+/**
+ * @brief Initialize window and transform tables
+ */
+bool MicroSafariWaveform::prepare(float sampleRateHz) {
+    if (!(sampleRateHz > 0)) {
+        return false;
+    }
+
+    _sampleRate = sampleRateHz;
+    _fill = 0;
+    _computed = false;
+    if (_ready) {
+        return true;
+    }
+
+#ifdef MICROSAFARI_WAVEFORM_ESP_DSP
+    // The twiddle table is shared by all users of esp-dsp in the firmware
+    esp_err_t result = dsps_fft2r_init_fc32(NULL, MICROSAFARI_WAVEFORM_SIZE);
+    if (result != ESP_OK && result != ESP_ERR_DSP_REINITIALIZED) {
+        return false;
+    }
+#else
+    for (size_t k = 0; k < MICROSAFARI_WAVEFORM_SIZE / 2; k++) {
+        double angle = 2.0 * M_PI * k / MICROSAFARI_WAVEFORM_SIZE;
+        _twiddle[2 * k] = (float)cos(angle);
+        _twiddle[2 * k + 1] = (float)-sin(angle);
+    }
+#endif
+
+    // Periodic Hann window
+    _windowSum = 0;
+    _windowPower = 0;
+    for (size_t i = 0; i < MICROSAFARI_WAVEFORM_SIZE; i++) {
+        _window[i] = (float)(0.5 - 0.5 * cos(2.0 * M_PI * i / MICROSAFARI_WAVEFORM_SIZE));
+        _windowSum += _window[i];
+        _windowPower += _window[i] * _window[i];
+    }
+
+    _ready = true;
+    return true;
+}
+
+/**
+ * @brief Start with pushed samples
+ */
+bool MicroSafariWaveform::begin(float sampleRateHz) {
+    return prepare(sampleRateHz);
+}
+
+/**
+ * @brief Start sampling from source
+ */
+bool MicroSafariWaveform::begin(MicroSafariSampleSource* source,
+                                uint8_t pin,
+                                uint32_t sourceRateHz,
+                                float sampleRateHz,
+                                float scale) {
+    if (source == nullptr || _source != nullptr || !prepare(sampleRateHz)) {
+        return false;
+    }
+    if (!source->begin(&pin, 1, sourceRateHz)) {
+        return false;
+    }
+
+    _source = source;
+    _pin = pin;
+    _scale = scale;
+    _armed = true;
+    return true;
+}
+
+/**
+ * @brief Stop sample source
+ */
+void MicroSafariWaveform::end() {
+    if (_source != nullptr) {
+        _source->end();
+        _source = nullptr;
+    }
+    _armed = false;
+}
+
+/**
+ * @brief Add frequency band
+ */
+int MicroSafariWaveform::addBand(const char* name, float lowHz, float highHz) {
+    if (name == nullptr || name[0] == '\0' || strlen(name) >= MICROSAFARI_WAVEFORM_NAME_LENGTH ||
+        !(lowHz >= 0) || !(highHz > lowHz) || _bandCount >= MICROSAFARI_WAVEFORM_MAX_BANDS) {
+        return -1;
+    }
+
+    Band& band = _bands[_bandCount];
+    strcpy(band.name, name);
+    band.lowHz = lowHz;
+    band.highHz = highHz;
+    return _bandCount++;
+}
+
+/**
+ * @brief Add one sample
+ */
+bool MicroSafariWaveform::addSample(float value) {
+    if (_fill >= MICROSAFARI_WAVEFORM_SIZE) {
+        return true;
+    }
+
+    // The spectrum of the last capture is overwritten from here on
+    _computed = false;
+    _work[2 * _fill] = value;
+    _fill++;
+    return _fill >= MICROSAFARI_WAVEFORM_SIZE;
+}
+
+/**
+ * @brief Start new capture from source
+ */
+void MicroSafariWaveform::start() {
+    // Pushed samples fill the buffer at the sketch's own pace
+    if (_source != nullptr) {
+        _fill = 0;
+        _armed = true;
+    }
+}
+
+/**
+ * @brief Move source samples into buffer
+ */
+bool MicroSafariWaveform::process() {
+    if (_source == nullptr) {
+        return isFull();
+    }
+
+    MicroSafariSample samples[MICROSAFARI_ACQ_READ_CHUNK];
+    size_t count;
+
+    // Read at most one capture's worth, so a free-running or fast source cannot keep us here
+    size_t total = 0;
+    while (total < MICROSAFARI_WAVEFORM_SIZE &&
+           (count = _source->read(samples, MICROSAFARI_ACQ_READ_CHUNK)) > 0) {
+        total += count;
+        if (!_armed) {
+            continue;
+        }
+        for (size_t i = 0; i < count; i++) {
+            if (addSample(samples[i].raw * _scale)) {
+                // Stop here; later samples belong to no capture
+                _armed = false;
+                return true;
+            }
+        }
+    }
+
+    return isFull();
+}
+
+/**
+ * @brief Check if buffer is full
+ */
+bool MicroSafariWaveform::isFull() const {
+    return _fill >= MICROSAFARI_WAVEFORM_SIZE;
+}
+
+/**
+ * @brief Check if capture is running
+ */
+bool MicroSafariWaveform::isCapturing() const {
+    return _armed;
+}
+
+/**
+ * @brief Run in-place FFT
+ */
+void MicroSafariWaveform::transform() {
+#ifdef MICROSAFARI_WAVEFORM_ESP_DSP
+    dsps_fft2r_fc32(_work, MICROSAFARI_WAVEFORM_SIZE);
+    dsps_bit_rev_fc32(_work, MICROSAFARI_WAVEFORM_SIZE);
+#else
+    const size_t n = MICROSAFARI_WAVEFORM_SIZE;
+
+    // Bit-reversal permutation
+    for (size_t i = 1, j = 0; i < n; i++) {
+        size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1) {
+            j ^= bit;
+        }
+        j ^= bit;
+        if (i < j) {
+            float re = _work[2 * i];
+            float im = _work[2 * i + 1];
+            _work[2 * i] = _work[2 * j];
+            _work[2 * i + 1] = _work[2 * j + 1];
+            _work[2 * j] = re;
+            _work[2 * j + 1] = im;
+        }
+    }
+
+    // Radix-2 butterflies, doubling the transform length each pass
+    for (size_t length = 2; length <= n; length <<= 1) {
+        size_t half = length >> 1;
+        size_t step = n / length;
+        for (size_t start = 0; start < n; start += length) {
+            for (size_t k = 0; k < half; k++) {
+                float wr = _twiddle[2 * k * step];
+                float wi = _twiddle[2 * k * step + 1];
+                float* a = &_work[2 * (start + k)];
+                float* b = &_work[2 * (start + k + half)];
+                float tr = b[0] * wr - b[1] * wi;
+                float ti = b[0] * wi + b[1] * wr;
+                b[0] = a[0] - tr;
+                b[1] = a[1] - ti;
+                a[0] += tr;
+                a[1] += ti;
+            }
+        }
+    }
+#endif
+}
+
+/**
+ * @brief Extract features from full buffer
+ */
+bool MicroSafariWaveform::compute() {
+    if (!_ready || !isFull()) {
+        return false;
+    }
+
+    const size_t n = MICROSAFARI_WAVEFORM_SIZE;
+    unsigned long started = micros();
+
+    // Time domain: DC level, RMS and peak of the remaining signal
+    double sum = 0;
+    for (size_t i = 0; i < n; i++) {
+        sum += _work[2 * i];
+    }
+    float mean = (float)(sum / n);
+
+    double sumSquares = 0;
+    float peak = 0;
+    for (size_t i = 0; i < n; i++) {
+        float value = _work[2 * i] - mean;
+        sumSquares += (double)value * value;
+        if (fabsf(value) > peak) {
+            peak = fabsf(value);
+        }
+        _work[2 * i] = value * _window[i];
+        _work[2 * i + 1] = 0;
+    }
+
+    unsigned long fftStarted = micros();
+    transform();
+    _features.fftMicros = micros() - fftStarted;
+
+    // Power spectrum into the front of the buffer; bin k only reads entries 2k and 2k + 1
+    for (size_t k = 0; k <= n / 2; k++) {
+        float re = _work[2 * k];
+        float im = _work[2 * k + 1];
+        _work[k] = re * re + im * im;
+    }
+
+    size_t peakBin = 1;
+    for (size_t k = 2; k < n / 2; k++) {
+        if (_work[k] > _work[peakBin]) {
+            peakBin = k;
+        }
+    }
+
+    // Gaussian interpolation of the peak from its neighbouring bins
+    float offset = 0;
+    float peakPower = _work[peakBin];
+    if (_work[peakBin - 1] > 0 && _work[peakBin] > 0 && _work[peakBin + 1] > 0) {
+        float left = logf(_work[peakBin - 1]);
+        float center = logf(_work[peakBin]);
+        float right = logf(_work[peakBin + 1]);
+        float curvature = left - 2 * center + right;
+        if (curvature < 0) {
+            offset = 0.5f * (left - right) / curvature;
+            // Top of the fit, which also undoes the window's scalloping loss
+            peakPower = expf(center - 0.25f * (left - right) * offset);
+        }
+    }
+
+    _features.mean = mean;
+    _features.rms = (float)sqrt(sumSquares / n);
+    _features.peak = peak;
+    _features.crest = _features.rms > 0 ? peak / _features.rms : 0;
+    _features.peakFrequency = (peakBin + offset) * _sampleRate / n;
+    _features.peakAmplitude = 2 * sqrtf(peakPower) / _windowSum;
+
+    // Mean square per band; over the whole spectrum the bands add up to rms^2
+    float binEnergy = 2.0f / (n * _windowPower);
+    for (size_t b = 0; b < _bandCount; b++) {
+        double energy = 0;
+        for (size_t k = 1; k <= n / 2; k++) {
+            float frequency = getBinFrequency(k);
+            if (frequency >= _bands[b].lowHz && frequency < _bands[b].highHz) {
+                energy += _work[k] * (k == n / 2 ? binEnergy / 2 : binEnergy);
+            }
+        }
+        _features.bandEnergy[b] = (float)energy;
+    }
+
+    _features.computeMicros = micros() - started;
+    _fill = 0;
+    _computed = true;
+    _captures++;
+    return true;
+}
+
+/**
+ * @brief Get features of last capture
+ */
+const MicroSafariWaveformFeatures& MicroSafariWaveform::getFeatures() const {
+    return _features;
+}
+
+/**
+ * @brief Get spectrum amplitude of a bin
+ */
+float MicroSafariWaveform::getAmplitude(size_t bin) const {
+    if (!_computed || bin > MICROSAFARI_WAVEFORM_SIZE / 2) {
+        return 0;
+    }
+    return (bin == 0 || bin == MICROSAFARI_WAVEFORM_SIZE / 2 ? 1 : 2) * sqrtf(_work[bin]) / _windowSum;
+}
+
+/**
+ * @brief Get frequency of a bin
+ */
+float MicroSafariWaveform::getBinFrequency(size_t bin) const {
+    return bin * _sampleRate / MICROSAFARI_WAVEFORM_SIZE;
+}
+
+/**
+ * @brief Write features into payload
+ */
+size_t MicroSafariWaveform::populate(JsonObject& payload) const {
+    if (_captures == 0) {
+        return 0;
+    }
+
+    char key[2 * MICROSAFARI_WAVEFORM_NAME_LENGTH + 8];
+    const char* names[] = { "rms", "peak", "crest", "freq", "freq_amp" };
+    const float values[] = { _features.rms, _features.peak, _features.crest,
+                             _features.peakFrequency, _features.peakAmplitude };
+    size_t written = 0;
+
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+        snprintf(key, sizeof(key), "%s_%s", _prefix, names[i]);
+        payload[key] = values[i];
+        written++;
+    }
+    for (size_t b = 0; b < _bandCount; b++) {
+        snprintf(key, sizeof(key), "%s_%s", _prefix, _bands[b].name);
+        payload[key] = _features.bandEnergy[b];
+        written++;
+    }
+    return written;
+}
+
+/**
+ * @brief Get capture count
+ */
+uint32_t MicroSafariWaveform::getCaptureCount() const {
+    return _captures;
+}
+
+/**
+ * @brief Get FFT implementation
+ */
+const char* MicroSafariWaveform::getBackend() {
+#ifdef MICROSAFARI_WAVEFORM_ESP_DSP
+    return "esp-dsp";
+#else
+    return "portable";
+#endif
+}
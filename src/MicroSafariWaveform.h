@@ -0,0 +1,251 @@
+/*!
+ * @file MicroSafariWaveform.h
+ * @brief High-rate waveform capture with on-device FFT features
+ * @version 1.0.0
+ * @date 2025-08-22
+ *
+ * Pump and motor vibration needs sampling around 1 kHz, far more than
+ * the ingest path can carry. MicroSafariWaveform fills a fixed buffer
+ * from a sample source (or from samples pushed by the sketch, e.g. an
+ * SPI accelerometer), removes the DC level, applies a Hann window and
+ * runs a radix-2 FFT in place. Only the features are uploaded: RMS,
+ * peak, crest factor, dominant frequency and its amplitude, and the
+ * energy of configurable frequency bands.
+ *
+ * When the esp-dsp component is available (bundled with arduino-esp32
+ * 3.x) the FFT uses its assembly kernels, which use the SIMD
+ * instructions of the ESP32-S3. Otherwise a portable implementation
+ * is used. Define MICROSAFARI_WAVEFORM_NO_ESP_DSP to force it.
+ *
+ * @section license License
+ * MIT License
+ */
+
+#ifndef MICROSAFARI_WAVEFORM_H
+#define MICROSAFARI_WAVEFORM_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "MicroSafariAcquisition.h"
+
+#ifndef MICROSAFARI_WAVEFORM_SIZE
+#define MICROSAFARI_WAVEFORM_SIZE 1024
+#endif
+
+#if MICROSAFARI_WAVEFORM_SIZE < 64 || (MICROSAFARI_WAVEFORM_SIZE & (MICROSAFARI_WAVEFORM_SIZE - 1)) != 0
+#error "MICROSAFARI_WAVEFORM_SIZE must be a power of two of at least 64"
+#endif
+
+#ifndef MICROSAFARI_WAVEFORM_MAX_BANDS
+#define MICROSAFARI_WAVEFORM_MAX_BANDS 8
+#endif
+
+/** @brief Maximum band or prefix name length, including terminator */
+#define MICROSAFARI_WAVEFORM_NAME_LENGTH 16
+
+#if !defined(MICROSAFARI_WAVEFORM_NO_ESP_DSP) && defined(__has_include)
+#if __has_include(<esp_dsp.h>)
+#define MICROSAFARI_WAVEFORM_ESP_DSP 1
+#endif
+#endif
+
+/**
+ * @brief Features of one captured waveform
+ */
+struct MicroSafariWaveformFeatures {
+    float mean;                      ///< DC level, removed before the other features
+    float rms;                       ///< RMS of the signal without DC
+    float peak;                      ///< Largest deviation from the DC level
+    float crest;                     ///< Peak divided by RMS
+    float peakFrequency;             ///< Dominant frequency in Hz, interpolated between bins
+    float peakAmplitude;             ///< Amplitude of the dominant frequency
+    float bandEnergy[MICROSAFARI_WAVEFORM_MAX_BANDS]; ///< Mean square per band
+    uint32_t fftMicros;              ///< Time spent in the FFT
+    uint32_t computeMicros;          ///< Time spent in compute(), FFT included
+};
+
+/**
+ * @brief Fixed-size waveform buffer with FFT feature extraction
+ */
+class MicroSafariWaveform {
+private:
+    /**
+     * @brief Frequency band reported as energy
+     */
+    struct Band {
+        char name[MICROSAFARI_WAVEFORM_NAME_LENGTH]; ///< Name in payloads
+        float lowHz;                 ///< Lower edge, inclusive
+        float highHz;                ///< Upper edge, exclusive
+    };
+
+    float _work[MICROSAFARI_WAVEFORM_SIZE * 2]; ///< Interleaved complex samples, then the power spectrum
+    float _window[MICROSAFARI_WAVEFORM_SIZE]; ///< Hann window
+#ifndef MICROSAFARI_WAVEFORM_ESP_DSP
+    float _twiddle[MICROSAFARI_WAVEFORM_SIZE]; ///< cos and -sin of the first half circle
+#endif
+    float _windowSum;                ///< Sum of the window, for amplitudes
+    float _windowPower;              ///< Sum of the squared window, for energies
+    Band _bands[MICROSAFARI_WAVEFORM_MAX_BANDS]; ///< Reported bands
+    size_t _bandCount;               ///< Number of bands
+    char _prefix[MICROSAFARI_WAVEFORM_NAME_LENGTH]; ///< Metric name prefix
+    MicroSafariSampleSource* _source; ///< Optional sample source
+    uint8_t _pin;                    ///< Pin sampled by the source
+    float _scale;                    ///< Factor applied to raw source samples
+    float _sampleRate;               ///< Samples per second in the buffer
+    size_t _fill;                    ///< Samples in the buffer
+    bool _armed;                     ///< process() stores source samples
+    bool _ready;                     ///< Transform tables initialized
+    bool _computed;                  ///< _features and the spectrum are valid
+    MicroSafariWaveformFeatures _features; ///< Features of the last capture
+    uint32_t _captures;              ///< Waveforms computed
+
+    /**
+     * @brief Internal method to initialize window and transform tables
+     */
+    bool prepare(float sampleRateHz);
+
+    /**
+     * @brief Internal method to run the in-place FFT on _work
+     */
+    void transform();
+
+public:
+    /**
+     * @brief Constructor for MicroSafariWaveform
+     * @param prefix Metric name prefix in payloads (default: "vib")
+     */
+    MicroSafariWaveform(const char* prefix = "vib");
+
+    /**
+     * @brief Start with samples pushed by addSample()
+     * @param sampleRateHz Rate at which samples are pushed
+     * @return true if started, false if the rate is invalid
+     */
+    bool begin(float sampleRateHz);
+
+    /**
+     * @brief Start sampling one pin from a sample source
+     *
+     * The source produces sampleRateHz samples per second. For
+     * MicroSafariDmaAdcSource that is the conversion rate divided by its
+     * conversions per pin. The first capture starts right away.
+     *
+     * @param source Sample source, not started yet
+     * @param pin Analog pin
+     * @param sourceRateHz Rate passed to the source's begin()
+     * @param sampleRateHz Samples per second read from the source
+     * @param scale Factor applied to raw samples, e.g. g per count (default: 1.0)
+     * @return true if sampling started, false otherwise
+     */
+    bool begin(MicroSafariSampleSource* source,
+               uint8_t pin,
+               uint32_t sourceRateHz,
+               float sampleRateHz,
+               float scale = 1.0f);
+
+    /**
+     * @brief Stop the sample source
+     */
+    void end();
+
+    /**
+     * @brief Add a frequency band reported as energy
+     * @param name Band name, appended to the prefix in payloads
+     * @param lowHz Lower edge, inclusive
+     * @param highHz Upper edge, exclusive
+     * @return Band index, -1 if full or invalid
+     */
+    int addBand(const char* name, float lowHz, float highHz);
+
+    /**
+     * @brief Add one sample to the buffer
+     * @param value Sample value
+     * @return true if the buffer is full
+     */
+    bool addSample(float value);
+
+    /**
+     * @brief Start a new capture from the sample source
+     *
+     * Does nothing without a source; pushed samples are not discarded.
+     */
+    void start();
+
+    /**
+     * @brief Move samples from the source into the buffer
+     *
+     * Reads at most MICROSAFARI_WAVEFORM_SIZE samples per call and
+     * returns as soon as the capture is full. Samples read while no
+     * capture is running are discarded, so stale samples do not pile up
+     * in the source.
+     *
+     * @return true if the buffer is full
+     */
+    bool process();
+
+    /**
+     * @brief Check if the buffer is full
+     * @return true if compute() can run
+     */
+    bool isFull() const;
+
+    /**
+     * @brief Check if a capture from the source is running
+     * @return true while process() stores samples
+     */
+    bool isCapturing() const;
+
+    /**
+     * @brief Extract features from the full buffer and empty it
+     * @return true if computed, false if the buffer is not full
+     */
+    bool compute();
+
+    /**
+     * @brief Get features of the last compute()
+     * @return Reference to the features
+     */
+    const MicroSafariWaveformFeatures& getFeatures() const;
+
+    /**
+     * @brief Get the spectrum amplitude of a bin of the last compute()
+     *
+     * Valid until the next sample is added.
+     *
+     * @param bin Bin index, 0 to MICROSAFARI_WAVEFORM_SIZE / 2
+     * @return Amplitude, 0 if out of range or not computed
+     */
+    float getAmplitude(size_t bin) const;
+
+    /**
+     * @brief Get the frequency of a spectrum bin
+     * @param bin Bin index
+     * @return Frequency in Hz
+     */
+    float getBinFrequency(size_t bin) const;
+
+    /**
+     * @brief Write the features of the last compute() into a payload
+     *
+     * Keys are <prefix>_rms, _peak, _crest, _freq, _freq_amp and
+     * <prefix>_<band> for every band.
+     *
+     * @param payload JSON object to populate
+     * @return Number of values written, 0 if nothing was computed yet
+     */
+    size_t populate(JsonObject& payload) const;
+
+    /**
+     * @brief Get number of waveforms computed
+     * @return Capture count
+     */
+    uint32_t getCaptureCount() const;
+
+    /**
+     * @brief Get the FFT implementation in use
+     * @return "esp-dsp" or "portable"
+     */
+    static const char* getBackend();
+};
+
+#endif // MICROSAFARI_WAVEFORM_H